@@ -0,0 +1,47 @@
+// Per-sample cost of ActivityDebouncer for a growing number of tracked ids.
+// The work per sample is one hash lookup, so the time should stay flat until
+// the state table no longer fits in cache.
+//
+// Build and run from the repository root:
+//   c++ -std=c++14 -O2 -o debounce_bench bench/debounce_bench.cpp common/ActivityDebouncer.cpp
+//   ./debounce_bench
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../common/ActivityDebouncer.h"
+
+static const int SAMPLES = 2000000;
+
+int main() {
+  int64_t fakeNow = 0;
+  DebounceClock clock = [&fakeNow]() { return fakeNow; };
+
+  const int idCounts[] = {1, 16, 256, 4096, 65536};
+  for (int idCount : idCounts) {
+    ActivityDebouncer debouncer(DebounceConfig(), clock);
+    std::vector<std::string> ids;
+    for (int i = 0; i < idCount; i++) {
+      ids.push_back("device-" + std::to_string(i));
+    }
+
+    // Flapping input with 100 ms between samples, so every branch is hit.
+    int reported = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < SAMPLES; i++) {
+      fakeNow += 100;
+      bool active = (i / 7) % 3 != 0;
+      reported += debouncer.Sample(ids[size_t(i) % ids.size()], active);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+    printf("%6d ids: %6.1f ns/sample (%d reported active)\n", idCount,
+           double(elapsed) / SAMPLES, reported);
+  }
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Time to list installed apps on Linux from a synthetic tree of .desktop
+// files (several XDG roots, a subdirectory and shadowed ids), followed by the
+// real roots of the machine running it.
+//
+// Build and run from the repository root:
+//   c++ -std=gnu++17 -O2 -pthread -o desktop_entries_bench bench/desktop_entries_bench.cpp linux/DesktopEntries.cpp
+//   ./desktop_entries_bench [entries]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "../linux/DesktopEntries.h"
+
+static const int RUNS = 20;
+
+static void WriteEntry(const std::string &path, int i, bool hidden) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    return;
+  }
+  fprintf(file,
+          "# Generated by desktop_entries_bench\n"
+          "[Desktop Entry]\n"
+          "Version=1.0\n"
+          "Type=Application\n"
+          "Name=Bench App %d\n"
+          "Name[de]=Bench Anwendung %d\n"
+          "GenericName=Benchmark\n"
+          "Comment=A synthetic application used to time the desktop entry scanner\n"
+          "Exec=/usr/bin/bench-app-%d %%U\n"
+          "Icon=bench-app\n"
+          "Categories=Utility;Development;\n"
+          "MimeType=text/plain;text/x-c;\n"
+          "Keywords=bench;test;\n"
+          "X-AppVersion=%d.0\n"
+          "%s"
+          "\n"
+          "[Desktop Action new-window]\n"
+          "Name=New Window\n"
+          "Exec=/usr/bin/bench-app-%d --new-window\n",
+          i, i, i, i, hidden ? "Hidden=true\n" : "", i);
+  fclose(file);
+}
+
+static double TimeList(const std::vector<DesktopEntryRoot> &roots, size_t *count) {
+  double best = 1e9;
+  for (int run = 0; run < RUNS; run++) {
+    auto start = std::chrono::steady_clock::now();
+    *count = ListInstalledApps(roots).size();
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    best = ms < best ? ms : best;
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  int entries = argc > 1 ? atoi(argv[1]) : 4000;
+
+  char base[] = "/tmp/desktop-bench-XXXXXX";
+  if (mkdtemp(base) == nullptr) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  // 80% system entries, 10% in a vendor subdirectory, 10% user overrides of
+  // system ids, half of which hide the system entry.
+  std::string user = std::string(base) + "/user";
+  std::string systemDir = std::string(base) + "/system";
+  std::string vendor = systemDir + "/vendor";
+  mkdir(user.c_str(), 0755);
+  mkdir(systemDir.c_str(), 0755);
+  mkdir(vendor.c_str(), 0755);
+  for (int i = 0; i < entries; i++) {
+    if (i % 10 == 0) {
+      WriteEntry(vendor + "/app" + std::to_string(i) + ".desktop", i, false);
+    } else {
+      WriteEntry(systemDir + "/vendor-app" + std::to_string(i) + ".desktop", i, false);
+    }
+    if (i % 10 == 1) {
+      WriteEntry(user + "/vendor-app" + std::to_string(i) + ".desktop", i, i % 20 == 1);
+    }
+  }
+
+  std::vector<DesktopEntryRoot> roots = {{user, "desktop"}, {systemDir, "desktop"}};
+  size_t count = 0;
+  double ms = TimeList(roots, &count);
+  printf("synthetic: %d files -> %zu apps, best of %d: %.2f ms\n",
+         entries + entries / 10, count, RUNS, ms);
+
+  std::vector<DesktopEntryRoot> systemRoots = DesktopEntryRoots();
+  ms = TimeList(systemRoots, &count);
+  printf("this machine: %zu roots -> %zu apps, best of %d: %.2f ms\n",
+         systemRoots.size(), count, RUNS, ms);
+
+  std::string cleanup = std::string("rm -rf ") + base;
+  return system(cleanup.c_str()) == 0 ? 0 : 1;
+}
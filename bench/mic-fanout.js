@@ -0,0 +1,101 @@
+/**
+ * Fan-out benchmark for createMicMonitor (Linux only)
+ *
+ * Replaces PipeWire with a synthetic backend and pushes events through the
+ * single shared subscription to an increasing number of subscribers. Half of
+ * the subscribers ask for per-device events, so every event is filtered as
+ * well as delivered.
+ *
+ *   node bench/mic-fanout.js
+ */
+
+const utils = require("../index.js");
+
+if (process.platform !== "linux" || !utils.__internal) {
+  console.log("Fan-out benchmark only runs on Linux with the native module built");
+  process.exit(0);
+}
+
+const { useSyntheticMicBackend, injectMicEvents } = utils.__internal;
+
+const EVENTS = 20000;
+const CHUNK = 4096;
+const DEVICES = 3;
+
+function settled() {
+  const stats = utils.getMicMonitorStats();
+  return stats.delivered + stats.dropped + stats.coalesced >= stats.pushed;
+}
+
+function waitForDelivery() {
+  return new Promise((resolve) => {
+    const check = () => (settled() ? resolve() : setImmediate(check));
+    check();
+  });
+}
+
+async function run(subscribers) {
+  let calls = 0;
+  const callback = () => {
+    calls++;
+  };
+
+  const handles = [];
+  for (let i = 0; i < subscribers; i++) {
+    handles.push(
+      utils.createMicMonitor({
+        callback,
+        capacity: 65536,
+        devices: i % 2 === 0 ? undefined : ["*"],
+      })
+    );
+  }
+
+  const before = utils.getMicMonitorStats();
+  const started = process.hrtime.bigint();
+  for (let sent = 0; sent < EVENTS; sent += CHUNK) {
+    injectMicEvents({ count: Math.min(CHUNK, EVENTS - sent), devices: DEVICES });
+    await waitForDelivery();
+  }
+  const elapsedNs = Number(process.hrtime.bigint() - started);
+  const after = utils.getMicMonitorStats();
+
+  for (const handle of handles) {
+    handle.close();
+  }
+
+  return {
+    subscribers,
+    calls,
+    delivered: after.delivered - before.delivered,
+    dropped: after.dropped - before.dropped,
+    batches: after.batches - before.batches,
+    elapsedMs: elapsedNs / 1e6,
+    nsPerCall: calls > 0 ? elapsedNs / calls : 0,
+  };
+}
+
+async function main() {
+  useSyntheticMicBackend(true);
+
+  console.log(`Mic monitor fan-out, ${EVENTS} events over ${DEVICES} devices + aggregate`);
+  console.log("subscribers   callbacks   dropped   batches   total ms   ns/callback");
+  for (const subscribers of [1, 10, 100, 250, 500]) {
+    const result = await run(subscribers);
+    console.log(
+      [
+        String(result.subscribers).padStart(11),
+        String(result.calls).padStart(11),
+        String(result.dropped).padStart(9),
+        String(result.batches).padStart(9),
+        result.elapsedMs.toFixed(1).padStart(10),
+        result.nsPerCall.toFixed(0).padStart(13),
+      ].join(" ")
+    );
+  }
+
+  useSyntheticMicBackend(false);
+  console.log(`\nOpen subscriptions after close(): ${utils.getMicMonitorStats().subscribers}`);
+}
+
+main();
@@ -0,0 +1,464 @@
+/**
+ * Latency benchmark for the native exports
+ *
+ * Every query runs against synthetic backends at each requested scale (Linux
+ * only: a generated procfs tree, .desktop tree and PipeWire graph), and with
+ * --real once more against the machine itself. Each result is one JSON line
+ * on stdout, for trend tracking; a readable table goes to stderr.
+ *
+ *   npm run bench -- [--processes=100,1000,10000,50000] [--links=10,500,5000]
+ *                    [--apps=1000,5000] [--frames=720,2160] [--iterations=200]
+ *                    [--real] [--only=name]
+ *
+ * OCR runs on generated 16:9 text frames of each --frames height, on every
+ * platform whose build has a text recognition backend, passed as raw BGRA
+ * and as PNG (with and without the encode), and with each preprocessing
+ * variant. On Linux the preprocessing stage is also timed alone per kernel
+ * set (avx2, sse2, neon, scalar), with its input throughput in GB/s.
+ * OcrSession runs on the same frames, unchanged and with one line changing
+ * each call, against ocrImage on the whole frame; on Linux the sessions and
+ * raw ocrImage also run with the synthetic OCR engine (scale engine=synthetic),
+ * so tiling and reuse are timed without Tesseract.
+ *
+ * The executor benches time getRunningProcessesAsync idle and while bulk
+ * OCR jobs (synthetic engine, 2160p) keep every bulk thread busy and more
+ * waiting, with the p99 time its jobs waited for a thread.
+ *
+ * Latency is per call, including the conversion to JS values; for promise
+ * variants it is the time until the promise settles. cpuUsPerCall is the
+ * process CPU time per call, worker threads included. heapBytesPerCall is the
+ * JS heap growth of one call right after a full GC, i.e. the result and the
+ * garbage made building it.
+ */
+
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const v8 = require("v8");
+const vm = require("vm");
+
+v8.setFlagsFromString("--expose-gc");
+const gc = vm.runInNewContext("gc");
+
+const utils = require("../index.js");
+const { makeProcTree, makeDesktopTree, makeGraph, makeTextFrame, encodePng } = require("./synthetic.js");
+
+function parseArgs() {
+  const options = {
+    processes: [100, 1000, 10000],
+    links: [10, 500, 5000],
+    apps: [1000, 5000],
+    frames: [720, 2160],
+    iterations: 200,
+    real: false,
+    only: null,
+  };
+  for (const arg of process.argv.slice(2)) {
+    const [key, value] = arg.replace(/^--/, "").split("=");
+    if (key === "real") {
+      options.real = true;
+    } else if (key === "only") {
+      options.only = value;
+    } else if (key === "iterations") {
+      options.iterations = Number(value);
+    } else if (key in options) {
+      options[key] = value.split(",").map(Number);
+    } else {
+      console.error(`Unknown option ${arg}`);
+      process.exit(1);
+    }
+  }
+  return options;
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+// Median JS heap growth of single calls made right after a full GC
+async function heapBytesPerCall(fn, samples) {
+  const growth = [];
+  let result = null;
+  for (let i = 0; i < samples; i++) {
+    result = null;
+    gc();
+    const before = v8.getHeapStatistics().used_heap_size;
+    result = await fn();
+    growth.push(v8.getHeapStatistics().used_heap_size - before);
+  }
+  growth.sort((a, b) => a - b);
+  return Math.max(0, percentile(growth, 0.5));
+}
+
+async function measure(name, scale, fn, iterations) {
+  // Warm caches (path cache, installed app index) and the JIT first
+  for (let i = 0; i < Math.min(10, iterations); i++) {
+    await fn();
+  }
+
+  const timings = new Float64Array(iterations);
+  const cpu = process.cpuUsage();
+  for (let i = 0; i < iterations; i++) {
+    const started = process.hrtime.bigint();
+    const result = fn();
+    if (result instanceof Promise) {
+      await result;
+    }
+    timings[i] = Number(process.hrtime.bigint() - started) / 1000;
+  }
+  const cpuUsed = process.cpuUsage(cpu);
+  timings.sort();
+
+  let total = 0;
+  for (const t of timings) {
+    total += t;
+  }
+  return {
+    bench: name,
+    scale,
+    platform: process.platform,
+    iterations,
+    p50Us: +percentile(timings, 0.5).toFixed(1),
+    p99Us: +percentile(timings, 0.99).toFixed(1),
+    maxUs: +timings[timings.length - 1].toFixed(1),
+    meanUs: +(total / iterations).toFixed(1),
+    cpuUsPerCall: +((cpuUsed.user + cpuUsed.system) / iterations).toFixed(1),
+    heapBytesPerCall: await heapBytesPerCall(fn, Math.min(20, iterations)),
+  };
+}
+
+const results = [];
+
+// `extra`, when given, returns fields added to the result once timed
+async function run(options, name, scale, fn, extra) {
+  if (options.only && !name.includes(options.only)) {
+    return;
+  }
+  // Scans of 50k entries take long enough that fewer calls suffice, and OCR
+  // takes long enough that a handful does
+  const weight = Math.max(1, (scale.processes || scale.apps || 0) / 5000);
+  const iterations = scale.height
+    ? Math.max(3, Math.round(options.iterations / 40))
+    : Math.max(20, Math.round(options.iterations / weight));
+  const result = await measure(name, scale, fn, iterations);
+  Object.assign(result, extra ? extra() : {});
+  results.push(result);
+  console.log(JSON.stringify(result));
+}
+
+// Not implemented on every platform; reported as skipped rather than timing
+// the JS no-op.
+function skip(options, name, reason) {
+  if (options.only && !name.includes(options.only)) {
+    return;
+  }
+  console.log(JSON.stringify({ bench: name, platform: process.platform, skipped: reason }));
+}
+
+async function processBenches(options, scale) {
+  let generation = 0;
+  await run(options, "getRunningProcesses", scale, () => utils.getRunningProcesses());
+  await run(options, "getRunningProcessesAsync", scale, () => utils.getRunningProcessesAsync());
+  // Same scan returned as one ArrayBuffer; compare heapBytesPerCall
+  await run(options, "getRunningProcessesPacked", scale, () => utils.getRunningProcesses({ packed: true }));
+  await run(options, "getRunningProcessesPackedAsync", scale, () =>
+    utils.getRunningProcessesAsync({ packed: true })
+  );
+  await run(options, "getRunningProcessesDelta", scale, () => {
+    const delta = utils.getRunningProcessesDelta(generation);
+    generation = delta.generation;
+    return delta;
+  });
+  if (process.platform === "linux") {
+    // One executable in 500 (bench-app-7 in the synthetic tree), filtered in
+    // JS after a full scan versus during the scan
+    const pattern = /\/bench-app-7$/;
+    await run(options, "getRunningProcessesFilteredInJs", scale, () =>
+      utils.getRunningProcesses().filter((path) => pattern.test(path))
+    );
+    await run(options, "getRunningProcessesFilteredByName", scale, () =>
+      utils.getRunningProcesses({ filter: { name: "^bench-app-7$" } })
+    );
+    await run(options, "getRunningProcessesFilteredByExe", scale, () =>
+      utils.getRunningProcesses({ filter: { exe: "*/bench-app-7" } })
+    );
+    await run(options, "getRunningProcessesFilteredByUid", scale, () =>
+      utils.getRunningProcesses({ filter: { uid: os.userInfo().uid } })
+    );
+    // Columns: stat only, then every field
+    await run(options, "getProcessesPpid", scale, () => utils.getProcesses({ fields: ["ppid"] }));
+    await run(options, "getProcessesAllFields", scale, () =>
+      utils.getProcesses({
+        fields: ["ppid", "exe", "cmdline", "uid", "startTime", "rss", "cpuTime"],
+      })
+    );
+    skip(options, "getRunningAppIDs", "not implemented on linux");
+  } else {
+    await run(options, "getRunningAppIDs", scale, () => utils.getRunningAppIDs());
+    await run(options, "getRunningAppIDsPacked", scale, () => utils.getRunningAppIDs({ packed: true }));
+  }
+}
+
+async function appBenches(options, scale) {
+  await run(options, "listInstalledApps", scale, () => utils.listInstalledApps());
+  await run(options, "listInstalledAppsAsync", scale, () => utils.listInstalledAppsAsync());
+}
+
+async function audioBenches(options, scale) {
+  await run(options, "getRunningInputAudioProcesses", scale, () => utils.getRunningInputAudioProcesses());
+  await run(options, "getProcessesAccessingMicrophoneWithResult", scale, () =>
+    utils.getProcessesAccessingMicrophoneWithResult()
+  );
+  await run(options, "getProcessesAccessingMicrophoneWithResultAsync", scale, () =>
+    utils.getProcessesAccessingMicrophoneWithResultAsync()
+  );
+  await run(options, "getProcessesAccessingMicrophoneDebouncedWithResult", scale, () =>
+    utils.getProcessesAccessingMicrophoneDebouncedWithResult()
+  );
+  await run(options, "getProcessesAccessingSpeakersWithResult", scale, () =>
+    utils.getProcessesAccessingSpeakersWithResult()
+  );
+  await run(options, "getProcessesAccessingSpeakersWithResultAsync", scale, () =>
+    utils.getProcessesAccessingSpeakersWithResultAsync()
+  );
+}
+
+async function ocrBenches(options) {
+  if (!utils.ocrImage) {
+    skip(options, "ocrImage", `not implemented on ${process.platform}`);
+    return;
+  }
+  const internal = process.platform === "linux" ? utils.__internal : null;
+  for (const height of options.frames) {
+    const width = Math.round((height * 16) / 9);
+    const frame = makeTextFrame(width, height);
+    const probe = await utils.ocrImage(frame);
+    if (!probe.success) {
+      skip(options, "ocrImage", probe.error);
+    } else {
+      const scale = { backend: "synthetic", width, height };
+      // What the capture pipeline paid before raw frames were accepted: a PNG
+      // encode in JS and a decode in the addon
+      await run(options, "ocrImagePngEncode", scale, () => utils.ocrImage(encodePng(frame)));
+      const png = encodePng(frame);
+      await run(options, "ocrImagePng", scale, () => utils.ocrImage(png));
+      await run(options, "ocrImageRaw", scale, () => utils.ocrImage(frame));
+      await run(options, "ocrImageRawNoPreprocess", scale, () => utils.ocrImage(frame, { preprocess: false }));
+      await run(options, "ocrImageRawDownscale2", scale, () =>
+        utils.ocrImage(frame, { preprocess: { downscale: 2 } })
+      );
+      await run(options, "ocrImageRawBinarize", scale, () =>
+        utils.ocrImage(frame, { preprocess: { binarize: true } })
+      );
+      await sessionBenches(options, scale, width, height);
+    }
+    if (internal) {
+      const scale = { backend: "synthetic", engine: "synthetic", width, height };
+      internal.useSyntheticOCRBackend(true);
+      try {
+        await run(options, "ocrImageRaw", scale, () => utils.ocrImage(frame));
+        await sessionBenches(options, scale, width, height);
+      } finally {
+        internal.useSyntheticOCRBackend(false);
+      }
+    }
+  }
+}
+
+// OcrSession on a still window, on one whose third line changes every call,
+// and from scratch (what its first frame costs); results carry the share of
+// tiles that reused cached text
+async function sessionBenches(options, scale, width, height) {
+  const still = makeTextFrame(width, height);
+  const versions = [makeTextFrame(width, height, [2], 1), makeTextFrame(width, height, [2], 2)];
+  for (const [name, next, reset] of [
+    ["ocrSessionStatic", () => still, false],
+    ["ocrSessionOneLineChanged", (i) => versions[i % 2], false],
+    ["ocrSessionFirstFrame", () => still, true],
+  ]) {
+    const session = utils.createOcrSession();
+    let calls = 0;
+    let tiles = 0;
+    let recognized = 0;
+    await run(
+      options,
+      name,
+      scale,
+      async () => {
+        if (reset) {
+          session.reset();
+        }
+        const result = await session.recognize(next(calls++));
+        tiles += result.tiles;
+        recognized += result.recognizedTiles;
+        return result;
+      },
+      () => ({ tileReuse: tiles ? +(1 - recognized / tiles).toFixed(3) : 0 })
+    );
+    session.close();
+  }
+}
+
+// The preprocessing stage alone, per kernel set; reports input GB/s from
+// the native time of each pass
+async function preprocessBenches(options) {
+  const internal = utils.__internal;
+  for (const height of options.frames) {
+    const width = Math.round((height * 16) / 9);
+    const frame = makeTextFrame(width, height);
+    for (const kernel of internal.imageKernels()) {
+      for (const [variant, preprocess] of [
+        ["Gray", {}],
+        ["Downscale2", { downscale: 2 }],
+        ["Binarize", { binarize: true }],
+      ]) {
+        const name = `preprocessImage${variant}`;
+        if (options.only && !name.includes(options.only)) {
+          continue;
+        }
+        const ns = [];
+        const result = await measure(name, { backend: "synthetic", width, height, kernel }, () => {
+          ns.push(internal.preprocessImage(frame, { ...preprocess, kernel }).ns);
+        }, Math.max(10, Math.round(options.iterations / 10)));
+        ns.sort((a, b) => a - b);
+        result.gbPerSec = +(frame.data.length / percentile(ns, 0.5)).toFixed(2);
+        results.push(result);
+        console.log(JSON.stringify(result));
+      }
+    }
+  }
+}
+
+// An interactive query alone, then with twice as many OCR jobs in flight as
+// there are bulk threads
+async function executorBenches(options) {
+  const internal = utils.__internal;
+  const frame = makeTextFrame(3840, 2160);
+  internal.useSyntheticOCRBackend(true);
+  try {
+    await utils.getRunningProcessesAsync();
+    const bulkJobs = utils.getExecutorStats().bulkThreads * 2;
+    for (const [name, load] of [
+      ["executorInteractiveIdle", 0],
+      ["executorInteractiveUnderBulkLoad", bulkJobs],
+    ]) {
+      if (options.only && !name.includes(options.only)) {
+        continue;
+      }
+      let loading = true;
+      const pumps = [];
+      for (let i = 0; i < load; i++) {
+        pumps.push(
+          (async () => {
+            while (loading) {
+              await utils.ocrImage(frame);
+            }
+          })()
+        );
+      }
+      utils.resetNativeStats();
+      await run(
+        options,
+        name,
+        { backend: "synthetic", bulkJobs: load },
+        () => utils.getRunningProcessesAsync(),
+        () => {
+          const wait = utils.getNativeStats().exports["executor.interactive:wait"];
+          return { interactiveWaitP99Us: wait ? +(wait.p99Ns / 1000).toFixed(1) : 0 };
+        }
+      );
+      loading = false;
+      await Promise.all(pumps);
+    }
+  } finally {
+    internal.useSyntheticOCRBackend(false);
+  }
+}
+
+async function syntheticBenches(options) {
+  const internal = utils.__internal;
+  const base = fs.mkdtempSync(path.join(os.tmpdir(), "node-mac-utils-bench-"));
+  const savedEnv = { ...process.env };
+
+  try {
+    for (const count of options.processes) {
+      const root = path.join(base, "proc");
+      makeProcTree(root, count);
+      internal.setProcRoot(root);
+      await processBenches(options, { backend: "synthetic", processes: count });
+    }
+    internal.setProcRoot(null);
+
+    for (const count of options.apps) {
+      // Roots and the index location are read from the environment per call
+      Object.assign(process.env, makeDesktopTree(path.join(base, "apps"), count));
+      await appBenches(options, { backend: "synthetic", apps: count });
+    }
+    for (const key of ["XDG_DATA_HOME", "XDG_DATA_DIRS", "XDG_CACHE_HOME"]) {
+      if (key in savedEnv) {
+        process.env[key] = savedEnv[key];
+      } else {
+        delete process.env[key];
+      }
+    }
+
+    for (const count of options.links) {
+      internal.loadSyntheticGraph(makeGraph(count));
+      await audioBenches(options, { backend: "synthetic", links: count });
+    }
+    internal.loadSyntheticGraph(null);
+
+    await preprocessBenches(options);
+    await executorBenches(options);
+  } finally {
+    fs.rmSync(base, { recursive: true, force: true });
+  }
+}
+
+async function main() {
+  const options = parseArgs();
+
+  if (process.platform === "linux" && utils.__internal) {
+    await syntheticBenches(options);
+  } else {
+    console.error("Synthetic backends are Linux only; running against this machine");
+    options.real = true;
+  }
+
+  if (options.real) {
+    const scale = { backend: "real" };
+    await processBenches(options, scale);
+    await appBenches(options, scale);
+    await audioBenches(options, scale);
+  }
+  await ocrBenches(options);
+
+  console.error("");
+  console.error(
+    "bench".padEnd(52) +
+      "scale".padEnd(40) +
+      "p50 µs".padStart(10) +
+      "p99 µs".padStart(10) +
+      "max µs".padStart(10) +
+      "cpu µs".padStart(10) +
+      "heap B".padStart(10) +
+      "GB/s".padStart(8)
+  );
+  for (const r of results) {
+    const scale = Object.entries(r.scale)
+      .map(([key, value]) => (key === "backend" ? value : `${key}=${value}`))
+      .join(" ");
+    console.error(
+      r.bench.padEnd(52) +
+        scale.padEnd(40) +
+        String(r.p50Us).padStart(10) +
+        String(r.p99Us).padStart(10) +
+        String(r.maxUs).padStart(10) +
+        String(r.cpuUsPerCall).padStart(10) +
+        String(r.heapBytesPerCall).padStart(10) +
+        String(r.gbPerSec === undefined ? "" : r.gbPerSec).padStart(8)
+    );
+  }
+}
+
+main();
@@ -0,0 +1,282 @@
+/**
+ * Deterministic fake backends for bench/run.js (Linux only): a procfs tree,
+ * an XDG tree of .desktop files and a PipeWire graph, plus text frames for
+ * OCR. The same scale always produces the same data, so runs on different
+ * machines are comparable.
+ */
+
+const fs = require("fs");
+const path = require("path");
+
+// Distinct executables; processes beyond this share paths, as on a real box
+const EXECUTABLES = 500;
+const KERNEL_THREAD_FLAG = 0x00200000;
+
+function statLine(pid, name, ppid, flags, startTime) {
+  // Fields 1-22 of /proc/<pid>/stat; the scanner reads ppid (4), flags (9)
+  // and start time (22).
+  const fields = [pid, `(${name})`, "S", ppid, pid, pid, 0, -1, flags];
+  while (fields.length < 21) {
+    fields.push(0);
+  }
+  fields.push(startTime);
+  return fields.join(" ") + "\n";
+}
+
+// Writes `count` processes (plus a few kernel threads and the non-PID
+// entries procfs also has) under `root`.
+function makeProcTree(root, count) {
+  fs.rmSync(root, { recursive: true, force: true });
+  fs.mkdirSync(root, { recursive: true });
+  for (const name of ["self", "sys", "thread-self"]) {
+    fs.mkdirSync(path.join(root, name));
+  }
+
+  const kernelThreads = Math.min(32, Math.ceil(count / 100));
+  for (let i = 0; i < count + kernelThreads; i++) {
+    const pid = 100 + i;
+    const dir = path.join(root, String(pid));
+    fs.mkdirSync(dir);
+    if (i >= count) {
+      fs.writeFileSync(path.join(dir, "stat"), statLine(pid, `kworker/${i}`, 2, KERNEL_THREAD_FLAG, 10 + i));
+      continue;
+    }
+    const name = `bench-app-${i % EXECUTABLES}`;
+    fs.writeFileSync(path.join(dir, "stat"), statLine(pid, name, 1, 0, 1000 + i));
+    // Only the link text is read, the target does not have to exist
+    fs.symlinkSync(`/usr/bin/${name}`, path.join(dir, "exe"));
+  }
+}
+
+// Writes `count` .desktop files split over a data home and one data dir, and
+// returns the environment that points listInstalledApps() at them.
+function makeDesktopTree(root, count) {
+  fs.rmSync(root, { recursive: true, force: true });
+  const home = path.join(root, "home", "applications");
+  const system = path.join(root, "system", "applications");
+  fs.mkdirSync(home, { recursive: true });
+  fs.mkdirSync(path.join(system, "vendor"), { recursive: true });
+
+  for (let i = 0; i < count; i++) {
+    const dir = i % 10 === 0 ? home : i % 10 === 1 ? path.join(system, "vendor") : system;
+    fs.writeFileSync(
+      path.join(dir, `org.bench.App${i}.desktop`),
+      "[Desktop Entry]\n" +
+        "Type=Application\n" +
+        `Name=Bench App ${i}\n` +
+        `Comment=Synthetic entry ${i} for the benchmark\n` +
+        `Exec=/usr/bin/bench-app-${i} %U\n` +
+        "Categories=Utility;\n" +
+        (i % 25 === 0 ? "NoDisplay=true\n" : "") +
+        "\n[Desktop Action New]\nName=New Window\nExec=/usr/bin/bench-app --new\n"
+    );
+  }
+
+  return {
+    XDG_DATA_HOME: path.join(root, "home"),
+    XDG_DATA_DIRS: path.join(root, "system"),
+    XDG_CACHE_HOME: path.join(root, "cache"),
+  };
+}
+
+// A graph with `links` node-to-node links: one capture and one playback
+// device per 50 links, and app streams that each record from a source or
+// play to a sink. Returns the spec for __internal.loadSyntheticGraph().
+function makeGraph(links) {
+  const devices = Math.max(1, Math.ceil(links / 50));
+  const nodes = [];
+  const edges = [];
+  let id = 1000;
+
+  const sources = [];
+  const sinks = [];
+  for (let i = 0; i < devices; i++) {
+    sources.push(id);
+    nodes.push({
+      id: id++,
+      props: {
+        "node.name": `alsa_input.bench-${i}`,
+        "node.description": `Bench Microphone ${i}`,
+        "media.class": "Audio/Source",
+      },
+    });
+    sinks.push(id);
+    nodes.push({
+      id: id++,
+      props: {
+        "node.name": `alsa_output.bench-${i}`,
+        "node.description": `Bench Speakers ${i}`,
+        "media.class": "Audio/Sink",
+      },
+    });
+  }
+
+  for (let i = 0; i < links; i++) {
+    const app = id++;
+    const capture = i % 2 === 0;
+    nodes.push({
+      id: app,
+      props: {
+        "node.name": `bench-app-${i % EXECUTABLES}`,
+        "application.name": `Bench App ${i % EXECUTABLES}`,
+        "application.process.id": String(100 + i),
+        "media.class": capture ? "Stream/Input/Audio" : "Stream/Output/Audio",
+      },
+    });
+    const device = (capture ? sources : sinks)[i % devices];
+    edges.push(capture ? { id: id++, output: device, input: app } : { id: id++, output: app, input: device });
+  }
+
+  return { nodes, links: edges };
+}
+
+// 5x7 glyphs, one bit per pixel row by row, for text that OCR engines read
+// without any font files.
+const GLYPHS = {
+  A: "01110100011000111111100011000110001",
+  B: "11110100011000111110100011000111110",
+  C: "01110100011000010000100001000101110",
+  D: "11110100011000110001100011000111110",
+  E: "11111100001000011110100001000011111",
+  F: "11111100001000011110100001000010000",
+  G: "01110100011000010111100011000101111",
+  H: "10001100011000111111100011000110001",
+  I: "01110001000010000100001000010001110",
+  J: "00111000100001000010000101001001100",
+  K: "10001100101010011000101001001010001",
+  L: "10000100001000010000100001000011111",
+  M: "10001110111010110101100011000110001",
+  N: "10001100011100110101100111000110001",
+  O: "01110100011000110001100011000101110",
+  P: "11110100011000111110100001000010000",
+  Q: "01110100011000110001101011001001101",
+  R: "11110100011000111110101001001010001",
+  S: "01111100001000001110000010000111110",
+  T: "11111001000010000100001000010000100",
+  U: "10001100011000110001100011000101110",
+  V: "10001100011000110001100010101000100",
+  W: "10001100011000110101101011010101010",
+  X: "10001100010101000100010101000110001",
+  Y: "10001100010101000100001000010000100",
+  Z: "11111000010001000100010001000011111",
+  0: "01110100011001110101110011000101110",
+  1: "00100011000010000100001000010001110",
+  2: "01110100010000100010001000100011111",
+  3: "11111000100010000010000011000101110",
+  4: "00010001100101010010111110001000010",
+  5: "11111100001111000001000011000101110",
+  6: "00110010001000011110100011000101110",
+  7: "11111000010001000100010000100001000",
+  8: "01110100011000101110100011000101110",
+  9: "01110100011000101111000010001001100",
+};
+const GLYPH_SCALE = 3;
+const GLYPH_ADVANCE = 6 * GLYPH_SCALE;
+const LINE_HEIGHT = 12 * GLYPH_SCALE;
+const MARGIN = 24;
+
+function drawText(frame, x, y, text) {
+  for (const ch of text) {
+    const glyph = GLYPHS[ch];
+    if (glyph) {
+      for (let bit = 0; bit < 35; bit++) {
+        if (glyph[bit] !== "1") {
+          continue;
+        }
+        const px = x + (bit % 5) * GLYPH_SCALE;
+        const py = y + Math.floor(bit / 5) * GLYPH_SCALE;
+        for (let dy = 0; dy < GLYPH_SCALE; dy++) {
+          const row = (py + dy) * frame.stride;
+          for (let dx = 0; dx < GLYPH_SCALE; dx++) {
+            frame.data.fill(0, row + (px + dx) * 4, row + (px + dx) * 4 + 3);
+          }
+        }
+      }
+    }
+    x += GLYPH_ADVANCE;
+  }
+}
+
+// The words on line `line` of a frame; `version` changes them.
+function lineText(line, version, columns) {
+  const words = [];
+  let seed = (line + 1) * 2654435761 + version * 40503;
+  let length = 0;
+  while (true) {
+    seed = (seed * 1103515245 + 12345) >>> 0;
+    const word = "BENCH" + (seed % 100000).toString(36).toUpperCase();
+    if (length + word.length + 1 > columns) {
+      break;
+    }
+    words.push(word);
+    length += word.length + 1;
+  }
+  return words.join(" ");
+}
+
+// A white BGRA frame of black text lines, like a screenshot of a document.
+// Lines listed in `changed` get other words, for dirty-region tests.
+function makeTextFrame(width, height, changed = [], version = 1) {
+  const stride = width * 4;
+  const frame = { width, height, stride, format: "bgra", data: Buffer.alloc(stride * height, 0xff) };
+  const columns = Math.floor((width - 2 * MARGIN) / GLYPH_ADVANCE);
+  for (let line = 0; MARGIN + (line + 1) * LINE_HEIGHT <= height; line++) {
+    drawText(frame, MARGIN, MARGIN + line * LINE_HEIGHT, lineText(line, changed.includes(line) ? version : 0, columns));
+  }
+  return frame;
+}
+
+const CRC_TABLE = Array.from({ length: 256 }, (_, n) => {
+  let c = n;
+  for (let k = 0; k < 8; k++) {
+    c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+  }
+  return c >>> 0;
+});
+
+function crc32(buffer) {
+  let c = 0xffffffff;
+  for (const byte of buffer) {
+    c = CRC_TABLE[(c ^ byte) & 0xff] ^ (c >>> 8);
+  }
+  return (c ^ 0xffffffff) >>> 0;
+}
+
+function pngChunk(type, data) {
+  const length = Buffer.alloc(4);
+  length.writeUInt32BE(data.length);
+  const body = Buffer.concat([Buffer.from(type, "ascii"), data]);
+  const crc = Buffer.alloc(4);
+  crc.writeUInt32BE(crc32(body));
+  return Buffer.concat([length, body, crc]);
+}
+
+// Encodes a BGRA frame as an RGBA PNG, the way the capture pipeline does
+// before handing it to ocrImage().
+function encodePng(frame) {
+  const zlib = require("zlib");
+  const raw = Buffer.alloc((frame.width * 4 + 1) * frame.height);
+  for (let y = 0; y < frame.height; y++) {
+    const out = y * (frame.width * 4 + 1);
+    for (let x = 0; x < frame.width; x++) {
+      const i = y * frame.stride + x * 4;
+      const o = out + 1 + x * 4;
+      raw[o] = frame.data[i + 2];
+      raw[o + 1] = frame.data[i + 1];
+      raw[o + 2] = frame.data[i];
+      raw[o + 3] = frame.data[i + 3];
+    }
+  }
+  const header = Buffer.alloc(13);
+  header.writeUInt32BE(frame.width, 0);
+  header.writeUInt32BE(frame.height, 4);
+  header.set([8, 6, 0, 0, 0], 8);
+  return Buffer.concat([
+    Buffer.from([0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a]),
+    pngChunk("IHDR", header),
+    pngChunk("IDAT", zlib.deflateSync(raw)),
+    pngChunk("IEND", Buffer.alloc(0)),
+  ]);
+}
+
+module.exports = { makeProcTree, makeDesktopTree, makeGraph, makeTextFrame, encodePng };
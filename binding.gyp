@@ -12,6 +12,23 @@
           "macOS/ScreenCapturePermissions.m",
           "macOS/ProcessUtils.mm",
           "macOS/ImageOCR.mm",
+          "common/Executor.cpp",
+          "common/ExecutorExports.cpp",
+          "common/ImageKernels.cpp",
+          "common/ImageKernelsNeon.cpp",
+          "common/ImageKernelsX86.cpp",
+          "common/ImagePreprocess.cpp",
+          "common/Marshal.cpp",
+          "common/MicMonitorHub.cpp",
+          "common/NativeStats.cpp",
+          "common/NativeStatsExports.cpp",
+          "common/OCRExports.cpp",
+          "common/OCRSession.cpp",
+          "common/PackedStrings.cpp",
+          "common/ProcessSnapshot.cpp",
+          "common/ProcessPathCache.cpp",
+          "common/ProcessTree.cpp",
+          "common/SyntheticOCR.cpp",
         ],
         "xcode_settings": {
           "OTHER_CFLAGS": ["-fobjc-arc"]
@@ -34,7 +51,8 @@
         "-framework CoreFoundation",
         "-framework AppKit",
         "-framework AudioToolbox",
-        "-framework AVFoundation"
+        "-framework AVFoundation",
+        "-framework Vision"
       ]
     }
   }, {
@@ -45,7 +63,17 @@
         "sources": [
           "windows/win_utils.cpp",
           "windows/AudioProcessMonitor.cpp",
-          "windows/MSIXTools.cpp"
+          "windows/MSIXTools.cpp",
+          "common/ActivityDebouncer.cpp",
+          "common/Executor.cpp",
+          "common/ExecutorExports.cpp",
+          "common/Marshal.cpp",
+          "common/NativeStats.cpp",
+          "common/NativeStatsExports.cpp",
+          "common/PackedStrings.cpp",
+          "common/ProcessSnapshot.cpp",
+          "common/ProcessPathCache.cpp",
+          "common/ProcessTree.cpp"
         ]
       }]
     ],
@@ -63,5 +91,64 @@
         'AdditionalOptions': ['/EHsc']
       }
     }
+  }, {
+    "target_name": "linux_utils",
+    "sources": [ ],
+    "conditions": [
+      ['OS=="linux"', {
+        "sources": [
+          "linux/linux_utils.cpp",
+          "linux/ProcessUtils.cpp",
+          "linux/ProcessWatcher.cpp",
+          "linux/DesktopEntries.cpp",
+          "linux/AppIndex.cpp",
+          "linux/PipeWireConnection.cpp",
+          "linux/PipeWireGraph.cpp",
+          "linux/PipeWireMonitor.cpp",
+          "linux/MicTimelineRecorder.cpp",
+          "linux/TesseractOCR.cpp",
+          "common/ActivityDebouncer.cpp",
+          "common/Executor.cpp",
+          "common/ExecutorExports.cpp",
+          "common/ImageKernels.cpp",
+          "common/ImageKernelsNeon.cpp",
+          "common/ImageKernelsX86.cpp",
+          "common/ImagePreprocess.cpp",
+          "common/Marshal.cpp",
+          "common/MicMonitorHub.cpp",
+          "common/MicTimeline.cpp",
+          "common/NativeStats.cpp",
+          "common/NativeStatsExports.cpp",
+          "common/OCRExports.cpp",
+          "common/OCRSession.cpp",
+          "common/PackedStrings.cpp",
+          "common/ProcessSnapshot.cpp",
+          "common/ProcessPathCache.cpp",
+          "common/ProcessTree.cpp",
+          "common/SyntheticOCR.cpp"
+        ],
+        "cflags": [
+          # PipeWire is optional; without it the microphone and speaker
+          # queries and monitors report that PipeWire is not available, and
+          # the process and app queries work as usual.
+          "<!@(pkg-config --cflags libpipewire-0.3 2>/dev/null && echo -DHAVE_PIPEWIRE || true)",
+          # Tesseract is optional; without it ocrImage() reports that text
+          # recognition is not available.
+          "<!@(pkg-config --cflags tesseract lept 2>/dev/null && echo -DHAVE_TESSERACT || true)"
+        ],
+        "libraries": [
+          "<!@(pkg-config --libs libpipewire-0.3 2>/dev/null || true)",
+          "<!@(pkg-config --libs tesseract lept 2>/dev/null || true)"
+        ]
+      }]
+    ],
+    'include_dirs': [
+      "<!@(node -p \"require('node-addon-api').include\")"
+    ],
+    'libraries': [],
+    'dependencies': [
+      "<!(node -p \"require('node-addon-api').gyp\")"
+    ],
+    'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ]
   }]
 }
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+#include "ActivityDebouncer.h"
+
+int64_t SteadyClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+ActivityDebouncer::ActivityDebouncer(const DebounceConfig &config,
+                                     DebounceClock clock)
+    : config_(config), clock_(std::move(clock)) {}
+
+void ActivityDebouncer::SetConfig(const DebounceConfig &config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+}
+
+DebounceConfig ActivityDebouncer::Config() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return config_;
+}
+
+bool ActivityDebouncer::Sample(const std::string &id, bool active) {
+  return SampleOne(id, active, nullptr);
+}
+
+bool ActivityDebouncer::Sample(const std::string &id, bool active,
+                               const DebounceConfig &config) {
+  return SampleOne(id, active, &config);
+}
+
+bool ActivityDebouncer::SampleOne(const std::string &id, bool active,
+                                  const DebounceConfig *config) {
+  int64_t now = clock_();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = devices_.find(id);
+  if (it == devices_.end()) {
+    it = devices_.emplace(id, DeviceState(now)).first;
+  }
+  return SampleLocked(it->second, active, now, config != nullptr ? *config : config_);
+}
+
+bool ActivityDebouncer::SampleLocked(DeviceState &state, bool active,
+                                     int64_t now, const DebounceConfig &c) {
+  int64_t timeSinceLastChange = now - state.lastStateChange;
+  int64_t timeSinceRapidWindow = now - state.rapidStateChangeWindow;
+
+  // Reset rapid change counter if outside window
+  if (timeSinceRapidWindow > c.rapidChangeWindowMs) {
+    state.rapidStateChangeCount = 0;
+    state.rapidStateChangeWindow = now;
+  }
+
+  if (active) {
+    state.lastActivityTime = now;
+    state.hasActivity = true;
+  }
+  // Power management holdoff: a device that was active moments ago is still
+  // reported active. Nothing is held before the first active sample.
+  bool holding =
+      state.hasActivity && now - state.lastActivityTime < c.activeHoldMs;
+
+  // Extended debounce if the device is flapping
+  int64_t effectiveDebounceMs = state.rapidStateChangeCount >= c.maxRapidChanges
+                                    ? c.extendedDebounceMs
+                                    : c.debounceMs;
+
+  if (active != state.lastActiveState) {
+    state.rapidStateChangeCount++;
+    if (active) {
+      // Going from inactive to active
+      state.consecutiveActiveChecks++;
+      state.consecutiveInactiveChecks = 0;
+      if (state.consecutiveActiveChecks >= c.requiredActiveChecks) {
+        state.lastActiveState = true;
+        state.lastReportedState = true;
+        state.lastStateChange = now;
+        return true;
+      }
+      // Still building confidence
+      return state.lastReportedState;
+    }
+
+    // Going from active to inactive
+    state.consecutiveInactiveChecks++;
+    state.consecutiveActiveChecks = 0;
+    if (holding) {
+      return true;
+    }
+    if (timeSinceLastChange < effectiveDebounceMs) {
+      return state.lastReportedState;
+    }
+    if (state.consecutiveInactiveChecks >= c.requiredInactiveChecks) {
+      state.lastActiveState = false;
+      state.lastReportedState = false;
+      state.lastStateChange = now;
+      return false;
+    }
+    return state.lastReportedState;
+  }
+
+  // Same raw state as the previous sample
+  if (active) {
+    state.consecutiveInactiveChecks = 0;
+    state.consecutiveActiveChecks = std::min(state.consecutiveActiveChecks + 1,
+                                             c.requiredActiveChecks + 1);
+    if (state.consecutiveActiveChecks >= c.requiredActiveChecks) {
+      state.lastReportedState = true;
+    }
+    return state.lastReportedState;
+  }
+
+  if (holding) {
+    return true;
+  }
+  state.consecutiveActiveChecks = 0;
+  state.consecutiveInactiveChecks = std::min(
+      state.consecutiveInactiveChecks + 1, c.requiredInactiveChecks + 1);
+  return state.lastReportedState;
+}
+
+std::vector<std::string>
+ActivityDebouncer::SampleSet(const std::vector<std::string> &activeIds) {
+  return SampleAll(activeIds, nullptr);
+}
+
+std::vector<std::string>
+ActivityDebouncer::SampleSet(const std::vector<std::string> &activeIds,
+                             const DebounceConfig &config) {
+  return SampleAll(activeIds, &config);
+}
+
+std::vector<std::string>
+ActivityDebouncer::SampleAll(const std::vector<std::string> &activeIds,
+                             const DebounceConfig *config) {
+  int64_t now = clock_();
+  std::unordered_set<std::string> active(activeIds.begin(), activeIds.end());
+  std::vector<std::string> reported;
+  std::vector<std::string> held;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const DebounceConfig &c = config != nullptr ? *config : config_;
+  for (const auto &id : activeIds) {
+    if (devices_.find(id) == devices_.end()) {
+      devices_.emplace(id, DeviceState(now));
+    }
+  }
+
+  std::unordered_set<std::string> added;
+  for (auto it = devices_.begin(); it != devices_.end();) {
+    bool isActive = active.find(it->first) != active.end();
+    bool report = SampleLocked(it->second, isActive, now, c);
+    if (report && !isActive) {
+      held.push_back(it->first);
+    } else if (report) {
+      added.insert(it->first);
+    }
+
+    // Settled inactive and quiet long enough that no flapping history is
+    // lost by starting over.
+    const DeviceState &state = it->second;
+    if (!report && !isActive && !state.lastReportedState &&
+        now - state.lastStateChange > c.rapidChangeWindowMs &&
+        now - state.lastActivityTime > c.rapidChangeWindowMs) {
+      it = devices_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (const auto &id : activeIds) {
+    if (added.erase(id) > 0) {
+      reported.push_back(id);
+    }
+  }
+  std::sort(held.begin(), held.end());
+  reported.insert(reported.end(), held.begin(), held.end());
+
+  return reported;
+}
+
+void ActivityDebouncer::Forget(const std::string &id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  devices_.erase(id);
+}
+
+void ActivityDebouncer::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  devices_.clear();
+}
+
+size_t ActivityDebouncer::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return devices_.size();
+}
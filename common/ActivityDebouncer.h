@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Thresholds of the debouncer. The defaults are the values that were tuned
+// for Bluetooth power management on Windows.
+struct DebounceConfig {
+  // Minimum time between a reported change and going inactive again
+  int64_t debounceMs;
+  // Keep reporting active this long after the last active sample
+  int64_t activeHoldMs;
+  // Consecutive samples needed before reporting active / inactive
+  int requiredActiveChecks;
+  int requiredInactiveChecks;
+  // maxRapidChanges raw changes within rapidChangeWindowMs switch
+  // the debounce time to extendedDebounceMs
+  int64_t rapidChangeWindowMs;
+  int maxRapidChanges;
+  int64_t extendedDebounceMs;
+
+  DebounceConfig()
+      : debounceMs(3000), activeHoldMs(5000), requiredActiveChecks(2),
+        requiredInactiveChecks(4), rapidChangeWindowMs(10000),
+        maxRapidChanges(5), extendedDebounceMs(8000) {}
+};
+
+// Returns a monotonic time in milliseconds.
+typedef std::function<int64_t()> DebounceClock;
+
+int64_t SteadyClockMs();
+
+// Hysteresis for devices (or streams) whose raw activity flaps. Each id has
+// its own state; Sample() turns one raw observation into the state that
+// should be reported. Every call is a single hash lookup plus constant work.
+class ActivityDebouncer {
+public:
+  explicit ActivityDebouncer(const DebounceConfig &config = DebounceConfig(),
+                             DebounceClock clock = SteadyClockMs);
+
+  void SetConfig(const DebounceConfig &config);
+  DebounceConfig Config();
+
+  bool Sample(const std::string &id, bool active);
+  // With `config` for this sample only, e.g. thresholds passed to one call
+  bool Sample(const std::string &id, bool active, const DebounceConfig &config);
+
+  // Samples every tracked id, treating the ones missing from `activeIds` as
+  // inactive, and returns the ids that should be reported active: those of
+  // `activeIds` first, in order, then any that are only held. Ids that have
+  // been quiet for a whole rapid-change window are forgotten.
+  std::vector<std::string> SampleSet(const std::vector<std::string> &activeIds);
+  std::vector<std::string> SampleSet(const std::vector<std::string> &activeIds,
+                                     const DebounceConfig &config);
+
+  void Forget(const std::string &id);
+  void Clear();
+  size_t Size();
+
+private:
+  struct DeviceState {
+    bool lastActiveState;
+    bool lastReportedState;
+    bool hasActivity;
+    int consecutiveActiveChecks;
+    int consecutiveInactiveChecks;
+    int rapidStateChangeCount;
+    int64_t lastStateChange;
+    int64_t lastActivityTime;
+    int64_t rapidStateChangeWindow;
+
+    explicit DeviceState(int64_t now)
+        : lastActiveState(false), lastReportedState(false), hasActivity(false),
+          consecutiveActiveChecks(0), consecutiveInactiveChecks(0),
+          rapidStateChangeCount(0), lastStateChange(now),
+          lastActivityTime(now), rapidStateChangeWindow(now) {}
+  };
+
+  // A null `config` stands for config_, read under the lock
+  bool SampleOne(const std::string &id, bool active, const DebounceConfig *config);
+  std::vector<std::string> SampleAll(const std::vector<std::string> &activeIds,
+                                     const DebounceConfig *config);
+  static bool SampleLocked(DeviceState &state, bool active, int64_t now,
+                           const DebounceConfig &c);
+
+  std::mutex mutex_;
+  DebounceConfig config_;
+  DebounceClock clock_;
+  std::unordered_map<std::string, DeviceState> devices_;
+};
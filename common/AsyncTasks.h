@@ -0,0 +1,167 @@
+#pragma once
+#include <napi.h>
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "Executor.h"
+#include "NativeStats.h"
+
+// A job of QueueExecutorPromise. Created and deleted on the JS thread.
+template <typename T> struct ExecutorPromiseJob {
+  typedef std::function<T()> Work;
+  typedef std::function<Napi::Value(Napi::Env, T &)> Convert;
+
+  std::string name;
+  Napi::Promise::Deferred deferred;
+  // Whatever `work` reads in place (e.g. a Buffer), kept from being
+  // collected until the Promise settles
+  Napi::ObjectReference keepAlive;
+  // The caller's AbortSignal and the listener added to it
+  Napi::ObjectReference signal;
+  Napi::FunctionReference onAbort;
+  Work work;
+  Convert convert;
+  T result;
+  // Set by `work` throwing, when built with C++ exceptions
+  std::string error;
+  bool cancelled;
+  ExportStats *workStats;
+  Napi::ThreadSafeFunction tsfn;
+
+  ExecutorPromiseJob(Napi::Env env, const char *name)
+      : name(name), deferred(Napi::Promise::Deferred::New(env)), result(),
+        cancelled(false), workStats(nullptr) {}
+};
+
+// Reads `options.signal`, which must be an AbortSignal if given. Returns
+// false with a TypeError pending otherwise.
+inline bool ReadAbortSignal(Napi::Env env, const Napi::Value &options,
+                            Napi::Object *signal) {
+  if (!options.IsObject()) {
+    return true;
+  }
+  Napi::Value value = options.As<Napi::Object>().Get("signal");
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsObject() || !value.As<Napi::Object>().Get("addEventListener").IsFunction()) {
+    Napi::TypeError::New(env, "Expected signal to be an AbortSignal").ThrowAsJavaScriptException();
+    return false;
+  }
+  *signal = value.As<Napi::Object>();
+  return true;
+}
+
+// The signal's reason, or an AbortError for signals without one
+inline Napi::Value AbortReason(Napi::Env env, const Napi::Object &signal,
+                               const std::string &name) {
+  Napi::Value reason = signal.IsEmpty() ? env.Undefined() : signal.Get("reason");
+  if (!reason.IsUndefined()) {
+    return reason;
+  }
+  Napi::Error error = Napi::Error::New(env, name + ": cancelled");
+  error.Set("name", Napi::String::New(env, "AbortError"));
+  return error.Value();
+}
+
+// Runs on the JS thread once the job ran or was cancelled
+template <typename T>
+void SettleExecutorPromise(Napi::Env env, Napi::Function, ExecutorPromiseJob<T> *job) {
+  Napi::Object signal;
+  if (!job->signal.IsEmpty()) {
+    signal = job->signal.Value();
+    signal.Get("removeEventListener")
+        .As<Napi::Function>()
+        .Call(signal, {Napi::String::New(env, "abort"), job->onAbort.Value()});
+  }
+  if (job->cancelled) {
+    job->deferred.Reject(AbortReason(env, signal, job->name));
+  } else if (!job->error.empty()) {
+    job->deferred.Reject(Napi::Error::New(env, job->error).Value());
+  } else {
+    job->deferred.Resolve(job->convert(env, job->result));
+  }
+  delete job;
+}
+
+// Runs `work` on the shared Executor's `lane` and settles a Promise on the
+// JS thread. Everything that does not need a Napi::Env (OS calls, string
+// conversion) belongs in `work`; `convert` only turns the finished C++
+// result into JS values. The time spent in `work` is recorded as
+// "<name>:work" in getNativeStats(). The Promise rejects right away when
+// the lane's queue is full, and with the signal's reason when `signal`
+// aborts before a worker starts the job.
+template <typename T>
+Napi::Value QueueExecutorPromise(Napi::Env env, ExecutorLane lane, const char *name,
+                                 typename ExecutorPromiseJob<T>::Work work,
+                                 typename ExecutorPromiseJob<T>::Convert convert,
+                                 Napi::Object keepAlive = Napi::Object(),
+                                 Napi::Object signal = Napi::Object()) {
+  auto *job = new ExecutorPromiseJob<T>(env, name);
+  Napi::Promise promise = job->deferred.Promise();
+  if (!signal.IsEmpty() && signal.Get("aborted").ToBoolean().Value()) {
+    job->deferred.Reject(AbortReason(env, signal, job->name));
+    delete job;
+    return promise;
+  }
+  job->work = std::move(work);
+  job->convert = std::move(convert);
+  job->workStats = NativeStats::Export(std::string(name) + ":work");
+  if (!keepAlive.IsEmpty()) {
+    job->keepAlive = Napi::Persistent(keepAlive);
+  }
+  job->tsfn = Napi::ThreadSafeFunction::New(env, Napi::Function(), name, 0, 1);
+
+  auto settle = [job]() {
+    // The callback deletes the job, so keep the handle to release it.
+    Napi::ThreadSafeFunction tsfn = job->tsfn;
+    tsfn.BlockingCall(job, SettleExecutorPromise<T>);
+    tsfn.Release();
+  };
+  std::shared_ptr<ExecutorJob> queued = Executor::Shared().Submit(
+      lane,
+      [job, settle]() {
+        {
+          ExportTimer timer(job->workStats);
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+          try {
+            job->result = job->work();
+          } catch (const std::exception &e) {
+            job->error = e.what();
+          }
+#else
+          job->result = job->work();
+#endif
+        }
+        settle();
+      },
+      [job, settle]() {
+        job->cancelled = true;
+        settle();
+      });
+  if (!queued) {
+    job->tsfn.Release();
+    job->deferred.Reject(
+        Napi::Error::New(env, std::string(name) + ": too many jobs queued").Value());
+    delete job;
+    return promise;
+  }
+
+  if (!signal.IsEmpty()) {
+    Napi::Function onAbort = Napi::Function::New(
+        env, [queued](const Napi::CallbackInfo &info) {
+          Executor::Shared().Cancel(queued);
+          return info.Env().Undefined();
+        });
+    signal.Get("addEventListener")
+        .As<Napi::Function>()
+        .Call(signal, {Napi::String::New(env, "abort"), onAbort});
+    job->signal = Napi::Persistent(signal);
+    job->onAbort = Napi::Persistent(onAbort);
+  }
+  return promise;
+}
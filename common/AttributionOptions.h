@@ -0,0 +1,28 @@
+#pragma once
+#include <napi.h>
+
+#include <string>
+
+// Reads `attribution` of an audio query's options: "process" (the default)
+// reports the process that opened the session, "rootApp" the application it
+// belongs to. Returns false with a pending exception on any other value.
+inline bool ReadRootAppAttribution(const Napi::CallbackInfo &info, size_t index,
+                                   bool *rootApp) {
+  *rootApp = false;
+  if (info.Length() <= index || !info[index].IsObject()) {
+    return true;
+  }
+  Napi::Value value = info[index].As<Napi::Object>().Get("attribution");
+  if (value.IsUndefined()) {
+    return true;
+  }
+  std::string mode = value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+  if (mode != "process" && mode != "rootApp") {
+    Napi::TypeError::New(info.Env(),
+                         "Expected attribution to be \"process\" or \"rootApp\"")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  *rootApp = mode == "rootApp";
+  return true;
+}
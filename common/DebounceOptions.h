@@ -0,0 +1,36 @@
+#pragma once
+#include <napi.h>
+
+#include "ActivityDebouncer.h"
+
+inline void ReadDebounceNumber(const Napi::Object &options, const char *name,
+                               int64_t &field) {
+  Napi::Value value = options.Get(name);
+  if (value.IsNumber()) {
+    field = value.As<Napi::Number>().Int64Value();
+  }
+}
+
+inline void ReadDebounceNumber(const Napi::Object &options, const char *name,
+                               int &field) {
+  Napi::Value value = options.Get(name);
+  if (value.IsNumber()) {
+    field = value.As<Napi::Number>().Int32Value();
+  }
+}
+
+// Applies the thresholds present in a JS options object on top of `config`.
+inline DebounceConfig ReadDebounceOptions(const Napi::Object &options,
+                                          DebounceConfig config) {
+  ReadDebounceNumber(options, "debounceMs", config.debounceMs);
+  ReadDebounceNumber(options, "activeHoldMs", config.activeHoldMs);
+  ReadDebounceNumber(options, "requiredActiveChecks",
+                     config.requiredActiveChecks);
+  ReadDebounceNumber(options, "requiredInactiveChecks",
+                     config.requiredInactiveChecks);
+  ReadDebounceNumber(options, "rapidChangeWindowMs",
+                     config.rapidChangeWindowMs);
+  ReadDebounceNumber(options, "maxRapidChanges", config.maxRapidChanges);
+  ReadDebounceNumber(options, "extendedDebounceMs", config.extendedDebounceMs);
+  return config;
+}
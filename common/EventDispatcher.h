@@ -0,0 +1,254 @@
+#pragma once
+#include <napi.h>
+#include <uv.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "EventRing.h"
+
+// One notification of a native monitor, in the (active, error) shape of the
+// monitoring callbacks.
+struct MonitorEvent {
+  // Coalescing key. Monitors that report a single aggregate state use 0;
+  // per-device events carry a non-zero id and the device name.
+  uint32_t device;
+  std::string deviceName;
+  bool active;
+  bool hasError;
+  int code;
+  std::string message;
+  std::string domain;
+
+  MonitorEvent() : device(0), active(false), hasError(false), code(0) {}
+};
+
+// Cumulative counters, shared by every dispatcher a monitor has created.
+struct EventDeliveryStats {
+  std::atomic<uint64_t> pushed;
+  std::atomic<uint64_t> delivered;
+  std::atomic<uint64_t> dropped;
+  std::atomic<uint64_t> coalesced;
+  std::atomic<uint64_t> batches;
+
+  EventDeliveryStats()
+      : pushed(0), delivered(0), dropped(0), coalesced(0), batches(0) {}
+};
+
+struct EventDispatcherOptions {
+  // Events that do not fit are dropped and counted, never waited for.
+  size_t capacity;
+  // When non-zero, the first event of a batch waits this long for more, and
+  // only the last state per device is delivered. Errors are never coalesced.
+  int64_t coalesceMs;
+
+  EventDispatcherOptions() : capacity(1024), coalesceMs(0) {}
+};
+
+inline Napi::Object EventDeliveryStatsToObject(const Napi::Env &env,
+                                               const EventDeliveryStats &stats) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("pushed", Napi::Number::New(env, double(stats.pushed.load())));
+  result.Set("delivered",
+             Napi::Number::New(env, double(stats.delivered.load())));
+  result.Set("dropped", Napi::Number::New(env, double(stats.dropped.load())));
+  result.Set("coalesced",
+             Napi::Number::New(env, double(stats.coalesced.load())));
+  result.Set("batches", Napi::Number::New(env, double(stats.batches.load())));
+  return result;
+}
+
+// Applies `capacity` and `coalesceMs` from a JS options object.
+inline EventDispatcherOptions ReadEventDispatcherOptions(const Napi::Value &value) {
+  EventDispatcherOptions options;
+  if (!value.IsObject()) {
+    return options;
+  }
+
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Value capacity = object.Get("capacity");
+  if (capacity.IsNumber() && capacity.As<Napi::Number>().Int64Value() > 0) {
+    options.capacity = size_t(capacity.As<Napi::Number>().Int64Value());
+  }
+  Napi::Value coalesceMs = object.Get("coalesceMs");
+  if (coalesceMs.IsNumber() && coalesceMs.As<Napi::Number>().Int64Value() > 0) {
+    options.coalesceMs = coalesceMs.As<Napi::Number>().Int64Value();
+  }
+  return options;
+}
+
+// Calls callback(active, error) for one event; the default delivery.
+inline void CallMonitorCallback(Napi::Env env, Napi::Function callback,
+                                const MonitorEvent &event) {
+  if (event.hasError) {
+    Napi::Error error = Napi::Error::New(env, event.message);
+    error.Set("code", Napi::Number::New(env, event.code));
+    error.Set("domain", Napi::String::New(env, event.domain));
+    callback.Call({Napi::Boolean::New(env, event.active), error.Value()});
+  } else {
+    callback.Call({Napi::Boolean::New(env, event.active), env.Null()});
+  }
+}
+
+// Carries events from native threads to the JS thread. Producers push into
+// a lock-free ring and at most one non-blocking wakeup is outstanding at a
+// time, so a burst of events costs one hop to the JS thread and the
+// producer (e.g. a CoreAudio queue) is never blocked.
+class EventDispatcher {
+public:
+  // Handles one event on the JS thread; `callback` is the function the
+  // dispatcher was created with.
+  typedef std::function<void(Napi::Env, Napi::Function, const MonitorEvent &)>
+      Sink;
+
+  // On the JS thread. By default the callback is called as
+  // callback(active, error).
+  static EventDispatcher *Create(Napi::Env env, Napi::Function callback,
+                                 const char *name,
+                                 const EventDispatcherOptions &options,
+                                 std::shared_ptr<EventDeliveryStats> stats,
+                                 Sink sink = CallMonitorCallback) {
+    return new EventDispatcher(env, callback, name, options, std::move(stats),
+                               std::move(sink));
+  }
+
+  // From any thread. Events pushed after Close() are ignored.
+  void Push(MonitorEvent &&event) {
+    if (closed_.load(std::memory_order_acquire)) {
+      return;
+    }
+    stats_->pushed.fetch_add(1, std::memory_order_relaxed);
+    if (!ring_.TryPush(std::move(event))) {
+      stats_->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // Pairs with the fence in Drain: either the consumer sees this event or
+    // this producer sees the cleared flag and wakes it again.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!wakeupPending_.exchange(true)) {
+      tsfn_.NonBlockingCall([this](Napi::Env env, Napi::Function callback) {
+        OnWakeup(env, callback);
+      });
+    }
+  }
+
+  // On the JS thread, once every producer has stopped. The dispatcher frees
+  // itself after the wakeups already queued have run.
+  void Close() {
+    if (closed_.exchange(true)) {
+      return;
+    }
+    uv_timer_stop(&timer_);
+    tsfn_.Release();
+  }
+
+private:
+  EventDispatcher(Napi::Env env, Napi::Function callback, const char *name,
+                  const EventDispatcherOptions &options,
+                  std::shared_ptr<EventDeliveryStats> stats, Sink sink)
+      : ring_(options.capacity), coalesceMs_(options.coalesceMs),
+        stats_(std::move(stats)), sink_(std::move(sink)),
+        wakeupPending_(false), closed_(false),
+        timerActive_(false) {
+    uv_loop_t *loop = nullptr;
+    napi_get_uv_event_loop(env, &loop);
+    uv_timer_init(loop, &timer_);
+    timer_.data = this;
+    uv_unref(reinterpret_cast<uv_handle_t *>(&timer_));
+
+    tsfn_ = Napi::ThreadSafeFunction::New(
+        env, callback, name, 0, 1, this,
+        [](Napi::Env, EventDispatcher *self) {
+          uv_close(reinterpret_cast<uv_handle_t *>(&self->timer_),
+                   [](uv_handle_t *handle) {
+                     delete static_cast<EventDispatcher *>(handle->data);
+                   });
+        });
+  }
+
+  void OnWakeup(Napi::Env env, Napi::Function callback) {
+    if (coalesceMs_ == 0) {
+      Drain(env, callback);
+    } else if (!timerActive_ && !closed_) {
+      timerActive_ = true;
+      uv_timer_start(&timer_, OnTimer, uint64_t(coalesceMs_), 0);
+    }
+  }
+
+  static void OnTimer(uv_timer_t *timer) {
+    auto self = static_cast<EventDispatcher *>(timer->data);
+    self->timerActive_ = false;
+    self->tsfn_.NonBlockingCall(
+        [self](Napi::Env env, Napi::Function callback) {
+          self->Drain(env, callback);
+        });
+  }
+
+  void Drain(Napi::Env env, Napi::Function callback) {
+    wakeupPending_.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    batch_.clear();
+    MonitorEvent event;
+    while (ring_.TryPop(event)) {
+      batch_.push_back(std::move(event));
+    }
+    if (batch_.empty()) {
+      return;
+    }
+    stats_->batches.fetch_add(1, std::memory_order_relaxed);
+
+    // Keep only the last state event per device, errors stay in place.
+    latest_.clear();
+    if (coalesceMs_ > 0) {
+      for (size_t i = 0; i < batch_.size(); i++) {
+        if (!batch_[i].hasError) {
+          latest_[batch_[i].device] = i;
+        }
+      }
+    }
+
+    Napi::HandleScope scope(env);
+    for (size_t i = 0; i < batch_.size(); i++) {
+      const MonitorEvent &item = batch_[i];
+      if (coalesceMs_ > 0 && !item.hasError && latest_[item.device] != i) {
+        stats_->coalesced.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      // The callback may have stopped monitoring; the rest of the batch
+      // never reaches JS.
+      if (closed_) {
+        stats_->dropped.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+
+      sink_(env, callback, item);
+      stats_->delivered.fetch_add(1, std::memory_order_relaxed);
+      // A throwing callback must not lose the rest of the batch; report the
+      // exception as uncaught, as MicMonitorHandle::Deliver does.
+      if (env.IsExceptionPending()) {
+        Napi::Error error = env.GetAndClearPendingException();
+        napi_fatal_exception(env, error.Value());
+      }
+    }
+  }
+
+  EventRing<MonitorEvent> ring_;
+  const int64_t coalesceMs_;
+  std::shared_ptr<EventDeliveryStats> stats_;
+  Sink sink_;
+  Napi::ThreadSafeFunction tsfn_;
+  uv_timer_t timer_;
+  std::atomic<bool> wakeupPending_;
+  std::atomic<bool> closed_;
+  // JS thread only
+  bool timerActive_;
+  std::vector<MonitorEvent> batch_;
+  std::unordered_map<uint32_t, size_t> latest_;
+};
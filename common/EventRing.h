@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Fixed-capacity lock-free queue for many producers and one consumer
+// (Vyukov's bounded queue). Each slot carries a sequence number that tells
+// producers and the consumer whose turn it is, so neither side ever waits on
+// the other; a full ring simply refuses the push.
+template <typename T> class EventRing {
+public:
+  // The capacity is rounded up to a power of two.
+  explicit EventRing(size_t capacity)
+      : capacity_(RoundUp(capacity)), mask_(capacity_ - 1),
+        slots_(new Slot[capacity_]), head_(0), tail_(0) {
+    for (size_t i = 0; i < capacity_; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  EventRing(const EventRing &) = delete;
+  EventRing &operator=(const EventRing &) = delete;
+
+  size_t Capacity() const { return capacity_; }
+
+  // Safe from any thread. Returns false when the ring is full.
+  bool TryPush(T &&value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &slot = slots_[pos & mask_];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value = std::move(value);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Only from the single consumer thread. Returns false when empty.
+  bool TryPop(T &out) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Slot &slot = slots_[pos & mask_];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (intptr_t(sequence) - intptr_t(pos + 1) < 0) {
+      return false;
+    }
+
+    out = std::move(slot.value);
+    head_.store(pos + 1, std::memory_order_relaxed);
+    slot.sequence.store(pos + capacity_, std::memory_order_release);
+    return true;
+  }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t RoundUp(size_t n) {
+    size_t capacity = 2;
+    while (capacity < n) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  // Consumer and producer positions on separate cache lines
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
+};
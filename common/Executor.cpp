@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "Executor.h"
+#include "NativeStats.h"
+
+namespace {
+
+// The worker the current thread is, if any
+thread_local const Executor *currentExecutor = nullptr;
+thread_local size_t currentWorker = 0;
+
+std::mutex sharedMutex;
+Executor *sharedExecutor = nullptr;
+ExecutorOptions sharedOptions;
+
+void Decrement(std::atomic<uint64_t> &value) {
+  value.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Increment(std::atomic<uint64_t> &value) {
+  value.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+const char *ExecutorLaneName(ExecutorLane lane) {
+  return lane == EXECUTOR_INTERACTIVE ? "interactive" : "bulk";
+}
+
+ExecutorJob::ExecutorJob(ExecutorLane lane, std::function<void()> run,
+                         std::function<void()> cancelled)
+    : lane_(lane), state_(QUEUED), run_(std::move(run)),
+      cancelled_(std::move(cancelled)), queuedAt_(std::chrono::steady_clock::now()) {}
+
+Executor::Executor(const ExecutorOptions &options) : bulkRunning_(0), stopping_(false) {
+  size_t threads = options.threads;
+  if (threads == 0) {
+    threads = std::min<size_t>(std::max<size_t>(std::thread::hardware_concurrency(), 2), 8);
+  }
+  bulkLimit_ = threads - std::min(options.interactiveThreads, threads - 1);
+  for (size_t lane = 0; lane < EXECUTOR_LANES; lane++) {
+    lanes_[lane].limit = std::max<size_t>(options.maxQueued[lane], 1);
+    lanes_[lane].wait = NativeStats::Export(
+        std::string("executor.") + ExecutorLaneName(ExecutorLane(lane)) + ":wait");
+  }
+
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back(new Worker());
+  }
+  for (size_t i = 0; i < threads; i++) {
+    workers_[i]->thread = std::thread(&Executor::Run, this, i);
+  }
+}
+
+Executor::~Executor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto &worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+Executor &Executor::Shared() {
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  if (sharedExecutor == nullptr) {
+    sharedExecutor = new Executor(sharedOptions);
+  }
+  return *sharedExecutor;
+}
+
+Executor *Executor::SharedIfStarted() {
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  return sharedExecutor;
+}
+
+bool Executor::Configure(const ExecutorOptions &options) {
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  if (sharedExecutor != nullptr) {
+    return false;
+  }
+  sharedOptions = options;
+  return true;
+}
+
+std::shared_ptr<ExecutorJob> Executor::Submit(ExecutorLane lane, std::function<void()> run,
+                                              std::function<void()> cancelled) {
+  Lane &stats = lanes_[lane];
+  if (stats.queued.load(std::memory_order_relaxed) >= stats.limit) {
+    Increment(stats.rejected);
+    return nullptr;
+  }
+  std::shared_ptr<ExecutorJob> job(
+      new ExecutorJob(lane, std::move(run), std::move(cancelled)));
+  Increment(stats.submitted);
+
+  // Counted before it can be taken, so that `queued` never goes below zero
+  auto enqueue = [&](std::deque<std::shared_ptr<ExecutorJob>> &queue) {
+    uint64_t queued = stats.queued.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint64_t max = stats.maxQueued.load(std::memory_order_relaxed);
+    while (queued > max &&
+           !stats.maxQueued.compare_exchange_weak(max, queued, std::memory_order_relaxed)) {
+    }
+    queue.push_back(job);
+  };
+  if (currentExecutor == this) {
+    Worker &worker = *workers_[currentWorker];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    enqueue(worker.jobs[lane]);
+  } else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enqueue(injected_[lane]);
+  }
+  Wake();
+  return job;
+}
+
+bool Executor::Cancel(const std::shared_ptr<ExecutorJob> &job) {
+  int expected = ExecutorJob::QUEUED;
+  if (!job || !job->state_.compare_exchange_strong(expected, ExecutorJob::CANCELLED)) {
+    return false;
+  }
+  // The entry stays in its queue; whoever takes it drops it
+  Lane &stats = lanes_[job->lane_];
+  Decrement(stats.queued);
+  Increment(stats.cancelled);
+  std::function<void()> cancelled = std::move(job->cancelled_);
+  job->run_ = nullptr;
+  if (cancelled) {
+    cancelled();
+  }
+  return true;
+}
+
+namespace {
+
+// Shared with the helper jobs, which may only start after ParallelFor
+// returned; they then find nothing left to claim and never touch `fn`.
+struct ParallelForState {
+  std::atomic<size_t> next;
+  size_t count;
+  const std::function<void(size_t)> *fn;
+  std::mutex mutex;
+  std::condition_variable done;
+  size_t finished;
+
+  ParallelForState(size_t count, const std::function<void(size_t)> *fn)
+      : next(0), count(count), fn(fn), finished(0) {}
+
+  void Work() {
+    for (;;) {
+      size_t index = next.fetch_add(1);
+      if (index >= count) {
+        return;
+      }
+      (*fn)(index);
+      std::lock_guard<std::mutex> lock(mutex);
+      if (++finished == count) {
+        done.notify_all();
+      }
+    }
+  }
+};
+
+} // namespace
+
+void Executor::ParallelFor(ExecutorLane lane, size_t count,
+                           const std::function<void(size_t)> &fn) {
+  if (count == 0) {
+    return;
+  }
+  auto state = std::make_shared<ParallelForState>(count, &fn);
+  size_t width = lane == EXECUTOR_BULK ? bulkLimit_ : workers_.size();
+  size_t helpers = std::min(count, width) - 1;
+  for (size_t i = 0; i < helpers; i++) {
+    if (!Submit(lane, [state]() { state->Work(); })) {
+      break;
+    }
+  }
+  state->Work();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->done.wait(lock, [&state] { return state->finished == state->count; });
+}
+
+ExecutorLaneStats Executor::Stats(ExecutorLane lane) const {
+  const Lane &stats = lanes_[lane];
+  ExecutorLaneStats result;
+  result.queued = stats.queued.load(std::memory_order_relaxed);
+  result.maxQueued = stats.maxQueued.load(std::memory_order_relaxed);
+  result.running = stats.running.load(std::memory_order_relaxed);
+  result.submitted = stats.submitted.load(std::memory_order_relaxed);
+  result.completed = stats.completed.load(std::memory_order_relaxed);
+  result.cancelled = stats.cancelled.load(std::memory_order_relaxed);
+  result.rejected = stats.rejected.load(std::memory_order_relaxed);
+  result.stolen = stats.stolen.load(std::memory_order_relaxed);
+  return result;
+}
+
+void Executor::Run(size_t index) {
+  currentExecutor = this;
+  currentWorker = index;
+  for (;;) {
+    std::shared_ptr<ExecutorJob> job = Next(index);
+    if (!job) {
+      return;
+    }
+    Execute(job);
+  }
+}
+
+std::shared_ptr<ExecutorJob> Executor::Next(size_t index) {
+  for (;;) {
+    std::shared_ptr<ExecutorJob> job = Take(index, EXECUTOR_INTERACTIVE);
+    if (job) {
+      return job;
+    }
+    if (ReserveBulk()) {
+      job = Take(index, EXECUTOR_BULK);
+      if (job) {
+        return job;
+      }
+      ReleaseBulk();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait(lock, [this] { return stopping_ || Runnable(); });
+    if (stopping_) {
+      return nullptr;
+    }
+  }
+}
+
+// Own queue newest first, then the shared queue, then the other workers'
+// queues oldest first
+std::shared_ptr<ExecutorJob> Executor::Take(size_t index, ExecutorLane lane) {
+  {
+    Worker &worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    auto &queue = worker.jobs[lane];
+    while (!queue.empty()) {
+      std::shared_ptr<ExecutorJob> job = std::move(queue.back());
+      queue.pop_back();
+      if (Claim(job)) {
+        return job;
+      }
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &queue = injected_[lane];
+    while (!queue.empty()) {
+      std::shared_ptr<ExecutorJob> job = std::move(queue.front());
+      queue.pop_front();
+      if (Claim(job)) {
+        return job;
+      }
+    }
+  }
+  for (size_t i = 1; i < workers_.size(); i++) {
+    Worker &victim = *workers_[(index + i) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    auto &queue = victim.jobs[lane];
+    while (!queue.empty()) {
+      std::shared_ptr<ExecutorJob> job = std::move(queue.front());
+      queue.pop_front();
+      if (Claim(job)) {
+        Increment(lanes_[lane].stolen);
+        return job;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// False for jobs cancelled while queued
+bool Executor::Claim(const std::shared_ptr<ExecutorJob> &job) {
+  int expected = ExecutorJob::QUEUED;
+  if (!job->state_.compare_exchange_strong(expected, ExecutorJob::RUNNING)) {
+    return false;
+  }
+  Lane &stats = lanes_[job->lane_];
+  Decrement(stats.queued);
+  Increment(stats.running);
+  auto waited = std::chrono::steady_clock::now() - job->queuedAt_;
+  stats.wait->latency.Record(uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count()));
+  return true;
+}
+
+void Executor::Execute(const std::shared_ptr<ExecutorJob> &job) {
+  job->run_();
+  // Frees what the job captured, while its handle may live on
+  job->run_ = nullptr;
+  job->cancelled_ = nullptr;
+  job->state_.store(ExecutorJob::FINISHED);
+
+  Lane &stats = lanes_[job->lane_];
+  Decrement(stats.running);
+  Increment(stats.completed);
+  if (job->lane_ == EXECUTOR_BULK) {
+    ReleaseBulk();
+  }
+}
+
+bool Executor::ReserveBulk() {
+  size_t running = bulkRunning_.load();
+  while (running < bulkLimit_) {
+    if (bulkRunning_.compare_exchange_weak(running, running + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A bulk job that waited for a free slot may start now
+void Executor::ReleaseBulk() {
+  bulkRunning_.fetch_sub(1);
+  if (lanes_[EXECUTOR_BULK].queued.load(std::memory_order_relaxed) > 0) {
+    Wake();
+  }
+}
+
+// Called with `mutex_` held
+bool Executor::Runnable() const {
+  return lanes_[EXECUTOR_INTERACTIVE].queued.load() > 0 ||
+         (lanes_[EXECUTOR_BULK].queued.load() > 0 && bulkRunning_.load() < bulkLimit_);
+}
+
+void Executor::Wake() {
+  // Taking the lock orders this after the check of a worker about to wait
+  { std::lock_guard<std::mutex> lock(mutex_); }
+  wake_.notify_one();
+}
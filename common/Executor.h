@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ExportStats;
+
+// Lanes in priority order: interactive for the quick queries a UI waits on
+// (microphone, speakers, processes), bulk for long jobs (OCR, installed
+// apps).
+enum ExecutorLane { EXECUTOR_INTERACTIVE = 0, EXECUTOR_BULK = 1 };
+const size_t EXECUTOR_LANES = 2;
+
+// "interactive" or "bulk"
+const char *ExecutorLaneName(ExecutorLane lane);
+
+struct ExecutorOptions {
+  // 0 picks one per core, from 2 to 8
+  size_t threads = 0;
+  // Threads bulk jobs never occupy, so that an interactive job never waits
+  // behind OCR. Capped so that at least one thread runs bulk jobs.
+  size_t interactiveThreads = 1;
+  // Jobs waiting beyond this many per lane are rejected
+  size_t maxQueued[EXECUTOR_LANES] = {256, 64};
+};
+
+struct ExecutorLaneStats {
+  // Jobs waiting now, and the most that ever waited at once
+  uint64_t queued;
+  uint64_t maxQueued;
+  uint64_t running;
+  uint64_t submitted;
+  uint64_t completed;
+  uint64_t cancelled;
+  // Turned away because `maxQueued` jobs were waiting
+  uint64_t rejected;
+  // Run by another worker than the one that queued them
+  uint64_t stolen;
+};
+
+// A queued job, kept by whoever may want to cancel it.
+class ExecutorJob {
+public:
+  ExecutorLane Lane() const { return lane_; }
+
+private:
+  friend class Executor;
+  enum State { QUEUED, RUNNING, FINISHED, CANCELLED };
+
+  ExecutorJob(ExecutorLane lane, std::function<void()> run,
+              std::function<void()> cancelled);
+
+  const ExecutorLane lane_;
+  std::atomic<int> state_;
+  std::function<void()> run_;
+  std::function<void()> cancelled_;
+  std::chrono::steady_clock::time_point queuedAt_;
+};
+
+// Native threads for the async exports, instead of the libuv threadpool,
+// which has four threads by default and runs jobs in submission order. Each
+// worker has its own queue per lane, for the jobs it submits itself
+// (ParallelFor), and steals from the others when it runs dry; jobs from
+// other threads go to a shared queue per lane. A free worker always takes
+// an interactive job before a bulk one.
+class Executor {
+public:
+  explicit Executor(const ExecutorOptions &options);
+  // Jobs still queued are dropped without calling either function.
+  ~Executor();
+
+  // The addon's executor, created on first use with the options of the last
+  // Configure(). Never destroyed: jobs may still run at exit.
+  static Executor &Shared();
+  // Returns false once Shared() has been created.
+  static bool Configure(const ExecutorOptions &options);
+  // Shared() if it has been created, so that reading stats does not start it
+  static Executor *SharedIfStarted();
+
+  // Queues `run` on `lane`. If the job is cancelled before a worker starts
+  // it, `cancelled` is called instead, on the cancelling thread. Returns null,
+  // calling neither, when the lane already has its maximum of jobs waiting.
+  std::shared_ptr<ExecutorJob> Submit(ExecutorLane lane, std::function<void()> run,
+                                      std::function<void()> cancelled = nullptr);
+
+  // False when the job has already started (or was cancelled before).
+  bool Cancel(const std::shared_ptr<ExecutorJob> &job);
+
+  // Calls fn(0) ... fn(count - 1) on the calling thread and on whichever
+  // workers are free for `lane`, and returns when every call has returned.
+  // Safe from within a job: when no worker is free, the caller runs
+  // everything itself.
+  void ParallelFor(ExecutorLane lane, size_t count,
+                   const std::function<void(size_t)> &fn);
+
+  size_t Threads() const { return workers_.size(); }
+  // Workers that may run bulk jobs at the same time
+  size_t BulkThreads() const { return bulkLimit_; }
+  ExecutorLaneStats Stats(ExecutorLane lane) const;
+
+private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<ExecutorJob>> jobs[EXECUTOR_LANES];
+    std::thread thread;
+  };
+
+  struct Lane {
+    std::atomic<uint64_t> queued{0};
+    std::atomic<uint64_t> maxQueued{0};
+    std::atomic<uint64_t> running{0};
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> cancelled{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> stolen{0};
+    size_t limit = 0;
+    // "executor.<lane>:wait" in getNativeStats(): time from Submit to start
+    ExportStats *wait = nullptr;
+  };
+
+  void Run(size_t index);
+  std::shared_ptr<ExecutorJob> Next(size_t index);
+  std::shared_ptr<ExecutorJob> Take(size_t index, ExecutorLane lane);
+  bool Claim(const std::shared_ptr<ExecutorJob> &job);
+  void Execute(const std::shared_ptr<ExecutorJob> &job);
+  bool ReserveBulk();
+  void ReleaseBulk();
+  bool Runnable() const;
+  void Wake();
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  size_t bulkLimit_;
+  Lane lanes_[EXECUTOR_LANES];
+  std::atomic<size_t> bulkRunning_;
+
+  // Guards the shared queues and `stopping_`; idle workers wait on `wake_`
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::shared_ptr<ExecutorJob>> injected_[EXECUTOR_LANES];
+  bool stopping_;
+};
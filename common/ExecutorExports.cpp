@@ -0,0 +1,86 @@
+#include <string>
+
+#include "Executor.h"
+#include "ExecutorExports.h"
+
+namespace {
+
+const ExecutorLane LANES[] = {EXECUTOR_INTERACTIVE, EXECUTOR_BULK};
+
+// {started, threads, bulkThreads, lanes: {interactive: {queued, maxQueued,
+// running, submitted, completed, cancelled, rejected, stolen}, bulk: {...}}};
+// all zero until the first async export has run
+Napi::Value GetExecutorStats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Executor *executor = Executor::SharedIfStarted();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("started", Napi::Boolean::New(env, executor != nullptr));
+  result.Set("threads", Napi::Number::New(env, executor ? double(executor->Threads()) : 0));
+  result.Set("bulkThreads",
+             Napi::Number::New(env, executor ? double(executor->BulkThreads()) : 0));
+
+  Napi::Object lanes = Napi::Object::New(env);
+  for (ExecutorLane lane : LANES) {
+    ExecutorLaneStats stats = executor ? executor->Stats(lane) : ExecutorLaneStats();
+    Napi::Object item = Napi::Object::New(env);
+    item.Set("queued", Napi::Number::New(env, double(stats.queued)));
+    item.Set("maxQueued", Napi::Number::New(env, double(stats.maxQueued)));
+    item.Set("running", Napi::Number::New(env, double(stats.running)));
+    item.Set("submitted", Napi::Number::New(env, double(stats.submitted)));
+    item.Set("completed", Napi::Number::New(env, double(stats.completed)));
+    item.Set("cancelled", Napi::Number::New(env, double(stats.cancelled)));
+    item.Set("rejected", Napi::Number::New(env, double(stats.rejected)));
+    item.Set("stolen", Napi::Number::New(env, double(stats.stolen)));
+    lanes.Set(ExecutorLaneName(lane), item);
+  }
+  result.Set("lanes", lanes);
+  return result;
+}
+
+bool ReadCount(Napi::Env env, Napi::Object object, const char *key, size_t min,
+               size_t max, size_t *out) {
+  Napi::Value value = object.Get(key);
+  if (value.IsUndefined()) {
+    return true;
+  }
+  double number = value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : -1;
+  if (!(number >= double(min) && number <= double(max)) || number != double(size_t(number))) {
+    Napi::TypeError::New(env, std::string("Expected ") + key + " to be an integer from " +
+                                  std::to_string(min) + " to " + std::to_string(max))
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  *out = size_t(number);
+  return true;
+}
+
+// configureExecutor({threads?, interactiveThreads?, maxQueued?: {interactive?,
+// bulk?}}) -> false, changing nothing, once an async export has run
+Napi::Value ConfigureExecutor(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  ExecutorOptions options;
+  if (info[0].IsObject()) {
+    Napi::Object object = info[0].As<Napi::Object>();
+    if (!ReadCount(env, object, "threads", 1, 256, &options.threads) ||
+        !ReadCount(env, object, "interactiveThreads", 0, 255, &options.interactiveThreads)) {
+      return env.Null();
+    }
+    Napi::Value maxQueued = object.Get("maxQueued");
+    if (maxQueued.IsObject()) {
+      for (ExecutorLane lane : LANES) {
+        if (!ReadCount(env, maxQueued.As<Napi::Object>(), ExecutorLaneName(lane), 1,
+                       1 << 20, &options.maxQueued[lane])) {
+          return env.Null();
+        }
+      }
+    }
+  }
+  return Napi::Boolean::New(env, Executor::Configure(options));
+}
+
+} // namespace
+
+void ExecutorInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("getExecutorStats", Napi::Function::New(env, GetExecutorStats));
+  exports.Set("configureExecutor", Napi::Function::New(env, ConfigureExecutor));
+}
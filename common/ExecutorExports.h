@@ -0,0 +1,5 @@
+#pragma once
+#include <napi.h>
+
+// Adds getExecutorStats() and configureExecutor() to `exports`.
+void ExecutorInit(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,91 @@
+#include "ImageKernels.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void ScalarGrayRow(const uint8_t *in, uint8_t *out, size_t pixels, bool bgr) {
+  const unsigned first = bgr ? 29 : 77, third = bgr ? 77 : 29;
+  for (size_t i = 0; i < pixels; i++, in += 4) {
+    out[i] = uint8_t((in[0] * first + in[1] * 150 + in[2] * third) >> 8);
+  }
+}
+
+void ScalarAccumulateRow(const uint8_t *row, uint16_t *sums, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    sums[i] = uint16_t(sums[i] + row[i]);
+  }
+}
+
+void ScalarSlideColumns(uint32_t *sums, const uint8_t *add, const uint8_t *sub,
+                        size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    sums[i] = sums[i] + add[i] - sub[i];
+  }
+}
+
+void ScalarThresholdRow(const uint8_t *pixels, const uint32_t *windowSums,
+                        const float *area, float scale, uint8_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    float lhs = float(pixels[i]) * area[i];
+    float rhs = float(windowSums[i]) * scale;
+    out[i] = lhs > rhs ? 255 : 0;
+  }
+}
+
+const ImageKernels SCALAR = {"scalar", ScalarGrayRow, ScalarAccumulateRow,
+                             ScalarSlideColumns, ScalarThresholdRow};
+
+bool CPUHasAVX2() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  // Also checks that the OS saves the AVX registers
+  return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  const int OSXSAVE = 1 << 27, AVX = 1 << 28;
+  if ((info[2] & (OSXSAVE | AVX)) != (OSXSAVE | AVX) ||
+      (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+const ImageKernels &ScalarImageKernels() { return SCALAR; }
+
+const std::vector<const ImageKernels *> &SupportedImageKernels() {
+  static const std::vector<const ImageKernels *> *supported = [] {
+    auto *kernels = new std::vector<const ImageKernels *>();
+    // SSE2 and NEON are part of the x86-64 and arm64 baselines
+    if (AVX2ImageKernels() != nullptr && CPUHasAVX2()) {
+      kernels->push_back(AVX2ImageKernels());
+    }
+    if (SSE2ImageKernels() != nullptr) {
+      kernels->push_back(SSE2ImageKernels());
+    }
+    if (NeonImageKernels() != nullptr) {
+      kernels->push_back(NeonImageKernels());
+    }
+    kernels->push_back(&SCALAR);
+    return kernels;
+  }();
+  return *supported;
+}
+
+const ImageKernels &ActiveImageKernels() {
+  static const ImageKernels *active = SupportedImageKernels().front();
+  return *active;
+}
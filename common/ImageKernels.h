@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Row kernels of the OCR preprocessing stage (ImagePreprocess.h). Every
+// instruction set implements the same arithmetic, so all of them produce
+// identical output; the best one the CPU supports is picked at runtime.
+struct ImageKernels {
+  const char *name;
+
+  // out[i] = luminance of the i-th 4-byte pixel of `in`, as
+  // (77 R + 150 G + 29 B) >> 8. `bgr` when blue is the first byte.
+  void (*grayRow)(const uint8_t *in, uint8_t *out, size_t pixels, bool bgr);
+
+  // sums[i] += row[i]; used to add up the rows of a downscaled block.
+  void (*accumulateRow)(const uint8_t *row, uint16_t *sums, size_t n);
+
+  // sums[i] += add[i] - sub[i]; moves a vertical window down one row.
+  void (*slideColumns)(uint32_t *sums, const uint8_t *add, const uint8_t *sub,
+                       size_t n);
+
+  // out[i] = pixels[i] * area[i] > windowSums[i] * scale ? 255 : 0, in
+  // float: a pixel is background when it is brighter than a fraction of
+  // its neighbourhood's mean.
+  void (*thresholdRow)(const uint8_t *pixels, const uint32_t *windowSums,
+                       const float *area, float scale, uint8_t *out, size_t n);
+};
+
+const ImageKernels &ScalarImageKernels();
+
+// Null when this build has no such kernels (e.g. NEON on x86). Whether the
+// CPU supports them is up to the caller, see SupportedImageKernels().
+const ImageKernels *SSE2ImageKernels();
+const ImageKernels *AVX2ImageKernels();
+const ImageKernels *NeonImageKernels();
+
+// The kernels this CPU can run, fastest first; scalar is always last.
+const std::vector<const ImageKernels *> &SupportedImageKernels();
+
+// The first of SupportedImageKernels(), detected once.
+const ImageKernels &ActiveImageKernels();
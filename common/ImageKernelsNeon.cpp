@@ -0,0 +1,94 @@
+#include "ImageKernels.h"
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+
+#include <arm_neon.h>
+
+namespace {
+
+void NeonGrayRow(const uint8_t *in, uint8_t *out, size_t pixels, bool bgr) {
+  const uint8x8_t w0 = vdup_n_u8(bgr ? 29 : 77), w1 = vdup_n_u8(150),
+                  w2 = vdup_n_u8(bgr ? 77 : 29);
+  size_t i = 0;
+  for (; i + 16 <= pixels; i += 16) {
+    uint8x16x4_t p = vld4q_u8(in + i * 4);
+    uint16x8_t lo = vmull_u8(vget_low_u8(p.val[0]), w0);
+    lo = vmlal_u8(lo, vget_low_u8(p.val[1]), w1);
+    lo = vmlal_u8(lo, vget_low_u8(p.val[2]), w2);
+    uint16x8_t hi = vmull_u8(vget_high_u8(p.val[0]), w0);
+    hi = vmlal_u8(hi, vget_high_u8(p.val[1]), w1);
+    hi = vmlal_u8(hi, vget_high_u8(p.val[2]), w2);
+    vst1q_u8(out + i, vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+  }
+  ScalarImageKernels().grayRow(in + i * 4, out + i, pixels - i, bgr);
+}
+
+void NeonAccumulateRow(const uint8_t *row, uint16_t *sums, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t bytes = vld1q_u8(row + i);
+    vst1q_u16(sums + i, vaddw_u8(vld1q_u16(sums + i), vget_low_u8(bytes)));
+    vst1q_u16(sums + i + 8, vaddw_u8(vld1q_u16(sums + i + 8), vget_high_u8(bytes)));
+  }
+  ScalarImageKernels().accumulateRow(row + i, sums + i, n - i);
+}
+
+inline void AddSigned(uint32_t *sums, int16x4_t diff) {
+  int32x4_t s = vreinterpretq_s32_u32(vld1q_u32(sums));
+  vst1q_u32(sums, vreinterpretq_u32_s32(vaddw_s16(s, diff)));
+}
+
+void NeonSlideColumns(uint32_t *sums, const uint8_t *add, const uint8_t *sub,
+                      size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t a = vld1q_u8(add + i), b = vld1q_u8(sub + i);
+    // Wrapping differences, read back as signed
+    int16x8_t lo = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(a), vget_low_u8(b)));
+    int16x8_t hi = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(a), vget_high_u8(b)));
+    AddSigned(sums + i, vget_low_s16(lo));
+    AddSigned(sums + i + 4, vget_high_s16(lo));
+    AddSigned(sums + i + 8, vget_low_s16(hi));
+    AddSigned(sums + i + 12, vget_high_s16(hi));
+  }
+  ScalarImageKernels().slideColumns(sums + i, add + i, sub + i, n - i);
+}
+
+inline uint16x4_t Background4(uint16x4_t pixels, const uint32_t *windowSums,
+                              const float *area, float32x4_t scale) {
+  float32x4_t lhs = vmulq_f32(vcvtq_f32_u32(vmovl_u16(pixels)), vld1q_f32(area));
+  float32x4_t rhs = vmulq_f32(vcvtq_f32_u32(vld1q_u32(windowSums)), scale);
+  return vmovn_u32(vcgtq_f32(lhs, rhs));
+}
+
+void NeonThresholdRow(const uint8_t *pixels, const uint32_t *windowSums,
+                      const float *area, float scale, uint8_t *out, size_t n) {
+  const float32x4_t factor = vdupq_n_f32(scale);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t bytes = vld1q_u8(pixels + i);
+    uint16x8_t lo = vmovl_u8(vget_low_u8(bytes)), hi = vmovl_u8(vget_high_u8(bytes));
+    uint16x8_t m0 = vcombine_u16(
+        Background4(vget_low_u16(lo), windowSums + i, area + i, factor),
+        Background4(vget_high_u16(lo), windowSums + i + 4, area + i + 4, factor));
+    uint16x8_t m1 = vcombine_u16(
+        Background4(vget_low_u16(hi), windowSums + i + 8, area + i + 8, factor),
+        Background4(vget_high_u16(hi), windowSums + i + 12, area + i + 12, factor));
+    vst1q_u8(out + i, vcombine_u8(vmovn_u16(m0), vmovn_u16(m1)));
+  }
+  ScalarImageKernels().thresholdRow(pixels + i, windowSums + i, area + i, scale,
+                                    out + i, n - i);
+}
+
+const ImageKernels NEON = {"neon", NeonGrayRow, NeonAccumulateRow,
+                           NeonSlideColumns, NeonThresholdRow};
+
+} // namespace
+
+const ImageKernels *NeonImageKernels() { return &NEON; }
+
+#else
+
+const ImageKernels *NeonImageKernels() { return nullptr; }
+
+#endif
@@ -0,0 +1,214 @@
+#include "ImageKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_KERNELS_X86 1
+#endif
+
+#ifdef IMAGE_KERNELS_X86
+
+#include <immintrin.h>
+
+// AVX2 functions are compiled for AVX2 on their own, so the rest of the
+// addon keeps the baseline instruction set and runs on any x86-64 CPU.
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+// 16-bit weights of the even bytes (0 and 2) and odd bytes (1 and 3) of a
+// 4-byte pixel, for _mm_madd_epi16 on the pixel split in two.
+inline int EvenWeights(bool bgr) { return bgr ? (77 << 16) | 29 : (29 << 16) | 77; }
+const int ODD_WEIGHTS = 150;
+
+// Luminance of four pixels, one per 32-bit lane.
+inline __m128i Gray4(__m128i pixels, __m128i even, __m128i odd) {
+  const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+  __m128i sum = _mm_add_epi32(
+      _mm_madd_epi16(_mm_and_si128(pixels, mask), even),
+      _mm_madd_epi16(_mm_srli_epi16(pixels, 8), odd));
+  return _mm_srli_epi32(sum, 8);
+}
+
+void SSE2GrayRow(const uint8_t *in, uint8_t *out, size_t pixels, bool bgr) {
+  const __m128i even = _mm_set1_epi32(EvenWeights(bgr));
+  const __m128i odd = _mm_set1_epi32(ODD_WEIGHTS);
+  size_t i = 0;
+  for (; i + 16 <= pixels; i += 16) {
+    const uint8_t *p = in + i * 4;
+    __m128i g0 = Gray4(_mm_loadu_si128((const __m128i *)p), even, odd);
+    __m128i g1 = Gray4(_mm_loadu_si128((const __m128i *)(p + 16)), even, odd);
+    __m128i g2 = Gray4(_mm_loadu_si128((const __m128i *)(p + 32)), even, odd);
+    __m128i g3 = Gray4(_mm_loadu_si128((const __m128i *)(p + 48)), even, odd);
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(g0, g1), _mm_packs_epi32(g2, g3));
+    _mm_storeu_si128((__m128i *)(out + i), packed);
+  }
+  ScalarImageKernels().grayRow(in + i * 4, out + i, pixels - i, bgr);
+}
+
+void SSE2AccumulateRow(const uint8_t *row, uint16_t *sums, size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)(row + i));
+    __m128i *s = (__m128i *)(sums + i);
+    _mm_storeu_si128(s, _mm_add_epi16(_mm_loadu_si128(s), _mm_unpacklo_epi8(bytes, zero)));
+    _mm_storeu_si128(s + 1, _mm_add_epi16(_mm_loadu_si128(s + 1), _mm_unpackhi_epi8(bytes, zero)));
+  }
+  ScalarImageKernels().accumulateRow(row + i, sums + i, n - i);
+}
+
+// Sign-extends the low or high four 16-bit lanes to 32 bits.
+inline __m128i WidenLo16(__m128i v) { return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); }
+inline __m128i WidenHi16(__m128i v) { return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16); }
+
+void SSE2SlideColumns(uint32_t *sums, const uint8_t *add, const uint8_t *sub,
+                      size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(add + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(sub + i));
+    __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+    __m128i *s = (__m128i *)(sums + i);
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), WidenLo16(lo)));
+    _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), WidenHi16(lo)));
+    _mm_storeu_si128(s + 2, _mm_add_epi32(_mm_loadu_si128(s + 2), WidenLo16(hi)));
+    _mm_storeu_si128(s + 3, _mm_add_epi32(_mm_loadu_si128(s + 3), WidenHi16(hi)));
+  }
+  ScalarImageKernels().slideColumns(sums + i, add + i, sub + i, n - i);
+}
+
+// All ones in the lanes where the pixel is background.
+inline __m128i Background4(__m128i pixels, const uint32_t *windowSums,
+                           const float *area, __m128 scale) {
+  __m128 lhs = _mm_mul_ps(_mm_cvtepi32_ps(pixels), _mm_loadu_ps(area));
+  __m128 rhs = _mm_mul_ps(
+      _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)windowSums)), scale);
+  return _mm_castps_si128(_mm_cmpgt_ps(lhs, rhs));
+}
+
+void SSE2ThresholdRow(const uint8_t *pixels, const uint32_t *windowSums,
+                      const float *area, float scale, uint8_t *out, size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 factor = _mm_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)(pixels + i));
+    __m128i lo = _mm_unpacklo_epi8(bytes, zero), hi = _mm_unpackhi_epi8(bytes, zero);
+    __m128i m0 = Background4(_mm_unpacklo_epi16(lo, zero), windowSums + i, area + i, factor);
+    __m128i m1 = Background4(_mm_unpackhi_epi16(lo, zero), windowSums + i + 4, area + i + 4, factor);
+    __m128i m2 = Background4(_mm_unpacklo_epi16(hi, zero), windowSums + i + 8, area + i + 8, factor);
+    __m128i m3 = Background4(_mm_unpackhi_epi16(hi, zero), windowSums + i + 12, area + i + 12, factor);
+    // Signed saturation keeps all ones as 0xff
+    __m128i packed = _mm_packs_epi16(_mm_packs_epi32(m0, m1), _mm_packs_epi32(m2, m3));
+    _mm_storeu_si128((__m128i *)(out + i), packed);
+  }
+  ScalarImageKernels().thresholdRow(pixels + i, windowSums + i, area + i, scale,
+                                    out + i, n - i);
+}
+
+TARGET_AVX2 inline __m256i Gray8(__m256i pixels, __m256i even, __m256i odd) {
+  const __m256i mask = _mm256_set1_epi32(0x00ff00ff);
+  __m256i sum = _mm256_add_epi32(
+      _mm256_madd_epi16(_mm256_and_si256(pixels, mask), even),
+      _mm256_madd_epi16(_mm256_srli_epi16(pixels, 8), odd));
+  return _mm256_srli_epi32(sum, 8);
+}
+
+TARGET_AVX2 void AVX2GrayRow(const uint8_t *in, uint8_t *out, size_t pixels,
+                             bool bgr) {
+  const __m256i even = _mm256_set1_epi32(EvenWeights(bgr));
+  const __m256i odd = _mm256_set1_epi32(ODD_WEIGHTS);
+  // The packs work within 128-bit lanes; this puts the pixels back in order
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  size_t i = 0;
+  for (; i + 32 <= pixels; i += 32) {
+    const uint8_t *p = in + i * 4;
+    __m256i g0 = Gray8(_mm256_loadu_si256((const __m256i *)p), even, odd);
+    __m256i g1 = Gray8(_mm256_loadu_si256((const __m256i *)(p + 32)), even, odd);
+    __m256i g2 = Gray8(_mm256_loadu_si256((const __m256i *)(p + 64)), even, odd);
+    __m256i g3 = Gray8(_mm256_loadu_si256((const __m256i *)(p + 96)), even, odd);
+    __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(g0, g1),
+                                         _mm256_packs_epi32(g2, g3));
+    _mm256_storeu_si256((__m256i *)(out + i),
+                        _mm256_permutevar8x32_epi32(packed, order));
+  }
+  SSE2GrayRow(in + i * 4, out + i, pixels - i, bgr);
+}
+
+TARGET_AVX2 void AVX2AccumulateRow(const uint8_t *row, uint16_t *sums, size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i *)(row + i));
+    __m256i *s = (__m256i *)(sums + i);
+    __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+    __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+    _mm256_storeu_si256(s, _mm256_add_epi16(_mm256_loadu_si256(s), lo));
+    _mm256_storeu_si256(s + 1, _mm256_add_epi16(_mm256_loadu_si256(s + 1), hi));
+  }
+  SSE2AccumulateRow(row + i, sums + i, n - i);
+}
+
+TARGET_AVX2 void AVX2SlideColumns(uint32_t *sums, const uint8_t *add,
+                                  const uint8_t *sub, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i diff = _mm256_sub_epi16(
+        _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(add + i))),
+        _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(sub + i))));
+    __m256i *s = (__m256i *)(sums + i);
+    _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s),
+                                            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(diff))));
+    _mm256_storeu_si256(s + 1, _mm256_add_epi32(_mm256_loadu_si256(s + 1),
+                                                _mm256_cvtepi16_epi32(_mm256_extracti128_si256(diff, 1))));
+  }
+  SSE2SlideColumns(sums + i, add + i, sub + i, n - i);
+}
+
+TARGET_AVX2 inline __m256i Background8(__m256i pixels, const uint32_t *windowSums,
+                                       const float *area, __m256 scale) {
+  __m256 lhs = _mm256_mul_ps(_mm256_cvtepi32_ps(pixels), _mm256_loadu_ps(area));
+  __m256 rhs = _mm256_mul_ps(
+      _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)windowSums)), scale);
+  return _mm256_castps_si256(_mm256_cmp_ps(lhs, rhs, _CMP_GT_OQ));
+}
+
+TARGET_AVX2 void AVX2ThresholdRow(const uint8_t *pixels, const uint32_t *windowSums,
+                                  const float *area, float scale, uint8_t *out,
+                                  size_t n) {
+  const __m256 factor = _mm256_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)(pixels + i));
+    __m256i m0 = Background8(_mm256_cvtepu8_epi32(bytes), windowSums + i, area + i, factor);
+    __m256i m1 = Background8(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)),
+                             windowSums + i + 8, area + i + 8, factor);
+    // [m0 0-3, m1 0-3 | m0 4-7, m1 4-7] reordered to [m0 | m1]
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(m0, m1), 0xd8);
+    __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(words),
+                                     _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128((__m128i *)(out + i), packed);
+  }
+  SSE2ThresholdRow(pixels + i, windowSums + i, area + i, scale, out + i, n - i);
+}
+
+const ImageKernels SSE2 = {"sse2", SSE2GrayRow, SSE2AccumulateRow,
+                           SSE2SlideColumns, SSE2ThresholdRow};
+const ImageKernels AVX2 = {"avx2", AVX2GrayRow, AVX2AccumulateRow,
+                           AVX2SlideColumns, AVX2ThresholdRow};
+
+} // namespace
+
+const ImageKernels *SSE2ImageKernels() { return &SSE2; }
+const ImageKernels *AVX2ImageKernels() { return &AVX2; }
+
+#else
+
+const ImageKernels *SSE2ImageKernels() { return nullptr; }
+const ImageKernels *AVX2ImageKernels() { return nullptr; }
+
+#endif
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ImagePreprocess.h"
+#include "NativeStats.h"
+
+namespace {
+
+// Half the side of the binarization window, in preprocessed pixels: a few
+// lines of screen text, so that the mean is taken over text and background.
+const size_t BINARIZE_RADIUS = 15;
+
+// A pixel is background when it is brighter than this fraction of the mean
+// of its window (Bradley and Roth use 85%).
+const float BINARIZE_RATIO = 0.85f;
+
+// Row `y` of the source as gray8: the row itself for gray8 frames,
+// otherwise converted into `scratch`.
+const uint8_t *SourceGrayRow(const OCRImage &image, const ImageKernels &kernels,
+                             size_t y, uint8_t *scratch) {
+  const uint8_t *row = image.data + y * image.stride;
+  if (image.format == OCR_FORMAT_GRAY8) {
+    return row;
+  }
+  kernels.grayRow(row, scratch, image.width, image.format == OCR_FORMAT_BGRA);
+  return scratch;
+}
+
+// dest[x] = the rounded mean of the `scale` column sums of block x, given
+// the reciprocal of scale * scale. A constant SCALE lets the compiler unroll
+// and vectorize the common factors; 0 reads `scale` instead.
+template <size_t SCALE>
+void ReduceBlocks(const uint16_t *sums, uint8_t *dest, size_t width,
+                  uint64_t reciprocal, size_t scale = SCALE) {
+  const uint32_t half = uint32_t(scale * scale / 2);
+  for (size_t x = 0; x < width; x++, sums += scale) {
+    uint32_t total = half;
+    for (size_t dx = 0; dx < scale; dx++) {
+      total += sums[dx];
+    }
+    dest[x] = uint8_t((total * reciprocal) >> 24);
+  }
+}
+
+void Grayscale(const OCRImage &image, const ImageKernels &kernels,
+               PreprocessedImage *out) {
+  const size_t width = out->width, height = out->height, scale = out->scale;
+  if (scale == 1) {
+    for (size_t y = 0; y < height; y++) {
+      uint8_t *dest = out->pixels.data() + y * width;
+      const uint8_t *row = SourceGrayRow(image, kernels, y, dest);
+      if (row != dest) {
+        memcpy(dest, row, width);
+      }
+    }
+    return;
+  }
+
+  // Each output row adds up `scale` source rows column by column, then
+  // `scale` columns at a time. At most 8 * 255 per column fits in 16 bits.
+  std::vector<uint8_t> scratch(image.width);
+  std::vector<uint16_t> sums(width * scale);
+  const uint32_t area = uint32_t(scale * scale);
+  // Rounded division by `area` as a multiply: exact since the dividend is
+  // below 2^15 and the reciprocal's error below 64
+  const uint64_t reciprocal = ((uint64_t(1) << 24) + area - 1) / area;
+  for (size_t y = 0; y < height; y++) {
+    std::fill(sums.begin(), sums.end(), 0);
+    for (size_t dy = 0; dy < scale; dy++) {
+      kernels.accumulateRow(SourceGrayRow(image, kernels, y * scale + dy, scratch.data()),
+                            sums.data(), sums.size());
+    }
+    uint8_t *dest = out->pixels.data() + y * width;
+    switch (scale) {
+    case 2:
+      ReduceBlocks<2>(sums.data(), dest, width, reciprocal);
+      break;
+    case 3:
+      ReduceBlocks<3>(sums.data(), dest, width, reciprocal);
+      break;
+    case 4:
+      ReduceBlocks<4>(sums.data(), dest, width, reciprocal);
+      break;
+    default:
+      ReduceBlocks<0>(sums.data(), dest, width, reciprocal, scale);
+      break;
+    }
+  }
+}
+
+// Bradley-Roth adaptive thresholding: keeps the vertical sums of the window
+// around the current row per column and slides them down one row at a time,
+// then adds up each window horizontally through a prefix sum.
+void Binarize(const ImageKernels &kernels, PreprocessedImage *image) {
+  const size_t width = image->width, height = image->height;
+  const size_t radius = BINARIZE_RADIUS;
+  const uint8_t *gray = image->pixels.data();
+  std::vector<uint8_t> binary(width * height), zeros(width, 0);
+  std::vector<uint32_t> columns(width, 0), prefix(width + 1, 0), windowSums(width);
+  std::vector<float> span(width), area(width);
+  for (size_t x = 0; x < width; x++) {
+    span[x] = float(std::min(width - 1, x + radius) - (x >= radius ? x - radius : 0) + 1);
+  }
+
+  size_t added = 0, removed = 0, areaRows = 0;
+  for (size_t y = 0; y < height; y++) {
+    const size_t begin = y >= radius ? y - radius : 0;
+    const size_t end = std::min(height, y + radius + 1);
+    while (added < end || removed < begin) {
+      const uint8_t *add = added < end ? gray + added++ * width : zeros.data();
+      const uint8_t *sub = removed < begin ? gray + removed++ * width : zeros.data();
+      kernels.slideColumns(columns.data(), add, sub, width);
+    }
+    // The window only changes height near the top and bottom edges
+    if (end - begin != areaRows) {
+      areaRows = end - begin;
+      for (size_t x = 0; x < width; x++) {
+        area[x] = span[x] * float(areaRows);
+      }
+    }
+
+    for (size_t x = 0; x < width; x++) {
+      prefix[x + 1] = prefix[x] + columns[x];
+    }
+    // Windows clipped by the left edge, whole windows, then the right edge
+    const size_t left = std::min(radius, width);
+    const size_t right = width > radius ? width - radius : 0;
+    size_t x = 0;
+    for (; x < left; x++) {
+      windowSums[x] = prefix[std::min(width, x + radius + 1)];
+    }
+    for (; x < right; x++) {
+      windowSums[x] = prefix[x + radius + 1] - prefix[x - radius];
+    }
+    for (; x < width; x++) {
+      windowSums[x] = prefix[width] - prefix[x >= radius ? x - radius : 0];
+    }
+    kernels.thresholdRow(gray + y * width, windowSums.data(), area.data(),
+                         BINARIZE_RATIO, binary.data() + y * width, width);
+  }
+  image->pixels.swap(binary);
+}
+
+} // namespace
+
+bool PreprocessImage(const OCRImage &image, const OCRPreprocessOptions &options,
+                     const ImageKernels &kernels, PreprocessedImage *out) {
+  if (image.format == OCR_FORMAT_PNG) {
+    return false;
+  }
+  size_t scale = std::min(std::max<size_t>(options.downscale, 1), MAX_PREPROCESS_DOWNSCALE);
+  // Smaller than one block: keep the frame as it is
+  if (image.width < scale || image.height < scale) {
+    scale = 1;
+  }
+  out->scale = scale;
+  out->width = image.width / scale;
+  out->height = image.height / scale;
+  out->pixels.resize(out->width * out->height);
+
+  Grayscale(image, kernels, out);
+  if (options.binarize) {
+    Binarize(kernels, out);
+  }
+  return true;
+}
+
+OCRData RecognizeWithPreprocessing(OCRBackend &backend, const OCRImage &image,
+                                   const OCROptions &options) {
+  if (!options.preprocess.enabled || image.format == OCR_FORMAT_PNG) {
+    return backend.Recognize(image, options);
+  }
+  static ExportStats *stats = NativeStats::Export("ocrImage:preprocess");
+  PreprocessedImage preprocessed;
+  {
+    ExportTimer timer(stats);
+    PreprocessImage(image, options.preprocess, ActiveImageKernels(), &preprocessed);
+  }
+
+  OCRImage gray{preprocessed.pixels.data(), preprocessed.pixels.size(), OCR_FORMAT_GRAY8,
+                preprocessed.width, preprocessed.height, preprocessed.width};
+  OCRData data = backend.Recognize(gray, options);
+  const size_t scale = preprocessed.scale;
+  if (scale > 1) {
+    // Back to the coordinates of the frame that was passed in
+    for (OCRObservation &observation : data.observations) {
+      Rectangle &bbox = observation.bbox;
+      bbox.x = std::min(bbox.x * scale, image.width);
+      bbox.y = std::min(bbox.y * scale, image.height);
+      bbox.width = std::min(bbox.width * scale, image.width - bbox.x);
+      bbox.height = std::min(bbox.height * scale, image.height - bbox.y);
+    }
+  }
+  return data;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ImageKernels.h"
+#include "OCR.h"
+
+// The stage in front of the OCR backend, for raw frames: grayscale, an
+// optional box downscale by an integer factor, and optional adaptive
+// (Bradley) binarization. Recognition engines do the same internally at
+// full resolution and in color; doing it here with SIMD kernels hands
+// them a fraction of the bytes.
+struct PreprocessedImage {
+  // width * height gray8 pixels, without padding
+  std::vector<uint8_t> pixels;
+  size_t width;
+  size_t height;
+  // Pixels of the original per pixel of `pixels`, in each direction
+  size_t scale;
+};
+
+// Box downscales are limited to this factor
+const size_t MAX_PREPROCESS_DOWNSCALE = 8;
+
+// False for PNG images, which the backends decode themselves.
+bool PreprocessImage(const OCRImage &image, const OCRPreprocessOptions &options,
+                     const ImageKernels &kernels, PreprocessedImage *out);
+
+// Runs `backend` on the preprocessed frame when options.preprocess asks for
+// it, and maps the boxes back to the coordinates of `image`.
+OCRData RecognizeWithPreprocessing(OCRBackend &backend, const OCRImage &image,
+                                   const OCROptions &options);
@@ -0,0 +1,136 @@
+#include <unordered_map>
+#include <utility>
+
+#include "Marshal.h"
+
+namespace {
+
+// Held as the addon's instance data, so each env (main thread, workers)
+// has its own keys and drops them on teardown. Each type's keys sit in a JS
+// array: before Node-API 10 references can only point at objects.
+struct KeyStore {
+  std::unordered_map<const void *, napi_ref> types;
+  // EnvReferences
+  std::unordered_map<const void *, napi_ref> objects;
+  // EnvState, with the function that deletes each
+  std::unordered_map<const void *, std::pair<void *, void (*)(void *)>> states;
+};
+
+void DeleteKeyStore(napi_env, void *data, void *) {
+  KeyStore *store = static_cast<KeyStore *>(data);
+  for (auto &state : store->states) {
+    state.second.second(state.second.first);
+  }
+  delete store;
+}
+
+KeyStore *SharedKeyStore(napi_env env) {
+  void *data = nullptr;
+  if (napi_get_instance_data(env, &data) == napi_ok && data != nullptr) {
+    return static_cast<KeyStore *>(data);
+  }
+  KeyStore *store = new KeyStore();
+  if (napi_set_instance_data(env, store, DeleteKeyStore, nullptr) != napi_ok) {
+    delete store;
+    return nullptr;
+  }
+  return store;
+}
+
+} // namespace
+
+namespace Marshal {
+
+bool PropertyKeys::Get(napi_env env, const void *type,
+                       const char *const *names, size_t count,
+                       napi_value *keys) {
+  KeyStore *store = SharedKeyStore(env);
+  if (store == nullptr) {
+    return false;
+  }
+
+  napi_value array = nullptr;
+  napi_ref &ref = store->types[type];
+  if (ref == nullptr) {
+    if (napi_create_array_with_length(env, count, &array) != napi_ok) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      napi_value key = nullptr;
+      if (napi_create_string_utf8(env, names[i], NAPI_AUTO_LENGTH, &key) != napi_ok ||
+          napi_set_element(env, array, uint32_t(i), key) != napi_ok) {
+        return false;
+      }
+    }
+    if (napi_create_reference(env, array, 1, &ref) != napi_ok) {
+      ref = nullptr;
+      return false;
+    }
+  } else if (napi_get_reference_value(env, ref, &array) != napi_ok) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (napi_get_element(env, array, uint32_t(i), &keys[i]) != napi_ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EnvReferences::Set(napi_env env, const void *tag, napi_value value) {
+  KeyStore *store = SharedKeyStore(env);
+  if (store == nullptr) {
+    return false;
+  }
+
+  auto it = store->objects.find(tag);
+  if (it != store->objects.end()) {
+    napi_delete_reference(env, it->second);
+    store->objects.erase(it);
+  }
+  if (value == nullptr) {
+    return true;
+  }
+  napi_ref ref = nullptr;
+  if (napi_create_reference(env, value, 1, &ref) != napi_ok) {
+    return false;
+  }
+  store->objects[tag] = ref;
+  return true;
+}
+
+napi_value EnvReferences::Get(napi_env env, const void *tag) {
+  KeyStore *store = SharedKeyStore(env);
+  if (store == nullptr) {
+    return nullptr;
+  }
+  auto it = store->objects.find(tag);
+  napi_value value = nullptr;
+  if (it == store->objects.end() ||
+      napi_get_reference_value(env, it->second, &value) != napi_ok) {
+    return nullptr;
+  }
+  return value;
+}
+
+void *EnvState::Find(napi_env env, const void *tag) {
+  KeyStore *store = SharedKeyStore(env);
+  if (store == nullptr) {
+    return nullptr;
+  }
+  auto it = store->states.find(tag);
+  return it == store->states.end() ? nullptr : it->second.first;
+}
+
+bool EnvState::Add(napi_env env, const void *tag, void *state,
+                   void (*destroy)(void *)) {
+  KeyStore *store = SharedKeyStore(env);
+  if (store == nullptr) {
+    return false;
+  }
+  store->states[tag] = std::make_pair(state, destroy);
+  return true;
+}
+
+} // namespace Marshal
@@ -0,0 +1,202 @@
+#pragma once
+#include <napi.h>
+
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Struct to JS object conversion driven by field descriptors. A type opts in
+// by specializing MarshalFields:
+//
+//   template <> struct MarshalFields<RenderProcessInfo> {
+//     static auto Get() {
+//       return std::make_tuple(Marshal::Field("processName", &RenderProcessInfo::processName),
+//                              Marshal::Field("processId", &RenderProcessInfo::processId));
+//     }
+//   };
+//
+// Marshal::ToArray() then creates the property keys once per env instead of
+// once per element, and defines all fields of an element in one
+// napi_define_properties call.
+template <typename Struct> struct MarshalFields;
+
+namespace Marshal {
+
+template <typename Struct, typename Getter> struct FieldDescriptor {
+  const char *name;
+  Getter get;
+};
+
+template <typename Struct, typename Member> struct MemberGetter {
+  Member Struct::*member;
+  const Member &operator()(const Struct &value) const { return value.*member; }
+};
+
+// A field read from a data member
+template <typename Struct, typename Member>
+FieldDescriptor<Struct, MemberGetter<Struct, Member>>
+Field(const char *name, Member Struct::*member) {
+  return {name, MemberGetter<Struct, Member>{member}};
+}
+
+// A field computed from the whole struct
+template <typename Struct, typename Getter>
+FieldDescriptor<Struct, Getter> Computed(const char *name, Getter get) {
+  return {name, get};
+}
+
+inline napi_value ToValue(napi_env env, const std::string &value) {
+  napi_value result = nullptr;
+  napi_create_string_utf8(env, value.data(), value.size(), &result);
+  return result;
+}
+
+inline napi_value ToValue(napi_env env, bool value) {
+  napi_value result = nullptr;
+  napi_get_boolean(env, value, &result);
+  return result;
+}
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, napi_value>::type
+ToValue(napi_env env, T value) {
+  napi_value result = nullptr;
+  napi_create_double(env, double(value), &result);
+  return result;
+}
+
+// Property keys of one struct type in one env. The JS strings are created
+// on first use and kept alive by references until the env goes away.
+class PropertyKeys {
+public:
+  // `type` identifies the struct; `names` are only read on the first call
+  // for that type.
+  static bool Get(napi_env env, const void *type, const char *const *names,
+                  size_t count, napi_value *keys);
+};
+
+// Objects the addon keeps per env, such as the constructors of its
+// ObjectWrap classes. They live in the same instance data as the property
+// keys, so each worker has its own and they go away with the env; a static
+// reference would be overwritten by the next env and point into the wrong
+// one.
+class EnvReferences {
+public:
+  // Keeps `value` under `tag`, replacing what was kept before; null drops
+  // the reference.
+  static bool Set(napi_env env, const void *tag, napi_value value);
+  // The object kept under `tag`, or null
+  static napi_value Get(napi_env env, const void *tag);
+};
+
+template <typename Struct> const void *TypeTag() {
+  static const char tag = 0;
+  return &tag;
+}
+
+// Native state the addon keeps per env, next to the references above. One
+// object of each type is created on first use and deleted with the env.
+class EnvState {
+public:
+  template <typename T> static T *Get(napi_env env) {
+    void *state = Find(env, TypeTag<T>());
+    if (state != nullptr) {
+      return static_cast<T *>(state);
+    }
+    T *created = new T();
+    if (!Add(env, TypeTag<T>(), created,
+             [](void *data) { delete static_cast<T *>(data); })) {
+      delete created;
+      return nullptr;
+    }
+    return created;
+  }
+
+private:
+  static void *Find(napi_env env, const void *tag);
+  static bool Add(napi_env env, const void *tag, void *state,
+                  void (*destroy)(void *));
+};
+
+template <typename Struct> class ObjectBuilder {
+public:
+  typedef decltype(MarshalFields<Struct>::Get()) Fields;
+  static const size_t COUNT = std::tuple_size<Fields>::value;
+
+  explicit ObjectBuilder(napi_env env)
+      : env_(env), fields_(MarshalFields<Struct>::Get()), ready_(false) {
+    const char *names[COUNT];
+    Names(names, std::make_index_sequence<COUNT>());
+    ready_ = PropertyKeys::Get(env, TypeTag<Struct>(), names, COUNT, keys_);
+  }
+
+  napi_value Build(const Struct &value) {
+    napi_value object = nullptr;
+    if (!ready_ || napi_create_object(env_, &object) != napi_ok) {
+      return nullptr;
+    }
+    napi_property_descriptor descriptors[COUNT];
+    Describe(value, descriptors, std::make_index_sequence<COUNT>());
+    if (napi_define_properties(env_, object, COUNT, descriptors) != napi_ok) {
+      return nullptr;
+    }
+    return object;
+  }
+
+private:
+  template <size_t... I>
+  void Names(const char **names, std::index_sequence<I...>) {
+    int unused[] = {0, (names[I] = std::get<I>(fields_).name, 0)...};
+    (void)unused;
+  }
+
+  template <size_t... I>
+  void Describe(const Struct &value, napi_property_descriptor *descriptors,
+                std::index_sequence<I...>) {
+    int unused[] = {
+        0, (descriptors[I] = Descriptor(
+                keys_[I], ToValue(env_, std::get<I>(fields_).get(value))),
+            0)...};
+    (void)unused;
+  }
+
+  static napi_property_descriptor Descriptor(napi_value key, napi_value value) {
+    // The attributes of a plain assignment
+    napi_property_descriptor descriptor = {
+        nullptr, key,    nullptr, nullptr, nullptr, value,
+        static_cast<napi_property_attributes>(napi_writable | napi_enumerable |
+                                              napi_configurable),
+        nullptr};
+    return descriptor;
+  }
+
+  napi_env env_;
+  Fields fields_;
+  napi_value keys_[COUNT];
+  bool ready_;
+};
+
+template <typename Struct>
+Napi::Object ToObject(Napi::Env env, const Struct &value) {
+  ObjectBuilder<Struct> builder(env);
+  return Napi::Object(env, builder.Build(value));
+}
+
+template <typename Struct>
+Napi::Array ToArray(Napi::Env env, const std::vector<Struct> &values) {
+  Napi::Array result = Napi::Array::New(env, values.size());
+  ObjectBuilder<Struct> builder(env);
+  for (size_t i = 0; i < values.size(); i++) {
+    napi_value object = builder.Build(values[i]);
+    if (object == nullptr) {
+      break;
+    }
+    napi_set_element(env, result, uint32_t(i), object);
+  }
+  return result;
+}
+
+} // namespace Marshal
@@ -0,0 +1,389 @@
+#include <algorithm>
+
+#include "Marshal.h"
+#include "MicMonitorHub.h"
+#include "NativeStats.h"
+#include "NativeStatsExports.h"
+
+// Same value as INFO_ERROR_CODE in index.js
+static const int INFO_ERROR_CODE = 1;
+
+// Tags of the per-env references: the MicMonitor class, and the
+// subscription behind startMonitoringMic/stopMonitoringMic
+static const char micMonitorClass = 0;
+static const char legacyMonitor = 0;
+
+bool MicSubscriberFilter::Matches(const MonitorEvent &event) const {
+  if (event.hasError) {
+    return event.code == INFO_ERROR_CODE ? info : errors;
+  }
+  if (!state) {
+    return false;
+  }
+  if (event.device == 0) {
+    return devices.empty();
+  }
+
+  for (const auto &name : devices) {
+    if (name == "*" || name == event.deviceName) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Napi::Function MicMonitorHandle::Define(Napi::Env env) {
+  return DefineClass(env, "MicMonitor",
+                     {InstanceMethod("close", &MicMonitorHandle::Close),
+                      InstanceAccessor("closed", &MicMonitorHandle::IsClosed,
+                                       nullptr)});
+}
+
+static std::vector<std::string> readStringList(const Napi::Value &value) {
+  std::vector<std::string> result;
+  if (value.IsString()) {
+    result.push_back(value.As<Napi::String>().Utf8Value());
+  } else if (value.IsArray()) {
+    Napi::Array array = value.As<Napi::Array>();
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      Napi::Value item = array.Get(i);
+      if (item.IsString()) {
+        result.push_back(item.As<Napi::String>().Utf8Value());
+      }
+    }
+  }
+  return result;
+}
+
+// Accepts createMicMonitor({ callback, ...options }) as well as
+// createMicMonitor(callback, options).
+MicMonitorHandle::MicMonitorHandle(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<MicMonitorHandle>(info), subscribed_(false) {
+  Napi::Env env = info.Env();
+
+  Napi::Value callback;
+  Napi::Value options = env.Undefined();
+  if (info[0].IsFunction()) {
+    callback = info[0];
+    options = info[1];
+  } else if (info[0].IsObject()) {
+    options = info[0];
+    callback = options.As<Napi::Object>().Get("callback");
+  }
+
+  if (callback.IsEmpty() || !callback.IsFunction()) {
+    Napi::TypeError::New(env, "Expected a callback function")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+  callback_ = Napi::Persistent(callback.As<Napi::Function>());
+
+  if (options.IsObject()) {
+    Napi::Object object = options.As<Napi::Object>();
+    Napi::Value events = object.Get("events");
+    if (!events.IsUndefined()) {
+      std::vector<std::string> names = readStringList(events);
+      filter_.state = std::find(names.begin(), names.end(), "state") != names.end();
+      filter_.errors = std::find(names.begin(), names.end(), "error") != names.end();
+      filter_.info = std::find(names.begin(), names.end(), "info") != names.end();
+    }
+    filter_.devices = readStringList(object.Get("devices"));
+  }
+
+  std::string error;
+  if (!MicMonitorEnv::Of(env)->Subscribe(
+          env, this, ReadEventDispatcherOptions(options), &error)) {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return;
+  }
+  subscribed_ = true;
+}
+
+// Runs from the garbage collector's finalizer when close() was not called.
+MicMonitorHandle::~MicMonitorHandle() { Detach(); }
+
+void MicMonitorHandle::Detach() {
+  if (!subscribed_) {
+    return;
+  }
+  subscribed_ = false;
+  MicMonitorEnv::Of(Env())->Unsubscribe(this);
+  callback_.Reset();
+}
+
+// Calls callback(active, error) for aggregate events and
+// callback(active, null, { id, name }) for per-device ones.
+void MicMonitorHandle::Deliver(Napi::Env env, const MonitorEvent &event) {
+  if (event.device != 0) {
+    Napi::Object device = Napi::Object::New(env);
+    device.Set("id", Napi::Number::New(env, event.device));
+    device.Set("name", Napi::String::New(env, event.deviceName));
+    callback_.Call({Napi::Boolean::New(env, event.active), env.Null(), device});
+  } else {
+    CallMonitorCallback(env, callback_.Value(), event);
+  }
+
+  // One throwing subscriber must not starve the others; report the exception
+  // as uncaught, as it would be for a callback invoked directly from native.
+  if (env.IsExceptionPending()) {
+    Napi::Error error = env.GetAndClearPendingException();
+    napi_fatal_exception(env, error.Value());
+  }
+}
+
+Napi::Value MicMonitorHandle::Close(const Napi::CallbackInfo &info) {
+  Detach();
+  return info.Env().Undefined();
+}
+
+Napi::Value MicMonitorHandle::IsClosed(const Napi::CallbackInfo &info) {
+  return Napi::Boolean::New(info.Env(), !subscribed_);
+}
+
+MicMonitorEnv *MicMonitorEnv::Of(Napi::Env env) {
+  return Marshal::EnvState::Get<MicMonitorEnv>(env);
+}
+
+MicMonitorEnv::MicMonitorEnv()
+    : env_(nullptr), dispatcher_(nullptr), delivering_(0), compact_(false) {}
+
+bool MicMonitorEnv::Subscribe(Napi::Env env, MicMonitorHandle *handle,
+                              const EventDispatcherOptions &options,
+                              std::string *error) {
+  if (dispatcher_ == nullptr) {
+    // Capacity and coalescing are taken from the subscriber that starts the
+    // env's subscription.
+    Napi::Function unused = Napi::Function::New(env, [](const Napi::CallbackInfo &) {});
+    EventDispatcher *dispatcher = EventDispatcher::Create(
+        env, unused, "MicListener", options, MicMonitorHub::Shared().Stats(),
+        [this](Napi::Env env, Napi::Function, const MonitorEvent &event) {
+          Deliver(env, event);
+        });
+    if (!MicMonitorHub::Shared().Attach(dispatcher, error)) {
+      dispatcher->Close();
+      return false;
+    }
+
+    // Added after the dispatcher's thread-safe function, so it runs before
+    // Node finalizes that on exit.
+    dispatcher_ = dispatcher;
+    env_ = env;
+    napi_add_env_cleanup_hook(env_, Cleanup, this);
+  }
+
+  subscribers_.push_back(handle);
+  return true;
+}
+
+void MicMonitorEnv::Unsubscribe(MicMonitorHandle *handle) {
+  auto it = std::find(subscribers_.begin(), subscribers_.end(), handle);
+  if (it == subscribers_.end()) {
+    return;
+  }
+
+  if (delivering_ > 0) {
+    *it = nullptr;
+    compact_ = true;
+  } else {
+    subscribers_.erase(it);
+  }
+
+  if (SubscriberCount() == 0) {
+    Shutdown();
+  }
+}
+
+void MicMonitorEnv::Shutdown() {
+  if (dispatcher_ == nullptr) {
+    return;
+  }
+  MicMonitorHub::Shared().Detach(dispatcher_);
+  dispatcher_->Close();
+  dispatcher_ = nullptr;
+  if (env_ != nullptr) {
+    napi_remove_env_cleanup_hook(env_, Cleanup, this);
+    env_ = nullptr;
+  }
+}
+
+void MicMonitorEnv::Cleanup(void *data) {
+  MicMonitorEnv *self = static_cast<MicMonitorEnv *>(data);
+  // The hook is already being run and must not be removed again.
+  self->env_ = nullptr;
+
+  std::vector<MicMonitorHandle *> handles = self->subscribers_;
+  for (MicMonitorHandle *handle : handles) {
+    if (handle != nullptr) {
+      handle->Detach();
+    }
+  }
+  self->Shutdown();
+}
+
+size_t MicMonitorEnv::SubscriberCount() const {
+  return subscribers_.size() -
+         size_t(std::count(subscribers_.begin(), subscribers_.end(), nullptr));
+}
+
+void MicMonitorEnv::Deliver(Napi::Env env, const MonitorEvent &event) {
+  Napi::HandleScope scope(env);
+
+  // Subscribers added by a callback start with the next event.
+  size_t count = subscribers_.size();
+  delivering_++;
+  for (size_t i = 0; i < count; i++) {
+    MicMonitorHandle *handle = subscribers_[i];
+    if (handle != nullptr && handle->Filter().Matches(event)) {
+      handle->Deliver(env, event);
+    }
+  }
+  delivering_--;
+
+  if (delivering_ == 0 && compact_) {
+    subscribers_.erase(
+        std::remove(subscribers_.begin(), subscribers_.end(), nullptr),
+        subscribers_.end());
+    compact_ = false;
+  }
+}
+
+MicMonitorHub &MicMonitorHub::Shared() {
+  static MicMonitorHub *hub = new MicMonitorHub();
+  return *hub;
+}
+
+MicMonitorHub::MicMonitorHub() : stats_(std::make_shared<EventDeliveryStats>()) {}
+
+void MicMonitorHub::SetBackendFactory(MicMonitorBackendFactory factory) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  factory_ = std::move(factory);
+}
+
+bool MicMonitorHub::Attach(EventDispatcher *target, std::string *error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!backend_ && !factory_) {
+    *error = "Microphone monitoring is not supported on this platform";
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> targets(targetsMutex_);
+    targets_.push_back(target);
+  }
+  if (backend_) {
+    return true;
+  }
+
+  NativeCounter *events = NativeStats::Counter("micMonitor.events");
+  NativeStats::Counter("micMonitor.starts")->Add();
+  backend_ = factory_();
+  if (!backend_->Start(
+          [this, events](MonitorEvent &&event) {
+            events->Add();
+            Publish(std::move(event));
+          },
+          error)) {
+    backend_.reset();
+    std::lock_guard<std::mutex> targets(targetsMutex_);
+    targets_.clear();
+    return false;
+  }
+  return true;
+}
+
+void MicMonitorHub::Detach(EventDispatcher *target) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool last = false;
+  {
+    std::lock_guard<std::mutex> targets(targetsMutex_);
+    targets_.erase(std::remove(targets_.begin(), targets_.end(), target),
+                   targets_.end());
+    last = targets_.empty();
+  }
+  if (last && backend_) {
+    backend_->Stop();
+    backend_.reset();
+  }
+}
+
+void MicMonitorHub::Inject(MonitorEvent &&event) { Publish(std::move(event)); }
+
+// Push() never blocks, so the lock is only held for the copies.
+void MicMonitorHub::Publish(MonitorEvent &&event) {
+  std::lock_guard<std::mutex> lock(targetsMutex_);
+  if (targets_.size() == 1) {
+    targets_[0]->Push(std::move(event));
+    return;
+  }
+  for (EventDispatcher *target : targets_) {
+    MonitorEvent copy = event;
+    target->Push(std::move(copy));
+  }
+}
+
+static Napi::Object NewMicMonitor(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Function constructor(env, Marshal::EnvReferences::Get(env, &micMonitorClass));
+  return constructor.New({info[0], info[1]});
+}
+
+static Napi::Value CreateMicMonitor(const Napi::CallbackInfo &info) {
+  return NewMicMonitor(info);
+}
+
+static void CloseLegacyMonitor(Napi::Env env) {
+  napi_value handle = Marshal::EnvReferences::Get(env, &legacyMonitor);
+  if (handle != nullptr) {
+    MicMonitorHandle::Unwrap(Napi::Object(env, handle))->Detach();
+    Marshal::EnvReferences::Set(env, &legacyMonitor, nullptr);
+  }
+}
+
+// Start monitoring microphone usage. Calling it again replaces the previous
+// callback instead of leaking it.
+static Napi::Value StartMonitoringMic(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsFunction()) {
+    Napi::TypeError::New(env, "Expected a callback function")
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  CloseLegacyMonitor(env);
+  Napi::Object handle = NewMicMonitor(info);
+  if (env.IsExceptionPending()) {
+    return env.Null();
+  }
+  Marshal::EnvReferences::Set(env, &legacyMonitor, handle);
+
+  return Napi::Boolean::New(env, true);
+}
+
+// Stop monitoring microphone usage
+static Napi::Value StopMonitoringMic(const Napi::CallbackInfo &info) {
+  CloseLegacyMonitor(info.Env());
+  return info.Env().Undefined();
+}
+
+// Delivery counters of the microphone monitor since the module was loaded,
+// and the subscriptions open in the calling env
+static Napi::Value GetMicMonitorStats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Object result =
+      EventDeliveryStatsToObject(env, *MicMonitorHub::Shared().Stats());
+  result.Set("subscribers",
+             Napi::Number::New(env, double(MicMonitorEnv::Of(env)->SubscriberCount())));
+  return result;
+}
+
+void MicMonitorHub::Init(Napi::Env env, Napi::Object exports,
+                         MicMonitorBackendFactory factory) {
+  Shared().SetBackendFactory(std::move(factory));
+  Marshal::EnvReferences::Set(env, &micMonitorClass, MicMonitorHandle::Define(env));
+
+  exports.Set("createMicMonitor", TimedFunction(env, "createMicMonitor", CreateMicMonitor));
+  exports.Set("startMonitoringMic", TimedFunction(env, "startMonitoringMic", StartMonitoringMic));
+  exports.Set("stopMonitoringMic", TimedFunction(env, "stopMonitoringMic", StopMonitoringMic));
+  exports.Set("getMicMonitorStats", TimedFunction(env, "getMicMonitorStats", GetMicMonitorStats));
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <napi.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "EventDispatcher.h"
+
+typedef std::function<void(MonitorEvent &&)> MonitorEventSink;
+
+// A native source of microphone events: CoreAudio on macOS, PipeWire on
+// Linux. The hub owns at most one started backend at a time.
+class MicMonitorBackend {
+public:
+  virtual ~MicMonitorBackend() {}
+
+  // `sink` may be called from any thread until Stop() returns.
+  virtual bool Start(MonitorEventSink sink, std::string *error) = 0;
+  virtual void Stop() = 0;
+};
+
+typedef std::function<std::unique_ptr<MicMonitorBackend>()>
+    MicMonitorBackendFactory;
+
+// Which events a subscriber receives.
+struct MicSubscriberFilter {
+  bool state;
+  bool errors;
+  bool info;
+  // Per-device events, by device name; "*" matches every device. Without
+  // device names only the aggregate microphone state is delivered.
+  std::vector<std::string> devices;
+
+  MicSubscriberFilter() : state(true), errors(true), info(true) {}
+
+  bool Matches(const MonitorEvent &event) const;
+};
+
+// JS handle returned by createMicMonitor(). It stays subscribed until
+// close() is called or the handle is garbage collected.
+class MicMonitorHandle : public Napi::ObjectWrap<MicMonitorHandle> {
+public:
+  static Napi::Function Define(Napi::Env env);
+
+  MicMonitorHandle(const Napi::CallbackInfo &info);
+  ~MicMonitorHandle();
+
+  const MicSubscriberFilter &Filter() const { return filter_; }
+  void Deliver(Napi::Env env, const MonitorEvent &event);
+  void Detach();
+
+private:
+  Napi::Value Close(const Napi::CallbackInfo &info);
+  Napi::Value IsClosed(const Napi::CallbackInfo &info);
+
+  Napi::FunctionReference callback_;
+  MicSubscriberFilter filter_;
+  bool subscribed_;
+};
+
+// The subscriptions of one env (main thread or worker): its handles and the
+// dispatcher that carries events to its JS thread. Kept in the env's
+// instance data and only used on that thread.
+class MicMonitorEnv {
+public:
+  static MicMonitorEnv *Of(Napi::Env env);
+
+  MicMonitorEnv();
+
+  bool Subscribe(Napi::Env env, MicMonitorHandle *handle,
+                 const EventDispatcherOptions &options, std::string *error);
+  void Unsubscribe(MicMonitorHandle *handle);
+
+  size_t SubscriberCount() const;
+
+private:
+  void Deliver(Napi::Env env, const MonitorEvent &event);
+  void Shutdown();
+  // Runs when the env exits with subscriptions still open.
+  static void Cleanup(void *data);
+
+  napi_env env_;
+  EventDispatcher *dispatcher_;
+  // Entries are nulled rather than erased while events are being delivered,
+  // since a subscriber may close itself or another one from its callback.
+  std::vector<MicMonitorHandle *> subscribers_;
+  int delivering_;
+  bool compact_;
+};
+
+// One native subscription shared by every env. The backend is started with
+// the first env that subscribes and stopped after the last one leaves; each
+// event is pushed to the dispatcher of every subscribed env, crosses to its
+// JS thread once and is then fanned out to that env's handles.
+class MicMonitorHub {
+public:
+  static MicMonitorHub &Shared();
+
+  // Exports createMicMonitor, startMonitoringMic, stopMonitoringMic and
+  // getMicMonitorStats.
+  static void Init(Napi::Env env, Napi::Object exports,
+                   MicMonitorBackendFactory factory);
+
+  // The factory used the next time the backend starts.
+  void SetBackendFactory(MicMonitorBackendFactory factory);
+
+  // Starts pushing events into `target`, starting the backend if needed.
+  bool Attach(EventDispatcher *target, std::string *error);
+  // Once it returns nothing is pushed into `target` any more; the backend is
+  // stopped after the last target is detached.
+  void Detach(EventDispatcher *target);
+
+  // Feeds an event as if it came from the backend; for tests and benchmarks.
+  // Safe from any thread.
+  void Inject(MonitorEvent &&event);
+
+  const std::shared_ptr<EventDeliveryStats> &Stats() const { return stats_; }
+
+private:
+  MicMonitorHub();
+
+  void Publish(MonitorEvent &&event);
+
+  // Guards the factory and the backend's start and stop
+  std::mutex mutex_;
+  MicMonitorBackendFactory factory_;
+  std::unique_ptr<MicMonitorBackend> backend_;
+  std::shared_ptr<EventDeliveryStats> stats_;
+  // Taken by the producers; never held while the backend starts or stops.
+  std::mutex targetsMutex_;
+  std::vector<EventDispatcher *> targets_;
+};
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <cstring>
+
+#include "MicTimeline.h"
+
+static const char EXPORT_MAGIC[8] = {'N', 'M', 'U', 'M', 'I', 'C', 'T', '1'};
+
+static void WriteVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(char(uint8_t(value) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(char(value));
+}
+
+static uint64_t ZigZag(int64_t value) {
+  return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static int64_t UnZigZag(uint64_t value) {
+  return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+namespace {
+
+// Bounds-checked reader for Import()
+struct BlobReader {
+  const uint8_t *pos;
+  const uint8_t *end;
+
+  bool Varint(uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos == end) {
+        return false;
+      }
+      uint8_t byte = *pos++;
+      result |= uint64_t(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t Remaining() const { return size_t(end - pos); }
+};
+
+} // namespace
+
+MicTimeline::MicTimeline(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)), head_(0), size_(0),
+      lastMs_(0), evicted_(0), samples_(0) {
+  records_.resize(capacity_);
+}
+
+uint32_t MicTimeline::Intern(const std::string &name) {
+  auto it = nameIds_.find(name);
+  if (it != nameIds_.end()) {
+    refs_[it->second]++;
+    return it->second;
+  }
+
+  uint32_t id;
+  if (!freeNames_.empty()) {
+    id = freeNames_.back();
+    freeNames_.pop_back();
+    names_[id] = name;
+    refs_[id] = 1;
+  } else {
+    id = uint32_t(names_.size());
+    names_.push_back(name);
+    refs_.push_back(1);
+  }
+  nameIds_.emplace(name, id);
+  return id;
+}
+
+void MicTimeline::Release(uint32_t id) {
+  if (--refs_[id] > 0) {
+    return;
+  }
+  nameIds_.erase(names_[id]);
+  std::string().swap(names_[id]);
+  freeNames_.push_back(id);
+}
+
+void MicTimeline::Append(const Record &record) {
+  if (size_ == capacity_) {
+    Record &oldest = records_[head_];
+    Release(oldest.process);
+    Release(oldest.device);
+    oldest = record;
+    head_ = (head_ + 1) % capacity_;
+    evicted_++;
+    return;
+  }
+
+  records_[(head_ + size_) % capacity_] = record;
+  size_++;
+}
+
+const MicTimeline::Record &MicTimeline::At(size_t index) const {
+  return records_[(head_ + index) % capacity_];
+}
+
+void MicTimeline::Update(const std::vector<MicUse> &uses, int64_t nowMs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lastMs_ = std::max(lastMs_, nowMs);
+  samples_++;
+
+  for (auto &use : open_) {
+    use.seen = false;
+  }
+
+  for (const auto &use : uses) {
+    auto process = nameIds_.find(use.process);
+    auto device = nameIds_.find(use.device);
+    bool found = false;
+    if (process != nameIds_.end() && device != nameIds_.end()) {
+      for (auto &item : open_) {
+        if (item.pid == use.pid && item.process == process->second &&
+            item.device == device->second) {
+          item.seen = true;
+          found = true;
+          break;
+        }
+      }
+    }
+    if (!found) {
+      OpenUse item;
+      item.pid = use.pid;
+      item.process = Intern(use.process);
+      item.device = Intern(use.device);
+      item.startMs = lastMs_;
+      item.seen = true;
+      open_.push_back(item);
+    }
+  }
+
+  // Closing hands the open use's name references over to the record.
+  size_t kept = 0;
+  for (size_t i = 0; i < open_.size(); i++) {
+    const OpenUse &item = open_[i];
+    if (item.seen) {
+      open_[kept++] = item;
+      continue;
+    }
+    Append(Record{item.startMs, lastMs_, item.pid, item.process, item.device});
+  }
+  open_.resize(kept);
+}
+
+void MicTimeline::CloseAll(int64_t nowMs) {
+  Update(std::vector<MicUse>(), nowMs);
+}
+
+MicInterval MicTimeline::ToInterval(const Record &record, bool open) const {
+  MicInterval interval;
+  interval.process = names_[record.process];
+  interval.pid = record.pid;
+  interval.device = names_[record.device];
+  interval.startMs = record.startMs;
+  interval.endMs = record.endMs;
+  interval.open = open;
+  return interval;
+}
+
+void MicTimeline::CollectOpen(int64_t nowMs,
+                              std::vector<Record> *records) const {
+  int64_t endMs = std::max(lastMs_, nowMs);
+  for (const auto &item : open_) {
+    records->push_back(
+        Record{item.startMs, endMs, item.pid, item.process, item.device});
+  }
+}
+
+std::vector<MicInterval> MicTimeline::Query(int64_t fromMs, int64_t toMs,
+                                            const std::string &process,
+                                            int64_t nowMs) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<MicInterval> result;
+
+  uint32_t processId = 0;
+  if (!process.empty()) {
+    auto it = nameIds_.find(process);
+    if (it == nameIds_.end()) {
+      return result;
+    }
+    processId = it->second;
+  }
+  auto matches = [&](const Record &record) {
+    return record.startMs < toMs && record.endMs > fromMs &&
+           (process.empty() || record.process == processId);
+  };
+
+  // First record ending after `fromMs`; every earlier one ends before it.
+  size_t low = 0;
+  size_t high = size_;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (At(mid).endMs > fromMs) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  for (size_t i = low; i < size_; i++) {
+    if (matches(At(i))) {
+      result.push_back(ToInterval(At(i), false));
+    }
+  }
+
+  std::vector<Record> open;
+  CollectOpen(nowMs, &open);
+  for (const auto &record : open) {
+    if (matches(record)) {
+      result.push_back(ToInterval(record, true));
+    }
+  }
+
+  return result;
+}
+
+std::string MicTimeline::Export(int64_t nowMs) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<Record> records;
+  records.reserve(size_ + open_.size());
+  for (size_t i = 0; i < size_; i++) {
+    records.push_back(At(i));
+  }
+  CollectOpen(nowMs, &records);
+
+  // Names are renumbered densely in order of first use.
+  std::vector<uint32_t> remap(names_.size(), UINT32_MAX);
+  std::vector<uint32_t> order;
+  auto number = [&](uint32_t id) {
+    if (remap[id] == UINT32_MAX) {
+      remap[id] = uint32_t(order.size());
+      order.push_back(id);
+    }
+    return remap[id];
+  };
+  for (const auto &record : records) {
+    number(record.process);
+    number(record.device);
+  }
+
+  std::string out(EXPORT_MAGIC, sizeof(EXPORT_MAGIC));
+  WriteVarint(out, order.size());
+  for (uint32_t id : order) {
+    WriteVarint(out, names_[id].size());
+    out += names_[id];
+  }
+
+  WriteVarint(out, records.size());
+  int64_t previousStart = 0;
+  for (const auto &record : records) {
+    WriteVarint(out, ZigZag(record.startMs - previousStart));
+    WriteVarint(out, uint64_t(record.endMs - record.startMs));
+    WriteVarint(out, record.pid);
+    WriteVarint(out, remap[record.process]);
+    WriteVarint(out, remap[record.device]);
+    previousStart = record.startMs;
+  }
+
+  return out;
+}
+
+bool MicTimeline::Import(const char *data, size_t size, size_t *imported) {
+  if (size < sizeof(EXPORT_MAGIC) ||
+      memcmp(data, EXPORT_MAGIC, sizeof(EXPORT_MAGIC)) != 0) {
+    return false;
+  }
+  BlobReader reader{reinterpret_cast<const uint8_t *>(data) + sizeof(EXPORT_MAGIC),
+                    reinterpret_cast<const uint8_t *>(data) + size};
+
+  // Every count is checked against the bytes left before allocating, since
+  // each name or record takes at least one byte per field.
+  uint64_t nameCount;
+  if (!reader.Varint(&nameCount) || nameCount > reader.Remaining()) {
+    return false;
+  }
+  std::vector<std::string> names(nameCount);
+  for (auto &name : names) {
+    uint64_t length;
+    if (!reader.Varint(&length) || length > reader.Remaining()) {
+      return false;
+    }
+    name.assign(reinterpret_cast<const char *>(reader.pos), size_t(length));
+    reader.pos += length;
+  }
+
+  uint64_t recordCount;
+  if (!reader.Varint(&recordCount) || recordCount > reader.Remaining() / 5) {
+    return false;
+  }
+  std::vector<Record> records(recordCount);
+  int64_t previousStart = 0;
+  for (auto &record : records) {
+    uint64_t start, duration, pid, process, device;
+    if (!reader.Varint(&start) || !reader.Varint(&duration) ||
+        !reader.Varint(&pid) || !reader.Varint(&process) ||
+        !reader.Varint(&device) || process >= nameCount ||
+        device >= nameCount || pid > UINT32_MAX || duration > INT64_MAX) {
+      return false;
+    }
+    record.startMs = previousStart + UnZigZag(start);
+    record.endMs = record.startMs + int64_t(duration);
+    record.pid = uint32_t(pid);
+    record.process = uint32_t(process);
+    record.device = uint32_t(device);
+    previousStart = record.startMs;
+  }
+  if (reader.Remaining() != 0) {
+    return false;
+  }
+
+  // Queries rely on end time order; only the newest `capacity_` fit.
+  std::stable_sort(records.begin(), records.end(),
+                   [](const Record &a, const Record &b) {
+                     return a.endMs < b.endMs;
+                   });
+  size_t skip = records.size() > capacity_ ? records.size() - capacity_ : 0;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < size_; i++) {
+    Release(At(i).process);
+    Release(At(i).device);
+  }
+  head_ = 0;
+  size_ = 0;
+
+  for (size_t i = skip; i < records.size(); i++) {
+    Record record = records[i];
+    record.process = Intern(names[record.process]);
+    record.device = Intern(names[record.device]);
+    Append(record);
+    lastMs_ = std::max(lastMs_, record.endMs);
+  }
+  *imported = records.size() - skip;
+  return true;
+}
+
+void MicTimeline::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  head_ = 0;
+  size_ = 0;
+  open_.clear();
+  names_.clear();
+  refs_.clear();
+  freeNames_.clear();
+  nameIds_.clear();
+  evicted_ = 0;
+  samples_ = 0;
+}
+
+MicTimelineStats MicTimeline::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  MicTimelineStats stats;
+  stats.capacity = capacity_;
+  stats.intervals = size_;
+  stats.open = open_.size();
+  stats.names = nameIds_.size();
+  stats.evicted = evicted_;
+  stats.samples = samples_;
+  return stats;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One process recording from one device, as observed by a sample.
+struct MicUse {
+  std::string process;
+  // 0 when the platform does not report it
+  uint32_t pid;
+  std::string device;
+};
+
+// A use over [startMs, endMs), in milliseconds since the epoch.
+struct MicInterval {
+  std::string process;
+  uint32_t pid;
+  std::string device;
+  int64_t startMs;
+  int64_t endMs;
+  // Still in use; `endMs` is the time of the query
+  bool open;
+};
+
+struct MicTimelineStats {
+  size_t capacity;
+  size_t intervals;
+  size_t open;
+  size_t names;
+  // Closed intervals overwritten by newer ones
+  uint64_t evicted;
+  uint64_t samples;
+};
+
+// Microphone usage history in a fixed number of interval records. Process
+// and device names are interned and shared by the records that use them, so
+// memory is bounded by the capacity however long it runs. Records are kept
+// in the order they closed, which is also end time order, so a range query
+// is a binary search plus the matching records.
+//
+// Export() writes a compact, byte-order independent blob (names once, then
+// varint-delta records) that Import() reads back.
+class MicTimeline {
+public:
+  explicit MicTimeline(size_t capacity);
+
+  // Opens intervals for uses not seen by the previous sample and closes the
+  // ones that are gone. Time never moves backwards within the timeline.
+  void Update(const std::vector<MicUse> &uses, int64_t nowMs);
+  // Closes every open interval, e.g. when recording stops.
+  void CloseAll(int64_t nowMs);
+
+  // Intervals overlapping [fromMs, toMs), oldest first. Open intervals end at
+  // `nowMs`. An empty `process` matches every process.
+  std::vector<MicInterval> Query(int64_t fromMs, int64_t toMs,
+                                 const std::string &process,
+                                 int64_t nowMs) const;
+
+  // Open intervals are exported as closed at `nowMs`.
+  std::string Export(int64_t nowMs) const;
+  // Replaces the closed history; open intervals are kept. Returns false and
+  // leaves the timeline unchanged if the blob is not valid.
+  bool Import(const char *data, size_t size, size_t *imported);
+
+  void Clear();
+  MicTimelineStats Stats() const;
+
+private:
+  struct Record {
+    int64_t startMs;
+    int64_t endMs;
+    uint32_t pid;
+    uint32_t process;
+    uint32_t device;
+  };
+
+  struct OpenUse {
+    uint32_t pid;
+    uint32_t process;
+    uint32_t device;
+    int64_t startMs;
+    bool seen;
+  };
+
+  // Caller holds mutex_ for all of these.
+  uint32_t Intern(const std::string &name);
+  void Release(uint32_t id);
+  void Append(const Record &record);
+  const Record &At(size_t index) const;
+  MicInterval ToInterval(const Record &record, bool open) const;
+  void CollectOpen(int64_t nowMs, std::vector<Record> *records) const;
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+
+  // Ring of closed intervals; `head_` is the oldest of `size_` records.
+  std::vector<Record> records_;
+  size_t head_;
+  size_t size_;
+
+  std::vector<OpenUse> open_;
+
+  // Interned names with the number of records (open or closed) using them.
+  // Freed slots are reused before the table grows.
+  std::vector<std::string> names_;
+  std::vector<uint32_t> refs_;
+  std::vector<uint32_t> freeNames_;
+  std::unordered_map<std::string, uint32_t> nameIds_;
+
+  int64_t lastMs_;
+  uint64_t evicted_;
+  uint64_t samples_;
+};
@@ -0,0 +1,194 @@
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "NativeStats.h"
+
+// Distinct (backend, code) pairs tracked; later ones are counted together
+// under backend "other".
+static const size_t ERROR_SLOTS = 128;
+
+namespace {
+
+struct ErrorSlot {
+  // 0 free, 1 being claimed, 2 ready
+  std::atomic<int> state;
+  const char *backend;
+  int64_t code;
+  std::atomic<uint64_t> count;
+};
+
+struct Registry {
+  std::mutex mutex;
+  // Never erased, so the pointers handed out stay valid.
+  std::map<std::string, std::unique_ptr<ExportStats>> exports;
+  std::map<std::string, std::unique_ptr<NativeCounter>> counters;
+  ErrorSlot errors[ERROR_SLOTS];
+  std::atomic<uint64_t> otherErrors;
+};
+
+Registry &Shared() {
+  static Registry *registry = new Registry();
+  return *registry;
+}
+
+bool SameBackend(const char *a, const char *b) {
+  return a == b || strcmp(a, b) == 0;
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() { Reset(); }
+
+uint64_t LatencyHistogram::LowerBound(int bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return uint64_t(bucket);
+  }
+  int exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  uint64_t sub = uint64_t(bucket % SUB_BUCKETS);
+  return (uint64_t(SUB_BUCKETS) + sub) << (exponent - SUB_BUCKET_BITS);
+}
+
+uint64_t LatencyHistogram::Count() const {
+  uint64_t count = 0;
+  for (const auto &bucket : counts_) {
+    count += bucket.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+uint64_t LatencyHistogram::ValueAtQuantile(double quantile) const {
+  uint64_t count = Count();
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = uint64_t(quantile * double(count - 1)) + 1;
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < BUCKETS; bucket++) {
+    seen += BucketCount(bucket);
+    if (seen >= rank) {
+      return LowerBound(bucket);
+    }
+  }
+  return MaxNs();
+}
+
+void LatencyHistogram::Reset() {
+  for (auto &count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  totalNs_.store(0, std::memory_order_relaxed);
+  maxNs_.store(0, std::memory_order_relaxed);
+}
+
+ExportStats *NativeStats::Export(const std::string &name) {
+  Registry &registry = Shared();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::unique_ptr<ExportStats> &slot = registry.exports[name];
+  if (!slot) {
+    slot.reset(new ExportStats());
+    slot->name = name;
+  }
+  return slot.get();
+}
+
+NativeCounter *NativeStats::Counter(const std::string &name) {
+  Registry &registry = Shared();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::unique_ptr<NativeCounter> &counter = registry.counters[name];
+  if (!counter) {
+    counter.reset(new NativeCounter());
+  }
+  return counter.get();
+}
+
+std::vector<ExportStats *> NativeStats::Exports() {
+  Registry &registry = Shared();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<ExportStats *> result;
+  for (const auto &item : registry.exports) {
+    result.push_back(item.second.get());
+  }
+  return result;
+}
+
+std::vector<std::pair<std::string, uint64_t>> NativeStats::Counters() {
+  Registry &registry = Shared();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<std::pair<std::string, uint64_t>> result;
+  for (const auto &item : registry.counters) {
+    result.emplace_back(item.first, item.second->Value());
+  }
+  return result;
+}
+
+std::vector<BackendErrorCount> NativeStats::BackendErrors() {
+  Registry &registry = Shared();
+  std::vector<BackendErrorCount> result;
+  for (const auto &slot : registry.errors) {
+    uint64_t count = slot.count.load(std::memory_order_relaxed);
+    if (slot.state.load(std::memory_order_acquire) == 2 && count > 0) {
+      result.push_back(BackendErrorCount{slot.backend, slot.code, count});
+    }
+  }
+  uint64_t other = registry.otherErrors.load(std::memory_order_relaxed);
+  if (other > 0) {
+    result.push_back(BackendErrorCount{"other", 0, other});
+  }
+  return result;
+}
+
+void NativeStats::Reset() {
+  Registry &registry = Shared();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto &item : registry.exports) {
+      item.second->latency.Reset();
+    }
+    for (auto &item : registry.counters) {
+      item.second->Reset();
+    }
+  }
+  // Claimed slots keep their key so concurrent recorders stay consistent.
+  for (auto &slot : registry.errors) {
+    slot.count.store(0, std::memory_order_relaxed);
+  }
+  registry.otherErrors.store(0, std::memory_order_relaxed);
+}
+
+void NativeStatsBackendError(const char *backend, int64_t code) {
+  Registry &registry = Shared();
+  size_t hash = std::hash<std::string>()(backend) ^ std::hash<int64_t>()(code);
+
+  // Open addressing; slots are claimed once and never released.
+  for (size_t probe = 0; probe < ERROR_SLOTS; probe++) {
+    ErrorSlot &slot = registry.errors[(hash + probe) % ERROR_SLOTS];
+    int state = slot.state.load(std::memory_order_acquire);
+    if (state == 0) {
+      int expected = 0;
+      if (slot.state.compare_exchange_strong(expected, 1,
+                                             std::memory_order_acquire)) {
+        slot.backend = backend;
+        slot.code = code;
+        slot.state.store(2, std::memory_order_release);
+        slot.count.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      state = expected;
+    }
+    while (state == 1) {
+      state = slot.state.load(std::memory_order_acquire);
+    }
+    if (slot.code == code && SameBackend(slot.backend, backend)) {
+      slot.count.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+  registry.otherErrors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NativeStatsCount(const char *counter) {
+  NativeStats::Counter(counter)->Add();
+}
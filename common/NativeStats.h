@@ -0,0 +1,150 @@
+#pragma once
+#include <stdint.h>
+
+// Process-wide instrumentation read by getNativeStats(): call latency per
+// export, failed OS calls per backend and status code, and named counters
+// such as monitor restarts. Latencies, counters and errors are recorded with
+// relaxed atomics only; just creating a slot or counter takes a lock.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Counts a failed OS call of `backend` ("coreaudio", "com", "pipewire"...)
+// by status code. `backend` must be a string literal.
+void NativeStatsBackendError(const char *backend, int64_t code);
+
+// Adds one to the named counter, e.g. "micMonitor.restarts". Looks the name
+// up under a lock on every call; hot paths keep the NativeCounter instead.
+void NativeStatsCount(const char *counter);
+
+#ifdef __cplusplus
+}
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Log-linear latency histogram in nanoseconds, in the style of
+// HdrHistogram: 8 linear sub-buckets per power of two, so every recorded
+// value is within 12.5% of its bucket's lower bound, from 1ns to ~18min.
+class LatencyHistogram {
+public:
+  static const int SUB_BUCKET_BITS = 3;
+  static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const int MAX_EXPONENT = 40;
+  static const int BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 2);
+
+  LatencyHistogram();
+
+  void Record(uint64_t ns) {
+    counts_[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    totalNs_.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max = maxNs_.load(std::memory_order_relaxed);
+    while (ns > max &&
+           !maxNs_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  static int BucketOf(uint64_t ns) {
+    if (ns < uint64_t(SUB_BUCKETS)) {
+      return int(ns);
+    }
+    int exponent = 63 - CountLeadingZeros(ns);
+    if (exponent > MAX_EXPONENT) {
+      return BUCKETS - 1;
+    }
+    int sub = int(ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS * (exponent - SUB_BUCKET_BITS + 1) + sub;
+  }
+  // Smallest value that falls into `bucket`
+  static uint64_t LowerBound(int bucket);
+
+  // Sums the buckets; kept off the recording path
+  uint64_t Count() const;
+  uint64_t TotalNs() const { return totalNs_.load(std::memory_order_relaxed); }
+  uint64_t MaxNs() const { return maxNs_.load(std::memory_order_relaxed); }
+  uint64_t BucketCount(int bucket) const {
+    return counts_[bucket].load(std::memory_order_relaxed);
+  }
+  // Lower bound of the bucket holding the given quantile (0..1)
+  uint64_t ValueAtQuantile(double quantile) const;
+  void Reset();
+
+private:
+  static int CountLeadingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - int(index);
+#else
+    return __builtin_clzll(value);
+#endif
+  }
+
+  std::atomic<uint64_t> counts_[BUCKETS];
+  std::atomic<uint64_t> totalNs_;
+  std::atomic<uint64_t> maxNs_;
+};
+
+struct ExportStats {
+  std::string name;
+  LatencyHistogram latency;
+};
+
+class NativeCounter {
+public:
+  NativeCounter() : value_(0) {}
+
+  void Add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t Value() const { return value_.load(std::memory_order_relaxed); }
+  void Reset() { value_.store(0, std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value_;
+};
+
+struct BackendErrorCount {
+  const char *backend;
+  int64_t code;
+  uint64_t count;
+};
+
+namespace NativeStats {
+
+// The slot for `name`, created on first use; slots live for the whole
+// process, so callers keep the pointer.
+ExportStats *Export(const std::string &name);
+NativeCounter *Counter(const std::string &name);
+
+std::vector<ExportStats *> Exports();
+std::vector<std::pair<std::string, uint64_t>> Counters();
+std::vector<BackendErrorCount> BackendErrors();
+void Reset();
+
+} // namespace NativeStats
+
+// Records the time until the end of the scope into `stats`.
+class ExportTimer {
+public:
+  explicit ExportTimer(ExportStats *stats)
+      : stats_(stats), started_(std::chrono::steady_clock::now()) {}
+
+  ~ExportTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - started_;
+    stats_->latency.Record(uint64_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+  }
+
+private:
+  ExportStats *stats_;
+  std::chrono::steady_clock::time_point started_;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "NativeStatsExports.h"
+#include "NativeStats.h"
+
+namespace {
+
+struct TimedCallback {
+  Napi::Function::Callback callback;
+  ExportStats *stats;
+};
+
+Napi::Value CallTimed(const Napi::CallbackInfo &info) {
+  const TimedCallback *timed = static_cast<const TimedCallback *>(info.Data());
+  ExportTimer timer(timed->stats);
+  return timed->callback(info);
+}
+
+const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+const char *const QUANTILE_NAMES[] = {"p50Ns", "p90Ns", "p99Ns", "p999Ns"};
+
+Napi::Object LatencyToObject(Napi::Env env, const LatencyHistogram &latency) {
+  Napi::Object result = Napi::Object::New(env);
+  uint64_t calls = latency.Count();
+  result.Set("calls", Napi::Number::New(env, double(calls)));
+  result.Set("meanNs", Napi::Number::New(
+                           env, calls > 0 ? double(latency.TotalNs()) / calls : 0));
+  for (size_t i = 0; i < sizeof(QUANTILES) / sizeof(QUANTILES[0]); i++) {
+    result.Set(QUANTILE_NAMES[i],
+               Napi::Number::New(env, double(latency.ValueAtQuantile(QUANTILES[i]))));
+  }
+  result.Set("maxNs", Napi::Number::New(env, double(latency.MaxNs())));
+
+  // Only the non-empty buckets, as [lowerBoundNs, count] pairs
+  Napi::Array histogram = Napi::Array::New(env);
+  uint32_t index = 0;
+  for (int bucket = 0; bucket < LatencyHistogram::BUCKETS; bucket++) {
+    uint64_t count = latency.BucketCount(bucket);
+    if (count == 0) {
+      continue;
+    }
+    Napi::Array pair = Napi::Array::New(env, 2);
+    pair.Set(uint32_t(0), Napi::Number::New(env, double(LatencyHistogram::LowerBound(bucket))));
+    pair.Set(uint32_t(1), Napi::Number::New(env, double(count)));
+    histogram.Set(index++, pair);
+  }
+  result.Set("histogram", histogram);
+  return result;
+}
+
+Napi::Value GetNativeStats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Object result = Napi::Object::New(env);
+
+  Napi::Object exports = Napi::Object::New(env);
+  for (const ExportStats *stats : NativeStats::Exports()) {
+    if (stats->latency.Count() > 0) {
+      exports.Set(stats->name, LatencyToObject(env, stats->latency));
+    }
+  }
+  result.Set("exports", exports);
+
+  Napi::Array errors = Napi::Array::New(env);
+  uint32_t index = 0;
+  for (const BackendErrorCount &error : NativeStats::BackendErrors()) {
+    Napi::Object item = Napi::Object::New(env);
+    item.Set("backend", Napi::String::New(env, error.backend));
+    item.Set("code", Napi::Number::New(env, double(error.code)));
+    item.Set("count", Napi::Number::New(env, double(error.count)));
+    errors.Set(index++, item);
+  }
+  result.Set("backendErrors", errors);
+
+  Napi::Object counters = Napi::Object::New(env);
+  for (const auto &counter : NativeStats::Counters()) {
+    counters.Set(counter.first, Napi::Number::New(env, double(counter.second)));
+  }
+  result.Set("counters", counters);
+  return result;
+}
+
+Napi::Value ResetNativeStats(const Napi::CallbackInfo &info) {
+  NativeStats::Reset();
+  return info.Env().Undefined();
+}
+
+} // namespace
+
+Napi::Function TimedFunction(Napi::Env env, const char *name,
+                             Napi::Function::Callback callback) {
+  // One per export and module load, kept for the life of the process like
+  // the slot it points to.
+  TimedCallback *timed = new TimedCallback{callback, NativeStats::Export(name)};
+  return Napi::Function::New(env, CallTimed, name, timed);
+}
+
+void NativeStatsInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("getNativeStats", Napi::Function::New(env, GetNativeStats));
+  exports.Set("resetNativeStats", Napi::Function::New(env, ResetNativeStats));
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <napi.h>
+
+// A JS function that calls `callback` and records each call's latency under
+// `name` in getNativeStats().
+Napi::Function TimedFunction(Napi::Env env, const char *name,
+                             Napi::Function::Callback callback);
+
+// Adds getNativeStats() and resetNativeStats() to `exports`.
+void NativeStatsInit(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Pixels, with the origin at the top-left corner of the image.
+class Rectangle {
+public:
+  size_t x, y, width, height;
+};
+
+class OCRObservation {
+public:
+  Rectangle bbox;
+  std::string text;
+  OCRObservation(const Rectangle &bbox, const std::string &text)
+      : bbox(bbox), text(text) {};
+};
+
+class OCRData {
+public:
+  bool success;
+  std::vector<OCRObservation> observations;
+  std::string error;
+  OCRData() : success(false) {}
+  OCRData(std::vector<OCRObservation> &observations)
+      : success(true), observations(observations) {}
+  OCRData(const bool &success) : success(success) {}
+  OCRData(const std::string &error) : success(false), error(error) {}
+};
+
+enum OCRImageFormat {
+  // Encoded image file; width, height and stride are unused
+  OCR_FORMAT_PNG,
+  // Raw pixels, 8 bits per channel. Alpha is ignored.
+  OCR_FORMAT_BGRA,
+  OCR_FORMAT_RGBA,
+  OCR_FORMAT_GRAY8,
+};
+
+// Bytes per pixel of a raw format, 0 for encoded ones.
+inline size_t OCRBytesPerPixel(OCRImageFormat format) {
+  switch (format) {
+  case OCR_FORMAT_BGRA:
+  case OCR_FORMAT_RGBA:
+    return 4;
+  case OCR_FORMAT_GRAY8:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+// A PNG file or a raw frame. The memory belongs to a JS value that is kept
+// alive for the job; backends read it in place and must not hold on to it
+// after Recognize() returns. For raw frames, rows start `stride` bytes apart
+// and `length` covers at least stride * (height - 1) + width * bpp bytes.
+struct OCRImage {
+  const uint8_t *data;
+  size_t length;
+  OCRImageFormat format;
+  size_t width;
+  size_t height;
+  size_t stride;
+};
+
+// See ImagePreprocess.h. Only applies to raw frames.
+struct OCRPreprocessOptions {
+  // Off hands the frame to the backend as it is
+  bool enabled = true;
+  // Integer box downscale, 1 for none
+  size_t downscale = 1;
+  bool binarize = false;
+};
+
+struct OCROptions {
+  // Recognition languages in the backend's notation ("en-US" for Vision,
+  // "eng" for Tesseract); empty for the backend default.
+  std::vector<std::string> languages;
+  OCRPreprocessOptions preprocess;
+};
+
+// A text recognition engine: Vision on macOS, Tesseract on Linux.
+class OCRBackend {
+public:
+  virtual ~OCRBackend() {}
+
+  virtual const char *Name() const = 0;
+  // Called from several executor threads at once.
+  virtual OCRData Recognize(const OCRImage &image,
+                            const OCROptions &options) = 0;
+};
+
+// Returns null when no engine is available in this build.
+typedef std::function<std::unique_ptr<OCRBackend>()> OCRBackendFactory;
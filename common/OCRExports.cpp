@@ -0,0 +1,577 @@
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "AsyncTasks.h"
+#include "ImagePreprocess.h"
+#include "Marshal.h"
+#include "NativeStatsExports.h"
+#include "OCRExports.h"
+#include "OCRSession.h"
+#include "SyntheticOCR.h"
+
+namespace {
+
+std::mutex backendMutex;
+OCRBackendFactory backendFactory;
+std::unique_ptr<OCRBackend> backend;
+bool backendCreated = false;
+// Set by the useSyntheticOCRBackend hook. Neither backend is destroyed
+// once created, since jobs in flight may still use the other one.
+std::unique_ptr<OCRBackend> syntheticBackend;
+bool useSynthetic = false;
+
+// Tag of the OcrSession class among the per-env references
+const char ocrSessionClass = 0;
+
+OCRBackend *SharedBackend() {
+  std::lock_guard<std::mutex> lock(backendMutex);
+  if (useSynthetic) {
+    return syntheticBackend.get();
+  }
+  if (!backendCreated) {
+    backendCreated = true;
+    if (backendFactory) {
+      backend = backendFactory();
+    }
+  }
+  return backend.get();
+}
+
+// {success, error, boxes: Int32Array of [x, y, width, height] per line,
+// text: string[]}
+Napi::Value OCRDataToObject(Napi::Env env, OCRData &data) {
+  size_t count = data.success ? data.observations.size() : 0;
+  Napi::Int32Array boxes = Napi::Int32Array::New(env, count * 4);
+  Napi::Array text = Napi::Array::New(env, count);
+  int32_t *out = boxes.Data();
+  for (size_t i = 0; i < count; i++) {
+    const Rectangle &bbox = data.observations[i].bbox;
+    out[i * 4] = int32_t(bbox.x);
+    out[i * 4 + 1] = int32_t(bbox.y);
+    out[i * 4 + 2] = int32_t(bbox.width);
+    out[i * 4 + 3] = int32_t(bbox.height);
+    text.Set(uint32_t(i), Napi::String::New(env, data.observations[i].text));
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("success", Napi::Boolean::New(env, data.success));
+  if (data.success) {
+    result.Set("error", env.Null());
+  } else {
+    result.Set("error", Napi::String::New(
+                            env, data.error.empty() ? "Text recognition failed" : data.error));
+  }
+  result.Set("boxes", boxes);
+  result.Set("text", text);
+  return result;
+}
+
+// preprocess: false | {downscale?: 1-8, binarize?: boolean}
+bool ReadPreprocessOptions(Napi::Env env, const Napi::Value &value,
+                           OCRPreprocessOptions *options) {
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (value.IsBoolean()) {
+    options->enabled = value.As<Napi::Boolean>().Value();
+    return true;
+  }
+  if (!value.IsObject()) {
+    Napi::TypeError::New(env, "Expected preprocess to be a boolean or an object")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Value downscale = object.Get("downscale");
+  if (!downscale.IsUndefined()) {
+    double factor = downscale.IsNumber() ? downscale.As<Napi::Number>().DoubleValue() : 0;
+    if (!(factor >= 1 && factor <= double(MAX_PREPROCESS_DOWNSCALE)) ||
+        factor != double(size_t(factor))) {
+      Napi::TypeError::New(env, "Expected preprocess.downscale to be an integer from 1 to 8")
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+    options->downscale = size_t(factor);
+  }
+  Napi::Value binarize = object.Get("binarize");
+  if (!binarize.IsUndefined()) {
+    if (!binarize.IsBoolean()) {
+      Napi::TypeError::New(env, "Expected preprocess.binarize to be a boolean")
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+    options->binarize = binarize.As<Napi::Boolean>().Value();
+  }
+  return true;
+}
+
+bool ReadOCROptions(Napi::Env env, const Napi::Value &value, OCROptions *options) {
+  if (!value.IsObject()) {
+    return true;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  if (!ReadPreprocessOptions(env, object.Get("preprocess"), &options->preprocess)) {
+    return false;
+  }
+  Napi::Value languages = object.Get("languages");
+  if (languages.IsUndefined()) {
+    return true;
+  }
+  if (!languages.IsArray()) {
+    Napi::TypeError::New(env, "Expected languages to be an array of strings")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  Napi::Array list = languages.As<Napi::Array>();
+  for (uint32_t i = 0; i < list.Length(); i++) {
+    Napi::Value language = list.Get(i);
+    if (!language.IsString()) {
+      Napi::TypeError::New(env, "Expected languages to be an array of strings")
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+    options->languages.push_back(language.As<Napi::String>().Utf8Value());
+  }
+  return true;
+}
+
+// Far beyond any screen, and keeps stride * height well within 2^53
+const double MAX_FRAME_SIDE = 65536;
+
+bool ReadFrameDimension(Napi::Object frame, const char *key, double max, size_t *out) {
+  Napi::Value value = frame.Get(key);
+  if (!value.IsNumber()) {
+    return false;
+  }
+  double number = value.As<Napi::Number>().DoubleValue();
+  if (!(number >= 1 && number <= max) || number != double(size_t(number))) {
+    return false;
+  }
+  *out = size_t(number);
+  return true;
+}
+
+// A PNG Buffer, or a raw frame {data, width, height, stride?, format} whose
+// data is a Buffer or typed array. Sets `owner` to the object holding the
+// bytes.
+bool ReadOCRImage(Napi::Env env, const Napi::Value &value, OCRImage *image,
+                  Napi::Object *owner) {
+  if (value.IsBuffer()) {
+    Napi::Buffer<uint8_t> buffer = value.As<Napi::Buffer<uint8_t>>();
+    *image = OCRImage{buffer.Data(), buffer.Length(), OCR_FORMAT_PNG, 0, 0, 0};
+    *owner = buffer;
+    return true;
+  }
+  if (!value.IsObject()) {
+    Napi::TypeError::New(env, "Expected a Buffer or a frame object")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Object frame = value.As<Napi::Object>();
+  Napi::Value data = frame.Get("data");
+  if (!data.IsTypedArray()) {
+    Napi::TypeError::New(env, "Expected frame.data to be a Buffer or typed array")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  Napi::TypedArray array = data.As<Napi::TypedArray>();
+
+  Napi::Value format = frame.Get("format");
+  std::string name = format.IsString() ? format.As<Napi::String>().Utf8Value() : "";
+  if (name == "bgra") {
+    image->format = OCR_FORMAT_BGRA;
+  } else if (name == "rgba") {
+    image->format = OCR_FORMAT_RGBA;
+  } else if (name == "gray8") {
+    image->format = OCR_FORMAT_GRAY8;
+  } else {
+    Napi::TypeError::New(env, "Expected frame.format to be 'bgra', 'rgba' or 'gray8'")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+
+  size_t bpp = OCRBytesPerPixel(image->format);
+  if (!ReadFrameDimension(frame, "width", MAX_FRAME_SIDE, &image->width) ||
+      !ReadFrameDimension(frame, "height", MAX_FRAME_SIDE, &image->height)) {
+    Napi::TypeError::New(env, "Expected frame.width and frame.height to be positive integers")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  image->stride = image->width * bpp;
+  if (!frame.Get("stride").IsUndefined() &&
+      (!ReadFrameDimension(frame, "stride", MAX_FRAME_SIDE * 4, &image->stride) ||
+       image->stride < image->width * bpp)) {
+    Napi::TypeError::New(env, "Expected frame.stride to be at least width * bytes per pixel")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+
+  image->data = static_cast<const uint8_t *>(array.ArrayBuffer().Data()) + array.ByteOffset();
+  image->length = array.ByteLength();
+  if (image->length < image->stride * (image->height - 1) + image->width * bpp) {
+    Napi::RangeError::New(env, "frame.data is smaller than stride * height")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  *owner = array;
+  return true;
+}
+
+// ocrImage(image: Buffer | frame, options?) -> Promise. The pixels are read
+// in place on an executor thread, so they must not be modified until the
+// Promise settles. Runs in the bulk lane; {signal} cancels it until it starts.
+Napi::Value OCRImageFunc(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  OCRImage image;
+  Napi::Object owner;
+  if (!ReadOCRImage(env, info[0], &image, &owner)) {
+    return env.Null();
+  }
+  OCROptions options;
+  Napi::Object signal;
+  if (!ReadOCROptions(env, info[1], &options) || !ReadAbortSignal(env, info[1], &signal)) {
+    return env.Null();
+  }
+
+  return QueueExecutorPromise<OCRData>(
+      env, EXECUTOR_BULK, "ocrImage",
+      [image, options]() {
+        OCRBackend *engine = SharedBackend();
+        if (engine == nullptr) {
+          return OCRData(std::string("Text recognition is not available in this build"));
+        }
+        return RecognizeWithPreprocessing(*engine, image, options);
+      },
+      OCRDataToObject, owner, signal);
+}
+
+struct SessionResult {
+  OCRData data;
+  OCRSessionStats frame;
+};
+
+void ParallelForOnBulkLane(size_t count, const std::function<void(size_t)> &fn) {
+  Executor::Shared().ParallelFor(EXECUTOR_BULK, count, fn);
+}
+
+// Queues one frame of a session on the bulk lane
+Napi::Value QueueSessionFrame(Napi::Env env, std::shared_ptr<OCRSession> session,
+                              const OCRImage &image, const OCROptions &options,
+                              Napi::Object keepAlive, Napi::Object signal) {
+  return QueueExecutorPromise<SessionResult>(
+      env, EXECUTOR_BULK, "ocrSession.recognize",
+      [session, image, options]() {
+        SessionResult result;
+        OCRBackend *engine = SharedBackend();
+        if (engine == nullptr) {
+          result.data = OCRData(std::string("Text recognition is not available in this build"));
+          return result;
+        }
+        result.data = session->Recognize(*engine, image, options, ParallelForOnBulkLane,
+                                         &result.frame);
+        return result;
+      },
+      [](Napi::Env env, SessionResult &result) {
+        Napi::Object object = OCRDataToObject(env, result.data).As<Napi::Object>();
+        object.Set("tiles", Napi::Number::New(env, double(result.frame.tiles)));
+        object.Set("recognizedTiles",
+                   Napi::Number::New(env, double(result.frame.recognizedTiles)));
+        return object;
+      },
+      keepAlive, signal);
+}
+
+// The recognize() calls of one session handle; JS thread only. Frames
+// waiting for their turn share it with the handle, so they see close().
+struct SessionChain {
+  // Null once the handle is closed
+  std::shared_ptr<OCRSession> session;
+  // The Promise of the last recognize() until it settles. The next call is
+  // queued once it settles, so that frames of one session never hold a
+  // worker waiting for each other.
+  Napi::ObjectReference last;
+  // Counts recognize() calls, to tell whether `last` is still the latest
+  uint64_t calls;
+
+  SessionChain() : calls(0) {}
+};
+
+// A recognize() call waiting for the previous one of its session
+struct PendingSessionFrame {
+  std::shared_ptr<SessionChain> chain;
+  OCRImage image;
+  OCROptions options;
+  Napi::ObjectReference keepAlive;
+  Napi::ObjectReference signal;
+};
+
+// JS handle returned by createOcrSession(). The native session is shared
+// with the jobs still running when the handle is closed or collected.
+class OCRSessionHandle : public Napi::ObjectWrap<OCRSessionHandle> {
+public:
+  static Napi::Function Define(Napi::Env env) {
+    return DefineClass(env, "OcrSession",
+                       {InstanceMethod("recognize", &OCRSessionHandle::Recognize),
+                        InstanceMethod("getStats", &OCRSessionHandle::GetStats),
+                        InstanceMethod("reset", &OCRSessionHandle::Reset),
+                        InstanceMethod("close", &OCRSessionHandle::Close),
+                        InstanceAccessor("closed", &OCRSessionHandle::IsClosed, nullptr)});
+  }
+
+  OCRSessionHandle(const Napi::CallbackInfo &info);
+
+private:
+  Napi::Value Recognize(const Napi::CallbackInfo &info);
+  Napi::Value GetStats(const Napi::CallbackInfo &info);
+  Napi::Value Reset(const Napi::CallbackInfo &info);
+  Napi::Value Close(const Napi::CallbackInfo &info);
+  Napi::Value IsClosed(const Napi::CallbackInfo &info) {
+    return Napi::Boolean::New(info.Env(), !chain_->session);
+  }
+
+  std::shared_ptr<SessionChain> chain_;
+};
+
+// createOcrSession({tileWidth?, tileHeight?, overlap?})
+OCRSessionHandle::OCRSessionHandle(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<OCRSessionHandle>(info), chain_(std::make_shared<SessionChain>()) {
+  Napi::Env env = info.Env();
+  OCRSessionOptions options;
+  if (info[0].IsObject()) {
+    Napi::Object object = info[0].As<Napi::Object>();
+    const struct {
+      const char *key;
+      size_t *value;
+      double min, max;
+    } fields[] = {{"tileWidth", &options.tileWidth, 32, 8192},
+                  {"tileHeight", &options.tileHeight, 32, 8192},
+                  {"overlap", &options.overlap, 0, 256}};
+    for (const auto &field : fields) {
+      Napi::Value value = object.Get(field.key);
+      if (value.IsUndefined()) {
+        continue;
+      }
+      double number = value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : -1;
+      if (!(number >= field.min && number <= field.max) ||
+          number != double(size_t(number))) {
+        Napi::TypeError::New(env, std::string("Expected ") + field.key +
+                                      " to be an integer from " +
+                                      std::to_string(int(field.min)) + " to " +
+                                      std::to_string(int(field.max)))
+            .ThrowAsJavaScriptException();
+        return;
+      }
+      *field.value = size_t(number);
+    }
+  }
+  chain_->session = std::make_shared<OCRSession>(options);
+}
+
+// recognize(frame, options?) -> Promise of the ocrImage() result plus the
+// tile counts of this frame
+Napi::Value OCRSessionHandle::Recognize(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (!chain_->session) {
+    Napi::Error::New(env, "OCR session is closed").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  OCRImage image;
+  Napi::Object owner;
+  if (!ReadOCRImage(env, info[0], &image, &owner)) {
+    return env.Null();
+  }
+  if (image.format == OCR_FORMAT_PNG) {
+    Napi::TypeError::New(env, "Expected a raw frame").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  OCROptions options;
+  Napi::Object signal;
+  if (!ReadOCROptions(env, info[1], &options) || !ReadAbortSignal(env, info[1], &signal)) {
+    return env.Null();
+  }
+
+  // The frame's pixels and this handle stay alive until the Promise settles
+  Napi::Object keepAlive = Napi::Object::New(env);
+  keepAlive.Set("frame", owner);
+  keepAlive.Set("session", Value());
+
+  Napi::Value promise;
+  if (chain_->last.IsEmpty()) {
+    promise = QueueSessionFrame(env, chain_->session, image, options, keepAlive, signal);
+  } else {
+    // Chained on the previous Promise whether it resolves or rejects; a
+    // signal that aborts meanwhile rejects once the frame's turn comes, and
+    // so does close().
+    auto pending = std::make_shared<PendingSessionFrame>();
+    pending->chain = chain_;
+    pending->image = image;
+    pending->options = options;
+    pending->keepAlive = Napi::Persistent(keepAlive);
+    if (!signal.IsEmpty()) {
+      pending->signal = Napi::Persistent(signal);
+    }
+    Napi::Function start = Napi::Function::New(env, [pending](const Napi::CallbackInfo &info) {
+      Napi::Env env = info.Env();
+      Napi::Object keepAlive = pending->keepAlive.Value();
+      Napi::Object signal = pending->signal.IsEmpty() ? Napi::Object() : pending->signal.Value();
+      pending->keepAlive.Reset();
+      pending->signal.Reset();
+      if (!pending->chain->session) {
+        Napi::Error::New(env, "OCR session is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+      }
+      return QueueSessionFrame(env, pending->chain->session, pending->image,
+                               pending->options, keepAlive, signal);
+    });
+    Napi::Object last = chain_->last.Value();
+    promise = last.Get("then").As<Napi::Function>().Call(last, {start, start});
+  }
+
+  // Dropped once it settles, unless a later call replaced it meanwhile, so
+  // the last result is not kept alive by the handle.
+  uint64_t call = ++chain_->calls;
+  std::shared_ptr<SessionChain> chain = chain_;
+  Napi::Function settled = Napi::Function::New(env, [chain, call](const Napi::CallbackInfo &info) {
+    if (chain->calls == call) {
+      chain->last.Reset();
+    }
+    return info.Env().Undefined();
+  });
+  Napi::Object object = promise.As<Napi::Object>();
+  object.Get("then").As<Napi::Function>().Call(object, {settled, settled});
+  chain_->last = Napi::Persistent(object);
+  return promise;
+}
+
+// Totals since the session was created
+Napi::Value OCRSessionHandle::GetStats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  OCRSessionStats stats = chain_->session ? chain_->session->Stats() : OCRSessionStats();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("frames", Napi::Number::New(env, double(stats.frames)));
+  result.Set("tiles", Napi::Number::New(env, double(stats.tiles)));
+  result.Set("recognizedTiles", Napi::Number::New(env, double(stats.recognizedTiles)));
+  result.Set("reusedTiles", Napi::Number::New(env, double(stats.reusedTiles)));
+  return result;
+}
+
+Napi::Value OCRSessionHandle::Reset(const Napi::CallbackInfo &info) {
+  if (chain_->session) {
+    chain_->session->Reset();
+  }
+  return info.Env().Undefined();
+}
+
+// Frees the cached text; recognize() rejects afterwards, and so do the
+// calls still waiting for an earlier frame. A frame already running ends.
+Napi::Value OCRSessionHandle::Close(const Napi::CallbackInfo &info) {
+  chain_->session.reset();
+  chain_->last.Reset();
+  return info.Env().Undefined();
+}
+
+Napi::Value CreateOcrSession(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Function constructor(env, Marshal::EnvReferences::Get(env, &ocrSessionClass));
+  return constructor.New({info[0]});
+}
+
+// Routes recognition to CreateSyntheticOCRBackend() (or back to the
+// platform engine with `false`), for tests without Vision or Tesseract.
+Napi::Value UseSyntheticOCRBackend(const Napi::CallbackInfo &info) {
+  bool synthetic = info.Length() < 1 || info[0].ToBoolean().Value();
+  std::lock_guard<std::mutex> lock(backendMutex);
+  if (synthetic && !syntheticBackend) {
+    syntheticBackend = CreateSyntheticOCRBackend();
+  }
+  useSynthetic = synthetic;
+  return info.Env().Undefined();
+}
+
+// preprocessImage(frame, {downscale?, binarize?, kernel?}) -> {kernel, ns,
+// width, height, scale, data}: runs the preprocessing stage alone on the JS
+// thread, with the named kernels or the active ones.
+Napi::Value PreprocessImageHook(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  OCRImage image;
+  Napi::Object owner;
+  if (!ReadOCRImage(env, info[0], &image, &owner)) {
+    return env.Null();
+  }
+  if (image.format == OCR_FORMAT_PNG) {
+    Napi::TypeError::New(env, "Expected a raw frame").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  OCRPreprocessOptions options;
+  if (!ReadPreprocessOptions(env, info[1], &options)) {
+    return env.Null();
+  }
+  const ImageKernels *kernels = &ActiveImageKernels();
+  if (info[1].IsObject() && info[1].As<Napi::Object>().Get("kernel").IsString()) {
+    std::string name = info[1].As<Napi::Object>().Get("kernel").As<Napi::String>().Utf8Value();
+    kernels = nullptr;
+    for (const ImageKernels *supported : SupportedImageKernels()) {
+      if (name == supported->name) {
+        kernels = supported;
+      }
+    }
+    if (kernels == nullptr) {
+      Napi::Error::New(env, "Kernels not supported on this CPU: " + name)
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+
+  PreprocessedImage out;
+  auto started = std::chrono::steady_clock::now();
+  PreprocessImage(image, options, *kernels, &out);
+  auto elapsed = std::chrono::steady_clock::now() - started;
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("kernel", Napi::String::New(env, kernels->name));
+  result.Set("ns", Napi::Number::New(
+                       env, double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())));
+  result.Set("width", Napi::Number::New(env, double(out.width)));
+  result.Set("height", Napi::Number::New(env, double(out.height)));
+  result.Set("scale", Napi::Number::New(env, double(out.scale)));
+  result.Set("data", Napi::Buffer<uint8_t>::Copy(env, out.pixels.data(), out.pixels.size()));
+  return result;
+}
+
+// Names of the preprocessing kernels this CPU runs, fastest (active) first
+Napi::Value ImageKernelsHook(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  const std::vector<const ImageKernels *> &supported = SupportedImageKernels();
+  Napi::Array names = Napi::Array::New(env, supported.size());
+  for (size_t i = 0; i < supported.size(); i++) {
+    names.Set(uint32_t(i), Napi::String::New(env, supported[i]->name));
+  }
+  return names;
+}
+
+} // namespace
+
+void OCRInternalInit(Napi::Env env, Napi::Object internal) {
+  internal.Set("preprocessImage", Napi::Function::New(env, PreprocessImageHook));
+  internal.Set("imageKernels", Napi::Function::New(env, ImageKernelsHook));
+  internal.Set("useSyntheticOCRBackend", Napi::Function::New(env, UseSyntheticOCRBackend));
+}
+
+void OCRInit(Napi::Env env, Napi::Object exports, OCRBackendFactory factory) {
+  {
+    std::lock_guard<std::mutex> lock(backendMutex);
+    if (!backendFactory) {
+      backendFactory = std::move(factory);
+    }
+  }
+  exports.Set(Napi::String::New(env, "ocrImage"),
+              TimedFunction(env, "ocrImage", OCRImageFunc));
+
+  Marshal::EnvReferences::Set(env, &ocrSessionClass, OCRSessionHandle::Define(env));
+  exports.Set(Napi::String::New(env, "createOcrSession"),
+              TimedFunction(env, "createOcrSession", CreateOcrSession));
+}
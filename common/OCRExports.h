@@ -0,0 +1,12 @@
+#pragma once
+#include <napi.h>
+
+#include "OCR.h"
+
+// Adds ocrImage() and createOcrSession() to `exports`. The backend is
+// created by `factory` on the first job and shared by every environment.
+void OCRInit(Napi::Env env, Napi::Object exports, OCRBackendFactory factory);
+
+// Adds the preprocessing and synthetic backend hooks for tests and
+// benchmarks to `internal`.
+void OCRInternalInit(Napi::Env env, Napi::Object internal);
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ImagePreprocess.h"
+#include "OCRSession.h"
+
+namespace {
+
+const uint64_t PRIME1 = 11400714785074694791ULL;
+const uint64_t PRIME2 = 14029467366897019727ULL;
+const uint64_t PRIME3 = 1609587929392839161ULL;
+const uint64_t PRIME4 = 9650029242287828579ULL;
+const uint64_t PRIME5 = 2870177450012600261ULL;
+
+inline uint64_t Rotate(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Read64(const uint8_t *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+  return Rotate(acc + input * PRIME2, 31) * PRIME1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t lane) {
+  return (acc ^ Round(0, lane)) * PRIME1 + PRIME4;
+}
+
+} // namespace
+
+uint64_t HashBytes(const uint8_t *data, size_t length, uint64_t seed) {
+  const uint8_t *p = data, *end = data + length;
+  uint64_t hash;
+  if (length >= 32) {
+    uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed,
+             v4 = seed - PRIME1;
+    for (; p + 32 <= end; p += 32) {
+      v1 = Round(v1, Read64(p));
+      v2 = Round(v2, Read64(p + 8));
+      v3 = Round(v3, Read64(p + 16));
+      v4 = Round(v4, Read64(p + 24));
+    }
+    hash = Rotate(v1, 1) + Rotate(v2, 7) + Rotate(v3, 12) + Rotate(v4, 18);
+    hash = MergeRound(MergeRound(MergeRound(MergeRound(hash, v1), v2), v3), v4);
+  } else {
+    hash = seed + PRIME5;
+  }
+  hash += uint64_t(length);
+
+  for (; p + 8 <= end; p += 8) {
+    hash = Rotate(hash ^ Round(0, Read64(p)), 27) * PRIME1 + PRIME4;
+  }
+  for (; p < end; p++) {
+    hash = Rotate(hash ^ (*p * PRIME5), 11) * PRIME1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= PRIME2;
+  hash ^= hash >> 29;
+  hash *= PRIME3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+namespace {
+
+size_t Right(const Rectangle &r) { return r.x + r.width; }
+size_t Bottom(const Rectangle &r) { return r.y + r.height; }
+
+// Boxes sharing at least half the height of the shorter one
+bool SameLine(const Rectangle &a, const Rectangle &b) {
+  size_t top = std::max(a.y, b.y), bottom = std::min(Bottom(a), Bottom(b));
+  return bottom > top && (bottom - top) * 2 >= std::min(a.height, b.height);
+}
+
+// `left` reaches the edge from the left and `right` continues past it, each
+// within `slack` of the edge.
+bool CrossesEdge(const Rectangle &left, const Rectangle &right, size_t edge,
+                 size_t slack) {
+  return left.x < edge && Right(left) + slack >= edge && right.x <= edge + slack &&
+         Right(right) > edge && left.x < right.x;
+}
+
+// Text both pieces read in their overlap (the end of `left`, the start of
+// `right`) is kept once.
+std::string JoinText(const std::string &left, const std::string &right,
+                     bool overlapping, bool spaced) {
+  if (overlapping) {
+    for (size_t k = std::min(left.size(), right.size()); k > 0; k--) {
+      if (left.compare(left.size() - k, k, right, 0, k) == 0) {
+        return left + right.substr(k);
+      }
+    }
+    spaced = true;
+  }
+  return left + (spaced ? " " : "") + right;
+}
+
+} // namespace
+
+std::vector<OCRObservation> StitchObservations(std::vector<OCRObservation> pieces,
+                                               const std::vector<size_t> &edges,
+                                               size_t overlap) {
+  std::sort(pieces.begin(), pieces.end(),
+            [](const OCRObservation &a, const OCRObservation &b) {
+              return a.bbox.x < b.bbox.x;
+            });
+
+  std::vector<OCRObservation> lines;
+  for (OCRObservation &piece : pieces) {
+    bool merged = false;
+    for (OCRObservation &line : lines) {
+      Rectangle &a = line.bbox;
+      const Rectangle &b = piece.bbox;
+      if (!SameLine(a, b)) {
+        continue;
+      }
+      // A gap at the edge up to a line height is a space, not a column gap
+      size_t slack = std::min(std::max(a.height, b.height), overlap * 2);
+      bool crosses = false;
+      for (size_t edge : edges) {
+        crosses = crosses || CrossesEdge(a, b, edge, slack);
+      }
+      if (!crosses) {
+        continue;
+      }
+
+      bool overlapping = b.x < Right(a);
+      bool spaced = !overlapping && (b.x - Right(a)) * 2 > std::max(a.height, b.height);
+      line.text = JoinText(line.text, piece.text, overlapping, spaced);
+      size_t right = std::max(Right(a), Right(b)), bottom = std::max(Bottom(a), Bottom(b));
+      a.y = std::min(a.y, b.y);
+      a.width = right - a.x;
+      a.height = bottom - a.y;
+      merged = true;
+      break;
+    }
+    if (!merged) {
+      lines.push_back(piece);
+    }
+  }
+
+  // Reading order
+  std::sort(lines.begin(), lines.end(),
+            [](const OCRObservation &a, const OCRObservation &b) {
+              return a.bbox.y != b.bbox.y ? a.bbox.y < b.bbox.y : a.bbox.x < b.bbox.x;
+            });
+  return lines;
+}
+
+OCRSession::OCRSession(const OCRSessionOptions &options)
+    : options_(options), columns_(0), resetPending_(false) {}
+
+void OCRSession::Layout(const OCRImage &frame, const std::string &key) {
+  if (key == key_) {
+    return;
+  }
+  key_ = key;
+  tiles_.clear();
+  const size_t tw = options_.tileWidth, th = options_.tileHeight, overlap = options_.overlap;
+  columns_ = (frame.width + tw - 1) / tw;
+  for (size_t y0 = 0; y0 < frame.height; y0 += th) {
+    for (size_t x0 = 0; x0 < frame.width; x0 += tw) {
+      Tile tile;
+      tile.x0 = x0;
+      tile.y0 = y0;
+      tile.x1 = std::min(frame.width, x0 + tw);
+      tile.y1 = std::min(frame.height, y0 + th);
+      tile.outerX0 = x0 > overlap ? x0 - overlap : 0;
+      tile.outerY0 = y0 > overlap ? y0 - overlap : 0;
+      tile.outerX1 = std::min(frame.width, tile.x1 + overlap);
+      tile.outerY1 = std::min(frame.height, tile.y1 + overlap);
+      tile.hash = 0;
+      tile.cached = false;
+      tiles_.push_back(std::move(tile));
+    }
+  }
+}
+
+void OCRSession::RecognizeTile(OCRBackend &backend, const OCRImage &frame,
+                               const OCROptions &options, Tile *tile) {
+  // The tile's area of the frame, read in place
+  const size_t bpp = OCRBytesPerPixel(frame.format);
+  const size_t width = tile->outerX1 - tile->outerX0, height = tile->outerY1 - tile->outerY0;
+  OCRImage crop{frame.data + tile->outerY0 * frame.stride + tile->outerX0 * bpp,
+                (height - 1) * frame.stride + width * bpp,
+                frame.format,
+                width,
+                height,
+                frame.stride};
+  OCRData data = RecognizeWithPreprocessing(backend, crop, options);
+
+  tile->observations.clear();
+  if (!data.success) {
+    tile->cached = false;
+    tile->error = data.error.empty() ? "Text recognition failed" : data.error;
+    return;
+  }
+  tile->cached = true;
+  tile->error.clear();
+  for (OCRObservation &observation : data.observations) {
+    Rectangle &bbox = observation.bbox;
+    bbox.x += tile->outerX0;
+    bbox.y += tile->outerY0;
+    // Lines seen by several tiles belong to the one holding their center
+    size_t cx = bbox.x + bbox.width / 2, cy = bbox.y + bbox.height / 2;
+    if (cx >= tile->x0 && cx < tile->x1 && cy >= tile->y0 && cy < tile->y1) {
+      tile->observations.push_back(std::move(observation));
+    }
+  }
+}
+
+OCRData OCRSession::Recognize(OCRBackend &backend, const OCRImage &frame,
+                              const OCROptions &options,
+                              const OCRParallelFor &parallelFor,
+                              OCRSessionStats *last) {
+  if (frame.format == OCR_FORMAT_PNG) {
+    return OCRData(std::string("OCR sessions take raw frames"));
+  }
+  if (resetPending_.exchange(false)) {
+    tiles_.clear();
+    key_.clear();
+  }
+
+  // Cached text is only valid for the same geometry, format and options
+  std::string key = std::to_string(frame.width) + "x" + std::to_string(frame.height) + "/" +
+                    std::to_string(int(frame.format)) + "/" +
+                    std::to_string(options.preprocess.enabled) +
+                    std::to_string(options.preprocess.downscale) +
+                    std::to_string(options.preprocess.binarize);
+  for (const std::string &language : options.languages) {
+    key += "/" + language;
+  }
+  Layout(frame, key);
+
+  const size_t bpp = OCRBytesPerPixel(frame.format);
+  std::vector<char> dirty(tiles_.size(), 0);
+  parallelFor(tiles_.size(), [&](size_t i) {
+    Tile &tile = tiles_[i];
+    uint64_t hash = 0;
+    for (size_t y = tile.outerY0; y < tile.outerY1; y++) {
+      hash = HashBytes(frame.data + y * frame.stride + tile.outerX0 * bpp,
+                       (tile.outerX1 - tile.outerX0) * bpp, hash);
+    }
+    dirty[i] = !tile.cached || hash != tile.hash;
+    tile.hash = hash;
+  });
+
+  std::vector<Tile *> changed;
+  for (size_t i = 0; i < tiles_.size(); i++) {
+    if (dirty[i]) {
+      changed.push_back(&tiles_[i]);
+    }
+  }
+  parallelFor(changed.size(), [&](size_t i) {
+    RecognizeTile(backend, frame, options, changed[i]);
+  });
+
+  OCRSessionStats frameStats;
+  frameStats.frames = 1;
+  frameStats.tiles = tiles_.size();
+  frameStats.recognizedTiles = changed.size();
+  frameStats.reusedTiles = tiles_.size() - changed.size();
+  {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.frames += frameStats.frames;
+    stats_.tiles += frameStats.tiles;
+    stats_.recognizedTiles += frameStats.recognizedTiles;
+    stats_.reusedTiles += frameStats.reusedTiles;
+  }
+  if (last != nullptr) {
+    *last = frameStats;
+  }
+
+  std::vector<OCRObservation> pieces;
+  for (const Tile &tile : tiles_) {
+    if (!tile.error.empty()) {
+      return OCRData(tile.error);
+    }
+    pieces.insert(pieces.end(), tile.observations.begin(), tile.observations.end());
+  }
+  std::vector<size_t> edges;
+  for (size_t column = 1; column < columns_; column++) {
+    edges.push_back(column * options_.tileWidth);
+  }
+  std::vector<OCRObservation> lines =
+      StitchObservations(std::move(pieces), edges, options_.overlap);
+  return OCRData(lines);
+}
+
+OCRSessionStats OCRSession::Stats() {
+  std::lock_guard<std::mutex> lock(statsMutex_);
+  return stats_;
+}
+
+void OCRSession::Reset() { resetPending_.store(true); }
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "OCR.h"
+
+struct OCRSessionOptions {
+  size_t tileWidth = 512;
+  size_t tileHeight = 256;
+  // Each tile is recognized together with this many pixels of its
+  // neighbours, so that a line cut by a tile edge is seen whole by the tile
+  // that holds its center (lines up to twice this tall).
+  size_t overlap = 32;
+};
+
+struct OCRSessionStats {
+  uint64_t frames = 0;
+  uint64_t tiles = 0;
+  // Tiles that went to the backend; the others reused cached text
+  uint64_t recognizedTiles = 0;
+  uint64_t reusedTiles = 0;
+};
+
+// Runs fn(0) ... fn(count - 1), possibly in parallel, and returns when all
+// have returned.
+typedef std::function<void(size_t count, const std::function<void(size_t)> &fn)>
+    OCRParallelFor;
+
+// OCR of successive frames of the same window. Frames are split into tiles
+// that are hashed, and only tiles whose pixels changed since the previous
+// frame are recognized again; the others reuse their cached observations.
+// Lines that cross a vertical tile edge are stitched back together.
+class OCRSession {
+public:
+  explicit OCRSession(const OCRSessionOptions &options);
+
+  // `frame` must be a raw frame. Calls on one session must not overlap;
+  // the JS handle queues them. `last` receives the counts of this frame
+  // alone.
+  OCRData Recognize(OCRBackend &backend, const OCRImage &frame,
+                    const OCROptions &options, const OCRParallelFor &parallelFor,
+                    OCRSessionStats *last);
+
+  // Safe while Recognize runs; it only waits for the counters to be copied.
+  OCRSessionStats Stats();
+
+  // Drops the cached tiles, so that the next frame is recognized whole.
+  // Never waits: the next Recognize drops them.
+  void Reset();
+
+private:
+  struct Tile {
+    // The part of the frame the tile owns, and the overlapping area it is
+    // recognized and hashed with
+    size_t x0, y0, x1, y1;
+    size_t outerX0, outerY0, outerX1, outerY1;
+    uint64_t hash;
+    bool cached;
+    // Set when the backend failed on the tile; it is tried again next frame
+    std::string error;
+    // Frame coordinates; only lines whose center the tile owns
+    std::vector<OCRObservation> observations;
+  };
+
+  void Layout(const OCRImage &frame, const std::string &key);
+  void RecognizeTile(OCRBackend &backend, const OCRImage &frame,
+                     const OCROptions &options, Tile *tile);
+
+  const OCRSessionOptions options_;
+  // Only touched by Recognize
+  std::vector<Tile> tiles_;
+  size_t columns_;
+  // Frame geometry and recognition options the cache was filled with
+  std::string key_;
+  std::atomic<bool> resetPending_;
+  // Guards `stats_` alone, so reading it never waits for a frame
+  std::mutex statsMutex_;
+  OCRSessionStats stats_;
+};
+
+// 64-bit hash of `length` bytes in the style of xxHash64: four independent
+// lanes of 8-byte words, so it runs at several GB/s. Not cryptographic.
+uint64_t HashBytes(const uint8_t *data, size_t length, uint64_t seed);
+
+// Joins the observations that are pieces of one line cut by a vertical tile
+// edge at x = `edges[i]`. Pieces overlap by up to twice `overlap`; text they
+// both contain is kept once.
+std::vector<OCRObservation> StitchObservations(std::vector<OCRObservation> pieces,
+                                               const std::vector<size_t> &edges,
+                                               size_t overlap);
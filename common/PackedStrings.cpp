@@ -0,0 +1,52 @@
+#include <cstring>
+
+#include "PackedStrings.h"
+
+PackedStrings PackStrings(const std::vector<std::string> &strings) {
+  PackedStrings packed;
+  size_t total = 0;
+  for (const std::string &value : strings) {
+    total += value.size();
+  }
+  packed.offsets.reserve(strings.size() + 1);
+  packed.bytes.reserve(total);
+
+  packed.offsets.push_back(0);
+  for (const std::string &value : strings) {
+    packed.bytes.append(value);
+    packed.offsets.push_back(uint32_t(packed.bytes.size()));
+  }
+  return packed;
+}
+
+Napi::Object PackedStringsToObject(const Napi::Env &env,
+                                   const PackedStrings &packed) {
+  // Copied rather than handed over as an external buffer, which Electron
+  // builds with the V8 memory cage refuse.
+  size_t offsetBytes = packed.offsets.size() * sizeof(uint32_t);
+  Napi::ArrayBuffer buffer =
+      Napi::ArrayBuffer::New(env, offsetBytes + packed.bytes.size());
+  uint8_t *data = static_cast<uint8_t *>(buffer.Data());
+  if (offsetBytes > 0) {
+    memcpy(data, packed.offsets.data(), offsetBytes);
+  }
+  if (!packed.bytes.empty()) {
+    memcpy(data + offsetBytes, packed.bytes.data(), packed.bytes.size());
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("count", Napi::Number::New(env, double(packed.offsets.size() - 1)));
+  result.Set("offsets",
+             Napi::Uint32Array::New(env, packed.offsets.size(), buffer, 0));
+  result.Set("data", Napi::Uint8Array::New(env, packed.bytes.size(), buffer,
+                                           offsetBytes));
+  return result;
+}
+
+bool WantsPackedStrings(const Napi::CallbackInfo &info, size_t index) {
+  if (info.Length() <= index || !info[index].IsObject()) {
+    return false;
+  }
+  Napi::Value packed = info[index].As<Napi::Object>().Get("packed");
+  return packed.IsBoolean() && packed.As<Napi::Boolean>().Value();
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <napi.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A string list laid out for a single ArrayBuffer: `count + 1` uint32
+// offsets followed by the UTF-8 bytes, entry i being
+// bytes[offsets[i], offsets[i + 1]). Built off the JS thread by the Promise
+// variants; only the copy into the ArrayBuffer happens on it.
+struct PackedStrings {
+  std::vector<uint32_t> offsets;
+  std::string bytes;
+};
+
+PackedStrings PackStrings(const std::vector<std::string> &strings);
+
+// {count, offsets: Uint32Array, data: Uint8Array}, both views of one
+// ArrayBuffer, which index.js wraps in a PackedStringList.
+Napi::Object PackedStringsToObject(const Napi::Env &env,
+                                   const PackedStrings &packed);
+
+// True when the argument at `index` is an options object with `packed: true`.
+bool WantsPackedStrings(const Napi::CallbackInfo &info, size_t index);
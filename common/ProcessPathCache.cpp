@@ -0,0 +1,90 @@
+#include <unordered_set>
+
+#include "ProcessPathCache.h"
+
+// Callers that never enumerate all processes (audio queries only) have no
+// point at which to prune, so the cache is simply reset past this size.
+static const size_t MAX_CACHE_ENTRIES = 65536;
+
+ProcessPathCache &ProcessPathCache::Shared() {
+  static ProcessPathCache *cache = new ProcessPathCache();
+  return *cache;
+}
+
+bool ProcessPathCache::Lookup(const ProcessKey &key, const std::string &image,
+                              const std::function<bool(std::string &)> &resolve,
+                              CachedProcessInfo &out) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end() && it->second.image == image) {
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      out = it->second;
+      return out.resolved;
+    }
+  }
+
+  // Resolve outside the lock; two threads missing on the same key both do
+  // the lookup and store the same value.
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  CachedProcessInfo info;
+  info.image = image;
+  info.resolved = resolve(info.path);
+  if (info.resolved) {
+    info.name = ProcessNameFromPath(info.path);
+  } else {
+    info.path.clear();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.size() >= MAX_CACHE_ENTRIES) {
+      entries_.clear();
+    }
+    entries_[key] = info;
+  }
+
+  out = std::move(info);
+  return out.resolved;
+}
+
+void ProcessPathCache::Forget(const ProcessKey &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.erase(key);
+}
+
+void ProcessPathCache::Retain(const std::vector<ProcessKey> &live) {
+  std::unordered_set<ProcessKey, ProcessKeyHash> keep(live.begin(),
+                                                      live.end());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (keep.find(it->first) == keep.end()) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+ProcessPathCacheStats ProcessPathCache::Stats() {
+  ProcessPathCacheStats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats.entries = entries_.size();
+  return stats;
+}
+
+void ProcessPathCache::ResetStats() {
+  hits_.store(0, std::memory_order_relaxed);
+  misses_.store(0, std::memory_order_relaxed);
+}
+
+std::string ProcessNameFromPath(const std::string &path) {
+  size_t lastSlash = path.find_last_of("/\\");
+  if (lastSlash == std::string::npos) {
+    return path;
+  }
+  return path.substr(lastSlash + 1);
+}
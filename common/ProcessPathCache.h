@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ProcessSnapshot.h"
+
+struct CachedProcessInfo {
+  std::string path;
+  std::string name;
+  // The image name the entry was resolved for (see Lookup)
+  std::string image;
+  // False when the path could not be resolved (e.g. access denied). Failures
+  // are cached as well so they are not retried on every poll.
+  bool resolved;
+
+  CachedProcessInfo() : resolved(false) {}
+};
+
+struct ProcessPathCacheStats {
+  uint64_t hits;
+  uint64_t misses;
+  size_t entries;
+};
+
+// Executable path and name per process, keyed by (pid, start time) so that a
+// reused PID never returns the previous owner's path. Shared by process
+// enumeration and every audio attribution query.
+class ProcessPathCache {
+public:
+  static ProcessPathCache &Shared();
+
+  // Fills `out` for the given process. On a miss `resolve` is called to look
+  // the path up; it returns false if the path is not available. exec()
+  // keeps the key but changes the executable, so `image` is the name the
+  // platform reports for the process image (the command name), and an entry
+  // cached for another image is resolved again. Empty where a process can
+  // never change its executable.
+  bool Lookup(const ProcessKey &key, const std::string &image,
+              const std::function<bool(std::string &)> &resolve,
+              CachedProcessInfo &out);
+
+  // Drops the entry for one process, e.g. when exec() is reported for it.
+  void Forget(const ProcessKey &key);
+
+  // Drops every entry that is not in `live`. Called after a full process
+  // enumeration so exited processes are invalidated.
+  void Retain(const std::vector<ProcessKey> &live);
+
+  ProcessPathCacheStats Stats();
+  void ResetStats();
+
+private:
+  ProcessPathCache() : hits_(0), misses_(0) {}
+
+  std::mutex mutex_;
+  std::unordered_map<ProcessKey, CachedProcessInfo, ProcessKeyHash> entries_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+};
+
+// Returns the last path component, accepting both separators.
+std::string ProcessNameFromPath(const std::string &path);
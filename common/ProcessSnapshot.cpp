@@ -0,0 +1,51 @@
+#include "ProcessSnapshot.h"
+
+ProcessDelta ProcessSnapshotStore::Update(std::vector<ProcessEntry> &&entries,
+                                          uint64_t sinceGeneration) {
+  std::unordered_map<ProcessKey, std::string, ProcessKeyHash> next;
+  next.reserve(entries.size());
+  for (auto &entry : entries) {
+    next.emplace(ProcessKey{entry.pid, entry.startTime}, std::move(entry.path));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ProcessDelta delta;
+
+  for (const auto &item : next) {
+    auto previous = current_.find(item.first);
+    if (previous == current_.end()) {
+      delta.added.push_back(item.second);
+    } else if (previous->second != item.second) {
+      // Same process after exec(): the old executable is gone
+      delta.removed.push_back(previous->second);
+      delta.added.push_back(item.second);
+    }
+  }
+  for (const auto &item : current_) {
+    if (next.find(item.first) == next.end()) {
+      delta.removed.push_back(item.second);
+    }
+  }
+
+  bool upToDate = generation_ != 0 && sinceGeneration == generation_;
+
+  // An unchanged process list keeps its generation, so a caller that is
+  // already up to date can keep passing the same value.
+  if (generation_ == 0 || !delta.added.empty() || !delta.removed.empty()) {
+    generation_++;
+  }
+  current_.swap(next);
+  delta.generation = generation_;
+
+  if (!upToDate) {
+    delta.full = true;
+    delta.removed.clear();
+    delta.added.clear();
+    delta.added.reserve(current_.size());
+    for (const auto &item : current_) {
+      delta.added.push_back(item.second);
+    }
+  }
+
+  return delta;
+}
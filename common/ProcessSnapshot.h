@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A process as seen by one enumeration pass. The start time is only used to
+// tell a reused PID apart from the process that held it before, so each
+// platform may use whatever unit its kernel reports.
+struct ProcessEntry {
+  uint32_t pid;
+  uint64_t startTime;
+  std::string path;
+  // 0 when the platform scan does not report it
+  uint32_t ppid;
+};
+
+struct ProcessKey {
+  uint32_t pid;
+  uint64_t startTime;
+
+  bool operator==(const ProcessKey &other) const {
+    return pid == other.pid && startTime == other.startTime;
+  }
+};
+
+struct ProcessKeyHash {
+  size_t operator()(const ProcessKey &key) const {
+    uint64_t h = (uint64_t(key.pid) * 0x9E3779B97F4A7C15ULL) ^ key.startTime;
+    return size_t(h ^ (h >> 32));
+  }
+};
+
+struct ProcessDelta {
+  std::vector<std::string> added;
+  std::vector<std::string> removed;
+  uint64_t generation;
+  // True when the caller's generation was stale and `added` holds the whole
+  // snapshot instead of a difference.
+  bool full;
+
+  ProcessDelta() : generation(0), full(false) {}
+};
+
+// Keeps the previous process snapshot so that polling callers only receive
+// what changed since the generation they last saw. Generation 0 never names
+// a snapshot, so passing it always yields a full result.
+class ProcessSnapshotStore {
+public:
+  ProcessSnapshotStore() : generation_(0) {}
+
+  ProcessDelta Update(std::vector<ProcessEntry> &&entries,
+                      uint64_t sinceGeneration);
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<ProcessKey, std::string, ProcessKeyHash> current_;
+  uint64_t generation_;
+};
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+#include "ProcessTree.h"
+
+// Walks stop here even if every ancestor matched, which only happens when
+// reused PIDs form a cycle.
+static const int MAX_TREE_DEPTH = 64;
+
+// A snapshot is taken again for unknown PIDs at most this often, so a
+// session of a process that cannot be enumerated does not cause a scan on
+// every query.
+static const int MIN_REFRESH_INTERVAL_MS = 500;
+
+ProcessTree &ProcessTree::Shared() {
+  static ProcessTree *tree = new ProcessTree();
+  return *tree;
+}
+
+void ProcessTree::Update(const std::vector<ProcessEntry> &entries) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pass_++;
+  for (const ProcessEntry &entry : entries) {
+    Node &node = nodes_[entry.pid];
+    if (node.pass == 0 || node.startTime != entry.startTime) {
+      node.startTime = entry.startTime;
+      node.path = entry.path;
+    } else if (node.path != entry.path) {
+      // exec() keeps the start time but not the executable
+      node.path = entry.path;
+    }
+    node.ppid = entry.ppid;
+    node.pass = pass_;
+  }
+
+  // Anything not seen in this pass has exited.
+  for (auto it = nodes_.begin(); it != nodes_.end();) {
+    if (it->second.pass != pass_) {
+      it = nodes_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  updated_ = std::chrono::steady_clock::now();
+}
+
+bool ProcessTree::RootApp(uint32_t pid, ProcessEntry *root) const {
+  auto current = nodes_.find(pid);
+  if (current == nodes_.end()) {
+    return false;
+  }
+
+  for (int depth = 0; depth < MAX_TREE_DEPTH; depth++) {
+    const Node &node = current->second;
+    auto parent = nodes_.find(node.ppid);
+    // A parent that started later holds a reused PID; the real one exited.
+    if (node.ppid == 0 || node.ppid == current->first ||
+        parent == nodes_.end() ||
+        parent->second.startTime > node.startTime ||
+        !IsSameApplication(parent->second.path, node.path)) {
+      break;
+    }
+    current = parent;
+  }
+
+  root->pid = current->first;
+  root->startTime = current->second.startTime;
+  root->path = current->second.path;
+  root->ppid = current->second.ppid;
+  return true;
+}
+
+std::vector<ProcessEntry>
+ProcessTree::RootApps(const std::vector<uint32_t> &pids,
+                      const std::function<void()> &refresh) {
+  std::vector<ProcessEntry> roots(pids.size(), ProcessEntry{0, 0, std::string(), 0});
+  bool missing = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < pids.size(); i++) {
+      // PID 0 means the session did not say; a snapshot would not help.
+      if (pids[i] != 0 && !RootApp(pids[i], &roots[i])) {
+        missing = true;
+      }
+    }
+    missing = missing && std::chrono::steady_clock::now() - updated_ >=
+                             std::chrono::milliseconds(MIN_REFRESH_INTERVAL_MS);
+  }
+  if (!missing || !refresh) {
+    return roots;
+  }
+
+  refresh();
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The refresh may also have moved known processes, e.g. a parent exited.
+  for (size_t i = 0; i < pids.size(); i++) {
+    if (pids[i] == 0 || !RootApp(pids[i], &roots[i])) {
+      roots[i] = ProcessEntry{0, 0, std::string(), 0};
+    }
+  }
+  return roots;
+}
+
+size_t ProcessTree::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nodes_.size();
+}
+
+static bool IsSeparator(char c) { return c == '/' || c == '\\'; }
+
+// Directories holding executables of unrelated packages, compared without
+// case for the Windows ones.
+static bool IsSharedDirectory(const std::string &dir) {
+  static const char *const SHARED[] = {
+      "/bin",
+      "/sbin",
+      "/usr/bin",
+      "/usr/sbin",
+      "/usr/local/bin",
+      "/usr/libexec",
+      "/usr/lib",
+      "c:\\windows",
+      "c:\\windows\\system32",
+      "c:\\windows\\syswow64",
+  };
+  std::string lower(dir);
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return char(std::tolower(c)); });
+  for (const char *shared : SHARED) {
+    if (lower == shared) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The outermost .app bundle on macOS (helpers live in nested bundles),
+// otherwise the directory of the executable.
+static std::string ApplicationLocation(const std::string &path) {
+  size_t bundle = path.find(".app/");
+  if (bundle != std::string::npos) {
+    return path.substr(0, bundle + 4);
+  }
+  size_t end = path.size();
+  while (end > 0 && !IsSeparator(path[end - 1])) {
+    end--;
+  }
+  if (end == 0) {
+    return path;
+  }
+  std::string dir = path.substr(0, end - 1);
+  return IsSharedDirectory(dir) ? path : dir;
+}
+
+bool IsSameApplication(const std::string &parent, const std::string &child) {
+  if (parent.empty() || child.empty()) {
+    return false;
+  }
+  if (parent == child) {
+    return true;
+  }
+  return ApplicationLocation(parent) == ApplicationLocation(child);
+}
+
+std::vector<std::string>
+AttributeToRootApps(const std::vector<SessionProcess> &sessions,
+                    const std::function<void()> &refresh) {
+  std::vector<uint32_t> pids;
+  pids.reserve(sessions.size());
+  for (const SessionProcess &session : sessions) {
+    pids.push_back(session.pid);
+  }
+  std::vector<ProcessEntry> roots = ProcessTree::Shared().RootApps(pids, refresh);
+
+  std::vector<std::string> apps;
+  std::unordered_set<std::string> seen;
+  for (size_t i = 0; i < sessions.size(); i++) {
+    const std::string &app =
+        roots[i].pid != 0 ? roots[i].path : sessions[i].fallback;
+    if (!app.empty() && seen.insert(app).second) {
+      apps.push_back(app);
+    }
+  }
+  return apps;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ProcessSnapshot.h"
+
+// Parent links of the processes seen by the last full enumeration, so that
+// audio sessions can be attributed to the application that owns them rather
+// than to a helper process. Each platform's GetRunningProcessEntries feeds
+// it; lookups only walk this index and never enumerate processes.
+class ProcessTree {
+public:
+  static ProcessTree &Shared();
+
+  // Brings the index in line with a full snapshot. Processes that are
+  // already known with the same start time are left as they are.
+  void Update(const std::vector<ProcessEntry> &entries);
+
+  // For each pid, the topmost ancestor that still belongs to the same
+  // application (the pid itself when its parent is another app). Entries
+  // for pids that are not in the index have pid 0. When some are missing
+  // and the index is older than a short interval, `refresh` is called once
+  // first; it is expected to enumerate processes, which lands in Update().
+  std::vector<ProcessEntry> RootApps(const std::vector<uint32_t> &pids,
+                                     const std::function<void()> &refresh);
+
+  size_t Size();
+
+private:
+  struct Node {
+    uint32_t ppid;
+    uint64_t startTime;
+    std::string path;
+    uint32_t pass;
+  };
+
+  ProcessTree() : pass_(0) {}
+
+  // Caller holds mutex_.
+  bool RootApp(uint32_t pid, ProcessEntry *root) const;
+
+  std::mutex mutex_;
+  std::unordered_map<uint32_t, Node> nodes_;
+  uint32_t pass_;
+  std::chrono::steady_clock::time_point updated_;
+};
+
+// True when `parent` and `child` are executables of one application: the
+// same .app bundle, or the same install directory. Shared directories such
+// as /usr/bin or System32 only match the identical executable.
+bool IsSameApplication(const std::string &parent, const std::string &child);
+
+// An audio session's process, and what to report for it when the process is
+// not in the tree (e.g. another user's, or a PipeWire client without a pid).
+struct SessionProcess {
+  uint32_t pid;
+  std::string fallback;
+};
+
+// The executable paths of the applications owning `sessions`, one per
+// application in first-seen order.
+std::vector<std::string>
+AttributeToRootApps(const std::vector<SessionProcess> &sessions,
+                    const std::function<void()> &refresh);
@@ -0,0 +1,102 @@
+#include <string>
+#include <vector>
+
+#include "OCRSession.h"
+#include "SyntheticOCR.h"
+
+namespace {
+
+class SyntheticOCRBackend : public OCRBackend {
+public:
+  const char *Name() const override { return "synthetic"; }
+
+  OCRData Recognize(const OCRImage &image, const OCROptions &options) override;
+};
+
+// Green for color frames; text is black on white either way.
+inline bool IsDark(const OCRImage &image, size_t bpp, size_t x, size_t y) {
+  const uint8_t *p = image.data + y * image.stride + x * bpp;
+  return (bpp == 1 ? p[0] : p[1]) < 128;
+}
+
+OCRData SyntheticOCRBackend::Recognize(const OCRImage &image, const OCROptions &) {
+  const size_t bpp = OCRBytesPerPixel(image.format);
+  if (bpp == 0) {
+    return OCRData(std::string("The synthetic backend takes raw frames"));
+  }
+  const size_t width = image.width, height = image.height;
+  std::vector<OCRObservation> observations;
+  std::vector<char> darkColumns(width);
+
+  size_t y = 0;
+  while (y < height) {
+    size_t top = y;
+    auto rowIsDark = [&](size_t row) {
+      for (size_t x = 0; x < width; x++) {
+        if (IsDark(image, bpp, x, row)) {
+          return true;
+        }
+      }
+      return false;
+    };
+    while (top < height && !rowIsDark(top)) {
+      top++;
+    }
+    size_t bottom = top;
+    while (bottom < height && rowIsDark(bottom)) {
+      bottom++;
+    }
+    y = bottom + 1;
+    if (top >= height || top == 0 || bottom == height) {
+      continue;
+    }
+
+    for (size_t x = 0; x < width; x++) {
+      darkColumns[x] = 0;
+      for (size_t row = top; row < bottom && !darkColumns[x]; row++) {
+        darkColumns[x] = IsDark(image, bpp, x, row);
+      }
+    }
+
+    std::string text;
+    size_t left = 0, right = 0;
+    size_t x = 0;
+    while (x < width) {
+      if (!darkColumns[x]) {
+        x++;
+        continue;
+      }
+      size_t start = x;
+      while (x < width && darkColumns[x]) {
+        x++;
+      }
+      if (start == 0 || x == width) {
+        continue;
+      }
+      std::vector<uint8_t> bits;
+      for (size_t row = top; row < bottom; row++) {
+        for (size_t column = start; column < x; column++) {
+          bits.push_back(IsDark(image, bpp, column, row));
+        }
+      }
+      char glyph = char('A' + HashBytes(bits.data(), bits.size(), x - start) % 26);
+      if (text.empty()) {
+        left = start;
+      } else if ((start - right) * 2 > bottom - top) {
+        text += ' ';
+      }
+      text += glyph;
+      right = x;
+    }
+    if (!text.empty()) {
+      observations.emplace_back(Rectangle{left, top, right - left, bottom - top}, text);
+    }
+  }
+  return OCRData(observations);
+}
+
+} // namespace
+
+std::unique_ptr<OCRBackend> CreateSyntheticOCRBackend() {
+  return std::unique_ptr<OCRBackend>(new SyntheticOCRBackend());
+}
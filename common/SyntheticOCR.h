@@ -0,0 +1,12 @@
+#pragma once
+#include <memory>
+
+#include "OCR.h"
+
+// Stands in for Vision or Tesseract in test-ocr.js and the benchmarks. It
+// reads dark text on a light background, like the frames of
+// bench/synthetic.js: each run of dark rows is a line, each run of dark
+// columns in it a glyph, named by a hash of its pixels, and a gap wider
+// than half the line height a space. Lines and glyphs cut by the image
+// edge are skipped, as a real engine would fail to read them.
+std::unique_ptr<OCRBackend> CreateSyntheticOCRBackend();
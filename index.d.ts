@@ -24,28 +24,433 @@ declare module "node-mac-utils" {
     | ResultErrorWithProcess<T>;
 
   export function getRunningInputAudioProcesses(): string[];
-  export function getProcessesAccessingMicrophoneWithResult(): ResultWithProcesses<string>;
-  export function getProcessesAccessingMicrophoneDebouncedWithResult(): ResultWithProcesses<string>;
+  // "rootApp" walks each session's process up to the application that owns
+  // it (e.g. the main browser process instead of its audio helper) and lists
+  // every application once; on Linux this uses the stream's
+  // application.process.id and reports executable paths. Ignored on Mac,
+  // which already reports bundle IDs.
+  export type AudioAttributionOptions = { attribution?: "process" | "rootApp" };
+  export function getProcessesAccessingMicrophoneWithResult(
+    options?: AudioAttributionOptions
+  ): ResultWithProcesses<string>;
+  // Thresholds of the debounced query (Windows Bluetooth devices, Linux
+  // per-application streams). Options apply to that call only.
+  export type MicrophoneDebounceOptions = {
+    debounceMs?: number; // default 3000
+    activeHoldMs?: number; // default 5000
+    requiredActiveChecks?: number; // default 2; 1 on Linux, so new users show up on the first call
+    requiredInactiveChecks?: number; // default 4
+    rapidChangeWindowMs?: number; // default 10000
+    maxRapidChanges?: number; // default 5
+    extendedDebounceMs?: number; // default 8000
+  };
+  export function getProcessesAccessingMicrophoneDebouncedWithResult(
+    options?: MicrophoneDebounceOptions
+  ): ResultWithProcesses<string>;
 
   // No-op on Mac
-  export function getProcessesAccessingSpeakersWithResult(): ResultWithProcesses<ProcessInfo>;
+  export function getProcessesAccessingSpeakersWithResult(
+    options?: AudioAttributionOptions
+  ): ResultWithProcesses<ProcessInfo>;
+
+  // Promise-returning variants that do the native work off the JS thread
+  export function getProcessesAccessingMicrophoneWithResultAsync(
+    options?: AudioAttributionOptions
+  ): Promise<ResultWithProcesses<string>>;
+  export function getProcessesAccessingSpeakersWithResultAsync(
+    options?: AudioAttributionOptions
+  ): Promise<ResultWithProcesses<ProcessInfo>>;
   export function installMSIXAndRestart(fileUri: string): void;
 
+  // Call latency of each native export since load (or the last reset);
+  // "<name>:work" entries time the executor part of the Promise variants,
+  // "executor.<lane>:wait" the time their jobs waited for a thread
+  export type ExportLatencyStats = {
+    calls: number;
+    meanNs: number;
+    p50Ns: number;
+    p90Ns: number;
+    p99Ns: number;
+    p999Ns: number;
+    maxNs: number;
+    // Non-empty buckets as [lowerBoundNs, count], each within 12.5% of its bound
+    histogram: [number, number][];
+  };
+  export type BackendErrorStats = {
+    backend: "coreaudio" | "com" | "pipewire" | "other";
+    code: number;
+    count: number;
+  };
+  export type NativeStats = {
+    exports: Record<string, ExportLatencyStats>;
+    backendErrors: BackendErrorStats[];
+    // e.g. micMonitor.starts, micMonitor.restarts, micMonitor.events
+    counters: Record<string, number>;
+  };
+  export function getNativeStats(): NativeStats;
+  export function resetNativeStats(): void;
+
+  // The Promise variants run on the addon's own threads, in two lanes: the
+  // microphone, speaker and process queries in "interactive", OCR and the
+  // installed app inventory in "bulk". Bulk jobs never occupy every thread,
+  // so interactive queries do not wait behind them.
+  export type ExecutorOptions = {
+    // Default one per core, from 2 to 8
+    threads?: number;
+    // Threads kept free of bulk jobs; default 1, at most threads - 1
+    interactiveThreads?: number;
+    // Jobs waiting per lane beyond which Promises reject; default 256 and 64
+    maxQueued?: { interactive?: number; bulk?: number };
+  };
+  // Returns false, changing nothing, once an async export has run
+  export function configureExecutor(options: ExecutorOptions): boolean;
+  export type ExecutorLaneStats = {
+    // Jobs waiting now, and the most that waited at once
+    queued: number;
+    maxQueued: number;
+    running: number;
+    submitted: number;
+    completed: number;
+    // Cancelled through an AbortSignal before they started
+    cancelled: number;
+    // Rejected because the lane's queue was full
+    rejected: number;
+    // Run by another thread than the one that queued them
+    stolen: number;
+  };
+  export type ExecutorStats = {
+    // False, with everything 0, until an async export has run
+    started: boolean;
+    threads: number;
+    bulkThreads: number;
+    lanes: { interactive: ExecutorLaneStats; bulk: ExecutorLaneStats };
+  };
+  export function getExecutorStats(): ExecutorStats;
+  // Bulk jobs can be cancelled until a thread starts them; their Promise
+  // then rejects with the signal's reason
+  export type CancelOptions = {
+    signal?: AbortSignal;
+  };
+
+  // Vision on macOS, Tesseract on Linux when built with it; elsewhere the
+  // promise resolves with success: false
+  export type OCROptions = {
+    // Recognition languages in priority order, e.g. ["en-US"] for Vision
+    // or ["eng"] for Tesseract
+    languages?: string[];
+    // Raw frames are converted to grayscale before recognition unless this
+    // is false. `downscale` (1-8) averages blocks of that many pixels per
+    // side, for large frames of large text; `binarize` applies an adaptive
+    // black and white threshold. Boxes are reported in frame coordinates
+    // either way.
+    preprocess?: boolean | { downscale?: number; binarize?: boolean };
+  } & CancelOptions;
+  export type OCRResult = {
+    success: boolean;
+    error: string | null;
+    // [x, y, width, height] per line of text, origin at the top-left corner
+    boxes: Int32Array;
+    text: string[];
+  };
+  // Uncompressed pixels, e.g. straight from screen capture, which skips the
+  // PNG encode and decode
+  export type OCRFrame = {
+    data: Buffer | Uint8Array | Uint8ClampedArray;
+    width: number;
+    height: number;
+    // Bytes from one row to the next; default width * bytes per pixel
+    stride?: number;
+    // 4 bytes per pixel for bgra and rgba (alpha is ignored), 1 for gray8
+    format: "bgra" | "rgba" | "gray8";
+  };
+  // A PNG file or a raw frame. The bytes are read in place; do not modify
+  // them until the promise settles
+  export function ocrImage(image: Buffer | OCRFrame, options?: OCROptions): Promise<OCRResult>;
+
+  // For OCR of the same window over and over: frames are split into tiles
+  // and only tiles whose pixels changed since the previous frame are
+  // recognized again, in parallel. Lines crossing a tile edge are joined.
+  export type OcrSessionOptions = {
+    tileWidth?: number; // default 512
+    tileHeight?: number; // default 256
+    // Pixels of the neighbouring tiles each tile is read with; lines up to
+    // twice as tall are never cut. Default 32
+    overlap?: number;
+  };
+  export type OcrSessionResult = OCRResult & {
+    tiles: number;
+    // Tiles of this frame that were recognized rather than reused
+    recognizedTiles: number;
+  };
+  export type OcrSessionStats = {
+    frames: number;
+    tiles: number;
+    recognizedTiles: number;
+    reusedTiles: number;
+  };
+  export type OcrSession = {
+    readonly closed: boolean;
+    // Calls run one at a time, in call order; each starts once the previous
+    // one settled. A new frame size or other options start over
+    recognize(frame: OCRFrame, options?: OCROptions): Promise<OcrSessionResult>;
+    getStats(): OcrSessionStats;
+    // Forgets the cached tiles, from the next frame that starts on
+    reset(): void;
+    // Calls still waiting for an earlier one reject; a running one finishes
+    close(): void;
+  };
+  export function createOcrSession(options?: OcrSessionOptions): OcrSession;
+
   export type InstalledApp = {
-    type: "msix" | "desktop" | "application"; // msix/desktop on Windows, application on macOS
+    // msix/desktop on Windows, application on macOS, desktop/flatpak/snap on Linux
+    type: "msix" | "desktop" | "application" | "flatpak" | "snap";
     name: string;
     id: string;
     version: string;
   };
+  // Returned by the string list exports when called with {packed: true}.
+  // Entries are kept as UTF-8 in one ArrayBuffer and decoded on access.
+  export class PackedStringList implements Iterable<string> {
+    static fromArray(strings: string[]): PackedStringList;
+    readonly length: number;
+    // length + 1 byte offsets into `bytes`
+    readonly offsets: Uint32Array;
+    readonly bytes: Buffer;
+    get(index: number): string | undefined;
+    // Compares bytes without decoding the entries
+    indexOf(value: string): number;
+    includes(value: string): boolean;
+    toArray(): string[];
+    [Symbol.iterator](): Iterator<string>;
+  }
+  export type PackedListOptions = { packed: true };
+
+  // Evaluated during the /proc scan (Linux only, other platforms throw), so
+  // rejected processes are never resolved or converted. All set criteria
+  // must match.
+  export type ProcessFilter = {
+    // Effective uid of the process
+    uid?: number;
+    // POSIX extended regex searched in the kernel command name (comm, at
+    // most 15 bytes)
+    name?: string;
+    // Patterns with * ? [ are globs in which * also matches "/", others are
+    // path prefixes; the path must match one of `exe` and none of `excludeExe`
+    exe?: string | string[];
+    excludeExe?: string | string[];
+    // These processes and all of their descendants
+    subtreeOf?: number | number[];
+  };
+  export type ProcessListOptions = { filter?: ProcessFilter; packed?: boolean };
+
   export function getRunningProcesses(): string[];
+  export function getRunningProcesses(options: ProcessListOptions & PackedListOptions): PackedStringList;
+  export function getRunningProcesses(options: ProcessListOptions): string[];
+
+  export type ProcessField =
+    | "pid"
+    | "ppid"
+    | "exe"
+    | "cmdline"
+    | "uid"
+    | "startTime"
+    | "rss"
+    | "cpuTime";
+  // Only the /proc files behind the requested fields are read. Defaults to
+  // pid, ppid and exe; pid is always included.
+  export type ProcessColumnsOptions = { fields?: ProcessField[]; filter?: ProcessFilter };
+  // One entry per process at the same index in every column. Columns that
+  // were not requested are absent. (Linux only; elsewhere `count` is 0.)
+  export type ProcessColumns = {
+    count: number;
+    pid: Uint32Array;
+    ppid?: Uint32Array;
+    // Empty when the executable cannot be read
+    exe?: PackedStringList;
+    // Arguments separated by "\0"
+    cmdline?: PackedStringList;
+    uid?: Uint32Array;
+    // Milliseconds since the epoch
+    startTime?: Float64Array;
+    // Resident set size in bytes
+    rss?: Float64Array;
+    // User plus system CPU time in milliseconds
+    cpuTime?: Float64Array;
+  };
+  export function getProcesses(options?: ProcessColumnsOptions): ProcessColumns;
+  export function getProcessesAsync(options?: ProcessColumnsOptions): Promise<ProcessColumns>;
+
+  export type ProcessDelta = {
+    added: string[];
+    removed: string[];
+    generation: number;
+    // true when `generation` was stale and `added` holds the full snapshot
+    full: boolean;
+  };
+  // Pass the generation from the previous call (or 0 for a full snapshot)
+  export function getRunningProcessesDelta(generation: number): ProcessDelta;
+  // macOS and Windows only. On Linux it and getRunningAppIDsAsync are no-ops
+  // that return [] and ignore {packed: true}.
   export function getRunningAppIDs(): string[];
+  export function getRunningAppIDs(options: PackedListOptions): PackedStringList;
+
+  // Counters of the native (pid, start time) -> executable path cache
+  export type ProcessCacheStats = {
+    hits: number;
+    misses: number;
+    entries: number;
+  };
+  export function getProcessCacheStats(): ProcessCacheStats;
+
+  // Linux: process exec/exit as they happen, from the netlink proc connector
+  // (needs CAP_NET_ADMIN) or else a /proc diff every 100ms-2s. A new call
+  // replaces the previous watcher of the same thread; each worker has its
+  // own, stopped when the worker exits.
+  export type ProcessEvent = {
+    type: "exec" | "exit";
+    pid: number;
+    ppid: number; // 0 when unknown
+    path: string; // "" when it could not be resolved
+  };
+  export type ProcessWatchOptions = {
+    netlink?: boolean; // false forces the /proc fallback, default true
+  };
+  export type ProcessWatchHandle = {
+    mode: "netlink" | "procfs" | "none";
+    close(): void;
+  };
+  export function watchProcesses(
+    callback: (events: ProcessEvent[]) => void,
+    options?: ProcessWatchOptions
+  ): ProcessWatchHandle;
+  export type ProcessWatchStats = {
+    mode: "netlink" | "procfs" | "none";
+    events: number;
+    batches: number;
+    // Netlink receive buffer overruns, each losing an unknown number of events
+    overflows: number;
+    // /proc scans of the fallback
+    scans: number;
+    // Events discarded because the callback fell behind
+    dropped: number;
+  };
+  export function getProcessWatchStats(): ProcessWatchStats;
   export function listInstalledApps(): InstalledApp[];
+  export function getRunningProcessesAsync(): Promise<string[]>;
+  export function getRunningProcessesAsync(
+    options: ProcessListOptions & PackedListOptions
+  ): Promise<PackedStringList>;
+  export function getRunningProcessesAsync(options: ProcessListOptions): Promise<string[]>;
+  export function getRunningAppIDsAsync(): Promise<string[]>;
+  export function getRunningAppIDsAsync(options: PackedListOptions): Promise<PackedStringList>;
+  export function listInstalledAppsAsync(options?: CancelOptions): Promise<InstalledApp[]>;
   export function currentInstalledApp(): InstalledApp | null;
 
+  // Linux: listInstalledApps() reuses an index in ~/.cache/node-mac-utils and
+  // only re-reads directories changed since. While watching, an inotify
+  // thread keeps it fresh and listInstalledApps() does no I/O at all.
+  export function startWatchingInstalledApps(): boolean;
+  export function stopWatchingInstalledApps(): void;
+  export type InstalledAppIndexStats = {
+    scans: number;
+    indexWrites: number;
+    watchRefreshes: number;
+    watching: boolean;
+    // Of the last scan
+    directories: number;
+    reusedDirectories: number;
+    parsedFiles: number;
+    reusedFiles: number;
+  };
+  export function getInstalledAppIndexStats(): InstalledAppIndexStats;
+
+  // Mac and Linux (PipeWire)
+  export type MicrophoneMonitorError = Error & {
+    code: number; // INFO_ERROR_CODE for informational messages
+    domain: string;
+  };
+  export type MicrophoneMonitorOptions = {
+    capacity?: number; // events buffered natively before dropping, default 1024
+    coalesceMs?: number; // wait this long per batch and keep the last state, default 0
+  };
+  export function startMonitoringMic(
+    callback: (
+      microphoneActive: boolean,
+      error: MicrophoneMonitorError | null
+    ) => void,
+    options?: MicrophoneMonitorOptions
+  ): boolean;
+  export function stopMonitoringMic(): void;
+  export type MicMonitorDevice = {
+    id: number;
+    name: string;
+  };
+  export type MicMonitorSubscriptionOptions = MicrophoneMonitorOptions & {
+    callback: (
+      microphoneActive: boolean,
+      error: MicrophoneMonitorError | null,
+      device?: MicMonitorDevice
+    ) => void;
+    // Event types to receive, default all. "info" is an error with INFO_ERROR_CODE
+    events?: Array<"state" | "error" | "info">;
+    // Receive per-device state instead of the aggregate; "*" matches every device (Linux)
+    devices?: string[];
+  };
+  // Every handle shares one native subscription. Call close() when done;
+  // handles that are garbage collected unsubscribe on their own.
+  export type MicMonitor = {
+    readonly closed: boolean;
+    close(): void;
+  };
+  export function createMicMonitor(
+    options: MicMonitorSubscriptionOptions
+  ): MicMonitor;
+  export type EventDeliveryStats = {
+    pushed: number;
+    delivered: number;
+    dropped: number;
+    coalesced: number;
+    batches: number;
+    subscribers?: number; // open createMicMonitor/startMonitoringMic subscriptions of the calling thread
+  };
+  export function getMicMonitorStats(): EventDeliveryStats;
+
+  // Linux: which processes used the microphone and when, kept natively in a
+  // fixed number of intervals. Times are ms since the epoch.
+  export type MicTimelineOptions = {
+    capacity?: number; // intervals kept before the oldest are dropped, default 16384
+  };
+  export function startMicTimeline(options?: MicTimelineOptions): boolean;
+  export function stopMicTimeline(): void;
+  export type MicTimelineInterval = {
+    process: string;
+    pid: number; // 0 when PipeWire did not report it
+    device: string;
+    start: number;
+    end: number | null; // null while still in use
+  };
+  export type MicTimelineQuery = {
+    from?: number;
+    to?: number;
+    process?: string;
+  };
+  export function queryMicTimeline(query?: MicTimelineQuery): MicTimelineInterval[];
+  export function exportMicTimeline(): Buffer;
+  // Replaces the history; returns the number of intervals kept
+  export function importMicTimeline(data: Buffer): number;
+  export type MicTimelineStats = {
+    recording: boolean;
+    capacity: number;
+    intervals: number;
+    open: number;
+    names: number;
+    evicted: number;
+    samples: number;
+  };
+  export function getMicTimelineStats(): MicTimelineStats;
+
   // Mac-only
   export function makeKeyAndOrderFront(windowID: number): void;
-  export function startMonitoringMic(): void;
-  export function stopMonitoringMic(): void;
   export function getMicrophoneAuthorizationStatus():
     | "NotDetermined"
     | "Restricted"
@@ -1,5 +1,110 @@
 let platform_utils;
 
+// What the string list exports return with {packed: true}: the entries stay
+// UTF-8 bytes in one ArrayBuffer and only become strings when read, so
+// filtering or diffing a large list allocates next to nothing.
+class PackedStringList {
+  // `packed` is {count, offsets, data} from the native side
+  constructor(packed) {
+    this.length = packed.count;
+    this.offsets = packed.offsets;
+    this.bytes = Buffer.from(packed.data.buffer, packed.data.byteOffset, packed.data.byteLength);
+  }
+
+  static fromArray(strings) {
+    const offsets = new Uint32Array(strings.length + 1);
+    const chunks = strings.map((value) => Buffer.from(value));
+    for (let i = 0; i < chunks.length; i++) {
+      offsets[i + 1] = offsets[i] + chunks[i].length;
+    }
+    return new PackedStringList({ count: strings.length, offsets, data: Buffer.concat(chunks) });
+  }
+
+  get(index) {
+    if (index < 0 || index >= this.length) {
+      return undefined;
+    }
+    return this.bytes.toString("utf8", this.offsets[index], this.offsets[index + 1]);
+  }
+
+  // Compares bytes, so no string is created for any entry
+  indexOf(value) {
+    const needle = Buffer.from(value);
+    for (let i = 0; i < this.length; i++) {
+      const start = this.offsets[i];
+      const end = this.offsets[i + 1];
+      if (end - start === needle.length && this.bytes.compare(needle, 0, needle.length, start, end) === 0) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  includes(value) {
+    return this.indexOf(value) !== -1;
+  }
+
+  *[Symbol.iterator]() {
+    for (let i = 0; i < this.length; i++) {
+      yield this.get(i);
+    }
+  }
+
+  toArray() {
+    return Array.from(this);
+  }
+}
+
+// Exports that accept {packed: true} where they are native; the first two
+// also take {filter}. The noops (e.g. getRunningAppIDs on Linux) are left
+// as they are and return [] whatever the options.
+const PACKED_LIST_EXPORTS = [
+  "getRunningProcesses",
+  "getRunningProcessesAsync",
+  "getRunningAppIDs",
+  "getRunningAppIDsAsync",
+];
+
+function toPackedStringList(result) {
+  return Array.isArray(result) ? PackedStringList.fromArray(result) : new PackedStringList(result);
+}
+
+// Only the Linux scanner evaluates {filter}; elsewhere it would silently
+// return everything.
+const FILTERED_LIST_EXPORTS = ["getRunningProcesses", "getRunningProcessesAsync"];
+
+function withListOptions(name, fn) {
+  return (options) => {
+    if (!options) {
+      return fn();
+    }
+    if (options.filter && !(process.platform === "linux" && FILTERED_LIST_EXPORTS.includes(name))) {
+      throw new Error(`${name}: process filters are only supported on Linux`);
+    }
+    const result = fn(options);
+    if (!options.packed) {
+      return result;
+    }
+    return result instanceof Promise ? result.then(toPackedStringList) : toPackedStringList(result);
+  };
+}
+
+// getProcesses returns its string columns packed like the lists above
+function withProcessColumns(fn) {
+  const wrap = (result) => {
+    for (const field of ["exe", "cmdline"]) {
+      if (result[field]) {
+        result[field] = new PackedStringList(result[field]);
+      }
+    }
+    return result;
+  };
+  return (options) => {
+    const result = fn(options);
+    return result instanceof Promise ? result.then(wrap) : wrap(result);
+  };
+}
+
 const noopPlatformUtils = {
   getRunningInputAudioProcesses: () => {
     return [];
@@ -25,9 +130,163 @@ const noopPlatformUtils = {
       processes: [],
     };
   },
+  getProcessesAccessingMicrophoneWithResultAsync: () => {
+    return Promise.resolve({
+      success: true,
+      error: null,
+      processes: [],
+    });
+  },
+  getProcessesAccessingSpeakersWithResultAsync: () => {
+    return Promise.resolve({
+      success: true,
+      error: null,
+      processes: [],
+    });
+  },
   getRunningProcesses: () => [],
+  getRunningProcessesAsync: () => Promise.resolve([]),
+  getProcesses: () => ({ count: 0, pid: new Uint32Array(0) }),
+  getProcessesAsync: () => Promise.resolve({ count: 0, pid: new Uint32Array(0) }),
+  getRunningProcessesDelta: () => {
+    return {
+      added: [],
+      removed: [],
+      generation: 0,
+      full: true,
+    };
+  },
   getRunningAppIDs: () => [],
+  getRunningAppIDsAsync: () => Promise.resolve([]),
+  getMicMonitorStats: () => {
+    return {
+      pushed: 0,
+      delivered: 0,
+      dropped: 0,
+      coalesced: 0,
+      batches: 0,
+      subscribers: 0,
+    };
+  },
+  createMicMonitor: () => {
+    return {
+      closed: true,
+      close: () => {},
+    };
+  },
+  startMicTimeline: () => false,
+  stopMicTimeline: () => {},
+  queryMicTimeline: () => [],
+  exportMicTimeline: () => Buffer.alloc(0),
+  importMicTimeline: () => 0,
+  getMicTimelineStats: () => {
+    return {
+      recording: false,
+      capacity: 0,
+      intervals: 0,
+      open: 0,
+      names: 0,
+      evicted: 0,
+      samples: 0,
+    };
+  },
+  getProcessCacheStats: () => {
+    return {
+      hits: 0,
+      misses: 0,
+      entries: 0,
+    };
+  },
+  watchProcesses: () => {
+    return {
+      mode: "none",
+      close: () => {},
+    };
+  },
+  getProcessWatchStats: () => {
+    return {
+      mode: "none",
+      events: 0,
+      batches: 0,
+      overflows: 0,
+      scans: 0,
+      dropped: 0,
+    };
+  },
+  getNativeStats: () => {
+    return {
+      exports: {},
+      backendErrors: [],
+      counters: {},
+    };
+  },
+  resetNativeStats: () => {},
+  getExecutorStats: () => {
+    const lane = () => ({
+      queued: 0,
+      maxQueued: 0,
+      running: 0,
+      submitted: 0,
+      completed: 0,
+      cancelled: 0,
+      rejected: 0,
+      stolen: 0,
+    });
+    return {
+      started: false,
+      threads: 0,
+      bulkThreads: 0,
+      lanes: { interactive: lane(), bulk: lane() },
+    };
+  },
+  configureExecutor: () => false,
+  ocrImage: () => {
+    return Promise.resolve({
+      success: false,
+      error: "Text recognition is not available on this platform",
+      boxes: new Int32Array(0),
+      text: [],
+    });
+  },
+  createOcrSession: () => {
+    let closed = false;
+    return {
+      recognize: () => {
+        return Promise.resolve({
+          success: false,
+          error: "Text recognition is not available on this platform",
+          boxes: new Int32Array(0),
+          text: [],
+          tiles: 0,
+          recognizedTiles: 0,
+        });
+      },
+      getStats: () => ({ frames: 0, tiles: 0, recognizedTiles: 0, reusedTiles: 0 }),
+      reset: () => {},
+      close: () => {
+        closed = true;
+      },
+      get closed() {
+        return closed;
+      },
+    };
+  },
   listInstalledApps: () => [],
+  startWatchingInstalledApps: () => false,
+  stopWatchingInstalledApps: () => {},
+  getInstalledAppIndexStats: () => {
+    return {
+      scans: 0,
+      indexWrites: 0,
+      watchRefreshes: 0,
+      watching: false,
+      directories: 0,
+      reusedDirectories: 0,
+      parsedFiles: 0,
+      reusedFiles: 0,
+    };
+  },
+  listInstalledAppsAsync: () => Promise.resolve([]),
   currentInstalledApp: () => null,
   installMSIXAndRestart: () => {},
   getMicrophoneAuthorizationStatus: () => {
@@ -49,12 +308,17 @@ if (process.platform === "darwin") {
 } else if (process.platform === "win32") {
   platform_utils = require("bindings")("win_utils.node");
 } else if (process.platform === "linux") {
+  let native_utils = {};
   try {
-    platform_utils = require("./linux/pipewire");
+    native_utils = require("bindings")("linux_utils.node");
   } catch (e) {
-    console.log(`node-mac-utils Failed to import pipewire for Linux: ${e}`);
-    platform_utils = noopPlatformUtils;
+    console.log(`node-mac-utils Failed to load native module for Linux: ${e}`);
   }
+
+  platform_utils = {
+    ...noopPlatformUtils,
+    ...native_utils,
+  };
 } else {
   console.log("node-mac-utils Unsupported platform:", process.platform);
   platform_utils = noopPlatformUtils;
@@ -70,6 +334,14 @@ module.exports = {
     platform_utils.getProcessesAccessingMicrophoneDebouncedWithResult,
   getProcessesAccessingSpeakersWithResult:
     platform_utils.getProcessesAccessingSpeakersWithResult,
+  getProcessesAccessingMicrophoneWithResultAsync:
+    platform_utils.getProcessesAccessingMicrophoneWithResultAsync,
+  getProcessesAccessingSpeakersWithResultAsync:
+    platform_utils.getProcessesAccessingSpeakersWithResultAsync,
+  getNativeStats: platform_utils.getNativeStats,
+  resetNativeStats: platform_utils.resetNativeStats,
+  getExecutorStats: platform_utils.getExecutorStats,
+  configureExecutor: platform_utils.configureExecutor,
   INFO_ERROR_CODE: 1,
   ERROR_DOMAIN: "com.MicrophoneUsageMonitor",
 
@@ -78,26 +350,79 @@ module.exports = {
     ? {
         makeKeyAndOrderFront: platform_utils.makeKeyAndOrderFront,
         startMonitoringMic: platform_utils.startMonitoringMic,
+        createMicMonitor: platform_utils.createMicMonitor,
         stopMonitoringMic: platform_utils.stopMonitoringMic,
+        getMicMonitorStats: platform_utils.getMicMonitorStats,
         getRunningProcesses: platform_utils.getRunningProcesses,
+        getRunningProcessesAsync: platform_utils.getRunningProcessesAsync,
+        getRunningProcessesDelta: platform_utils.getRunningProcessesDelta,
+        getProcessCacheStats: platform_utils.getProcessCacheStats,
         getRunningAppIDs: platform_utils.getRunningAppIDs,
+        getRunningAppIDsAsync: platform_utils.getRunningAppIDsAsync,
         listInstalledApps: platform_utils.listInstalledApps,
+        listInstalledAppsAsync: platform_utils.listInstalledAppsAsync,
         currentInstalledApp: platform_utils.currentInstalledApp,
         getMicrophoneAuthorizationStatus:
           platform_utils.getMicrophoneAuthorizationStatus,
         requestMicrophoneAccess: platform_utils.requestMicrophoneAccess,
         checkScreenCaptureAccess: platform_utils.checkScreenCaptureAccess,
         requestScreenCaptureAccess: platform_utils.requestScreenCaptureAccess,
+        ocrImage: platform_utils.ocrImage,
+        createOcrSession: platform_utils.createOcrSession,
       }
     : {}),
   // Windows-specific exports
   ...(process.platform === "win32"
     ? {
         getRunningProcesses: platform_utils.getRunningProcesses,
+        getRunningProcessesAsync: platform_utils.getRunningProcessesAsync,
+        getRunningProcessesDelta: platform_utils.getRunningProcessesDelta,
+        getProcessCacheStats: platform_utils.getProcessCacheStats,
         getRunningAppIDs: platform_utils.getRunningAppIDs,
+        getRunningAppIDsAsync: platform_utils.getRunningAppIDsAsync,
         listInstalledApps: platform_utils.listInstalledApps,
+        listInstalledAppsAsync: platform_utils.listInstalledAppsAsync,
         currentInstalledApp: platform_utils.currentInstalledApp,
         installMSIXAndRestart: platform_utils.installMSIXAndRestart,
       }
     : {}),
+  // Linux-specific exports
+  ...(process.platform === "linux"
+    ? {
+        startMonitoringMic: platform_utils.startMonitoringMic,
+        createMicMonitor: platform_utils.createMicMonitor,
+        stopMonitoringMic: platform_utils.stopMonitoringMic,
+        getMicMonitorStats: platform_utils.getMicMonitorStats,
+        startMicTimeline: platform_utils.startMicTimeline,
+        stopMicTimeline: platform_utils.stopMicTimeline,
+        queryMicTimeline: platform_utils.queryMicTimeline,
+        exportMicTimeline: platform_utils.exportMicTimeline,
+        importMicTimeline: platform_utils.importMicTimeline,
+        getMicTimelineStats: platform_utils.getMicTimelineStats,
+        getRunningProcesses: platform_utils.getRunningProcesses,
+        getRunningProcessesAsync: platform_utils.getRunningProcessesAsync,
+        getRunningProcessesDelta: platform_utils.getRunningProcessesDelta,
+        getProcesses: withProcessColumns(platform_utils.getProcesses),
+        getProcessesAsync: withProcessColumns(platform_utils.getProcessesAsync),
+        getProcessCacheStats: platform_utils.getProcessCacheStats,
+        watchProcesses: platform_utils.watchProcesses,
+        getProcessWatchStats: platform_utils.getProcessWatchStats,
+        listInstalledApps: platform_utils.listInstalledApps,
+        listInstalledAppsAsync: platform_utils.listInstalledAppsAsync,
+        startWatchingInstalledApps: platform_utils.startWatchingInstalledApps,
+        stopWatchingInstalledApps: platform_utils.stopWatchingInstalledApps,
+        getInstalledAppIndexStats: platform_utils.getInstalledAppIndexStats,
+        ocrImage: platform_utils.ocrImage,
+        createOcrSession: platform_utils.createOcrSession,
+        // Test and benchmark hooks, not a stable API
+        __internal: platform_utils.__internal,
+      }
+    : {}),
 };
+
+for (const name of PACKED_LIST_EXPORTS) {
+  if (module.exports[name] !== noopPlatformUtils[name]) {
+    module.exports[name] = withListOptions(name, module.exports[name]);
+  }
+}
+module.exports.PackedStringList = PackedStringList;
@@ -0,0 +1,539 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AppIndex.h"
+
+static const char INDEX_MAGIC[8] = {'N', 'M', 'U', 'A', 'P', 'P', 'S', '1'};
+static const uint32_t INDEX_BYTE_ORDER = 0x01020304;
+
+// Changes usually come in bursts (a package manager writing a dozen files),
+// so the watcher waits for this long without events before rescanning.
+static const int WATCH_SETTLE_MS = 200;
+static const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                   IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB |
+                                   IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+namespace {
+
+struct IndexString {
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct IndexHeader {
+  char magic[8];
+  uint32_t byteOrder;
+  uint32_t directoryCount;
+  uint32_t entryCount;
+  uint32_t subdirectoryCount;
+  uint32_t stringBytes;
+  uint32_t reserved;
+};
+
+struct IndexDirectory {
+  int64_t mtime;
+  IndexString path;
+  uint32_t firstEntry;
+  uint32_t entryCount;
+  uint32_t firstSubdirectory;
+  uint32_t subdirectoryCount;
+};
+
+struct IndexEntry {
+  int64_t mtime;
+  IndexString fileName;
+  IndexString name;
+  IndexString appId;
+  IndexString version;
+  uint32_t visible;
+  uint32_t reserved;
+};
+
+// Typed views into a mapped (and size-checked) index file
+struct IndexLayout {
+  const IndexHeader *header;
+  const IndexDirectory *directories;
+  const IndexEntry *entries;
+  const IndexString *subdirectories;
+  const char *strings;
+
+  explicit IndexLayout(const char *data)
+      : header(reinterpret_cast<const IndexHeader *>(data)),
+        directories(reinterpret_cast<const IndexDirectory *>(header + 1)),
+        entries(reinterpret_cast<const IndexEntry *>(directories + header->directoryCount)),
+        subdirectories(reinterpret_cast<const IndexString *>(entries + header->entryCount)),
+        strings(reinterpret_cast<const char *>(subdirectories + header->subdirectoryCount)) {}
+
+  // Out of range references read as empty rather than past the mapping.
+  std::string_view String(const IndexString &ref) const {
+    if (uint64_t(ref.offset) + ref.length > header->stringBytes) {
+      return std::string_view();
+    }
+    return std::string_view(strings + ref.offset, ref.length);
+  }
+};
+
+static_assert(sizeof(IndexHeader) % 8 == 0, "records must stay 8-byte aligned");
+static_assert(sizeof(IndexDirectory) % 8 == 0, "records must stay 8-byte aligned");
+static_assert(sizeof(IndexEntry) % 8 == 0, "records must stay 8-byte aligned");
+
+// Builds the string blob while the records are written.
+class StringBlob {
+public:
+  IndexString Add(const std::string &value) {
+    IndexString ref{uint32_t(bytes_.size()), uint32_t(value.size())};
+    bytes_.append(value);
+    return ref;
+  }
+  const std::string &Bytes() const { return bytes_; }
+
+private:
+  std::string bytes_;
+};
+
+// Refuses the cached copy of directories the watcher saw change, since a
+// file rewritten in place leaves the directory mtime alone.
+class DirtyFilter : public DesktopScanCache {
+public:
+  DirtyFilter(const DesktopScanCache &cache, const std::unordered_set<std::string> &dirty)
+      : cache_(cache), dirty_(dirty) {}
+
+  bool LoadDirectory(DesktopDirectory *dir) const override {
+    return dirty_.count(dir->path) == 0 && cache_.LoadDirectory(dir);
+  }
+  bool LoadEntry(const std::string &dirPath, DesktopEntry *entry) const override {
+    return cache_.LoadEntry(dirPath, entry);
+  }
+
+private:
+  const DesktopScanCache &cache_;
+  const std::unordered_set<std::string> &dirty_;
+};
+
+} // namespace
+
+AppIndex::AppIndex(std::string path)
+    : path_(std::move(path)), data_(nullptr), size_(0) {}
+
+AppIndex::~AppIndex() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+}
+
+std::string AppIndex::DefaultPath() {
+  const char *cache = getenv("XDG_CACHE_HOME");
+  std::string base;
+  if (cache != nullptr && cache[0] == '/') {
+    base = cache;
+  } else {
+    const char *home = getenv("HOME");
+    if (home == nullptr || home[0] != '/') {
+      return std::string();
+    }
+    base = std::string(home) + "/.cache";
+  }
+  return base + "/node-mac-utils/installed-apps.idx";
+}
+
+bool AppIndex::Open() {
+  if (path_.empty()) {
+    return false;
+  }
+  int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(IndexHeader)) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  auto header = static_cast<const IndexHeader *>(data);
+  uint64_t expected = sizeof(IndexHeader) +
+                      uint64_t(header->directoryCount) * sizeof(IndexDirectory) +
+                      uint64_t(header->entryCount) * sizeof(IndexEntry) +
+                      uint64_t(header->subdirectoryCount) * sizeof(IndexString) +
+                      header->stringBytes;
+  if (memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+      header->byteOrder != INDEX_BYTE_ORDER || expected != uint64_t(st.st_size)) {
+    munmap(data, size_t(st.st_size));
+    return false;
+  }
+
+  data_ = static_cast<const char *>(data);
+  size_ = size_t(st.st_size);
+  return true;
+}
+
+size_t AppIndex::DirectoryCount() const {
+  return data_ != nullptr ? IndexLayout(data_).header->directoryCount : 0;
+}
+
+int64_t AppIndex::FindDirectory(const std::string &path) const {
+  if (data_ == nullptr) {
+    return -1;
+  }
+  IndexLayout layout(data_);
+  const IndexDirectory *begin = layout.directories;
+  const IndexDirectory *end = begin + layout.header->directoryCount;
+  const IndexDirectory *it = std::lower_bound(
+      begin, end, path, [&](const IndexDirectory &dir, const std::string &value) {
+        return layout.String(dir.path) < std::string_view(value);
+      });
+  if (it == end || layout.String(it->path) != std::string_view(path)) {
+    return -1;
+  }
+  return it - begin;
+}
+
+void AppIndex::CopyEntry(uint32_t index, DesktopEntry *entry) const {
+  IndexLayout layout(data_);
+  const IndexEntry &record = layout.entries[index];
+  entry->name = std::string(layout.String(record.name));
+  entry->appId = std::string(layout.String(record.appId));
+  entry->version = std::string(layout.String(record.version));
+  entry->visible = record.visible != 0;
+}
+
+bool AppIndex::LoadDirectory(DesktopDirectory *dir) const {
+  int64_t found = FindDirectory(dir->path);
+  if (found < 0) {
+    return false;
+  }
+  IndexLayout layout(data_);
+  const IndexDirectory &record = layout.directories[found];
+  if (record.mtime != dir->mtime ||
+      uint64_t(record.firstEntry) + record.entryCount > layout.header->entryCount ||
+      uint64_t(record.firstSubdirectory) + record.subdirectoryCount >
+          layout.header->subdirectoryCount) {
+    return false;
+  }
+
+  dir->subdirectories.clear();
+  for (uint32_t i = 0; i < record.subdirectoryCount; i++) {
+    dir->subdirectories.emplace_back(
+        layout.String(layout.subdirectories[record.firstSubdirectory + i]));
+  }
+  dir->entries.resize(record.entryCount);
+  for (uint32_t i = 0; i < record.entryCount; i++) {
+    DesktopEntry &entry = dir->entries[i];
+    const IndexEntry &source = layout.entries[record.firstEntry + i];
+    entry.fileName = std::string(layout.String(source.fileName));
+    entry.mtime = source.mtime;
+    CopyEntry(record.firstEntry + i, &entry);
+  }
+  return true;
+}
+
+bool AppIndex::LoadEntry(const std::string &dirPath, DesktopEntry *entry) const {
+  int64_t found = FindDirectory(dirPath);
+  if (found < 0) {
+    return false;
+  }
+  IndexLayout layout(data_);
+  const IndexDirectory &record = layout.directories[found];
+  if (uint64_t(record.firstEntry) + record.entryCount > layout.header->entryCount) {
+    return false;
+  }
+
+  const IndexEntry *begin = layout.entries + record.firstEntry;
+  const IndexEntry *end = begin + record.entryCount;
+  const IndexEntry *it = std::lower_bound(
+      begin, end, entry->fileName, [&](const IndexEntry &item, const std::string &value) {
+        return layout.String(item.fileName) < std::string_view(value);
+      });
+  if (it == end || layout.String(it->fileName) != std::string_view(entry->fileName) ||
+      it->mtime != entry->mtime) {
+    return false;
+  }
+
+  CopyEntry(uint32_t(it - layout.entries), entry);
+  return true;
+}
+
+// mkdir -p for the parent directories of `path`
+static bool CreateParentDirectories(const std::string &path) {
+  for (size_t slash = path.find('/', 1); slash != std::string::npos;
+       slash = path.find('/', slash + 1)) {
+    std::string dir = path.substr(0, slash);
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool AppIndex::Write(const std::string &path, const std::vector<DesktopDirectory> &dirs) {
+  if (path.empty() || !CreateParentDirectories(path)) {
+    return false;
+  }
+
+  std::vector<const DesktopDirectory *> sorted;
+  sorted.reserve(dirs.size());
+  for (const auto &dir : dirs) {
+    sorted.push_back(&dir);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const DesktopDirectory *a, const DesktopDirectory *b) {
+              return a->path < b->path;
+            });
+
+  StringBlob strings;
+  std::vector<IndexDirectory> directories;
+  std::vector<IndexEntry> entries;
+  std::vector<IndexString> subdirectories;
+  directories.reserve(sorted.size());
+  for (const DesktopDirectory *dir : sorted) {
+    IndexDirectory record;
+    record.mtime = dir->mtime;
+    record.path = strings.Add(dir->path);
+    record.firstEntry = uint32_t(entries.size());
+    record.entryCount = uint32_t(dir->entries.size());
+    record.firstSubdirectory = uint32_t(subdirectories.size());
+    record.subdirectoryCount = uint32_t(dir->subdirectories.size());
+    directories.push_back(record);
+
+    for (const auto &entry : dir->entries) {
+      IndexEntry item;
+      item.mtime = entry.mtime;
+      item.fileName = strings.Add(entry.fileName);
+      item.name = strings.Add(entry.name);
+      item.appId = strings.Add(entry.appId);
+      item.version = strings.Add(entry.version);
+      item.visible = entry.visible ? 1 : 0;
+      item.reserved = 0;
+      entries.push_back(item);
+    }
+    for (const auto &name : dir->subdirectories) {
+      subdirectories.push_back(strings.Add(name));
+    }
+  }
+
+  IndexHeader header;
+  memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  header.byteOrder = INDEX_BYTE_ORDER;
+  header.directoryCount = uint32_t(directories.size());
+  header.entryCount = uint32_t(entries.size());
+  header.subdirectoryCount = uint32_t(subdirectories.size());
+  header.stringBytes = uint32_t(strings.Bytes().size());
+  header.reserved = 0;
+
+  // Readers map the file, so it is written next to the target and renamed
+  // over it rather than truncated in place.
+  std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+  FILE *file = fopen(tmpPath.c_str(), "wbe");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(directories.data(), sizeof(IndexDirectory), directories.size(), file) ==
+                directories.size() &&
+            fwrite(entries.data(), sizeof(IndexEntry), entries.size(), file) ==
+                entries.size() &&
+            fwrite(subdirectories.data(), sizeof(IndexString), subdirectories.size(),
+                   file) == subdirectories.size() &&
+            fwrite(strings.Bytes().data(), 1, strings.Bytes().size(), file) ==
+                strings.Bytes().size();
+  ok = fclose(file) == 0 && ok;
+
+  if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+InstalledAppIndex &InstalledAppIndex::Shared() {
+  static InstalledAppIndex *index = new InstalledAppIndex();
+  return *index;
+}
+
+InstalledAppIndex::InstalledAppIndex() : stats_(), inotifyFd_(-1), stopFd_(-1) {}
+
+std::vector<InstalledApp> InstalledAppIndex::List() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!watcher_.joinable()) {
+    Refresh(std::unordered_set<std::string>());
+  }
+  return apps_;
+}
+
+AppIndexStats InstalledAppIndex::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void InstalledAppIndex::Refresh(const std::unordered_set<std::string> &dirty) {
+  std::vector<DesktopEntryRoot> roots = DesktopEntryRoots();
+  std::string path = AppIndex::DefaultPath();
+  AppIndex index(path);
+  bool opened = index.Open();
+
+  DirtyFilter cache(index, dirty);
+  DesktopScanStats scan;
+  dirs_ = ScanDesktopEntries(roots, &cache, &scan);
+  apps_ = ResolveInstalledApps(roots, dirs_);
+  stats_.scans++;
+  stats_.lastScan = scan;
+
+  bool changed = !opened || scan.reusedDirectories != scan.directories ||
+                 scan.parsedFiles > 0 || index.DirectoryCount() != dirs_.size();
+  if (changed && AppIndex::Write(path, dirs_)) {
+    stats_.indexWrites++;
+  }
+}
+
+bool InstalledAppIndex::StartWatching(std::string *error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (watcher_.joinable()) {
+    return true;
+  }
+
+  inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd_ < 0) {
+    *error = std::string("inotify_init1 failed: ") + strerror(errno);
+    return false;
+  }
+  stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stopFd_ < 0) {
+    *error = std::string("eventfd failed: ") + strerror(errno);
+    close(inotifyFd_);
+    inotifyFd_ = -1;
+    return false;
+  }
+
+  Refresh(std::unordered_set<std::string>());
+  SyncWatches();
+  stats_.watching = true;
+  watcher_ = std::thread(&InstalledAppIndex::WatchLoop, this);
+  return true;
+}
+
+void InstalledAppIndex::StopWatching() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!watcher_.joinable()) {
+      return;
+    }
+    // Wakes WatchLoop; writing to an eventfd only fails on counter overflow.
+    uint64_t one = 1;
+    ssize_t written = write(stopFd_, &one, sizeof(one));
+    (void)written;
+  }
+  watcher_.join();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  close(inotifyFd_);
+  close(stopFd_);
+  inotifyFd_ = -1;
+  stopFd_ = -1;
+  watches_.clear();
+  stats_.watching = false;
+}
+
+void InstalledAppIndex::SyncWatches() {
+  std::unordered_set<std::string> wanted;
+  for (const auto &dir : dirs_) {
+    wanted.insert(dir.path);
+  }
+
+  for (auto it = watches_.begin(); it != watches_.end();) {
+    if (wanted.erase(it->second) == 0) {
+      inotify_rm_watch(inotifyFd_, it->first);
+      it = watches_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Whatever is left in `wanted` is not watched yet.
+  for (const auto &path : wanted) {
+    int wd = inotify_add_watch(inotifyFd_, path.c_str(), WATCH_MASK);
+    if (wd >= 0) {
+      watches_[wd] = path;
+    }
+  }
+}
+
+void InstalledAppIndex::WatchLoop() {
+  alignas(struct inotify_event) char buffer[4096];
+  std::unordered_set<std::string> dirty;
+  bool pending = false;
+  auto deadline = std::chrono::steady_clock::now();
+
+  for (;;) {
+    int timeout = -1;
+    if (pending) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      timeout = int(std::max<int64_t>(0, remaining.count()));
+    }
+
+    struct pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+    if (poll(fds, 2, timeout) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((fds[0].revents & POLLIN) != 0) {
+      ssize_t len;
+      while ((len = read(inotifyFd_, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + len;) {
+          auto event = reinterpret_cast<struct inotify_event *>(p);
+          p += sizeof(struct inotify_event) + event->len;
+
+          if ((event->mask & IN_Q_OVERFLOW) != 0) {
+            for (const auto &watch : watches_) {
+              dirty.insert(watch.second);
+            }
+            continue;
+          }
+          auto it = watches_.find(event->wd);
+          if (it == watches_.end()) {
+            continue;
+          }
+          dirty.insert(it->second);
+          if ((event->mask & IN_IGNORED) != 0) {
+            watches_.erase(it);
+          }
+        }
+      }
+      pending = true;
+      deadline = std::chrono::steady_clock::now() +
+                 std::chrono::milliseconds(WATCH_SETTLE_MS);
+    }
+
+    if (pending && std::chrono::steady_clock::now() >= deadline) {
+      Refresh(dirty);
+      SyncWatches();
+      stats_.watchRefreshes++;
+      dirty.clear();
+      pending = false;
+    }
+  }
+}
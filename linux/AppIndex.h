@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "DesktopEntries.h"
+
+// A persisted DesktopScanCache. The file is a header followed by fixed-size
+// directory and entry records and one string blob, so mapping it is all the
+// loading there is:
+//
+//   AppIndexHeader
+//   AppIndexDirectory[directoryCount]  sorted by path
+//   AppIndexEntry[entryCount]          grouped by directory, by file name
+//   AppIndexString[subdirectoryCount]  subdirectory names
+//   char[stringBytes]
+//
+// Records use host byte order; an index written by another architecture
+// fails the magic check and is rebuilt.
+class AppIndex : public DesktopScanCache {
+public:
+  explicit AppIndex(std::string path);
+  ~AppIndex();
+
+  // $XDG_CACHE_HOME/node-mac-utils/installed-apps.idx
+  static std::string DefaultPath();
+
+  // Maps the file; false when it is missing or not a valid index.
+  bool Open();
+  bool IsOpen() const { return data_ != nullptr; }
+  size_t DirectoryCount() const;
+
+  bool LoadDirectory(DesktopDirectory *dir) const override;
+  bool LoadEntry(const std::string &dirPath, DesktopEntry *entry) const override;
+
+  // Replaces the file at `path` atomically.
+  static bool Write(const std::string &path, const std::vector<DesktopDirectory> &dirs);
+
+private:
+  // Index of the directory record for `path`, or -1
+  int64_t FindDirectory(const std::string &path) const;
+  void CopyEntry(uint32_t index, DesktopEntry *entry) const;
+
+  std::string path_;
+  const char *data_;
+  size_t size_;
+};
+
+struct AppIndexStats {
+  uint64_t scans;
+  uint64_t indexWrites;
+  uint64_t watchRefreshes;
+  DesktopScanStats lastScan;
+  bool watching;
+};
+
+// listInstalledApps() on Linux: scans against the on-disk index and rewrites
+// it when something changed. While watching, an inotify thread refreshes the
+// result in the background and List() returns it without touching the disk.
+class InstalledAppIndex {
+public:
+  static InstalledAppIndex &Shared();
+
+  std::vector<InstalledApp> List();
+  bool StartWatching(std::string *error);
+  void StopWatching();
+  AppIndexStats Stats();
+
+private:
+  InstalledAppIndex();
+
+  // Caller holds mutex_. Directories in `dirty` are listed again even if
+  // their mtime did not change.
+  void Refresh(const std::unordered_set<std::string> &dirty);
+  void SyncWatches();
+  void WatchLoop();
+
+  std::mutex mutex_;
+  std::vector<InstalledApp> apps_;
+  std::vector<DesktopDirectory> dirs_;
+  AppIndexStats stats_;
+
+  int inotifyFd_;
+  int stopFd_;
+  std::unordered_map<int, std::string> watches_;
+  std::thread watcher_;
+};
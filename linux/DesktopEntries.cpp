@@ -0,0 +1,604 @@
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+
+#include "DesktopEntries.h"
+
+static const size_t READ_BUFFER_SIZE = 16 * 1024;
+// Larger files are not desktop entries anyone wrote by hand; skip them
+// rather than map them.
+static const off_t MAX_DESKTOP_FILE_SIZE = 1 << 20;
+// A directory with more files than this is parsed by several workers.
+static const size_t FILES_PER_TASK = 64;
+static const unsigned MAX_SCAN_THREADS = 4;
+
+static const char DESKTOP_SUFFIX[] = ".desktop";
+static const size_t DESKTOP_SUFFIX_LEN = sizeof(DESKTOP_SUFFIX) - 1;
+
+static std::string_view Trim(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+// Copies a string value, resolving the \s \n \t \r \\ escapes.
+static std::string Unescape(std::string_view value) {
+  std::string result;
+  result.reserve(value.size());
+  for (size_t i = 0; i < value.size(); i++) {
+    char c = value[i];
+    if (c == '\\' && i + 1 < value.size()) {
+      switch (value[++i]) {
+      case 's':
+        c = ' ';
+        break;
+      case 'n':
+        c = '\n';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      case 'r':
+        c = '\r';
+        break;
+      default:
+        c = value[i];
+        break;
+      }
+    }
+    result.push_back(c);
+  }
+  return result;
+}
+
+// Calls fn(key, value) for every entry of the [Desktop Entry] group, pointing
+// straight into `data`, and stops at the next group header so actions and
+// other groups are never read. Localized keys are passed through as-is.
+template <typename F>
+static void ForEachDesktopEntryKey(const char *data, size_t size, F &&fn) {
+  const char *p = data;
+  const char *end = data + size;
+  bool inGroup = false;
+
+  while (p < end) {
+    auto eol = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+    if (eol == nullptr) {
+      eol = end;
+    }
+    std::string_view line(p, size_t(eol - p));
+    p = eol + 1;
+
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    if (line.front() == '[') {
+      if (inGroup) {
+        return;
+      }
+      inGroup = line == "[Desktop Entry]";
+      continue;
+    }
+    if (!inGroup) {
+      continue;
+    }
+
+    size_t eq = line.find('=');
+    if (eq != std::string_view::npos) {
+      fn(Trim(line.substr(0, eq)), Trim(line.substr(eq + 1)));
+    }
+  }
+}
+
+// Calls fn(data, size) with the contents of `name` (relative to dirFd).
+// Desktop entries are a few KB, so they are read into a stack buffer with
+// one syscall; only larger files are mapped, which costs an fstat and a
+// mmap/munmap pair more per file.
+template <typename F>
+static bool WithFileContents(int dirFd, const char *name, F &&fn) {
+  int fd = openat(dirFd, name, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  char buffer[READ_BUFFER_SIZE];
+  ssize_t len = read(fd, buffer, sizeof(buffer));
+  if (len <= 0) {
+    close(fd);
+    return false;
+  }
+  if (size_t(len) < sizeof(buffer)) {
+    close(fd);
+    fn(static_cast<const char *>(buffer), size_t(len));
+    return true;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      st.st_size > MAX_DESKTOP_FILE_SIZE) {
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  fn(static_cast<const char *>(data), size_t(st.st_size));
+  munmap(data, size_t(st.st_size));
+  return true;
+}
+
+// "version: 1.2.3" from a snap's meta/snap.yaml
+static std::string SnapVersion(const std::string &instance) {
+  std::string version;
+  std::string path = "/snap/" + instance + "/current/meta";
+  int dirFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dirFd < 0) {
+    return version;
+  }
+
+  WithFileContents(dirFd, "snap.yaml", [&](const char *data, size_t size) {
+    std::string_view text(data, size);
+    size_t pos = 0;
+    while (pos < text.size()) {
+      size_t eol = text.find('\n', pos);
+      if (eol == std::string_view::npos) {
+        eol = text.size();
+      }
+      std::string_view line = text.substr(pos, eol - pos);
+      pos = eol + 1;
+      if (line.compare(0, 8, "version:") == 0) {
+        std::string_view value = Trim(line.substr(8));
+        if (value.size() >= 2 && (value.front() == '\'' || value.front() == '"') &&
+            value.back() == value.front()) {
+          value = value.substr(1, value.size() - 2);
+        }
+        version.assign(value.data(), value.size());
+        return;
+      }
+    }
+  });
+  close(dirFd);
+  return version;
+}
+
+// Flatpak does not put a version in the exported entry; report the branch
+// the app is deployed from ("stable", "beta", ...), read from the
+// <installation>/app/<id>/current -> <arch>/<branch> link.
+static std::string FlatpakBranch(const std::string &root, const std::string &appId) {
+  static const char EXPORTS[] = "/exports/share/applications";
+  size_t pos = root.rfind(EXPORTS);
+  if (pos == std::string::npos || appId.empty()) {
+    return std::string();
+  }
+
+  std::string link = root.substr(0, pos) + "/app/" + appId + "/current";
+  char target[PATH_MAX];
+  ssize_t len = readlink(link.c_str(), target, sizeof(target));
+  if (len <= 0 || size_t(len) >= sizeof(target)) {
+    return std::string();
+  }
+  std::string_view value(target, size_t(len));
+  size_t slash = value.rfind('/');
+  if (slash != std::string_view::npos) {
+    value.remove_prefix(slash + 1);
+  }
+  return std::string(value);
+}
+
+static bool ParseDesktopFile(int dirFd, const char *name, DesktopEntry *entry) {
+  bool isApplication = false;
+  bool hidden = false;
+
+  bool found = WithFileContents(dirFd, name, [&](const char *data, size_t size) {
+    ForEachDesktopEntryKey(data, size, [&](std::string_view key, std::string_view value) {
+      if (key == "Type") {
+        isApplication = value == "Application";
+      } else if (key == "Name") {
+        entry->name = Unescape(value);
+      } else if (key == "NoDisplay" || key == "Hidden") {
+        hidden = hidden || value == "true";
+      } else if (key == "X-Flatpak" || key == "X-SnapInstanceName") {
+        entry->appId.assign(value.data(), value.size());
+      } else if (key == "X-AppImage-Version" || key == "X-AppVersion") {
+        entry->version.assign(value.data(), value.size());
+      }
+    });
+  });
+
+  // Hidden entries still count, so that they hide the same id further down.
+  entry->visible = found && isApplication && !hidden && !entry->name.empty();
+  return found;
+}
+
+static bool HasDesktopSuffix(const char *name) {
+  size_t len = strlen(name);
+  return len > DESKTOP_SUFFIX_LEN &&
+         memcmp(name + len - DESKTOP_SUFFIX_LEN, DESKTOP_SUFFIX, DESKTOP_SUFFIX_LEN) == 0;
+}
+
+namespace {
+
+// One unit of work: list a directory, or parse a batch of its files.
+struct ScanTask {
+  DesktopDirectory *dir;
+  std::vector<std::string> files;
+};
+
+// Work queue shared by the scan threads. Listing a directory adds tasks for
+// its subdirectories and file batches, so the scan ends when the queue is
+// empty and no task is still running. The queue owns the directories.
+class ScanQueue {
+public:
+  DesktopDirectory *AddDirectory(size_t root, std::string path,
+                                 std::string idPrefix) {
+    std::unique_ptr<DesktopDirectory> dir(new DesktopDirectory());
+    dir->path = std::move(path);
+    dir->root = root;
+    dir->idPrefix = std::move(idPrefix);
+    dir->mtime = -1;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    DesktopDirectory *result = dir.get();
+    dirs_.push_back(std::move(dir));
+    tasks_.push_back(ScanTask{result, {}});
+    cond_.notify_one();
+    return result;
+  }
+
+  void Push(ScanTask &&task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    cond_.notify_one();
+  }
+
+  bool Pop(ScanTask *task) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return !tasks_.empty() || running_ == 0; });
+    if (tasks_.empty()) {
+      return false;
+    }
+    *task = std::move(tasks_.back());
+    tasks_.pop_back();
+    running_++;
+    return true;
+  }
+
+  void Done() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--running_ == 0 && tasks_.empty()) {
+      cond_.notify_all();
+    }
+  }
+
+  // Only once every worker has returned
+  std::vector<std::unique_ptr<DesktopDirectory>> &Directories() { return dirs_; }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<ScanTask> tasks_;
+  std::vector<std::unique_ptr<DesktopDirectory>> dirs_;
+  int running_ = 0;
+};
+
+struct ParsedFile {
+  DesktopDirectory *dir;
+  DesktopEntry entry;
+};
+
+// What one worker produced; merged after the workers are joined so that no
+// lock is taken per file.
+struct ScanOutput {
+  std::vector<ParsedFile> files;
+  DesktopScanStats stats = {0, 0, 0, 0};
+};
+
+} // namespace
+
+static int64_t ModifiedTime(const struct stat &st) {
+  return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+static void ScanDirectory(ScanQueue &queue, DesktopDirectory *dir,
+                          const DesktopScanCache *cache, ScanOutput &out) {
+  int dirFd = open(dir->path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dirFd < 0) {
+    return;
+  }
+  struct stat st;
+  if (fstat(dirFd, &st) != 0) {
+    close(dirFd);
+    return;
+  }
+  dir->mtime = ModifiedTime(st);
+  out.stats.directories++;
+
+  if (cache != nullptr && cache->LoadDirectory(dir)) {
+    close(dirFd);
+    out.stats.reusedDirectories++;
+    for (const auto &name : dir->subdirectories) {
+      queue.AddDirectory(dir->root, dir->path + "/" + name,
+                         dir->idPrefix + name + "-");
+    }
+    return;
+  }
+
+  DIR *listing = fdopendir(dirFd);
+  if (listing == nullptr) {
+    close(dirFd);
+    return;
+  }
+
+  ScanTask batch{dir, {}};
+  while (struct dirent *entry = readdir(listing)) {
+    const char *name = entry->d_name;
+    if (name[0] == '.') {
+      continue;
+    }
+
+    unsigned char type = entry->d_type;
+    if (type == DT_UNKNOWN || type == DT_LNK) {
+      if (fstatat(dirfd(listing), name, &st, 0) != 0) {
+        continue;
+      }
+      type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+    }
+
+    if (type == DT_DIR) {
+      dir->subdirectories.push_back(name);
+      queue.AddDirectory(dir->root, dir->path + "/" + name,
+                         dir->idPrefix + name + "-");
+    } else if (HasDesktopSuffix(name)) {
+      batch.files.push_back(name);
+      if (batch.files.size() == FILES_PER_TASK) {
+        queue.Push(std::move(batch));
+        batch = ScanTask{dir, {}};
+      }
+    }
+  }
+  closedir(listing);
+
+  if (!batch.files.empty()) {
+    queue.Push(std::move(batch));
+  }
+}
+
+static void ParseFiles(const ScanTask &task, const std::vector<DesktopEntryRoot> &roots,
+                       const DesktopScanCache *cache, ScanOutput &out) {
+  DesktopDirectory *dir = task.dir;
+  int dirFd = open(dir->path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dirFd < 0) {
+    return;
+  }
+
+  const DesktopEntryRoot &root = roots[dir->root];
+  for (const auto &file : task.files) {
+    ParsedFile parsed{dir, DesktopEntry()};
+    DesktopEntry &entry = parsed.entry;
+    entry.fileName = file;
+    entry.mtime = 0;
+
+    if (cache != nullptr) {
+      struct stat st;
+      if (fstatat(dirFd, file.c_str(), &st, 0) != 0) {
+        continue;
+      }
+      entry.mtime = ModifiedTime(st);
+      if (cache->LoadEntry(dir->path, &entry)) {
+        out.stats.reusedFiles++;
+        out.files.push_back(std::move(parsed));
+        continue;
+      }
+    }
+
+    if (!ParseDesktopFile(dirFd, file.c_str(), &entry)) {
+      continue;
+    }
+    out.stats.parsedFiles++;
+
+    if (entry.visible && entry.version.empty()) {
+      if (root.type == "snap" && !entry.appId.empty()) {
+        entry.version = SnapVersion(entry.appId);
+      } else if (root.type == "flatpak") {
+        entry.version = FlatpakBranch(root.path, entry.appId);
+      }
+    }
+    out.files.push_back(std::move(parsed));
+  }
+  close(dirFd);
+}
+
+static std::string EnvOr(const char *name, const std::string &fallback) {
+  const char *value = getenv(name);
+  return value != nullptr && value[0] != '\0' ? std::string(value) : fallback;
+}
+
+std::vector<DesktopEntryRoot> DesktopEntryRoots() {
+  std::string home = EnvOr("HOME", "");
+  std::vector<std::string> dataDirs;
+  dataDirs.push_back(EnvOr("XDG_DATA_HOME", home.empty() ? "" : home + "/.local/share"));
+
+  std::string systemDirs = EnvOr("XDG_DATA_DIRS", "/usr/local/share:/usr/share");
+  size_t start = 0;
+  while (start <= systemDirs.size()) {
+    size_t colon = systemDirs.find(':', start);
+    if (colon == std::string::npos) {
+      colon = systemDirs.size();
+    }
+    dataDirs.push_back(systemDirs.substr(start, colon - start));
+    start = colon + 1;
+  }
+
+  // Usually already in XDG_DATA_DIRS when Flatpak or Snap is installed, but
+  // not for processes started outside a login session.
+  if (!home.empty()) {
+    dataDirs.push_back(home + "/.local/share/flatpak/exports/share");
+  }
+  dataDirs.push_back("/var/lib/flatpak/exports/share");
+  dataDirs.push_back("/var/lib/snapd/desktop");
+
+  std::vector<DesktopEntryRoot> roots;
+  std::unordered_set<std::string> seen;
+  for (const auto &dataDir : dataDirs) {
+    if (dataDir.empty() || dataDir[0] != '/') {
+      continue;
+    }
+    std::string applications = dataDir + "/applications";
+    char resolved[PATH_MAX];
+    if (realpath(applications.c_str(), resolved) == nullptr ||
+        !seen.insert(resolved).second) {
+      continue;
+    }
+
+    DesktopEntryRoot root{resolved, "desktop"};
+    if (root.path.find("/flatpak/exports/share/") != std::string::npos) {
+      root.type = "flatpak";
+    } else if (root.path.compare(0, 22, "/var/lib/snapd/desktop") == 0) {
+      root.type = "snap";
+    }
+    roots.push_back(std::move(root));
+  }
+
+  return roots;
+}
+
+std::vector<DesktopDirectory> ScanDesktopEntries(
+    const std::vector<DesktopEntryRoot> &roots, const DesktopScanCache *cache,
+    DesktopScanStats *stats) {
+  ScanQueue queue;
+  for (size_t i = 0; i < roots.size(); i++) {
+    queue.AddDirectory(i, roots[i].path, "");
+  }
+
+  unsigned threadCount =
+      std::max(1u, std::min(MAX_SCAN_THREADS, std::thread::hardware_concurrency()));
+  std::vector<ScanOutput> outputs(threadCount);
+  auto worker = [&](ScanOutput &out) {
+    ScanTask task;
+    while (queue.Pop(&task)) {
+      if (task.files.empty()) {
+        ScanDirectory(queue, task.dir, cache, out);
+      } else {
+        ParseFiles(task, roots, cache, out);
+      }
+      queue.Done();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < threadCount; i++) {
+    threads.emplace_back(worker, std::ref(outputs[i]));
+  }
+  worker(outputs[0]);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  DesktopScanStats total = {0, 0, 0, 0};
+  for (auto &out : outputs) {
+    for (auto &parsed : out.files) {
+      parsed.dir->entries.push_back(std::move(parsed.entry));
+    }
+    total.directories += out.stats.directories;
+    total.reusedDirectories += out.stats.reusedDirectories;
+    total.parsedFiles += out.stats.parsedFiles;
+    total.reusedFiles += out.stats.reusedFiles;
+  }
+  if (stats != nullptr) {
+    *stats = total;
+  }
+
+  // Directories that vanished during the walk are dropped.
+  std::vector<DesktopDirectory> dirs;
+  dirs.reserve(queue.Directories().size());
+  for (auto &dir : queue.Directories()) {
+    if (dir->mtime < 0) {
+      continue;
+    }
+    std::sort(dir->entries.begin(), dir->entries.end(),
+              [](const DesktopEntry &a, const DesktopEntry &b) {
+                return a.fileName < b.fileName;
+              });
+    dirs.push_back(std::move(*dir));
+  }
+
+  return dirs;
+}
+
+std::vector<InstalledApp> ResolveInstalledApps(
+    const std::vector<DesktopEntryRoot> &roots,
+    const std::vector<DesktopDirectory> &dirs) {
+  struct Candidate {
+    std::string fileId;
+    size_t root;
+    const DesktopEntry *entry;
+  };
+
+  std::vector<Candidate> candidates;
+  for (const auto &dir : dirs) {
+    for (const auto &entry : dir.entries) {
+      candidates.push_back(Candidate{dir.idPrefix + entry.fileName, dir.root, &entry});
+    }
+  }
+
+  // The first root that has a desktop file id wins, even when its entry is
+  // hidden; a user's Hidden=true copy is how an app gets removed from menus.
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+              int order = a.fileId.compare(b.fileId);
+              return order != 0 ? order < 0 : a.root < b.root;
+            });
+
+  std::vector<InstalledApp> apps;
+  apps.reserve(candidates.size());
+  for (size_t i = 0; i < candidates.size(); i++) {
+    const Candidate &candidate = candidates[i];
+    const DesktopEntry &entry = *candidate.entry;
+    if ((i > 0 && candidates[i - 1].fileId == candidate.fileId) || !entry.visible) {
+      continue;
+    }
+
+    InstalledApp app;
+    app.AppType = roots[candidate.root].type;
+    app.AppName = entry.name;
+    app.Id = !entry.appId.empty()
+                 ? entry.appId
+                 : candidate.fileId.substr(0, candidate.fileId.size() - DESKTOP_SUFFIX_LEN);
+    app.Version = entry.version;
+    apps.push_back(std::move(app));
+  }
+
+  return apps;
+}
+
+std::vector<InstalledApp> ListInstalledApps(
+    const std::vector<DesktopEntryRoot> &roots) {
+  return ResolveInstalledApps(roots, ScanDesktopEntries(roots, nullptr, nullptr));
+}
+
+std::vector<InstalledApp> ListInstalledApps() {
+  return ListInstalledApps(DesktopEntryRoots());
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class InstalledApp {
+public:
+  std::string AppType;
+  std::string AppName;
+  std::string Id;
+  std::string Version;
+
+  InstalledApp() : AppType("desktop") {}
+};
+
+// An "applications" directory holding .desktop files, and the InstalledApp
+// type reported for the entries found in it: desktop, flatpak or snap.
+struct DesktopEntryRoot {
+  std::string path;
+  std::string type;
+};
+
+// One parsed .desktop file
+struct DesktopEntry {
+  std::string fileName;
+  std::string name;
+  // X-Flatpak or X-SnapInstanceName; the desktop file id is used otherwise
+  std::string appId;
+  std::string version;
+  // Nanoseconds; only read when scanning with a cache
+  int64_t mtime;
+  // Type=Application with a Name and neither Hidden nor NoDisplay
+  bool visible;
+};
+
+// The .desktop files directly inside one directory below a root, sorted by
+// file name.
+struct DesktopDirectory {
+  std::string path;
+  size_t root;
+  // Prefix of the desktop file ids in this directory, e.g. "kde4-" for kde4/
+  std::string idPrefix;
+  int64_t mtime;
+  std::vector<std::string> subdirectories;
+  std::vector<DesktopEntry> entries;
+};
+
+// The result of an earlier scan, used to skip work that is still valid.
+class DesktopScanCache {
+public:
+  virtual ~DesktopScanCache() {}
+
+  // Fills the entries and subdirectories of `dir` when dir->path was cached
+  // with the same dir->mtime.
+  virtual bool LoadDirectory(DesktopDirectory *dir) const = 0;
+  // Fills `entry` when entry->fileName in `dirPath` was cached with the same
+  // entry->mtime.
+  virtual bool LoadEntry(const std::string &dirPath, DesktopEntry *entry) const = 0;
+};
+
+struct DesktopScanStats {
+  size_t directories;
+  size_t reusedDirectories;
+  size_t parsedFiles;
+  size_t reusedFiles;
+};
+
+// $XDG_DATA_HOME, $XDG_DATA_DIRS, the Flatpak exports and the Snap desktop
+// directory, in precedence order, with duplicates and missing ones removed.
+std::vector<DesktopEntryRoot> DesktopEntryRoots();
+
+// Walks `roots` on a small thread pool. With a cache, a directory whose
+// mtime is unchanged is taken from it without being listed, and in a changed
+// directory only files with a new mtime are parsed. Adding, removing or
+// renaming a file changes the directory mtime; rewriting one in place does
+// not, which is what the InstalledAppIndex watcher is for.
+std::vector<DesktopDirectory> ScanDesktopEntries(
+    const std::vector<DesktopEntryRoot> &roots, const DesktopScanCache *cache,
+    DesktopScanStats *stats);
+
+// Turns scanned directories into apps, applying the precedence rules below.
+std::vector<InstalledApp> ResolveInstalledApps(
+    const std::vector<DesktopEntryRoot> &roots,
+    const std::vector<DesktopDirectory> &dirs);
+
+// Lists the visible applications under `roots`. An entry hides entries with
+// the same desktop file id in later roots, as in the XDG menu spec.
+std::vector<InstalledApp> ListInstalledApps(
+    const std::vector<DesktopEntryRoot> &roots);
+std::vector<InstalledApp> ListInstalledApps();
@@ -0,0 +1,74 @@
+#include <chrono>
+
+#include "MicTimelineRecorder.h"
+#include "PipeWireGraph.h"
+
+// Upper bound on one wait; changes wake the thread much sooner.
+static const int WAIT_TIMEOUT_MS = 1000;
+
+int64_t WallClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+MicTimelineRecorder::MicTimelineRecorder(MicTimeline *timeline)
+    : timeline_(timeline), running_(false) {}
+
+MicTimelineRecorder::~MicTimelineRecorder() { Stop(); }
+
+static std::vector<MicUse> UsesFromLinks(const std::vector<AudioLinkInfo> &links) {
+  std::vector<MicUse> uses;
+  for (const auto &link : links) {
+    // Same rule as MicrophoneProcesses(); the output is the device (or the
+    // app node a monitor chain records from).
+    if (!link.inputIsApp) {
+      continue;
+    }
+    MicUse use;
+    use.process = link.inputName;
+    use.pid = link.inputPid;
+    use.device = link.outputName;
+    uses.push_back(std::move(use));
+  }
+  return uses;
+}
+
+bool MicTimelineRecorder::Start(std::string *error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_.load()) {
+    return true;
+  }
+  if (!PipeWireGraph::Shared().EnsureStarted(error)) {
+    return false;
+  }
+
+  running_ = true;
+  thread_ = std::thread(&MicTimelineRecorder::Run, this);
+  return true;
+}
+
+void MicTimelineRecorder::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_.exchange(false)) {
+    return;
+  }
+  PipeWireGraph::Shared().Index().Wake();
+  thread_.join();
+  timeline_->CloseAll(WallClockMs());
+}
+
+void MicTimelineRecorder::Run() {
+  PipeWireGraphIndex &index = PipeWireGraph::Shared().Index();
+  uint64_t seen = index.Generation();
+  timeline_->Update(UsesFromLinks(index.Links()), WallClockMs());
+
+  while (running_.load()) {
+    uint64_t generation = index.WaitForChange(seen, WAIT_TIMEOUT_MS);
+    if (generation == seen || !running_.load()) {
+      continue;
+    }
+    seen = generation;
+    timeline_->Update(UsesFromLinks(index.Links()), WallClockMs());
+  }
+}
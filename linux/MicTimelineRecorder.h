@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../common/MicTimeline.h"
+
+// Feeds a MicTimeline from the PipeWire graph index: every app node linked
+// to a capture node is one use. The thread sleeps until the graph changes,
+// so an idle graph costs nothing.
+class MicTimelineRecorder {
+public:
+  explicit MicTimelineRecorder(MicTimeline *timeline);
+  ~MicTimelineRecorder();
+
+  // Both may be called from any thread.
+  bool Start(std::string *error);
+  // Closes the open intervals at the time of the call.
+  void Stop();
+  bool IsRunning() const { return running_.load(); }
+
+private:
+  void Run();
+
+  MicTimeline *timeline_;
+  // Held while the thread is started or joined
+  std::mutex mutex_;
+  std::thread thread_;
+  std::atomic<bool> running_;
+};
+
+// Milliseconds since the epoch, the time base of the timeline
+int64_t WallClockMs();
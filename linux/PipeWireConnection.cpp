@@ -0,0 +1,279 @@
+#include "PipeWireConnection.h"
+
+#ifdef HAVE_PIPEWIRE
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <pipewire/pipewire.h>
+
+#include "../common/NativeStats.h"
+
+// Matches the restart delay of MicrophoneUsageMonitor on macOS
+static const time_t RECONNECT_DELAY_SECONDS = 3;
+
+struct PipeWireConnection::State {
+  PipeWireConnection *owner;
+  struct pw_thread_loop *loop = nullptr;
+  struct pw_context *context = nullptr;
+  struct pw_core *core = nullptr;
+  struct pw_registry *registry = nullptr;
+  struct spa_source *reconnectTimer = nullptr;
+  struct spa_hook coreListener;
+  struct spa_hook registryListener;
+
+  // Two core syncs: the first flushes the registry globals, the second the
+  // info events of whatever the owner bound while handling them.
+  int syncSeq = 0;
+  int syncStage = 0;
+
+  explicit State(PipeWireConnection *owner) : owner(owner) {
+    spa_zero(coreListener);
+    spa_zero(registryListener);
+  }
+
+  bool Connect();
+  void Disconnect();
+  void ScheduleReconnect();
+
+  void HandleGlobal(uint32_t id, const char *type,
+                    const struct spa_dict *props) {
+    owner->OnGlobal(id, type, props);
+  }
+  void HandleGlobalRemove(uint32_t id) { owner->OnGlobalRemove(id); }
+  void HandleDone(uint32_t id, int seq);
+  void HandleError(uint32_t id, int res, const char *message);
+  void HandleReconnectTimer();
+};
+
+static void OnRegistryGlobal(void *data, uint32_t id, uint32_t permissions,
+                             const char *type, uint32_t version,
+                             const struct spa_dict *props) {
+  static_cast<PipeWireConnection::State *>(data)->HandleGlobal(id, type, props);
+}
+
+static void OnRegistryGlobalRemove(void *data, uint32_t id) {
+  static_cast<PipeWireConnection::State *>(data)->HandleGlobalRemove(id);
+}
+
+static const struct pw_registry_events &RegistryEvents() {
+  static struct pw_registry_events events;
+  events.version = PW_VERSION_REGISTRY_EVENTS;
+  events.global = OnRegistryGlobal;
+  events.global_remove = OnRegistryGlobalRemove;
+  return events;
+}
+
+static void OnCoreDone(void *data, uint32_t id, int seq) {
+  static_cast<PipeWireConnection::State *>(data)->HandleDone(id, seq);
+}
+
+static void OnCoreError(void *data, uint32_t id, int seq, int res,
+                        const char *message) {
+  static_cast<PipeWireConnection::State *>(data)->HandleError(id, res,
+                                                              message);
+}
+
+static const struct pw_core_events &CoreEvents() {
+  static struct pw_core_events events;
+  events.version = PW_VERSION_CORE_EVENTS;
+  events.done = OnCoreDone;
+  events.error = OnCoreError;
+  return events;
+}
+
+static void OnReconnectTimer(void *data, uint64_t expirations) {
+  static_cast<PipeWireConnection::State *>(data)->HandleReconnectTimer();
+}
+
+bool PipeWireConnection::State::Connect() {
+  core = pw_context_connect(context, nullptr, 0);
+  if (core == nullptr) {
+    NativeStatsBackendError("pipewire", -errno);
+    return false;
+  }
+  pw_core_add_listener(core, &coreListener, &CoreEvents(), this);
+
+  registry = pw_core_get_registry(core, PW_VERSION_REGISTRY, 0);
+  pw_registry_add_listener(registry, &registryListener, &RegistryEvents(),
+                           this);
+
+  syncStage = 0;
+  syncSeq = pw_core_sync(core, PW_ID_CORE, 0);
+  return true;
+}
+
+void PipeWireConnection::State::Disconnect() {
+  if (registry != nullptr) {
+    owner->OnDisconnect();
+    spa_hook_remove(&registryListener);
+    pw_proxy_destroy(reinterpret_cast<struct pw_proxy *>(registry));
+    registry = nullptr;
+  }
+  if (core != nullptr) {
+    spa_hook_remove(&coreListener);
+    pw_core_disconnect(core);
+    core = nullptr;
+  }
+  syncStage = 0;
+}
+
+void PipeWireConnection::State::ScheduleReconnect() {
+  struct timespec delay = {RECONNECT_DELAY_SECONDS, 0};
+  pw_loop_update_timer(pw_thread_loop_get_loop(loop), reconnectTimer, &delay,
+                       nullptr, false);
+}
+
+void PipeWireConnection::State::HandleDone(uint32_t id, int seq) {
+  if (id != PW_ID_CORE || seq != syncSeq) {
+    return;
+  }
+
+  if (syncStage == 0) {
+    syncStage = 1;
+    syncSeq = pw_core_sync(core, PW_ID_CORE, syncSeq);
+  } else if (syncStage == 1) {
+    syncStage = 2;
+    owner->OnSynced();
+    pw_thread_loop_signal(loop, false);
+  }
+}
+
+void PipeWireConnection::State::HandleError(uint32_t id, int res,
+                                            const char *message) {
+  NativeStatsBackendError("pipewire", res);
+  if (id != PW_ID_CORE || res != -EPIPE) {
+    return;
+  }
+
+  // The daemon went away. Retry from the loop thread.
+  owner->OnConnectionLost(res, message != nullptr ? message : "");
+  ScheduleReconnect();
+}
+
+void PipeWireConnection::State::HandleReconnectTimer() {
+  Disconnect();
+  if (Connect()) {
+    owner->OnReconnected();
+  } else {
+    ScheduleReconnect();
+  }
+}
+
+PipeWireConnection::PipeWireConnection() {}
+
+PipeWireConnection::~PipeWireConnection() {}
+
+bool PipeWireConnection::Start(const char *name, std::string *error) {
+  if (state_) {
+    *error = "Already started";
+    return false;
+  }
+
+  static bool initialized = false;
+  if (!initialized) {
+    pw_init(nullptr, nullptr);
+    initialized = true;
+  }
+
+  std::unique_ptr<State> state(new State(this));
+  state->loop = pw_thread_loop_new(name, nullptr);
+  if (state->loop == nullptr) {
+    *error = "Failed to create PipeWire thread loop";
+    return false;
+  }
+
+  // The hooks may look at state_ as soon as the loop thread runs.
+  state_ = std::move(state);
+  State *s = state_.get();
+
+  pw_thread_loop_lock(s->loop);
+  s->context = pw_context_new(pw_thread_loop_get_loop(s->loop), nullptr, 0);
+  s->reconnectTimer =
+      pw_loop_add_timer(pw_thread_loop_get_loop(s->loop), OnReconnectTimer, s);
+  bool connected = s->context != nullptr && s->Connect();
+  if (connected && pw_thread_loop_start(s->loop) < 0) {
+    s->Disconnect();
+    connected = false;
+  }
+  pw_thread_loop_unlock(s->loop);
+
+  if (!connected) {
+    *error = "Failed to connect to PipeWire";
+    if (s->reconnectTimer != nullptr) {
+      pw_loop_destroy_source(pw_thread_loop_get_loop(s->loop),
+                             s->reconnectTimer);
+    }
+    if (s->context != nullptr) {
+      pw_context_destroy(s->context);
+    }
+    pw_thread_loop_destroy(s->loop);
+    state_.reset();
+    return false;
+  }
+
+  return true;
+}
+
+void PipeWireConnection::Stop() {
+  if (!state_) {
+    return;
+  }
+
+  // Once the loop thread is joined nothing else touches the proxies.
+  pw_thread_loop_stop(state_->loop);
+  state_->Disconnect();
+  pw_loop_destroy_source(pw_thread_loop_get_loop(state_->loop),
+                         state_->reconnectTimer);
+  pw_context_destroy(state_->context);
+  pw_thread_loop_destroy(state_->loop);
+  state_.reset();
+}
+
+bool PipeWireConnection::WaitForSync(int timeoutSeconds) {
+  if (!state_) {
+    return false;
+  }
+
+  time_t deadline = time(nullptr) + timeoutSeconds;
+  pw_thread_loop_lock(state_->loop);
+  while (state_->syncStage < 2 && time(nullptr) < deadline) {
+    pw_thread_loop_timed_wait(state_->loop, 1);
+  }
+  bool synced = state_->syncStage == 2;
+  pw_thread_loop_unlock(state_->loop);
+
+  return synced;
+}
+
+struct pw_registry *PipeWireConnection::Registry() const {
+  return state_->registry;
+}
+
+bool PipeWireConnection::IsSynced() const { return state_->syncStage == 2; }
+
+#else
+
+// Without libpipewire nothing connects, so the subclass hooks never run and
+// every query reports the error from Start().
+struct PipeWireConnection::State {};
+
+PipeWireConnection::PipeWireConnection() {}
+
+PipeWireConnection::~PipeWireConnection() {}
+
+bool PipeWireConnection::Start(const char *name, std::string *error) {
+  *error = "PipeWire is not available (built without libpipewire)";
+  return false;
+}
+
+void PipeWireConnection::Stop() {}
+
+bool PipeWireConnection::WaitForSync(int timeoutSeconds) { return false; }
+
+struct pw_registry *PipeWireConnection::Registry() const { return nullptr; }
+
+bool PipeWireConnection::IsSynced() const { return false; }
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct pw_registry;
+struct pw_thread_loop;
+struct spa_dict;
+
+// A registry connection to the PipeWire daemon on its own pw_thread_loop.
+// Subclasses receive registry events on the loop thread. The connection
+// re-establishes itself a few seconds after the daemon goes away.
+//
+// Subclasses must call Stop() from their destructor, since the hooks are
+// virtual and the subclass is gone by the time ~PipeWireConnection runs.
+class PipeWireConnection {
+public:
+  PipeWireConnection();
+  virtual ~PipeWireConnection();
+
+  bool Start(const char *name, std::string *error);
+  void Stop();
+  bool IsStarted() const { return state_ != nullptr; }
+
+  // Blocks until the registry and everything bound while it was replayed
+  // have been received, or until the timeout expires.
+  bool WaitForSync(int timeoutSeconds);
+
+  struct State;
+
+protected:
+  // Only valid on the loop thread, i.e. from inside the hooks below.
+  struct pw_registry *Registry() const;
+  bool IsSynced() const;
+
+  virtual void OnGlobal(uint32_t id, const char *type,
+                        const struct spa_dict *props) = 0;
+  virtual void OnGlobalRemove(uint32_t id) = 0;
+  // The initial registry replay is complete, after a (re)connect.
+  virtual void OnSynced() {}
+  virtual void OnConnectionLost(int res, const char *message) {}
+  virtual void OnReconnected() {}
+  // Destroy any proxies bound from OnGlobal; the registry goes away next.
+  virtual void OnDisconnect() {}
+
+private:
+  std::unique_ptr<State> state_;
+};
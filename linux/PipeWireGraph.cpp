@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <unordered_set>
+
+#ifdef HAVE_PIPEWIRE
+#include <pipewire/pipewire.h>
+#else
+// The index still serves synthetic graphs, which use the same keys
+#define PW_KEY_NODE_NAME "node.name"
+#define PW_KEY_NODE_DESCRIPTION "node.description"
+#define PW_KEY_APP_NAME "application.name"
+#define PW_KEY_APP_PROCESS_ID "application.process.id"
+#endif
+
+#include "PipeWireGraph.h"
+
+// How long the first query waits for the registry to be replayed
+static const int INITIAL_SYNC_TIMEOUT_SECONDS = 2;
+
+struct PropKeyStore {
+  std::mutex mutex;
+  std::unordered_map<std::string, uint32_t> ids;
+  // A deque keeps references returned by Name() valid while it grows.
+  std::deque<std::string> names;
+};
+
+static PropKeyStore &KeyStore() {
+  static PropKeyStore *store = new PropKeyStore();
+  return *store;
+}
+
+uint32_t PropKeyTable::Intern(const char *key) {
+  PropKeyStore &store = KeyStore();
+  std::lock_guard<std::mutex> lock(store.mutex);
+  auto it = store.ids.find(key);
+  if (it != store.ids.end()) {
+    return it->second;
+  }
+
+  uint32_t id = uint32_t(store.names.size());
+  store.names.emplace_back(key);
+  store.ids.emplace(store.names.back(), id);
+  return id;
+}
+
+const std::string &PropKeyTable::Name(uint32_t id) {
+  PropKeyStore &store = KeyStore();
+  std::lock_guard<std::mutex> lock(store.mutex);
+  return store.names[id];
+}
+
+static uint32_t NodeNameKey() {
+  static uint32_t key = PropKeyTable::Intern(PW_KEY_NODE_NAME);
+  return key;
+}
+
+static uint32_t AppNameKey() {
+  static uint32_t key = PropKeyTable::Intern(PW_KEY_APP_NAME);
+  return key;
+}
+
+static uint32_t ProcessIdKey() {
+  static uint32_t key = PropKeyTable::Intern(PW_KEY_APP_PROCESS_ID);
+  return key;
+}
+
+static uint32_t NodeDescriptionKey() {
+  static uint32_t key = PropKeyTable::Intern(PW_KEY_NODE_DESCRIPTION);
+  return key;
+}
+
+const std::string *GraphNode::Prop(uint32_t key) const {
+  for (const auto &prop : props) {
+    if (prop.first == key) {
+      return &prop.second;
+    }
+  }
+  return nullptr;
+}
+
+void PipeWireGraphIndex::UpdateNode(uint32_t id, const GraphProp *props,
+                                    size_t count) {
+  GraphNode node;
+  node.props.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (props[i].key == nullptr || props[i].value == nullptr) {
+      continue;
+    }
+    node.props.emplace_back(PropKeyTable::Intern(props[i].key),
+                            props[i].value);
+  }
+
+  const std::string *name = node.Prop(NodeNameKey());
+  const std::string *appName = node.Prop(AppNameKey());
+  const std::string *description = node.Prop(NodeDescriptionKey());
+  const std::string *pid = node.Prop(ProcessIdKey());
+  if (name != nullptr) {
+    node.name = *name;
+  }
+  if (pid != nullptr) {
+    node.pid = uint32_t(strtoul(pid->c_str(), nullptr, 10));
+  }
+  node.isApp = appName != nullptr && !appName->empty();
+  node.isDevice = description != nullptr && !description->empty();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  nodes_[id] = std::move(node);
+  Changed();
+}
+
+void PipeWireGraphIndex::AddLink(uint32_t id, uint32_t outputNode,
+                                 uint32_t inputNode) {
+  uint64_t key = PairKey(inputNode, outputNode);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = links_.find(id);
+  if (it != links_.end()) {
+    if (it->second == key) {
+      return;
+    }
+    if (--pairs_[it->second] == 0) {
+      pairs_.erase(it->second);
+    }
+  }
+
+  links_[id] = key;
+  pairs_[key]++;
+  Changed();
+}
+
+void PipeWireGraphIndex::Remove(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (nodes_.erase(id) > 0) {
+    Changed();
+    return;
+  }
+
+  auto it = links_.find(id);
+  if (it == links_.end()) {
+    return;
+  }
+  if (--pairs_[it->second] == 0) {
+    pairs_.erase(it->second);
+  }
+  links_.erase(it);
+  Changed();
+}
+
+void PipeWireGraphIndex::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  nodes_.clear();
+  links_.clear();
+  pairs_.clear();
+  Changed();
+}
+
+uint64_t PipeWireGraphIndex::Generation() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return generation_;
+}
+
+void PipeWireGraphIndex::Changed() {
+  generation_++;
+  changed_.notify_all();
+}
+
+uint64_t PipeWireGraphIndex::WaitForChange(uint64_t seen, int timeoutMs) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t wakes = wakes_;
+  changed_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]() {
+    return generation_ != seen || wakes_ != wakes;
+  });
+  return generation_;
+}
+
+void PipeWireGraphIndex::Wake() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  wakes_++;
+  changed_.notify_all();
+}
+
+std::vector<AudioLinkInfo> PipeWireGraphIndex::Links() {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Sorted so that results do not depend on hash order
+  std::vector<uint64_t> keys;
+  keys.reserve(pairs_.size());
+  for (const auto &pair : pairs_) {
+    keys.push_back(pair.first);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<AudioLinkInfo> links;
+  links.reserve(keys.size());
+  for (uint64_t key : keys) {
+    uint32_t inputId = uint32_t(key >> 32);
+    uint32_t outputId = uint32_t(key);
+    auto input = nodes_.find(inputId);
+    auto output = nodes_.find(outputId);
+    // Links can be announced before their nodes; skip them until then.
+    if (input == nodes_.end() || output == nodes_.end()) {
+      continue;
+    }
+
+    AudioLinkInfo link;
+    link.inputId = inputId;
+    link.outputId = outputId;
+    link.inputName = input->second.name;
+    link.outputName = output->second.name;
+    link.inputPid = input->second.pid;
+    link.outputPid = output->second.pid;
+    link.inputIsApp = input->second.isApp;
+    link.outputIsApp = output->second.isApp;
+    links.push_back(std::move(link));
+  }
+
+  return links;
+}
+
+static void AppendUnique(std::vector<std::string> &out,
+                         std::unordered_set<std::string> &seen,
+                         const std::string &value) {
+  if (seen.insert(value).second) {
+    out.push_back(value);
+  }
+}
+
+std::vector<std::string> PipeWireGraphIndex::MicrophoneProcesses() {
+  std::vector<std::string> processes;
+  std::unordered_set<std::string> seen;
+  for (const auto &link : Links()) {
+    if (link.inputIsApp) {
+      AppendUnique(processes, seen, link.inputName);
+    }
+  }
+
+  return processes;
+}
+
+std::vector<SessionProcess> PipeWireGraphIndex::MicrophoneSessions() {
+  std::vector<SessionProcess> sessions;
+  std::unordered_set<uint32_t> seen;
+  for (const auto &link : Links()) {
+    if (link.inputIsApp && seen.insert(link.inputId).second) {
+      sessions.push_back(SessionProcess{link.inputPid, link.inputName});
+    }
+  }
+
+  return sessions;
+}
+
+std::vector<std::string> PipeWireGraphIndex::InputAudioProcesses() {
+  std::vector<std::string> processes;
+  std::unordered_set<std::string> seen;
+  for (const auto &link : Links()) {
+    if (link.inputIsApp) {
+      AppendUnique(processes, seen,
+                   link.outputIsApp ? link.outputName : link.inputName);
+    }
+  }
+
+  return processes;
+}
+
+std::vector<SpeakerStreamInfo> PipeWireGraphIndex::SpeakerStreams() {
+  std::vector<SpeakerStreamInfo> streams;
+  std::unordered_set<std::string> seen;
+  for (const auto &link : Links()) {
+    if (!link.outputIsApp) {
+      continue;
+    }
+    // Names cannot contain NUL, so it separates the pair unambiguously.
+    std::string key = link.outputName + '\0' + link.inputName;
+    if (!seen.insert(key).second) {
+      continue;
+    }
+
+    SpeakerStreamInfo stream;
+    stream.processName = link.outputName;
+    stream.deviceName = link.inputName;
+    stream.pid = link.outputPid;
+    streams.push_back(std::move(stream));
+  }
+
+  return streams;
+}
+
+PipeWireGraph &PipeWireGraph::Shared() {
+  static PipeWireGraph *graph = new PipeWireGraph();
+  return *graph;
+}
+
+PipeWireGraph::~PipeWireGraph() { Stop(); }
+
+bool PipeWireGraph::EnsureStarted(std::string *error) {
+  std::lock_guard<std::mutex> lock(startMutex_);
+  if (IsStarted() || synthetic_) {
+    return true;
+  }
+
+  if (!Start("graph-index", error)) {
+    return false;
+  }
+  WaitForSync(INITIAL_SYNC_TIMEOUT_SECONDS);
+  return true;
+}
+
+void PipeWireGraph::UseSynthetic(bool synthetic) {
+  std::lock_guard<std::mutex> lock(startMutex_);
+  if (IsStarted()) {
+    Stop();
+  }
+  synthetic_ = synthetic;
+  index_.Clear();
+}
+
+#ifdef HAVE_PIPEWIRE
+
+static bool ParseNodeId(const char *value, uint32_t *id) {
+  if (value == nullptr || *value == '\0') {
+    return false;
+  }
+
+  char *end = nullptr;
+  unsigned long parsed = strtoul(value, &end, 10);
+  if (*end != '\0') {
+    return false;
+  }
+  *id = uint32_t(parsed);
+  return true;
+}
+
+void PipeWireGraph::OnGlobal(uint32_t id, const char *type,
+                             const struct spa_dict *props) {
+  if (props == nullptr) {
+    return;
+  }
+
+  if (strcmp(type, PW_TYPE_INTERFACE_Node) == 0) {
+    std::vector<GraphProp> items;
+    items.reserve(props->n_items);
+    const struct spa_dict_item *item;
+    spa_dict_for_each(item, props) {
+      GraphProp prop;
+      prop.key = item->key;
+      prop.value = item->value;
+      items.push_back(prop);
+    }
+    index_.UpdateNode(id, items.data(), items.size());
+  } else if (strcmp(type, PW_TYPE_INTERFACE_Link) == 0) {
+    uint32_t outputNode;
+    uint32_t inputNode;
+    if (ParseNodeId(spa_dict_lookup(props, PW_KEY_LINK_OUTPUT_NODE),
+                    &outputNode) &&
+        ParseNodeId(spa_dict_lookup(props, PW_KEY_LINK_INPUT_NODE),
+                    &inputNode)) {
+      index_.AddLink(id, outputNode, inputNode);
+    }
+  }
+}
+
+#else
+
+// Never called: the connection cannot start without libpipewire
+void PipeWireGraph::OnGlobal(uint32_t id, const char *type,
+                             const struct spa_dict *props) {}
+
+#endif
+
+void PipeWireGraph::OnGlobalRemove(uint32_t id) { index_.Remove(id); }
+
+void PipeWireGraph::OnConnectionLost(int res, const char *message) {
+  index_.Clear();
+}
+
+void PipeWireGraph::OnDisconnect() { index_.Clear(); }
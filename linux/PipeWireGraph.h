@@ -0,0 +1,133 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "PipeWireConnection.h"
+#include "../common/ProcessTree.h"
+
+// Property keys are interned once per process so a node keeps only small
+// integer ids next to its values.
+class PropKeyTable {
+public:
+  static uint32_t Intern(const char *key);
+  static const std::string &Name(uint32_t id);
+};
+
+struct GraphProp {
+  const char *key;
+  const char *value;
+};
+
+struct GraphNode {
+  std::string name;
+  // application.process.id, 0 when the client did not set it
+  uint32_t pid;
+  bool isApp;
+  bool isDevice;
+  std::vector<std::pair<uint32_t, std::string>> props;
+
+  GraphNode() : pid(0), isApp(false), isDevice(false) {}
+
+  // Returns null when the node does not have the property.
+  const std::string *Prop(uint32_t key) const;
+};
+
+// One (output node -> input node) pair, however many port links connect it.
+struct AudioLinkInfo {
+  uint32_t inputId;
+  uint32_t outputId;
+  std::string inputName;
+  std::string outputName;
+  uint32_t inputPid;
+  uint32_t outputPid;
+  bool inputIsApp;
+  bool outputIsApp;
+};
+
+struct SpeakerStreamInfo {
+  std::string processName;
+  std::string deviceName;
+  // application.process.id of the stream, 0 when unknown
+  uint32_t pid;
+};
+
+// Nodes and node-to-node links of the PipeWire graph, maintained from
+// registry add/remove events. Queries copy out under the lock and never
+// touch PipeWire.
+class PipeWireGraphIndex {
+public:
+  PipeWireGraphIndex() : generation_(0), wakes_(0) {}
+
+  void UpdateNode(uint32_t id, const GraphProp *props, size_t count);
+  void AddLink(uint32_t id, uint32_t outputNode, uint32_t inputNode);
+  // Removes the node or link with this registry id, whichever it is.
+  void Remove(uint32_t id);
+  void Clear();
+
+  // Bumped on every change, so callers can tell whether to re-query.
+  uint64_t Generation();
+  // Blocks until the generation differs from `seen`, Wake() is called or
+  // `timeoutMs` passes; returns the current generation.
+  uint64_t WaitForChange(uint64_t seen, int timeoutMs);
+  void Wake();
+
+  std::vector<AudioLinkInfo> Links();
+  std::vector<std::string> MicrophoneProcesses();
+  // Recording streams by application.process.id, with the node name to
+  // fall back on
+  std::vector<SessionProcess> MicrophoneSessions();
+  std::vector<std::string> InputAudioProcesses();
+  std::vector<SpeakerStreamInfo> SpeakerStreams();
+
+private:
+  // Caller holds mutex_.
+  void Changed();
+
+  static uint64_t PairKey(uint32_t inputNode, uint32_t outputNode) {
+    return (uint64_t(inputNode) << 32) | outputNode;
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<uint32_t, GraphNode> nodes_;
+  // Link id -> pair key, and pair key -> number of port links.
+  std::unordered_map<uint32_t, uint64_t> links_;
+  std::unordered_map<uint64_t, uint32_t> pairs_;
+  uint64_t generation_;
+  uint64_t wakes_;
+  std::condition_variable changed_;
+};
+
+// Process-wide connection that feeds a PipeWireGraphIndex. It is started by
+// the first query and then kept up to date by the daemon's events.
+class PipeWireGraph : private PipeWireConnection {
+public:
+  static PipeWireGraph &Shared();
+
+  // Connects on first use and waits for the initial registry replay.
+  bool EnsureStarted(std::string *error);
+  PipeWireGraphIndex &Index() { return index_; }
+
+  // Disconnects and serves whatever is put into Index() instead, for
+  // benchmarks on machines without PipeWire. false clears the index and
+  // connects again on the next query.
+  void UseSynthetic(bool synthetic);
+
+private:
+  PipeWireGraph() : synthetic_(false) {}
+  ~PipeWireGraph();
+
+  void OnGlobal(uint32_t id, const char *type,
+                const struct spa_dict *props) override;
+  void OnGlobalRemove(uint32_t id) override;
+  void OnConnectionLost(int res, const char *message) override;
+  void OnDisconnect() override;
+
+  std::mutex startMutex_;
+  PipeWireGraphIndex index_;
+  bool synthetic_;
+};
@@ -0,0 +1,187 @@
+#include <cstring>
+
+#ifdef HAVE_PIPEWIRE
+#include <pipewire/pipewire.h>
+#endif
+
+#include "PipeWireMonitor.h"
+#include "../common/NativeStats.h"
+
+struct PipeWireMicMonitor::SourceNode {
+  PipeWireMicMonitor *owner;
+  uint32_t id;
+  std::string name;
+#ifdef HAVE_PIPEWIRE
+  struct pw_proxy *proxy;
+  struct spa_hook listener;
+#endif
+  bool running;
+
+  void SetRunning(bool value) {
+    bool changed = value != running;
+    running = value;
+    if (changed && owner->sourceCallback_ && owner->IsSynced()) {
+      owner->sourceCallback_(id, name, running);
+    }
+    owner->Report();
+  }
+};
+
+#ifdef HAVE_PIPEWIRE
+
+static bool IsSourceClass(const char *mediaClass) {
+  return mediaClass != nullptr && strncmp(mediaClass, "Audio/Source", 12) == 0;
+}
+
+static void OnNodeInfo(void *data, const struct pw_node_info *info) {
+  if ((info->change_mask & PW_NODE_CHANGE_MASK_STATE) == 0) {
+    return;
+  }
+
+  static_cast<PipeWireMicMonitor::SourceNode *>(data)->SetRunning(
+      info->state == PW_NODE_STATE_RUNNING);
+}
+
+static const struct pw_node_events &NodeEvents() {
+  static struct pw_node_events events;
+  events.version = PW_VERSION_NODE_EVENTS;
+  events.info = OnNodeInfo;
+  return events;
+}
+
+#endif
+
+PipeWireMicMonitor::PipeWireMicMonitor()
+    : hasReported_(false), lastReported_(false) {}
+
+PipeWireMicMonitor::~PipeWireMicMonitor() { Stop(); }
+
+void PipeWireMicMonitor::SetSourceCallback(MicSourceCallback callback) {
+  sourceCallback_ = std::move(callback);
+}
+
+bool PipeWireMicMonitor::Start(MicStateCallback callback, std::string *error) {
+  callback_ = std::move(callback);
+  hasReported_ = false;
+  return PipeWireConnection::Start("mic-monitor", error);
+}
+
+void PipeWireMicMonitor::Stop() { PipeWireConnection::Stop(); }
+
+#ifdef HAVE_PIPEWIRE
+
+void PipeWireMicMonitor::OnGlobal(uint32_t id, const char *type,
+                                  const struct spa_dict *props) {
+  if (strcmp(type, PW_TYPE_INTERFACE_Node) != 0 || props == nullptr ||
+      !IsSourceClass(spa_dict_lookup(props, PW_KEY_MEDIA_CLASS))) {
+    return;
+  }
+
+  auto proxy = static_cast<struct pw_proxy *>(
+      pw_registry_bind(Registry(), id, type, PW_VERSION_NODE, 0));
+  if (proxy == nullptr) {
+    return;
+  }
+
+  // Device events carry the human readable description when there is one
+  const char *name = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+  if (name == nullptr) {
+    name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+  }
+
+  std::unique_ptr<SourceNode> node(new SourceNode());
+  node->owner = this;
+  node->id = id;
+  node->name = name != nullptr ? name : "";
+  node->proxy = proxy;
+  node->running = false;
+  spa_zero(node->listener);
+  pw_proxy_add_object_listener(proxy, &node->listener, &NodeEvents(),
+                               node.get());
+  sources_[id] = std::move(node);
+}
+
+void PipeWireMicMonitor::OnGlobalRemove(uint32_t id) {
+  auto it = sources_.find(id);
+  if (it == sources_.end()) {
+    return;
+  }
+
+  spa_hook_remove(&it->second->listener);
+  pw_proxy_destroy(it->second->proxy);
+  if (it->second->running && sourceCallback_ && IsSynced()) {
+    sourceCallback_(id, it->second->name, false);
+  }
+  sources_.erase(it);
+  Report();
+}
+
+#else
+
+// Never called: the connection cannot start without libpipewire
+void PipeWireMicMonitor::OnGlobal(uint32_t id, const char *type,
+                                  const struct spa_dict *props) {}
+
+void PipeWireMicMonitor::OnGlobalRemove(uint32_t id) {}
+
+#endif
+
+void PipeWireMicMonitor::OnSynced() {
+  if (sourceCallback_) {
+    for (const auto &item : sources_) {
+      if (item.second->running) {
+        sourceCallback_(item.first, item.second->name, true);
+      }
+    }
+  }
+  Report();
+}
+
+void PipeWireMicMonitor::OnConnectionLost(int res, const char *message) {
+  MicMonitorError error{res, std::string("PipeWire connection lost: ") +
+                                 message};
+  callback_(false, &error);
+  ReportInfo("Waiting to restart monitoring...");
+}
+
+void PipeWireMicMonitor::OnReconnected() {
+  NativeStatsCount("micMonitor.restarts");
+  ReportInfo("✅ Restarting monitoring");
+}
+
+void PipeWireMicMonitor::OnDisconnect() {
+#ifdef HAVE_PIPEWIRE
+  for (auto &item : sources_) {
+    spa_hook_remove(&item.second->listener);
+    pw_proxy_destroy(item.second->proxy);
+  }
+#endif
+  sources_.clear();
+}
+
+void PipeWireMicMonitor::Report() {
+  // Node info arriving during the initial replay is folded into one report.
+  if (!IsSynced()) {
+    return;
+  }
+
+  bool active = false;
+  for (const auto &item : sources_) {
+    if (item.second->running) {
+      active = true;
+      break;
+    }
+  }
+
+  if (hasReported_ && active == lastReported_) {
+    return;
+  }
+  hasReported_ = true;
+  lastReported_ = active;
+  callback_(active, nullptr);
+}
+
+void PipeWireMicMonitor::ReportInfo(const char *message) {
+  MicMonitorError info{MIC_MONITOR_INFO_ERROR_CODE, message};
+  callback_(false, &info);
+}
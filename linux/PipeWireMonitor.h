@@ -0,0 +1,61 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "PipeWireConnection.h"
+
+// Same values as INFO_ERROR_CODE / errorDomain in macOS/MicrophoneUsageMonitor
+static const int MIC_MONITOR_INFO_ERROR_CODE = 1;
+static const char MIC_MONITOR_ERROR_DOMAIN[] = "com.MicrophoneUsageMonitor";
+
+struct MicMonitorError {
+  int code;
+  std::string message;
+};
+
+// Called on the PipeWire loop thread. `error` is null for plain state
+// changes; informational messages use MIC_MONITOR_INFO_ERROR_CODE.
+typedef std::function<void(bool microphoneActive, const MicMonitorError *error)>
+    MicStateCallback;
+
+// Called on the loop thread when a single Audio/Source node starts or stops
+// running, once the initial state is known.
+typedef std::function<void(uint32_t node, const std::string &name, bool running)>
+    MicSourceCallback;
+
+// Watches PipeWire for running Audio/Source nodes. It subscribes to registry
+// and node-info events on its own pw_thread_loop, so it costs nothing while
+// the graph is idle, and only reports when the aggregate state changes.
+class PipeWireMicMonitor : private PipeWireConnection {
+public:
+  PipeWireMicMonitor();
+  ~PipeWireMicMonitor();
+
+  // Optional; must be set before Start().
+  void SetSourceCallback(MicSourceCallback callback);
+  bool Start(MicStateCallback callback, std::string *error);
+  void Stop();
+
+  struct SourceNode;
+
+private:
+  void OnGlobal(uint32_t id, const char *type,
+                const struct spa_dict *props) override;
+  void OnGlobalRemove(uint32_t id) override;
+  void OnSynced() override;
+  void OnConnectionLost(int res, const char *message) override;
+  void OnReconnected() override;
+  void OnDisconnect() override;
+
+  void Report();
+  void ReportInfo(const char *message);
+
+  // Only nodes whose media.class starts with Audio/Source are bound.
+  std::unordered_map<uint32_t, std::unique_ptr<SourceNode>> sources_;
+  MicStateCallback callback_;
+  MicSourceCallback sourceCallback_;
+  bool hasReported_;
+  bool lastReported_;
+};
@@ -0,0 +1,610 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "ProcessUtils.h"
+#include "../common/ProcessPathCache.h"
+#include "../common/ProcessTree.h"
+
+// Layout of the records returned by getdents64(2). glibc only exposes this
+// syscall through readdir(), which copies every entry into its own buffer.
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+static const size_t DIRENT_BUFFER_SIZE = 32 * 1024;
+static const char DELETED_SUFFIX[] = " (deleted)";
+
+// The procfs tree that is scanned; benchmarks point it at a synthetic copy.
+// Descriptors of earlier roots stay open, since a watcher thread may still
+// be using one.
+static std::mutex procRootMutex;
+static std::string procRoot = "/proc";
+static int procRootFd = -1;
+
+void SetProcRoot(const std::string &path) {
+  std::lock_guard<std::mutex> lock(procRootMutex);
+  procRoot = path.empty() ? "/proc" : path;
+  procRootFd = -1;
+}
+
+// A fresh descriptor, for scans that move its directory offset.
+static int OpenProcRoot() {
+  std::lock_guard<std::mutex> lock(procRootMutex);
+  return open(procRoot.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+// A descriptor kept open for lookups of single processes.
+static int SharedProcRoot() {
+  std::lock_guard<std::mutex> lock(procRootMutex);
+  if (procRootFd < 0) {
+    procRootFd = open(procRoot.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  }
+  return procRootFd;
+}
+
+// Parses a /proc entry name as a PID, returning 0 for anything that is not
+// purely numeric (self, thread-self, sys, ...).
+static int ParsePid(const char *name) {
+  int pid = 0;
+  for (const char *p = name; *p != '\0'; ++p) {
+    if (*p < '0' || *p > '9') {
+      return 0;
+    }
+    pid = pid * 10 + (*p - '0');
+  }
+  return pid;
+}
+
+// Writes "<pid>/<leaf>" into buf without going through snprintf.
+static void FormatPidPath(char *buf, int pid, const char *leaf) {
+  char digits[16];
+  int n = 0;
+  do {
+    digits[n++] = char('0' + pid % 10);
+    pid /= 10;
+  } while (pid > 0);
+
+  char *out = buf;
+  while (n > 0) {
+    *out++ = digits[--n];
+  }
+  *out++ = '/';
+  while (*leaf != '\0') {
+    *out++ = *leaf++;
+  }
+  *out = '\0';
+}
+
+// Calls fn(pid) for every process directory in /proc, reading the directory
+// in large batches. Returns false if /proc could not be read at all.
+template <typename F> static bool ForEachPid(int procFd, F &&fn) {
+  alignas(LinuxDirent64) char buffer[DIRENT_BUFFER_SIZE];
+
+  for (;;) {
+    long nread = syscall(SYS_getdents64, procFd, buffer, sizeof(buffer));
+    if (nread < 0) {
+      return false;
+    }
+    if (nread == 0) {
+      return true;
+    }
+
+    for (long offset = 0; offset < nread;) {
+      auto entry = reinterpret_cast<LinuxDirent64 *>(buffer + offset);
+      offset += entry->d_reclen;
+
+      if (entry->d_type != DT_DIR) {
+        continue;
+      }
+      int pid = ParsePid(entry->d_name);
+      if (pid > 0) {
+        fn(pid);
+      }
+    }
+  }
+}
+
+// Resolves /proc/<pid>/exe into buf, returning the path length or 0 when the
+// link cannot be read.
+static size_t ReadExePath(int procFd, int pid, char *buf, size_t size) {
+  char linkPath[32];
+  FormatPidPath(linkPath, pid, "exe");
+
+  // Processes owned by other users fail with EACCES, matching proc_pidpath
+  // on macOS.
+  ssize_t len = readlinkat(procFd, linkPath, buf, size);
+  if (len <= 0 || size_t(len) >= size) {
+    return 0;
+  }
+
+  // The kernel appends " (deleted)" when the binary was replaced on disk.
+  const size_t suffixLen = sizeof(DELETED_SUFFIX) - 1;
+  if (size_t(len) > suffixLen &&
+      memcmp(buf + len - suffixLen, DELETED_SUFFIX, suffixLen) == 0) {
+    len -= suffixLen;
+  }
+
+  return size_t(len);
+}
+
+// PF_KTHREAD from include/linux/sched.h
+static const unsigned long KERNEL_THREAD_FLAG = 0x00200000;
+
+// The fields of /proc/<pid>/stat used by the scanner. startTime (clock ticks
+// since boot) together with the PID identifies a process across PID reuse.
+struct ProcStat {
+  int ppid;
+  unsigned long flags;
+  // Clock ticks
+  uint64_t userTime;
+  uint64_t systemTime;
+  uint64_t startTime;
+  // Pages
+  uint64_t rss;
+  // TASK_COMM_LEN is 16
+  char comm[16];
+};
+
+static bool ReadProcStat(int procFd, int pid, ProcStat *stat) {
+  char statPath[32];
+  FormatPidPath(statPath, pid, "stat");
+
+  int fd = openat(procFd, statPath, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  char buf[1024];
+  ssize_t len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (len <= 0) {
+    return false;
+  }
+  buf[len] = '\0';
+
+  // The command name may contain spaces and parentheses, so fields are
+  // counted from the last ')', which is followed by field 3 (state).
+  const char *p = strrchr(buf, ')');
+  const char *name = strchr(buf, '(');
+  if (p == nullptr || name == nullptr || name > p || p[1] != ' ' ||
+      p[2] == '\0') {
+    return false;
+  }
+  size_t commLen = std::min(size_t(p - name - 1), sizeof(stat->comm) - 1);
+  memcpy(stat->comm, name + 1, commLen);
+  stat->comm[commLen] = '\0';
+  p += 3;
+
+  char *end = nullptr;
+  stat->rss = 0;
+  for (int field = 4; field <= 24; field++) {
+    p = strchr(p, ' ');
+    if (p == nullptr) {
+      // Everything up to starttime is needed; rss is best effort
+      return field > 22;
+    }
+    p++;
+    uint64_t value = strtoull(p, &end, 10);
+    switch (field) {
+    case 4:
+      stat->ppid = int(value);
+      break;
+    case 9:
+      stat->flags = (unsigned long)value;
+      break;
+    case 14:
+      stat->userTime = value;
+      break;
+    case 15:
+      stat->systemTime = value;
+      break;
+    case 22:
+      stat->startTime = value;
+      break;
+    case 24:
+      stat->rss = value;
+      break;
+    }
+    p = end;
+  }
+
+  return true;
+}
+
+ProcessFilter::ProcessFilter() : hasUid_(false), uid_(0), hasName_(false) {}
+
+ProcessFilter::~ProcessFilter() {
+  if (hasName_) {
+    regfree(&name_);
+  }
+}
+
+void ProcessFilter::SetUid(uint32_t uid) {
+  hasUid_ = true;
+  uid_ = uid;
+}
+
+bool ProcessFilter::SetNamePattern(const std::string &pattern,
+                                   std::string *error) {
+  if (hasName_) {
+    regfree(&name_);
+    hasName_ = false;
+  }
+  int res = regcomp(&name_, pattern.c_str(), REG_EXTENDED | REG_NOSUB);
+  if (res != 0) {
+    char message[256];
+    regerror(res, &name_, message, sizeof(message));
+    *error = std::string("Invalid name pattern: ") + message;
+    return false;
+  }
+  hasName_ = true;
+  return true;
+}
+
+void ProcessFilter::AddExePattern(const std::string &pattern, bool exclude) {
+  bool glob = pattern.find_first_of("*?[") != std::string::npos;
+  (exclude ? excluded_ : included_).push_back(ExePattern{pattern, glob});
+}
+
+void ProcessFilter::AddSubtreeRoot(uint32_t pid) {
+  subtreeRoots_.push_back(pid);
+}
+
+bool ProcessFilter::MatchesOwner(uint32_t uid) const {
+  return !hasUid_ || uid == uid_;
+}
+
+bool ProcessFilter::MatchesName(const char *comm) const {
+  return !hasName_ || regexec(&name_, comm, 0, nullptr, 0) == 0;
+}
+
+bool ProcessFilter::Matches(const ExePattern &pattern,
+                            const std::string &path) {
+  if (pattern.glob) {
+    return fnmatch(pattern.pattern.c_str(), path.c_str(), 0) == 0;
+  }
+  return path.compare(0, pattern.pattern.size(), pattern.pattern) == 0;
+}
+
+bool ProcessFilter::MatchesPath(const std::string &path) const {
+  for (const ExePattern &pattern : excluded_) {
+    if (Matches(pattern, path)) {
+      return false;
+    }
+  }
+  if (included_.empty()) {
+    return true;
+  }
+  for (const ExePattern &pattern : included_) {
+    if (Matches(pattern, path)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Marks the processes under the filter's subtree roots, given every
+// (ppid, pid) pair of the scan sorted by ppid.
+static std::vector<uint32_t>
+SubtreePids(const ProcessFilter &filter,
+            const std::vector<std::pair<uint32_t, uint32_t>> &children) {
+  std::vector<uint32_t> pids(filter.subtreeRoots());
+  for (size_t i = 0; i < pids.size(); i++) {
+    auto range = std::equal_range(
+        children.begin(), children.end(), std::make_pair(pids[i], uint32_t(0)),
+        [](const std::pair<uint32_t, uint32_t> &a,
+           const std::pair<uint32_t, uint32_t> &b) { return a.first < b.first; });
+    for (auto it = range.first; it != range.second; ++it) {
+      pids.push_back(it->second);
+    }
+  }
+  std::sort(pids.begin(), pids.end());
+  return pids;
+}
+
+// A process that passed the checks made before its path is resolved
+struct ScanCandidate {
+  ProcessKey key;
+  ProcStat stat;
+  uint32_t uid;
+};
+
+// Owner of /proc/<pid>, or false when the process is gone
+static bool ReadProcOwner(int procFd, int pid, uint32_t *uid) {
+  char dirPath[32];
+  FormatPidPath(dirPath, pid, "");
+  struct stat owner;
+  if (fstatat(procFd, dirPath, &owner, 0) != 0) {
+    return false;
+  }
+  *uid = uint32_t(owner.st_uid);
+  return true;
+}
+
+// Reads the stat of every user process into `candidates`, keeping only
+// those that pass the name, owner and subtree checks of `filter` when it is
+// set. `live` gets every process for trimming the path cache.
+static void CollectProcesses(int procFd, const ProcessFilter *filter,
+                             bool needUid, std::vector<ProcessKey> &live,
+                             std::vector<ScanCandidate> &candidates) {
+  // Only the subtree test has to wait for the whole scan, as a parent may be
+  // listed after its children.
+  std::vector<std::pair<uint32_t, uint32_t>> children;
+  bool subtree = filter != nullptr && !filter->subtreeRoots().empty();
+  needUid = needUid || (filter != nullptr && filter->hasUid());
+
+  ForEachPid(procFd, [&](int pid) {
+    ScanCandidate candidate;
+    if (!ReadProcStat(procFd, pid, &candidate.stat) ||
+        (candidate.stat.flags & KERNEL_THREAD_FLAG) != 0) {
+      return;
+    }
+
+    candidate.key = ProcessKey{uint32_t(pid), candidate.stat.startTime};
+    candidate.uid = 0;
+    live.push_back(candidate.key);
+    if (subtree) {
+      children.emplace_back(uint32_t(candidate.stat.ppid), uint32_t(pid));
+    }
+    if (filter != nullptr && !filter->MatchesName(candidate.stat.comm)) {
+      return;
+    }
+    if (needUid && (!ReadProcOwner(procFd, pid, &candidate.uid) ||
+                    (filter != nullptr && !filter->MatchesOwner(candidate.uid)))) {
+      return;
+    }
+    candidates.push_back(candidate);
+  });
+
+  if (subtree) {
+    std::sort(children.begin(), children.end());
+    std::vector<uint32_t> pids = SubtreePids(*filter, children);
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                    [&](const ScanCandidate &candidate) {
+                                      return !std::binary_search(
+                                          pids.begin(), pids.end(),
+                                          candidate.key.pid);
+                                    }),
+                     candidates.end());
+  }
+}
+
+// The executable path through the shared cache; false when it cannot be read.
+// `comm` changes on exec(), which keeps the key, so the path is read again.
+static bool LookupExePath(int procFd, const ProcessKey &key, const char *comm,
+                          CachedProcessInfo &info) {
+  return ProcessPathCache::Shared().Lookup(key, comm, [&](std::string &path) {
+    char pathbuf[4096];
+    size_t len = ReadExePath(procFd, int(key.pid), pathbuf, sizeof(pathbuf));
+    path.assign(pathbuf, len);
+    return len > 0;
+  }, info);
+}
+
+// Remember the size of the last scan so results are allocated once.
+static std::atomic<size_t> lastScanCount(256);
+
+static void FinishScan(int procFd, const std::vector<ProcessKey> &live) {
+  close(procFd);
+  // Anything not seen in this pass has exited.
+  ProcessPathCache::Shared().Retain(live);
+  lastScanCount.store(live.size() + live.size() / 8, std::memory_order_relaxed);
+}
+
+// Lists the user processes in /proc whose executable path could be read,
+// keeping only those that pass `filter` when it is set. The path cache is
+// trimmed to the live processes either way; unfiltered scans also refresh
+// the process tree.
+static std::vector<ProcessEntry> ScanProcesses(const ProcessFilter *filter) {
+  std::vector<ProcessEntry> entries;
+  std::vector<ProcessKey> live;
+  std::vector<ScanCandidate> candidates;
+  live.reserve(lastScanCount.load(std::memory_order_relaxed));
+  candidates.reserve(filter == nullptr ? live.capacity() : 0);
+
+  int procFd = OpenProcRoot();
+  if (procFd < 0) {
+    return entries;
+  }
+
+  CollectProcesses(procFd, filter, false, live, candidates);
+
+  entries.reserve(candidates.size());
+  CachedProcessInfo info;
+  for (const ScanCandidate &candidate : candidates) {
+    if (LookupExePath(procFd, candidate.key, candidate.stat.comm, info) &&
+        (filter == nullptr || filter->MatchesPath(info.path))) {
+      entries.push_back(ProcessEntry{candidate.key.pid, candidate.key.startTime,
+                                     info.path, uint32_t(candidate.stat.ppid)});
+    }
+  }
+
+  FinishScan(procFd, live);
+  if (filter == nullptr) {
+    ProcessTree::Shared().Update(entries);
+  }
+  return entries;
+}
+
+// Boot time in seconds since the epoch, from the btime line of /proc/stat;
+// 0 when it is missing (synthetic trees), leaving start times relative to
+// boot.
+static uint64_t ReadBootTime(int procFd) {
+  int fd = openat(procFd, "stat", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return 0;
+  }
+  std::string content;
+  char buf[4096];
+  ssize_t len;
+  while ((len = read(fd, buf, sizeof(buf))) > 0) {
+    content.append(buf, size_t(len));
+  }
+  close(fd);
+
+  size_t line = content.find("\nbtime ");
+  return line == std::string::npos
+             ? 0
+             : strtoull(content.c_str() + line + sizeof("\nbtime ") - 1, nullptr, 10);
+}
+
+// /proc/<pid>/cmdline with the arguments separated by NUL and the final NUL
+// dropped; empty for zombies and kernel threads.
+static void ReadCmdline(int procFd, int pid, std::string &cmdline) {
+  // Limits what a process with a huge argument list costs the scan
+  static const size_t MAX_CMDLINE = 128 * 1024;
+  char path[32];
+  FormatPidPath(path, pid, "cmdline");
+
+  cmdline.clear();
+  int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  char buf[4096];
+  ssize_t len;
+  while (cmdline.size() < MAX_CMDLINE &&
+         (len = read(fd, buf, sizeof(buf))) > 0) {
+    cmdline.append(buf, size_t(len));
+  }
+  close(fd);
+  if (!cmdline.empty() && cmdline.back() == '\0') {
+    cmdline.pop_back();
+  }
+}
+
+ProcessRecords GetProcessRecords(uint32_t fields, const ProcessFilter *filter) {
+  ProcessRecords records;
+  records.fields = fields | PROCESS_FIELD_PID;
+  std::vector<ProcessKey> live;
+  std::vector<ScanCandidate> candidates;
+  live.reserve(lastScanCount.load(std::memory_order_relaxed));
+
+  int procFd = OpenProcRoot();
+  if (procFd < 0) {
+    return records;
+  }
+
+  CollectProcesses(procFd, filter, (fields & PROCESS_FIELD_UID) != 0, live,
+                   candidates);
+
+  static const double TICKS_PER_SECOND = double(sysconf(_SC_CLK_TCK));
+  static const double PAGE_BYTES = double(sysconf(_SC_PAGESIZE));
+  double bootTimeMs = 0;
+  if ((fields & PROCESS_FIELD_START_TIME) != 0) {
+    bootTimeMs = double(ReadBootTime(procFd)) * 1000;
+  }
+  bool needExe = (fields & PROCESS_FIELD_EXE) != 0 ||
+                 (filter != nullptr && filter->hasExePatterns());
+
+  records.pid.reserve(candidates.size());
+  CachedProcessInfo info;
+  std::string cmdline;
+  for (const ScanCandidate &candidate : candidates) {
+    const ProcStat &stat = candidate.stat;
+    if (needExe) {
+      // Unlike getRunningProcesses, processes of other users stay in with
+      // an empty path, unless exe patterns have to be matched.
+      if (!LookupExePath(procFd, candidate.key, candidate.stat.comm, info)) {
+        info.path.clear();
+      }
+      if (filter != nullptr && filter->hasExePatterns() &&
+          !filter->MatchesPath(info.path)) {
+        continue;
+      }
+    }
+
+    records.pid.push_back(candidate.key.pid);
+    if ((fields & PROCESS_FIELD_PPID) != 0) {
+      records.ppid.push_back(uint32_t(stat.ppid));
+    }
+    if ((fields & PROCESS_FIELD_UID) != 0) {
+      records.uid.push_back(candidate.uid);
+    }
+    if ((fields & PROCESS_FIELD_START_TIME) != 0) {
+      records.startTimeMs.push_back(
+          bootTimeMs + double(stat.startTime) * 1000 / TICKS_PER_SECOND);
+    }
+    if ((fields & PROCESS_FIELD_RSS) != 0) {
+      records.rssBytes.push_back(double(stat.rss) * PAGE_BYTES);
+    }
+    if ((fields & PROCESS_FIELD_CPU_TIME) != 0) {
+      records.cpuTimeMs.push_back(double(stat.userTime + stat.systemTime) *
+                                  1000 / TICKS_PER_SECOND);
+    }
+    if ((fields & PROCESS_FIELD_EXE) != 0) {
+      records.exe.push_back(info.path);
+    }
+    if ((fields & PROCESS_FIELD_CMDLINE) != 0) {
+      ReadCmdline(procFd, int(candidate.key.pid), cmdline);
+      records.cmdline.push_back(cmdline);
+    }
+  }
+
+  FinishScan(procFd, live);
+  return records;
+}
+
+std::vector<ProcessEntry> GetRunningProcessEntries() {
+  return ScanProcesses(nullptr);
+}
+
+bool ResolveProcess(uint32_t pid, bool execed, ProcessEntry *entry, uint32_t *ppid) {
+  int procFd = SharedProcRoot();
+  ProcStat stat;
+  if (procFd < 0 || !ReadProcStat(procFd, int(pid), &stat) ||
+      (stat.flags & KERNEL_THREAD_FLAG) != 0) {
+    return false;
+  }
+
+  ProcessKey key{pid, stat.startTime};
+  auto &cache = ProcessPathCache::Shared();
+  if (execed) {
+    cache.Forget(key);
+  }
+  CachedProcessInfo info;
+  LookupExePath(procFd, key, stat.comm, info);
+
+  entry->pid = pid;
+  entry->startTime = stat.startTime;
+  entry->path = info.path;
+  entry->ppid = uint32_t(stat.ppid);
+  if (ppid != nullptr) {
+    *ppid = uint32_t(stat.ppid);
+  }
+  return true;
+}
+
+static std::vector<std::string> EntryPaths(std::vector<ProcessEntry> &&entries) {
+  std::vector<std::string> processes;
+  processes.reserve(entries.size());
+  for (auto &entry : entries) {
+    processes.push_back(std::move(entry.path));
+  }
+
+  return processes;
+}
+
+std::vector<std::string> GetRunningProcesses() {
+  return EntryPaths(ScanProcesses(nullptr));
+}
+
+std::vector<std::string> GetMatchingProcesses(const ProcessFilter &filter) {
+  return EntryPaths(ScanProcesses(&filter));
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <regex.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../common/ProcessSnapshot.h"
+
+// Criteria for GetMatchingProcesses(); a process must meet all that are set.
+// Everything except the executable patterns is decided from /proc/<pid>/stat
+// and the directory owner, so rejected processes never have their path
+// resolved.
+class ProcessFilter {
+public:
+  ProcessFilter();
+  ~ProcessFilter();
+  ProcessFilter(const ProcessFilter &) = delete;
+  ProcessFilter &operator=(const ProcessFilter &) = delete;
+
+  // Owner of /proc/<pid>, i.e. the effective uid
+  void SetUid(uint32_t uid);
+  // POSIX extended regex, searched in the kernel's command name (comm, at
+  // most 15 bytes, as shown by `ps -o comm`)
+  bool SetNamePattern(const std::string &pattern, std::string *error);
+  // Patterns containing * ? or [ are fnmatch(3) globs in which * also
+  // matches '/'; anything else is a path prefix. The path has to match one
+  // of the included patterns, if any, and none of the excluded ones.
+  void AddExePattern(const std::string &pattern, bool exclude);
+  // Keeps `pid` and all of its descendants
+  void AddSubtreeRoot(uint32_t pid);
+
+  bool MatchesOwner(uint32_t uid) const;
+  bool MatchesName(const char *comm) const;
+  bool MatchesPath(const std::string &path) const;
+
+  bool hasUid() const { return hasUid_; }
+  bool hasExePatterns() const { return !included_.empty() || !excluded_.empty(); }
+  const std::vector<uint32_t> &subtreeRoots() const { return subtreeRoots_; }
+
+private:
+  struct ExePattern {
+    std::string pattern;
+    bool glob;
+  };
+  static bool Matches(const ExePattern &pattern, const std::string &path);
+
+  bool hasUid_;
+  uint32_t uid_;
+  bool hasName_;
+  regex_t name_;
+  std::vector<ExePattern> included_;
+  std::vector<ExePattern> excluded_;
+  std::vector<uint32_t> subtreeRoots_;
+};
+
+// Columns of ProcessRecords. /proc/<pid>/stat is read for every process
+// anyway; the other sources are only touched when their field is asked for:
+// the exe link (through the path cache), cmdline, and the owner of
+// /proc/<pid>.
+enum ProcessField : uint32_t {
+  PROCESS_FIELD_PID = 1 << 0,
+  PROCESS_FIELD_PPID = 1 << 1,
+  PROCESS_FIELD_EXE = 1 << 2,
+  PROCESS_FIELD_CMDLINE = 1 << 3,
+  PROCESS_FIELD_UID = 1 << 4,
+  PROCESS_FIELD_START_TIME = 1 << 5,
+  PROCESS_FIELD_RSS = 1 << 6,
+  PROCESS_FIELD_CPU_TIME = 1 << 7,
+};
+
+// One scan as columns. pid is always filled; every other column is empty
+// unless its bit is in `fields`, and then has one value per pid.
+struct ProcessRecords {
+  uint32_t fields;
+  std::vector<uint32_t> pid;
+  std::vector<uint32_t> ppid;
+  std::vector<uint32_t> uid;
+  // Milliseconds since the epoch
+  std::vector<double> startTimeMs;
+  std::vector<double> rssBytes;
+  // User plus system time
+  std::vector<double> cpuTimeMs;
+  std::vector<std::string> exe;
+  // Arguments separated by NUL
+  std::vector<std::string> cmdline;
+
+  ProcessRecords() : fields(0) {}
+};
+
+std::vector<std::string> GetRunningProcesses();
+std::vector<std::string> GetMatchingProcesses(const ProcessFilter &filter);
+// All user processes, including those whose executable cannot be read
+// (other users' processes; their exe is empty). `filter` may be null.
+ProcessRecords GetProcessRecords(uint32_t fields, const ProcessFilter *filter);
+std::vector<ProcessEntry> GetRunningProcessEntries();
+
+// Looks up one process through the shared path cache. Works for zombies as
+// long as the path was cached while the process was alive; `execed` drops
+// the cached path first, since exec() keeps the PID and start time. Returns
+// false when the process is gone or is a kernel thread.
+bool ResolveProcess(uint32_t pid, bool execed, ProcessEntry *entry, uint32_t *ppid);
+
+// Scans `path` instead of /proc (empty restores it). For benchmarks that
+// generate a synthetic process tree.
+void SetProcRoot(const std::string &path);
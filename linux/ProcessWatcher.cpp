@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "ProcessUtils.h"
+#include "ProcessWatcher.h"
+
+// Events are handed over after each drained burst, or sooner when a burst
+// (a build running thousands of compilers) gets this large.
+static const size_t MAX_BATCH = 512;
+static const int CONNECTOR_RCVBUF = 4 * 1024 * 1024;
+
+// Bounds of the /proc fallback interval. It halves after a scan that saw
+// changes and grows by half after one that did not.
+static const int MIN_SCAN_INTERVAL_MS = 100;
+static const int MAX_SCAN_INTERVAL_MS = 2000;
+static const int INITIAL_SCAN_INTERVAL_MS = 500;
+
+const char *ProcessWatcherModeName(ProcessWatcher::Mode mode) {
+  switch (mode) {
+  case ProcessWatcher::NETLINK:
+    return "netlink";
+  case ProcessWatcher::PROC_DIFF:
+    return "procfs";
+  default:
+    return "none";
+  }
+}
+
+ProcessWatcher::ProcessWatcher() : mode_(NONE), socket_(-1), stopFd_(-1) {}
+
+ProcessWatcher::~ProcessWatcher() { Stop(); }
+
+// Subscribes to the proc connector; returns the socket or -errno. Binding to
+// the CN_IDX_PROC group is what needs CAP_NET_ADMIN.
+int ProcessWatcher::OpenConnector() {
+  int sock = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+  if (sock < 0) {
+    return -errno;
+  }
+
+  struct sockaddr_nl addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = CN_IDX_PROC;
+  if (bind(sock, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+    int err = errno;
+    close(sock);
+    return -err;
+  }
+
+  // A larger buffer makes ENOBUFS under exec storms less likely; FORCE is
+  // allowed since we have CAP_NET_ADMIN at this point.
+  int size = CONNECTOR_RCVBUF;
+  if (setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) != 0) {
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  }
+
+  alignas(struct nlmsghdr) char buffer[NLMSG_SPACE(sizeof(struct cn_msg) +
+                                                   sizeof(enum proc_cn_mcast_op))];
+  memset(buffer, 0, sizeof(buffer));
+  auto header = reinterpret_cast<struct nlmsghdr *>(buffer);
+  header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+  header->nlmsg_type = NLMSG_DONE;
+  header->nlmsg_pid = uint32_t(getpid());
+
+  auto message = static_cast<struct cn_msg *>(NLMSG_DATA(header));
+  message->id.idx = CN_IDX_PROC;
+  message->id.val = CN_VAL_PROC;
+  message->len = sizeof(enum proc_cn_mcast_op);
+  enum proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+  memcpy(message->data, &op, sizeof(op));
+
+  if (send(sock, header, header->nlmsg_len, 0) < 0) {
+    int err = errno;
+    close(sock);
+    return -err;
+  }
+  return sock;
+}
+
+bool ProcessWatcher::Start(ProcessEventCallback callback, bool allowNetlink,
+                           std::string *error) {
+  if (thread_.joinable()) {
+    *error = "Process watcher already running";
+    return false;
+  }
+
+  stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stopFd_ < 0) {
+    *error = std::string("eventfd failed: ") + strerror(errno);
+    return false;
+  }
+  callback_ = std::move(callback);
+
+  socket_ = allowNetlink ? OpenConnector() : -1;
+  if (socket_ >= 0) {
+    mode_ = NETLINK;
+    thread_ = std::thread(&ProcessWatcher::RunNetlink, this);
+  } else {
+    socket_ = -1;
+    mode_ = PROC_DIFF;
+    thread_ = std::thread(&ProcessWatcher::RunProcDiff, this);
+  }
+  return true;
+}
+
+void ProcessWatcher::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+
+  uint64_t one = 1;
+  ssize_t written = write(stopFd_, &one, sizeof(one));
+  (void)written;
+  thread_.join();
+
+  if (socket_ >= 0) {
+    close(socket_);
+    socket_ = -1;
+  }
+  close(stopFd_);
+  stopFd_ = -1;
+  mode_ = NONE;
+}
+
+bool ProcessWatcher::WaitForStop(int ms) {
+  struct pollfd fd = {stopFd_, POLLIN, 0};
+  int ready;
+  do {
+    ready = poll(&fd, 1, ms);
+  } while (ready < 0 && errno == EINTR);
+  return ready == 0;
+}
+
+void ProcessWatcher::Deliver(std::vector<ProcessEvent> &events) {
+  if (events.empty()) {
+    return;
+  }
+  stats_.events.fetch_add(events.size(), std::memory_order_relaxed);
+  stats_.batches.fetch_add(1, std::memory_order_relaxed);
+  callback_(std::move(events));
+  events.clear();
+}
+
+// Processes seen exec'ing, so their exit can be reported with a path even
+// when they are reaped before /proc could be read.
+typedef std::unordered_map<uint32_t, ProcessEvent> ExecedProcesses;
+
+static ProcessEvent ExecEvent(uint32_t pid, ExecedProcesses *execed) {
+  ProcessEntry entry;
+  uint32_t ppid = 0;
+  ProcessEvent event{ProcessEvent::EXEC, pid, 0, std::string()};
+  if (ResolveProcess(pid, true, &entry, &ppid)) {
+    event.ppid = ppid;
+    event.path = std::move(entry.path);
+  }
+  (*execed)[pid] = event;
+  return event;
+}
+
+static ProcessEvent ExitEvent(uint32_t pid, uint32_t ppid, ExecedProcesses *execed) {
+  ProcessEvent event{ProcessEvent::EXIT, pid, ppid, std::string()};
+  auto found = execed->find(pid);
+  if (found != execed->end()) {
+    event.path = std::move(found->second.path);
+    execed->erase(found);
+  } else {
+    // Started before the watcher; it is a zombie now, so the cache may know it.
+    ProcessEntry entry;
+    if (ResolveProcess(pid, false, &entry, nullptr)) {
+      event.path = std::move(entry.path);
+    }
+  }
+  return event;
+}
+
+// After lost events some exits were never seen; forget processes that are
+// gone so the map does not grow.
+static void PruneExecedProcesses(ExecedProcesses *execed) {
+  for (auto it = execed->begin(); it != execed->end();) {
+    if (kill(pid_t(it->first), 0) != 0 && errno == ESRCH) {
+      it = execed->erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ProcessWatcher::RunNetlink() {
+  alignas(struct nlmsghdr) char buffer[64 * 1024];
+  std::vector<ProcessEvent> batch;
+  ExecedProcesses execed;
+
+  for (;;) {
+    struct pollfd fds[2] = {{socket_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+
+    // Drain everything queued so one wakeup becomes one batch.
+    for (;;) {
+      ssize_t len = recv(socket_, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if (len < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == ENOBUFS) {
+          stats_.overflows.fetch_add(1, std::memory_order_relaxed);
+          PruneExecedProcesses(&execed);
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          break;
+        }
+        // The socket is unusable; keep reporting through /proc instead.
+        Deliver(batch);
+        mode_ = PROC_DIFF;
+        RunProcDiff();
+        return;
+      }
+
+      int remaining = int(len);
+      for (auto header = reinterpret_cast<struct nlmsghdr *>(buffer);
+           NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+        if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP) {
+          continue;
+        }
+        auto message = static_cast<struct cn_msg *>(NLMSG_DATA(header));
+        if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) {
+          continue;
+        }
+
+        // The payload follows a 20-byte cn_msg header and is not 8-byte
+        // aligned, so it is copied out rather than accessed in place.
+        struct proc_event event;
+        if (message->len < sizeof(event.what) + sizeof(event.cpu) +
+                               sizeof(event.timestamp_ns)) {
+          continue;
+        }
+        memset(&event, 0, sizeof(event));
+        memcpy(&event, message->data, std::min<size_t>(message->len, sizeof(event)));
+
+        if (event.what == proc_event::PROC_EVENT_EXEC) {
+          batch.push_back(ExecEvent(uint32_t(event.event_data.exec.process_tgid), &execed));
+        } else if (event.what == proc_event::PROC_EVENT_EXIT) {
+          // Threads exit too; only the thread group leader ends the process.
+          const auto &exit = event.event_data.exit;
+          if (exit.process_pid == exit.process_tgid) {
+            batch.push_back(
+                ExitEvent(uint32_t(exit.process_tgid), uint32_t(exit.parent_tgid), &execed));
+          }
+        }
+      }
+
+      if (batch.size() >= MAX_BATCH) {
+        Deliver(batch);
+      }
+    }
+
+    Deliver(batch);
+  }
+}
+
+void ProcessWatcher::RunProcDiff() {
+  typedef std::unordered_map<ProcessKey, std::string, ProcessKeyHash> Snapshot;
+
+  auto scan = [this]() {
+    Snapshot snapshot;
+    for (auto &entry : GetRunningProcessEntries()) {
+      snapshot.emplace(ProcessKey{entry.pid, entry.startTime}, std::move(entry.path));
+    }
+    stats_.scans.fetch_add(1, std::memory_order_relaxed);
+    return snapshot;
+  };
+
+  Snapshot previous = scan();
+  int interval = INITIAL_SCAN_INTERVAL_MS;
+  std::vector<ProcessEvent> batch;
+
+  while (WaitForStop(interval)) {
+    Snapshot current = scan();
+
+    for (const auto &item : current) {
+      if (previous.count(item.first) == 0) {
+        ProcessEntry entry;
+        uint32_t ppid = 0;
+        ResolveProcess(item.first.pid, false, &entry, &ppid);
+        batch.push_back(ProcessEvent{ProcessEvent::EXEC, item.first.pid, ppid, item.second});
+      }
+    }
+    for (auto &item : previous) {
+      if (current.count(item.first) == 0) {
+        batch.push_back(
+            ProcessEvent{ProcessEvent::EXIT, item.first.pid, 0, std::move(item.second)});
+      }
+    }
+
+    interval = batch.empty()
+                   ? std::min(MAX_SCAN_INTERVAL_MS, interval + interval / 2)
+                   : std::max(MIN_SCAN_INTERVAL_MS, interval / 2);
+    Deliver(batch);
+    previous = std::move(current);
+  }
+}
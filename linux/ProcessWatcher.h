@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ProcessEvent {
+  enum Type { EXEC, EXIT };
+
+  Type type;
+  uint32_t pid;
+  // 0 when it could not be determined (exec of a process that exited before
+  // it was looked up, exit reported by the /proc fallback)
+  uint32_t ppid;
+  // Empty when it could not be resolved (other user's process, or an exit
+  // of a process whose path was never cached)
+  std::string path;
+};
+
+// Called on the watcher thread with every event read in one wakeup.
+typedef std::function<void(std::vector<ProcessEvent> &&events)>
+    ProcessEventCallback;
+
+struct ProcessWatcherStats {
+  std::atomic<uint64_t> events;
+  std::atomic<uint64_t> batches;
+  // Times the kernel reported a full netlink receive buffer (ENOBUFS); the
+  // number of events lost with each is unknown.
+  std::atomic<uint64_t> overflows;
+  // /proc scans of the fallback
+  std::atomic<uint64_t> scans;
+
+  ProcessWatcherStats() : events(0), batches(0), overflows(0), scans(0) {}
+};
+
+// Reports process exec and exit. Uses the netlink proc connector, which
+// sees every process including short-lived ones but needs CAP_NET_ADMIN;
+// otherwise falls back to diffing /proc at an interval that shrinks while
+// processes come and go and grows while nothing changes.
+class ProcessWatcher {
+public:
+  enum Mode { NONE, NETLINK, PROC_DIFF };
+
+  ProcessWatcher();
+  ~ProcessWatcher();
+
+  // `allowNetlink` false forces the /proc fallback.
+  bool Start(ProcessEventCallback callback, bool allowNetlink, std::string *error);
+  void Stop();
+
+  Mode CurrentMode() const { return mode_.load(); }
+  const ProcessWatcherStats &Stats() const { return stats_; }
+
+private:
+  int OpenConnector();
+  void RunNetlink();
+  void RunProcDiff();
+  // Sleeps up to `ms`, returning false once Stop() was called.
+  bool WaitForStop(int ms);
+  void Deliver(std::vector<ProcessEvent> &events);
+
+  ProcessEventCallback callback_;
+  std::thread thread_;
+  std::atomic<Mode> mode_;
+  ProcessWatcherStats stats_;
+  int socket_;
+  int stopFd_;
+};
+
+const char *ProcessWatcherModeName(ProcessWatcher::Mode mode);
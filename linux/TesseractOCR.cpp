@@ -0,0 +1,160 @@
+#include "TesseractOCR.h"
+
+#ifdef HAVE_TESSERACT
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <leptonica/allheaders.h>
+#include <tesseract/baseapi.h>
+#include <tesseract/resultiterator.h>
+
+#include "../common/ImageKernels.h"
+
+namespace {
+
+typedef std::unique_ptr<tesseract::TessBaseAPI> TessEngine;
+
+class TesseractOCRBackend : public OCRBackend {
+public:
+  const char *Name() const override { return "tesseract"; }
+
+  OCRData Recognize(const OCRImage &image, const OCROptions &options) override;
+
+private:
+  // Engines are not thread-safe and slow to initialize, so each job borrows
+  // an idle one loaded with its languages.
+  TessEngine Acquire(const std::string &languages, std::string *error);
+  void Release(const std::string &languages, TessEngine engine);
+
+  std::mutex mutex_;
+  std::vector<std::pair<std::string, TessEngine>> idle_;
+};
+
+TessEngine TesseractOCRBackend::Acquire(const std::string &languages,
+                                        std::string *error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+      if (it->first == languages) {
+        TessEngine engine = std::move(it->second);
+        idle_.erase(it);
+        return engine;
+      }
+    }
+  }
+
+  TessEngine engine(new tesseract::TessBaseAPI());
+  // The data path comes from TESSDATA_PREFIX or the build default.
+  if (engine->Init(nullptr, languages.c_str()) != 0) {
+    *error = "Could not load Tesseract data for " + languages;
+    return TessEngine();
+  }
+  return engine;
+}
+
+void TesseractOCRBackend::Release(const std::string &languages,
+                                  TessEngine engine) {
+  engine->Clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  idle_.emplace_back(languages, std::move(engine));
+}
+
+OCRData TesseractOCRBackend::Recognize(const OCRImage &image,
+                                       const OCROptions &options) {
+  std::string languages;
+  for (const std::string &language : options.languages) {
+    languages += (languages.empty() ? "" : "+") + language;
+  }
+  if (languages.empty()) {
+    languages = "eng";
+  }
+
+  Pix *pix = nullptr;
+  std::vector<uint8_t> gray;
+  if (image.format == OCR_FORMAT_PNG) {
+    pix = pixReadMem(image.data, image.length);
+    if (pix == nullptr) {
+      return OCRData(std::string("Could not decode image"));
+    }
+  } else if (image.format == OCR_FORMAT_BGRA) {
+    // Tesseract reads 4-byte pixels as RGBA and only needs luminance, so
+    // convert here rather than swizzle. Only reached with preprocessing off.
+    const ImageKernels &kernels = ActiveImageKernels();
+    gray.resize(image.width * image.height);
+    for (size_t y = 0; y < image.height; y++) {
+      kernels.grayRow(image.data + y * image.stride, gray.data() + y * image.width,
+                      image.width, true);
+    }
+  }
+
+  std::string error;
+  TessEngine engine = Acquire(languages, &error);
+  if (!engine) {
+    if (pix != nullptr) {
+      pixDestroy(&pix);
+    }
+    return OCRData(error);
+  }
+
+  // Raw frames are copied into the engine's own image by SetImage()
+  if (pix != nullptr) {
+    engine->SetImage(pix);
+  } else if (!gray.empty()) {
+    engine->SetImage(gray.data(), int(image.width), int(image.height), 1, int(image.width));
+  } else {
+    engine->SetImage(image.data, int(image.width), int(image.height),
+                     int(OCRBytesPerPixel(image.format)), int(image.stride));
+  }
+  std::vector<OCRObservation> observations;
+  bool recognized = engine->Recognize(nullptr) == 0;
+  tesseract::ResultIterator *it = recognized ? engine->GetIterator() : nullptr;
+  // Lines, as Vision reports them
+  const tesseract::PageIteratorLevel level = tesseract::RIL_TEXTLINE;
+  if (it != nullptr) {
+    do {
+      char *utf8 = it->GetUTF8Text(level);
+      if (utf8 == nullptr) {
+        continue;
+      }
+      std::string text(utf8);
+      delete[] utf8;
+      while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) {
+        text.pop_back();
+      }
+      int left, top, right, bottom;
+      if (text.empty() || !it->BoundingBox(level, &left, &top, &right, &bottom)) {
+        continue;
+      }
+      observations.emplace_back(
+          Rectangle{size_t(left), size_t(top), size_t(right - left), size_t(bottom - top)},
+          text);
+    } while (it->Next(level));
+    delete it;
+  }
+
+  Release(languages, std::move(engine));
+  if (pix != nullptr) {
+    pixDestroy(&pix);
+  }
+  if (!recognized) {
+    return OCRData(std::string("Tesseract could not recognize the image"));
+  }
+  return OCRData(observations);
+}
+
+} // namespace
+
+std::unique_ptr<OCRBackend> CreateTesseractOCRBackend() {
+  return std::unique_ptr<OCRBackend>(new TesseractOCRBackend());
+}
+
+#else
+
+std::unique_ptr<OCRBackend> CreateTesseractOCRBackend() {
+  return std::unique_ptr<OCRBackend>();
+}
+
+#endif
@@ -0,0 +1,8 @@
+#pragma once
+#include <memory>
+
+#include "../common/OCR.h"
+
+// Tesseract text recognition as an OCRBackend. Null when the addon was built
+// without libtesseract (the pkg-config check in binding.gyp failed).
+std::unique_ptr<OCRBackend> CreateTesseractOCRBackend();
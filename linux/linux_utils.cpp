@@ -0,0 +1,1336 @@
+#include <napi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#include "AppIndex.h"
+#include "MicTimelineRecorder.h"
+#include "PipeWireGraph.h"
+#include "PipeWireMonitor.h"
+#include "ProcessUtils.h"
+#include "ProcessWatcher.h"
+#include "TesseractOCR.h"
+#include "../common/ActivityDebouncer.h"
+#include "../common/AsyncTasks.h"
+#include "../common/AttributionOptions.h"
+#include "../common/DebounceOptions.h"
+#include "../common/EventDispatcher.h"
+#include "../common/ExecutorExports.h"
+#include "../common/Marshal.h"
+#include "../common/MicMonitorHub.h"
+#include "../common/NativeStatsExports.h"
+#include "../common/OCRExports.h"
+#include "../common/PackedStrings.h"
+#include "../common/ProcessPathCache.h"
+#include "../common/ProcessTree.h"
+
+static ProcessSnapshotStore processSnapshots;
+// Thresholds of the debounced microphone query. The stream list comes from
+// the graph index and does not flap like Bluetooth endpoints, so a new user
+// is reported on the first sample; the other thresholds are the defaults.
+static DebounceConfig micDebounceDefaults() {
+  DebounceConfig config;
+  config.requiredActiveChecks = 1;
+  return config;
+}
+
+// Per-application hysteresis for the debounced microphone query
+static ActivityDebouncer micDebouncer(micDebounceDefaults());
+
+static Napi::Array stringsToArray(const Napi::Env& env, const std::vector<std::string>& strings) {
+  Napi::Array result = Napi::Array::New(env, strings.size());
+  for (size_t i = 0; i < strings.size(); i++) {
+    result.Set(i, Napi::String::New(env, strings[i]));
+  }
+
+  return result;
+}
+
+struct AudioQueryResult {
+  std::vector<std::string> processes;
+  std::vector<SpeakerStreamInfo> streams;
+  std::string errorMessage;
+  bool success;
+
+  AudioQueryResult() : success(true) {}
+};
+
+static Napi::Object audioResultToObject(const Napi::Env& env, AudioQueryResult& result) {
+  Napi::Object resultObj = Napi::Object::New(env);
+  resultObj.Set("success", Napi::Boolean::New(env, result.success));
+  if (!result.success) {
+    resultObj.Set("error", Napi::String::New(env, result.errorMessage));
+    resultObj.Set("processes", Napi::Array::New(env));
+  } else {
+    resultObj.Set("error", env.Null());
+    resultObj.Set("processes", stringsToArray(env, result.processes));
+  }
+
+  return resultObj;
+}
+
+// Only streams that are linked are listed, so all of them are active
+template <> struct MarshalFields<SpeakerStreamInfo> {
+  static auto Get() {
+    return std::make_tuple(
+        Marshal::Field("processName", &SpeakerStreamInfo::processName),
+        Marshal::Field("deviceName", &SpeakerStreamInfo::deviceName),
+        Marshal::Computed<SpeakerStreamInfo>("isActive",
+                                             [](const SpeakerStreamInfo &) { return true; }));
+  }
+};
+
+static Napi::Object speakerResultToObject(const Napi::Env& env, AudioQueryResult& result) {
+  Napi::Object resultObj = Napi::Object::New(env);
+  resultObj.Set("success", Napi::Boolean::New(env, result.success));
+  resultObj.Set("error", result.success ? env.Null() : Napi::String::New(env, result.errorMessage));
+
+  resultObj.Set("processes", Marshal::ToArray(env, result.streams));
+
+  return resultObj;
+}
+
+static void refreshProcessTree() {
+  GetRunningProcessEntries();
+}
+
+// Apps recording from any source, read from the PipeWire graph index. With
+// `rootApp` they are the executables of the apps owning each stream's
+// application.process.id instead of node names.
+static AudioQueryResult QueryMicrophoneProcesses(bool rootApp = false) {
+  AudioQueryResult result;
+  PipeWireGraph& graph = PipeWireGraph::Shared();
+  if (!graph.EnsureStarted(&result.errorMessage)) {
+    result.success = false;
+    return result;
+  }
+
+  result.processes = rootApp
+                         ? AttributeToRootApps(graph.Index().MicrophoneSessions(), refreshProcessTree)
+                         : graph.Index().MicrophoneProcesses();
+  return result;
+}
+
+// Names each stream after the app owning its process, one stream per app
+// and device
+static void attributeStreamsToRootApps(std::vector<SpeakerStreamInfo>& streams) {
+  std::vector<uint32_t> pids;
+  pids.reserve(streams.size());
+  for (const auto& stream : streams) {
+    pids.push_back(stream.pid);
+  }
+  std::vector<ProcessEntry> roots = ProcessTree::Shared().RootApps(pids, refreshProcessTree);
+
+  std::vector<SpeakerStreamInfo> attributed;
+  std::unordered_set<std::string> seen;
+  for (size_t i = 0; i < streams.size(); i++) {
+    SpeakerStreamInfo stream = streams[i];
+    if (roots[i].pid != 0) {
+      stream.pid = roots[i].pid;
+      stream.processName = ProcessNameFromPath(roots[i].path);
+    }
+    if (seen.insert(stream.processName + '\0' + stream.deviceName).second) {
+      attributed.push_back(std::move(stream));
+    }
+  }
+  streams.swap(attributed);
+}
+
+// Apps playing to any sink, read from the PipeWire graph index
+static AudioQueryResult QuerySpeakerStreams(bool rootApp = false) {
+  AudioQueryResult result;
+  PipeWireGraph& graph = PipeWireGraph::Shared();
+  if (!graph.EnsureStarted(&result.errorMessage)) {
+    result.success = false;
+    return result;
+  }
+
+  result.streams = graph.Index().SpeakerStreams();
+  if (rootApp) {
+    attributeStreamsToRootApps(result.streams);
+  }
+  return result;
+}
+
+Napi::Value GetRunningInputAudioProcesses(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  PipeWireGraph& graph = PipeWireGraph::Shared();
+  std::string error;
+  if (!graph.EnsureStarted(&error)) {
+    return Napi::Array::New(env);
+  }
+
+  return stringsToArray(env, graph.Index().InputAudioProcesses());
+}
+
+// {attribution: "rootApp"} reports the owning apps instead of the streams
+Napi::Value GetProcessesAccessingMicrophoneWithResult(const Napi::CallbackInfo& info) {
+  bool rootApp = false;
+  if (!ReadRootAppAttribution(info, 0, &rootApp)) {
+    return info.Env().Null();
+  }
+  AudioQueryResult result = QueryMicrophoneProcesses(rootApp);
+  return audioResultToObject(info.Env(), result);
+}
+
+Napi::Value GetProcessesAccessingMicrophoneWithResultAsync(const Napi::CallbackInfo& info) {
+  bool rootApp = false;
+  if (!ReadRootAppAttribution(info, 0, &rootApp)) {
+    return info.Env().Null();
+  }
+  return QueueExecutorPromise<AudioQueryResult>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getProcessesAccessingMicrophoneWithResultAsync",
+      [rootApp]() { return QueryMicrophoneProcesses(rootApp); }, audioResultToObject);
+}
+
+// Microphone users smoothed per application, so a stream that briefly stops
+// and restarts does not flap. Thresholds passed as options apply to this
+// call only.
+Napi::Value GetProcessesAccessingMicrophoneDebouncedWithResult(const Napi::CallbackInfo& info) {
+  DebounceConfig config = micDebouncer.Config();
+  if (info.Length() > 0 && info[0].IsObject()) {
+    config = ReadDebounceOptions(info[0].As<Napi::Object>(), config);
+  }
+
+  AudioQueryResult result = QueryMicrophoneProcesses();
+  if (result.success) {
+    result.processes = micDebouncer.SampleSet(result.processes, config);
+  }
+  return audioResultToObject(info.Env(), result);
+}
+
+Napi::Value GetProcessesAccessingSpeakersWithResult(const Napi::CallbackInfo& info) {
+  bool rootApp = false;
+  if (!ReadRootAppAttribution(info, 0, &rootApp)) {
+    return info.Env().Null();
+  }
+  AudioQueryResult result = QuerySpeakerStreams(rootApp);
+  return speakerResultToObject(info.Env(), result);
+}
+
+Napi::Value GetProcessesAccessingSpeakersWithResultAsync(const Napi::CallbackInfo& info) {
+  bool rootApp = false;
+  if (!ReadRootAppAttribution(info, 0, &rootApp)) {
+    return info.Env().Null();
+  }
+  return QueueExecutorPromise<AudioQueryResult>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getProcessesAccessingSpeakersWithResultAsync",
+      [rootApp]() { return QuerySpeakerStreams(rootApp); }, speakerResultToObject);
+}
+
+// Adds a string or each string of an array as an exe pattern
+static bool addExePatterns(Napi::Env env, const Napi::Value& value, bool exclude,
+                           ProcessFilter* filter) {
+  if (value.IsString()) {
+    filter->AddExePattern(value.As<Napi::String>().Utf8Value(), exclude);
+    return true;
+  }
+  if (!value.IsArray()) {
+    Napi::TypeError::New(env, "Expected exe patterns as a string or an array of strings")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  Napi::Array patterns = value.As<Napi::Array>();
+  for (uint32_t i = 0; i < patterns.Length(); i++) {
+    Napi::Value pattern = patterns.Get(i);
+    if (!pattern.IsString()) {
+      Napi::TypeError::New(env, "Expected exe patterns as a string or an array of strings")
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+    filter->AddExePattern(pattern.As<Napi::String>().Utf8Value(), exclude);
+  }
+  return true;
+}
+
+// Reads `filter` of the getRunningProcesses options: {uid, name, exe,
+// excludeExe, subtreeOf}. Leaves `result` empty when there is none; returns
+// false with a pending exception when it is malformed.
+static bool readProcessFilter(Napi::Env env, const Napi::Value& options,
+                              std::shared_ptr<ProcessFilter>* result) {
+  if (!options.IsObject()) {
+    return true;
+  }
+  Napi::Value spec = options.As<Napi::Object>().Get("filter");
+  if (spec.IsUndefined() || spec.IsNull()) {
+    return true;
+  }
+  if (!spec.IsObject()) {
+    Napi::TypeError::New(env, "Expected filter to be an object").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Object object = spec.As<Napi::Object>();
+  auto filter = std::make_shared<ProcessFilter>();
+  Napi::Value uid = object.Get("uid");
+  if (uid.IsNumber()) {
+    filter->SetUid(uid.As<Napi::Number>().Uint32Value());
+  }
+  Napi::Value name = object.Get("name");
+  if (name.IsString()) {
+    std::string error;
+    if (!filter->SetNamePattern(name.As<Napi::String>().Utf8Value(), &error)) {
+      Napi::Error::New(env, error).ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+  Napi::Value exe = object.Get("exe");
+  if (!exe.IsUndefined() && !addExePatterns(env, exe, false, filter.get())) {
+    return false;
+  }
+  Napi::Value excludeExe = object.Get("excludeExe");
+  if (!excludeExe.IsUndefined() && !addExePatterns(env, excludeExe, true, filter.get())) {
+    return false;
+  }
+  Napi::Value subtreeOf = object.Get("subtreeOf");
+  if (subtreeOf.IsNumber()) {
+    filter->AddSubtreeRoot(subtreeOf.As<Napi::Number>().Uint32Value());
+  } else if (subtreeOf.IsArray()) {
+    Napi::Array roots = subtreeOf.As<Napi::Array>();
+    for (uint32_t i = 0; i < roots.Length(); i++) {
+      Napi::Value root = roots.Get(i);
+      if (root.IsNumber()) {
+        filter->AddSubtreeRoot(root.As<Napi::Number>().Uint32Value());
+      }
+    }
+  }
+
+  *result = filter;
+  return true;
+}
+
+// Gets a list of running executables by reading /proc directly. With
+// {packed: true} the list comes back as one ArrayBuffer instead of strings;
+// {filter} is applied during the scan.
+Napi::Value GetRunningProcessesFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  std::shared_ptr<ProcessFilter> filter;
+  if (!readProcessFilter(env, info[0], &filter)) {
+    return env.Null();
+  }
+  std::vector<std::string> processes =
+      filter ? GetMatchingProcesses(*filter) : GetRunningProcesses();
+
+  if (WantsPackedStrings(info, 0)) {
+    return PackedStringsToObject(env, PackStrings(processes));
+  }
+  return stringsToArray(env, processes);
+}
+
+// Promise-returning variant of getRunningProcesses, scanned off the JS thread
+Napi::Value GetRunningProcessesAsyncFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  std::shared_ptr<ProcessFilter> filter;
+  if (!readProcessFilter(env, info[0], &filter)) {
+    return env.Null();
+  }
+  auto scan = [filter]() {
+    return filter ? GetMatchingProcesses(*filter) : GetRunningProcesses();
+  };
+
+  if (WantsPackedStrings(info, 0)) {
+    return QueueExecutorPromise<PackedStrings>(
+        env, EXECUTOR_INTERACTIVE, "getRunningProcessesAsync",
+        [scan]() { return PackStrings(scan()); }, PackedStringsToObject);
+  }
+  return QueueExecutorPromise<std::vector<std::string>>(
+      env, EXECUTOR_INTERACTIVE, "getRunningProcessesAsync", scan, stringsToArray);
+}
+
+struct ProcessFieldName {
+  const char* name;
+  uint32_t field;
+};
+
+static const ProcessFieldName PROCESS_FIELD_NAMES[] = {
+    {"pid", PROCESS_FIELD_PID},
+    {"ppid", PROCESS_FIELD_PPID},
+    {"exe", PROCESS_FIELD_EXE},
+    {"cmdline", PROCESS_FIELD_CMDLINE},
+    {"uid", PROCESS_FIELD_UID},
+    {"startTime", PROCESS_FIELD_START_TIME},
+    {"rss", PROCESS_FIELD_RSS},
+    {"cpuTime", PROCESS_FIELD_CPU_TIME},
+};
+
+static const uint32_t DEFAULT_PROCESS_FIELDS =
+    PROCESS_FIELD_PID | PROCESS_FIELD_PPID | PROCESS_FIELD_EXE;
+
+// Reads `fields` of the getProcesses options into a ProcessField mask;
+// returns false with a pending exception on an unknown name.
+static bool readProcessFields(Napi::Env env, const Napi::Value& options, uint32_t* result) {
+  *result = DEFAULT_PROCESS_FIELDS;
+  if (!options.IsObject()) {
+    return true;
+  }
+  Napi::Value spec = options.As<Napi::Object>().Get("fields");
+  if (spec.IsUndefined() || spec.IsNull()) {
+    return true;
+  }
+  if (!spec.IsArray()) {
+    Napi::TypeError::New(env, "Expected fields to be an array of field names")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Array names = spec.As<Napi::Array>();
+  uint32_t fields = PROCESS_FIELD_PID;
+  for (uint32_t i = 0; i < names.Length(); i++) {
+    Napi::Value value = names.Get(i);
+    std::string name = value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+    auto match = std::find_if(std::begin(PROCESS_FIELD_NAMES), std::end(PROCESS_FIELD_NAMES),
+                              [&](const ProcessFieldName& entry) { return name == entry.name; });
+    if (match == std::end(PROCESS_FIELD_NAMES)) {
+      Napi::TypeError::New(env, "Unknown process field: " + name).ThrowAsJavaScriptException();
+      return false;
+    }
+    fields |= match->field;
+  }
+
+  *result = fields;
+  return true;
+}
+
+template <typename T, typename TypedArray>
+static TypedArray copyToTypedArray(const Napi::Env& env, const std::vector<T>& values) {
+  Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, values.size() * sizeof(T));
+  if (!values.empty()) {
+    memcpy(buffer.Data(), values.data(), values.size() * sizeof(T));
+  }
+  return TypedArray::New(env, values.size(), buffer, 0);
+}
+
+// {count, pid, ...} with one typed array (or packed string list) per
+// requested field, all indexed alike
+static Napi::Object processRecordsToObject(const Napi::Env& env, const ProcessRecords& records) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("count", Napi::Number::New(env, double(records.pid.size())));
+  result.Set("pid", copyToTypedArray<uint32_t, Napi::Uint32Array>(env, records.pid));
+  if ((records.fields & PROCESS_FIELD_PPID) != 0) {
+    result.Set("ppid", copyToTypedArray<uint32_t, Napi::Uint32Array>(env, records.ppid));
+  }
+  if ((records.fields & PROCESS_FIELD_EXE) != 0) {
+    result.Set("exe", PackedStringsToObject(env, PackStrings(records.exe)));
+  }
+  if ((records.fields & PROCESS_FIELD_CMDLINE) != 0) {
+    result.Set("cmdline", PackedStringsToObject(env, PackStrings(records.cmdline)));
+  }
+  if ((records.fields & PROCESS_FIELD_UID) != 0) {
+    result.Set("uid", copyToTypedArray<uint32_t, Napi::Uint32Array>(env, records.uid));
+  }
+  if ((records.fields & PROCESS_FIELD_START_TIME) != 0) {
+    result.Set("startTime", copyToTypedArray<double, Napi::Float64Array>(env, records.startTimeMs));
+  }
+  if ((records.fields & PROCESS_FIELD_RSS) != 0) {
+    result.Set("rss", copyToTypedArray<double, Napi::Float64Array>(env, records.rssBytes));
+  }
+  if ((records.fields & PROCESS_FIELD_CPU_TIME) != 0) {
+    result.Set("cpuTime", copyToTypedArray<double, Napi::Float64Array>(env, records.cpuTimeMs));
+  }
+  return result;
+}
+
+// Gets running processes as columns: {fields: [...]} picks which ones
+// (pid, ppid and exe by default) and only their /proc files are read;
+// {filter} works as for getRunningProcesses.
+Napi::Value GetProcessesFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  uint32_t fields = 0;
+  std::shared_ptr<ProcessFilter> filter;
+  if (!readProcessFields(env, info[0], &fields) ||
+      !readProcessFilter(env, info[0], &filter)) {
+    return env.Null();
+  }
+
+  return processRecordsToObject(env, GetProcessRecords(fields, filter.get()));
+}
+
+// Promise-returning variant of getProcesses, scanned off the JS thread
+Napi::Value GetProcessesAsyncFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  uint32_t fields = 0;
+  std::shared_ptr<ProcessFilter> filter;
+  if (!readProcessFields(env, info[0], &fields) ||
+      !readProcessFilter(env, info[0], &filter)) {
+    return env.Null();
+  }
+
+  return QueueExecutorPromise<ProcessRecords>(
+      env, EXECUTOR_INTERACTIVE, "getProcessesAsync",
+      [fields, filter]() { return GetProcessRecords(fields, filter.get()); },
+      processRecordsToObject);
+}
+
+// Gets the processes started and exited since the given snapshot generation
+Napi::Value GetRunningProcessesDeltaFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  uint64_t generation = 0;
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    generation = uint64_t(info[0].As<Napi::Number>().Int64Value());
+  }
+
+  auto delta = processSnapshots.Update(GetRunningProcessEntries(), generation);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("added", stringsToArray(env, delta.added));
+  result.Set("removed", stringsToArray(env, delta.removed));
+  result.Set("generation", Napi::Number::New(env, double(delta.generation)));
+  result.Set("full", Napi::Boolean::New(env, delta.full));
+
+  return result;
+}
+
+template <> struct MarshalFields<InstalledApp> {
+  static auto Get() {
+    return std::make_tuple(Marshal::Field("type", &InstalledApp::AppType),
+                           Marshal::Field("name", &InstalledApp::AppName),
+                           Marshal::Field("id", &InstalledApp::Id),
+                           Marshal::Field("version", &InstalledApp::Version));
+  }
+};
+
+static Napi::Object installedAppToObject(const Napi::Env& env, const InstalledApp& app) {
+  return Marshal::ToObject(env, app);
+}
+
+static Napi::Array installedAppsToArray(const Napi::Env& env, const std::vector<InstalledApp>& apps) {
+  return Marshal::ToArray(env, apps);
+}
+
+static std::vector<InstalledApp> listIndexedApps() {
+  return InstalledAppIndex::Shared().List();
+}
+
+// Gets installed apps from the XDG, Flatpak and Snap .desktop entries. Only
+// directories changed since the on-disk index was written are read again.
+Napi::Value ListInstalledAppsFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  return installedAppsToArray(env, listIndexedApps());
+}
+
+// Promise-returning variant of listInstalledApps; the scan runs off the JS
+// thread, in the executor's bulk lane. {signal} cancels it until it starts.
+Napi::Value ListInstalledAppsAsyncFunc(const Napi::CallbackInfo& info) {
+  Napi::Object signal;
+  if (!ReadAbortSignal(info.Env(), info[0], &signal)) {
+    return info.Env().Null();
+  }
+  return QueueExecutorPromise<std::vector<InstalledApp>>(
+      info.Env(), EXECUTOR_BULK, "listInstalledAppsAsync", listIndexedApps,
+      installedAppsToArray, Napi::Object(), signal);
+}
+
+// Keeps the installed app index fresh from an inotify thread, so that
+// listInstalledApps() returns without touching the disk
+Napi::Value StartWatchingInstalledAppsFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  std::string error;
+  if (!InstalledAppIndex::Shared().StartWatching(&error)) {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value StopWatchingInstalledAppsFunc(const Napi::CallbackInfo& info) {
+  InstalledAppIndex::Shared().StopWatching();
+  return info.Env().Undefined();
+}
+
+// Gets the counters of the installed app index and its last scan
+Napi::Value GetInstalledAppIndexStatsFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  AppIndexStats stats = InstalledAppIndex::Shared().Stats();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("scans", Napi::Number::New(env, double(stats.scans)));
+  result.Set("indexWrites", Napi::Number::New(env, double(stats.indexWrites)));
+  result.Set("watchRefreshes", Napi::Number::New(env, double(stats.watchRefreshes)));
+  result.Set("watching", Napi::Boolean::New(env, stats.watching));
+  result.Set("directories", Napi::Number::New(env, double(stats.lastScan.directories)));
+  result.Set("reusedDirectories",
+             Napi::Number::New(env, double(stats.lastScan.reusedDirectories)));
+  result.Set("parsedFiles", Napi::Number::New(env, double(stats.lastScan.parsedFiles)));
+  result.Set("reusedFiles", Napi::Number::New(env, double(stats.lastScan.reusedFiles)));
+
+  return result;
+}
+
+// Gets hit/miss counters of the shared PID to executable path cache
+Napi::Value GetProcessCacheStatsFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  auto stats = ProcessPathCache::Shared().Stats();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("hits", Napi::Number::New(env, double(stats.hits)));
+  result.Set("misses", Napi::Number::New(env, double(stats.misses)));
+  result.Set("entries", Napi::Number::New(env, double(stats.entries)));
+
+  return result;
+}
+
+// Batches from the process watcher thread wait here for the JS thread. At
+// most one wakeup is outstanding, so while the callback is busy new batches
+// merge into the next call instead of queueing calls.
+struct ProcessWatchDelivery {
+  std::mutex mutex;
+  std::vector<ProcessEvent> pending;
+  bool wakeupPending;
+  Napi::ThreadSafeFunction tsfn;
+
+  ProcessWatchDelivery() : wakeupPending(false) {}
+};
+
+// Events beyond this many undelivered ones are dropped and counted
+static const size_t MAX_PENDING_PROCESS_EVENTS = 64 * 1024;
+
+// The watcher of one env (main thread or worker), kept in its instance data.
+// A cleanup hook stops it when the env exits, before Node finalizes the tsfn.
+struct ProcessWatchEnv {
+  ProcessWatcher watcher;
+  // Null while not watching
+  ProcessWatchDelivery* delivery;
+  uint64_t generation;
+  std::atomic<uint64_t> dropped;
+  napi_env env;
+
+  ProcessWatchEnv() : delivery(nullptr), generation(0), dropped(0), env(nullptr) {}
+};
+
+static ProcessWatchEnv* processWatchEnv(napi_env env) {
+  return Marshal::EnvState::Get<ProcessWatchEnv>(env);
+}
+
+static Napi::Array processEventsToArray(const Napi::Env& env, const std::vector<ProcessEvent>& events) {
+  Napi::Array result = Napi::Array::New(env, events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    Napi::Object event = Napi::Object::New(env);
+    event.Set("type", Napi::String::New(env, events[i].type == ProcessEvent::EXEC ? "exec" : "exit"));
+    event.Set("pid", Napi::Number::New(env, events[i].pid));
+    event.Set("ppid", Napi::Number::New(env, events[i].ppid));
+    event.Set("path", Napi::String::New(env, events[i].path));
+    result.Set(i, event);
+  }
+
+  return result;
+}
+
+static void deliverProcessEvents(ProcessWatchDelivery* delivery, std::vector<ProcessEvent>&& events,
+                                 std::atomic<uint64_t>& dropped) {
+  std::lock_guard<std::mutex> lock(delivery->mutex);
+  if (delivery->pending.size() + events.size() > MAX_PENDING_PROCESS_EVENTS) {
+    dropped.fetch_add(events.size(), std::memory_order_relaxed);
+    return;
+  }
+  if (delivery->pending.empty()) {
+    delivery->pending = std::move(events);
+  } else {
+    std::move(events.begin(), events.end(), std::back_inserter(delivery->pending));
+  }
+  if (delivery->wakeupPending) {
+    return;
+  }
+
+  delivery->wakeupPending = true;
+  delivery->tsfn.NonBlockingCall([delivery](Napi::Env env, Napi::Function callback) {
+    std::vector<ProcessEvent> batch;
+    {
+      std::lock_guard<std::mutex> lock(delivery->mutex);
+      batch.swap(delivery->pending);
+      delivery->wakeupPending = false;
+    }
+    // Emptied by close() after this call was queued
+    if (batch.empty()) {
+      return;
+    }
+
+    Napi::HandleScope scope(env);
+    callback.Call({processEventsToArray(env, batch)});
+    if (env.IsExceptionPending()) {
+      Napi::Error error = env.GetAndClearPendingException();
+      napi_fatal_exception(env, error.Value());
+    }
+  });
+}
+
+static void stopWatchingProcessesHook(void* data);
+
+// On the env's JS thread. Joins the watcher thread first, so nothing is
+// delivered after this returns; batches already queued are discarded with
+// the tsfn.
+static void stopWatchingProcesses(ProcessWatchEnv* state) {
+  if (state->delivery == nullptr) {
+    return;
+  }
+
+  state->watcher.Stop();
+  {
+    std::lock_guard<std::mutex> lock(state->delivery->mutex);
+    state->delivery->pending.clear();
+  }
+  state->delivery->tsfn.Release();
+  state->delivery = nullptr;
+  if (state->env != nullptr) {
+    napi_remove_env_cleanup_hook(state->env, stopWatchingProcessesHook, state);
+    state->env = nullptr;
+  }
+}
+
+static void stopWatchingProcessesHook(void* data) {
+  ProcessWatchEnv* state = static_cast<ProcessWatchEnv*>(data);
+  // Already running, so not removed again
+  state->env = nullptr;
+  stopWatchingProcesses(state);
+}
+
+// Calls callback(events) with the processes that exec'd and exited since the
+// last call. Uses the netlink proc connector when the process has
+// CAP_NET_ADMIN, and otherwise diffs /proc; `{ netlink: false }` forces the
+// latter. Replaces the previous watcher of the calling thread; each worker
+// has its own. Returns { mode, close() }.
+Napi::Value WatchProcessesFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsFunction()) {
+    Napi::TypeError::New(env, "Expected a callback function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  bool allowNetlink = true;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Value netlink = info[1].As<Napi::Object>().Get("netlink");
+    if (netlink.IsBoolean()) {
+      allowNetlink = netlink.As<Napi::Boolean>().Value();
+    }
+  }
+
+  ProcessWatchEnv* state = processWatchEnv(env);
+  stopWatchingProcesses(state);
+
+  auto delivery = new ProcessWatchDelivery();
+  delivery->tsfn = Napi::ThreadSafeFunction::New(
+      env, info[0].As<Napi::Function>(), "watchProcesses", 0, 1, delivery,
+      [](Napi::Env, ProcessWatchDelivery* self) { delete self; });
+
+  std::string error;
+  bool started = state->watcher.Start(
+      [delivery, state](std::vector<ProcessEvent>&& events) {
+        deliverProcessEvents(delivery, std::move(events), state->dropped);
+      },
+      allowNetlink, &error);
+  if (!started) {
+    delivery->tsfn.Release();
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  state->delivery = delivery;
+  state->env = env;
+  napi_add_env_cleanup_hook(env, stopWatchingProcessesHook, state);
+  uint64_t generation = ++state->generation;
+
+  Napi::Object handle = Napi::Object::New(env);
+  handle.Set("mode", Napi::String::New(env, ProcessWatcherModeName(state->watcher.CurrentMode())));
+  handle.Set("close", Napi::Function::New(env, [generation](const Napi::CallbackInfo& info) {
+    ProcessWatchEnv* state = processWatchEnv(info.Env());
+    // A handle replaced by a later watchProcesses() call no longer owns the watcher
+    if (generation == state->generation) {
+      stopWatchingProcesses(state);
+    }
+    return info.Env().Undefined();
+  }));
+
+  return handle;
+}
+
+// Gets the counters of the calling thread's process watcher. `overflows`
+// counts netlink receive buffer overruns, each losing an unknown number of
+// events; `dropped` counts events discarded because JS fell behind.
+Napi::Value GetProcessWatchStatsFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ProcessWatchEnv* state = processWatchEnv(env);
+  ProcessWatcher& watcher = state->watcher;
+  const ProcessWatcherStats& stats = watcher.Stats();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("mode", Napi::String::New(env, ProcessWatcherModeName(watcher.CurrentMode())));
+  result.Set("events", Napi::Number::New(env, double(stats.events.load())));
+  result.Set("batches", Napi::Number::New(env, double(stats.batches.load())));
+  result.Set("overflows", Napi::Number::New(env, double(stats.overflows.load())));
+  result.Set("scans", Napi::Number::New(env, double(stats.scans.load())));
+  result.Set("dropped", Napi::Number::New(env, double(state->dropped.load())));
+
+  return result;
+}
+
+// Microphone usage history. The timeline is created by the first call that
+// needs it, with the capacity given to startMicTimeline() if that came first.
+static const size_t DEFAULT_MIC_TIMELINE_CAPACITY = 16384;
+
+struct MicTimelineState {
+  MicTimeline timeline;
+  MicTimelineRecorder recorder;
+
+  explicit MicTimelineState(size_t capacity) : timeline(capacity), recorder(&timeline) {}
+};
+
+// Set once, by whichever thread (main or worker) gets there first
+static std::once_flag micTimelineOnce;
+static std::atomic<MicTimelineState*> micTimelineState(nullptr);
+
+static MicTimelineState& sharedMicTimelineState(size_t capacity = DEFAULT_MIC_TIMELINE_CAPACITY) {
+  std::call_once(micTimelineOnce, [capacity]() {
+    // Never destroyed: the recorder thread may still be running at exit.
+    micTimelineState.store(new MicTimelineState(capacity));
+  });
+  return *micTimelineState.load();
+}
+
+static MicTimeline& sharedMicTimeline() { return sharedMicTimelineState().timeline; }
+
+// Records which processes use the microphone, and for how long, until
+// stopMicTimeline() is called. Options: { capacity } intervals kept.
+Napi::Value StartMicTimelineFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  size_t capacity = DEFAULT_MIC_TIMELINE_CAPACITY;
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Value value = info[0].As<Napi::Object>().Get("capacity");
+    if (value.IsNumber() && value.As<Napi::Number>().Int64Value() > 0) {
+      capacity = size_t(value.As<Napi::Number>().Int64Value());
+    }
+  }
+  std::string error;
+  if (!sharedMicTimelineState(capacity).recorder.Start(&error)) {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Boolean::New(env, true);
+}
+
+// Stops recording; intervals still open end now. The history is kept.
+Napi::Value StopMicTimelineFunc(const Napi::CallbackInfo& info) {
+  MicTimelineState* state = micTimelineState.load();
+  if (state != nullptr) {
+    state->recorder.Stop();
+  }
+  return info.Env().Undefined();
+}
+
+static Napi::Array micIntervalsToArray(const Napi::Env& env, const std::vector<MicInterval>& intervals) {
+  Napi::Array result = Napi::Array::New(env, intervals.size());
+  for (size_t i = 0; i < intervals.size(); i++) {
+    Napi::Object interval = Napi::Object::New(env);
+    interval.Set("process", Napi::String::New(env, intervals[i].process));
+    interval.Set("pid", Napi::Number::New(env, intervals[i].pid));
+    interval.Set("device", Napi::String::New(env, intervals[i].device));
+    interval.Set("start", Napi::Number::New(env, double(intervals[i].startMs)));
+    interval.Set("end", intervals[i].open ? env.Null() : Napi::Number::New(env, double(intervals[i].endMs)));
+    result.Set(i, interval);
+  }
+
+  return result;
+}
+
+// queryMicTimeline({ from, to, process }) gets the intervals overlapping
+// [from, to) (ms since the epoch, both optional), oldest first. Intervals
+// still open have a null end.
+Napi::Value QueryMicTimelineFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  int64_t from = 0;
+  int64_t to = INT64_MAX;
+  std::string process;
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (options.Get("from").IsNumber()) {
+      from = options.Get("from").As<Napi::Number>().Int64Value();
+    }
+    if (options.Get("to").IsNumber()) {
+      to = options.Get("to").As<Napi::Number>().Int64Value();
+    }
+    if (options.Get("process").IsString()) {
+      process = options.Get("process").As<Napi::String>().Utf8Value();
+    }
+  }
+
+  return micIntervalsToArray(env, sharedMicTimeline().Query(from, to, process, WallClockMs()));
+}
+
+// Gets the history as a compact binary blob; open intervals end now.
+Napi::Value ExportMicTimelineFunc(const Napi::CallbackInfo& info) {
+  std::string blob = sharedMicTimeline().Export(WallClockMs());
+  return Napi::Buffer<char>::Copy(info.Env(), blob.data(), blob.size());
+}
+
+// Replaces the recorded history with a blob from exportMicTimeline() and
+// returns the number of intervals kept (the newest, up to the capacity).
+Napi::Value ImportMicTimelineFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsBuffer()) {
+    Napi::TypeError::New(env, "Expected a Buffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Buffer<char> blob = info[0].As<Napi::Buffer<char>>();
+
+  size_t imported = 0;
+  if (!sharedMicTimeline().Import(blob.Data(), blob.Length(), &imported)) {
+    Napi::Error::New(env, "Invalid microphone timeline data").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Number::New(env, double(imported));
+}
+
+Napi::Value GetMicTimelineStatsFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  MicTimelineState& state = sharedMicTimelineState();
+  MicTimelineStats stats = state.timeline.Stats();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("recording", Napi::Boolean::New(env, state.recorder.IsRunning()));
+  result.Set("capacity", Napi::Number::New(env, double(stats.capacity)));
+  result.Set("intervals", Napi::Number::New(env, double(stats.intervals)));
+  result.Set("open", Napi::Number::New(env, double(stats.open)));
+  result.Set("names", Napi::Number::New(env, double(stats.names)));
+  result.Set("evicted", Napi::Number::New(env, double(stats.evicted)));
+  result.Set("samples", Napi::Number::New(env, double(stats.samples)));
+
+  return result;
+}
+
+// Microphone monitoring via PipeWire; same callback contract as macOS. Besides
+// the aggregate state it reports each Audio/Source node, keyed by node id, for
+// subscribers that ask for devices.
+class PipeWireMicBackend : public MicMonitorBackend {
+public:
+  bool Start(MonitorEventSink sink, std::string* error) override {
+    monitor_.SetSourceCallback([sink](uint32_t node, const std::string& name, bool running) {
+      MonitorEvent event;
+      event.device = node;
+      event.deviceName = name;
+      event.active = running;
+      sink(std::move(event));
+    });
+
+    return monitor_.Start([sink](bool microphoneActive, const MicMonitorError* err) {
+      MonitorEvent event;
+      event.active = microphoneActive;
+      if (err != nullptr) {
+        event.hasError = true;
+        event.code = err->code;
+        event.message = err->message;
+        event.domain = MIC_MONITOR_ERROR_DOMAIN;
+      }
+      sink(std::move(event));
+    }, error);
+  }
+
+  void Stop() override { monitor_.Stop(); }
+
+private:
+  PipeWireMicMonitor monitor_;
+};
+
+// Stands in for PipeWire in bench/mic-fanout.js; events come from
+// InjectMicEvents only.
+class SyntheticMicBackend : public MicMonitorBackend {
+public:
+  bool Start(MonitorEventSink sink, std::string* error) override { return true; }
+  void Stop() override {}
+};
+
+static std::unique_ptr<MicMonitorBackend> createPipeWireMicBackend() {
+  return std::unique_ptr<MicMonitorBackend>(new PipeWireMicBackend());
+}
+
+// Synthetic event producers for test-event-delivery.js. They push through
+// the same dispatcher as the microphone monitor, with their own counters.
+struct SyntheticEvents {
+  EventDispatcher* dispatcher;
+  std::shared_ptr<EventDeliveryStats> stats;
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> produced;
+  std::atomic<int> running;
+
+  SyntheticEvents() : dispatcher(nullptr), produced(0), running(0) {}
+};
+
+static SyntheticEvents* syntheticEvents = nullptr;
+
+static Napi::Object syntheticStatsToObject(const Napi::Env& env) {
+  Napi::Object result = EventDeliveryStatsToObject(env, *syntheticEvents->stats);
+  result.Set("produced", Napi::Number::New(env, double(syntheticEvents->produced.load())));
+  result.Set("finished", Napi::Boolean::New(env, syntheticEvents->running.load() == 0));
+  return result;
+}
+
+static uint32_t readUint32Option(const Napi::Value& options, const char* name, uint32_t fallback) {
+  if (!options.IsObject()) {
+    return fallback;
+  }
+  Napi::Value value = options.As<Napi::Object>().Get(name);
+  return value.IsNumber() ? value.As<Napi::Number>().Uint32Value() : fallback;
+}
+
+// startSyntheticEvents(callback, { producers, events, devices, intervalUs,
+// capacity, coalesceMs }) starts `producers` threads that each push `events`
+// state flips spread over `devices` coalescing keys.
+Napi::Value StartSyntheticEvents(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsFunction()) {
+    Napi::TypeError::New(env, "Expected a callback function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (syntheticEvents != nullptr) {
+    Napi::Error::New(env, "Synthetic events already running").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uint32_t producers = readUint32Option(info[1], "producers", 4);
+  uint32_t events = readUint32Option(info[1], "events", 100000);
+  uint32_t devices = std::max(readUint32Option(info[1], "devices", 8), 1u);
+  uint32_t intervalUs = readUint32Option(info[1], "intervalUs", 0);
+
+  syntheticEvents = new SyntheticEvents();
+  syntheticEvents->stats = std::make_shared<EventDeliveryStats>();
+  syntheticEvents->dispatcher = EventDispatcher::Create(
+      env, info[0].As<Napi::Function>(), "SyntheticEvents",
+      ReadEventDispatcherOptions(info[1]), syntheticEvents->stats);
+  syntheticEvents->running = int(producers);
+
+  for (uint32_t p = 0; p < producers; p++) {
+    SyntheticEvents* state = syntheticEvents;
+    state->threads.emplace_back([state, p, events, devices, intervalUs]() {
+      for (uint32_t i = 0; i < events; i++) {
+        MonitorEvent event;
+        event.device = (p * events + i) % devices;
+        event.active = (i & 1) == 0;
+        state->dispatcher->Push(std::move(event));
+        state->produced.fetch_add(1, std::memory_order_relaxed);
+        if (intervalUs > 0) {
+          std::this_thread::sleep_for(std::chrono::microseconds(intervalUs));
+        }
+      }
+      state->running.fetch_sub(1);
+    });
+  }
+
+  return env.Undefined();
+}
+
+Napi::Value GetSyntheticEventStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (syntheticEvents == nullptr) {
+    return env.Null();
+  }
+  return syntheticStatsToObject(env);
+}
+
+// Joins the producers, closes the dispatcher and returns the final counters
+Napi::Value StopSyntheticEvents(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (syntheticEvents == nullptr) {
+    return env.Null();
+  }
+
+  for (auto& thread : syntheticEvents->threads) {
+    thread.join();
+  }
+  syntheticEvents->dispatcher->Close();
+  Napi::Object result = syntheticStatsToObject(env);
+  delete syntheticEvents;
+  syntheticEvents = nullptr;
+
+  return result;
+}
+
+// Routes subsequent createMicMonitor() subscriptions to SyntheticMicBackend
+// (or back to PipeWire with `false`). Takes effect once every handle is closed.
+Napi::Value UseSyntheticMicBackend(const Napi::CallbackInfo& info) {
+  bool synthetic = info.Length() < 1 || info[0].ToBoolean().Value();
+  if (synthetic) {
+    MicMonitorHub::Shared().SetBackendFactory([]() {
+      return std::unique_ptr<MicMonitorBackend>(new SyntheticMicBackend());
+    });
+  } else {
+    MicMonitorHub::Shared().SetBackendFactory(createPipeWireMicBackend);
+  }
+  return info.Env().Undefined();
+}
+
+// injectMicEvents({ count, devices }) pushes `count` state flips through the
+// shared subscription, alternating between the aggregate state and `devices`
+// named devices ("device-1"...). Returns the number of events pushed.
+Napi::Value InjectMicEvents(const Napi::CallbackInfo& info) {
+  uint32_t count = readUint32Option(info[0], "count", 1);
+  uint32_t devices = readUint32Option(info[0], "devices", 0);
+
+  for (uint32_t i = 0; i < count; i++) {
+    MonitorEvent event;
+    event.active = ((i / (devices + 1)) & 1) == 0;
+    event.device = i % (devices + 1);
+    if (event.device != 0) {
+      event.deviceName = "device-" + std::to_string(event.device);
+    }
+    MicMonitorHub::Shared().Inject(std::move(event));
+  }
+
+  return Napi::Number::New(info.Env(), count);
+}
+
+// recordMicUses([{ process, pid, device }], time) feeds one sample to the
+// microphone timeline, as the PipeWire recorder would at `time`.
+Napi::Value RecordMicUses(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "Expected an array of uses and a time").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array items = info[0].As<Napi::Array>();
+  std::vector<MicUse> uses;
+  for (uint32_t i = 0; i < items.Length(); i++) {
+    Napi::Value item = items.Get(i);
+    if (!item.IsObject()) {
+      continue;
+    }
+    Napi::Object object = item.As<Napi::Object>();
+    MicUse use;
+    use.process = object.Get("process").ToString().Utf8Value();
+    use.device = object.Get("device").ToString().Utf8Value();
+    use.pid = readUint32Option(object, "pid", 0);
+    uses.push_back(std::move(use));
+  }
+  sharedMicTimeline().Update(uses, info[1].As<Napi::Number>().Int64Value());
+
+  return env.Undefined();
+}
+
+// runDebouncer(options, steps) feeds an ActivityDebouncer with the thresholds
+// of the debounced microphone query, plus `options`, on a clock that only
+// moves to each step's `at` (ms). A step is { at, id, active: boolean } for
+// Sample or { at, active: [ids] } for SampleSet; each result is
+// { reported, tracked } with what the call returned and the ids tracked
+// after it.
+Napi::Value RunDebouncer(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsArray()) {
+    Napi::TypeError::New(env, "Expected options and an array of steps").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  int64_t now = 0;
+  ActivityDebouncer debouncer(ReadDebounceOptions(info[0].As<Napi::Object>(), micDebounceDefaults()),
+                              [&now]() { return now; });
+  Napi::Array steps = info[1].As<Napi::Array>();
+  Napi::Array results = Napi::Array::New(env, steps.Length());
+  for (uint32_t i = 0; i < steps.Length(); i++) {
+    Napi::Value item = steps.Get(i);
+    if (!item.IsObject()) {
+      Napi::TypeError::New(env, "Expected each step to be an object").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    Napi::Object step = item.As<Napi::Object>();
+    now = step.Get("at").ToNumber().Int64Value();
+
+    Napi::Object result = Napi::Object::New(env);
+    Napi::Value active = step.Get("active");
+    if (active.IsArray()) {
+      Napi::Array ids = active.As<Napi::Array>();
+      std::vector<std::string> activeIds;
+      for (uint32_t k = 0; k < ids.Length(); k++) {
+        activeIds.push_back(ids.Get(k).ToString().Utf8Value());
+      }
+      result.Set("reported", stringsToArray(env, debouncer.SampleSet(activeIds)));
+    } else {
+      bool reported = debouncer.Sample(step.Get("id").ToString().Utf8Value(), active.ToBoolean().Value());
+      result.Set("reported", Napi::Boolean::New(env, reported));
+    }
+    result.Set("tracked", Napi::Number::New(env, double(debouncer.Size())));
+    results.Set(i, result);
+  }
+
+  return results;
+}
+
+// setProcRoot(path) makes the process queries scan a synthetic procfs tree
+// (bench/synthetic.js); null or "" goes back to /proc.
+Napi::Value SetProcRootFunc(const Napi::CallbackInfo& info) {
+  std::string path;
+  if (info.Length() > 0 && info[0].IsString()) {
+    path = info[0].As<Napi::String>().Utf8Value();
+  }
+  SetProcRoot(path);
+  return info.Env().Undefined();
+}
+
+// loadSyntheticGraph({ nodes: [{ id, props }], links: [{ id, output, input }] })
+// replaces PipeWire with the given graph for the audio queries; null goes
+// back to the daemon.
+Napi::Value LoadSyntheticGraph(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  PipeWireGraph& graph = PipeWireGraph::Shared();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    graph.UseSynthetic(false);
+    return env.Undefined();
+  }
+  graph.UseSynthetic(true);
+
+  Napi::Object spec = info[0].As<Napi::Object>();
+  PipeWireGraphIndex& index = graph.Index();
+  Napi::Value nodes = spec.Get("nodes");
+  if (nodes.IsArray()) {
+    Napi::Array items = nodes.As<Napi::Array>();
+    for (uint32_t i = 0; i < items.Length(); i++) {
+      Napi::Object node = items.Get(i).As<Napi::Object>();
+      Napi::Object props = node.Get("props").As<Napi::Object>();
+      Napi::Array keys = props.GetPropertyNames();
+
+      // GraphProp only borrows the strings
+      std::vector<std::string> strings;
+      strings.reserve(keys.Length() * 2);
+      for (uint32_t k = 0; k < keys.Length(); k++) {
+        Napi::Value key = keys.Get(k);
+        strings.push_back(key.ToString().Utf8Value());
+        strings.push_back(props.Get(key).ToString().Utf8Value());
+      }
+      std::vector<GraphProp> graphProps;
+      for (size_t k = 0; k < strings.size(); k += 2) {
+        graphProps.push_back(GraphProp{strings[k].c_str(), strings[k + 1].c_str()});
+      }
+      index.UpdateNode(readUint32Option(node, "id", 0), graphProps.data(), graphProps.size());
+    }
+  }
+
+  Napi::Value links = spec.Get("links");
+  if (links.IsArray()) {
+    Napi::Array items = links.As<Napi::Array>();
+    for (uint32_t i = 0; i < items.Length(); i++) {
+      Napi::Value link = items.Get(i);
+      index.AddLink(readUint32Option(link, "id", 0), readUint32Option(link, "output", 0),
+                    readUint32Option(link, "input", 0));
+    }
+  }
+
+  return env.Undefined();
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "getRunningProcesses"),
+              TimedFunction(env, "getRunningProcesses", GetRunningProcessesFunc));
+
+  exports.Set(Napi::String::New(env, "getRunningProcessesAsync"),
+              TimedFunction(env, "getRunningProcessesAsync", GetRunningProcessesAsyncFunc));
+
+  exports.Set(Napi::String::New(env, "getProcesses"),
+              TimedFunction(env, "getProcesses", GetProcessesFunc));
+
+  exports.Set(Napi::String::New(env, "getProcessesAsync"),
+              TimedFunction(env, "getProcessesAsync", GetProcessesAsyncFunc));
+
+  exports.Set(Napi::String::New(env, "getRunningProcessesDelta"),
+              TimedFunction(env, "getRunningProcessesDelta", GetRunningProcessesDeltaFunc));
+
+  exports.Set(Napi::String::New(env, "getProcessCacheStats"),
+              TimedFunction(env, "getProcessCacheStats", GetProcessCacheStatsFunc));
+
+  exports.Set(Napi::String::New(env, "watchProcesses"),
+              TimedFunction(env, "watchProcesses", WatchProcessesFunc));
+
+  exports.Set(Napi::String::New(env, "getProcessWatchStats"),
+              TimedFunction(env, "getProcessWatchStats", GetProcessWatchStatsFunc));
+
+  exports.Set(Napi::String::New(env, "startMicTimeline"),
+              TimedFunction(env, "startMicTimeline", StartMicTimelineFunc));
+
+  exports.Set(Napi::String::New(env, "stopMicTimeline"),
+              TimedFunction(env, "stopMicTimeline", StopMicTimelineFunc));
+
+  exports.Set(Napi::String::New(env, "queryMicTimeline"),
+              TimedFunction(env, "queryMicTimeline", QueryMicTimelineFunc));
+
+  exports.Set(Napi::String::New(env, "exportMicTimeline"),
+              TimedFunction(env, "exportMicTimeline", ExportMicTimelineFunc));
+
+  exports.Set(Napi::String::New(env, "importMicTimeline"),
+              TimedFunction(env, "importMicTimeline", ImportMicTimelineFunc));
+
+  exports.Set(Napi::String::New(env, "getMicTimelineStats"),
+              TimedFunction(env, "getMicTimelineStats", GetMicTimelineStatsFunc));
+
+  exports.Set(Napi::String::New(env, "listInstalledApps"),
+              TimedFunction(env, "listInstalledApps", ListInstalledAppsFunc));
+
+  exports.Set(Napi::String::New(env, "listInstalledAppsAsync"),
+              TimedFunction(env, "listInstalledAppsAsync", ListInstalledAppsAsyncFunc));
+
+  exports.Set(Napi::String::New(env, "startWatchingInstalledApps"),
+              TimedFunction(env, "startWatchingInstalledApps", StartWatchingInstalledAppsFunc));
+
+  exports.Set(Napi::String::New(env, "stopWatchingInstalledApps"),
+              TimedFunction(env, "stopWatchingInstalledApps", StopWatchingInstalledAppsFunc));
+
+  exports.Set(Napi::String::New(env, "getInstalledAppIndexStats"),
+              TimedFunction(env, "getInstalledAppIndexStats", GetInstalledAppIndexStatsFunc));
+
+  exports.Set(Napi::String::New(env, "getRunningInputAudioProcesses"),
+              TimedFunction(env, "getRunningInputAudioProcesses", GetRunningInputAudioProcesses));
+
+  exports.Set(Napi::String::New(env, "getProcessesAccessingMicrophoneWithResult"),
+              TimedFunction(env, "getProcessesAccessingMicrophoneWithResult", GetProcessesAccessingMicrophoneWithResult));
+
+  exports.Set(Napi::String::New(env, "getProcessesAccessingMicrophoneWithResultAsync"),
+              TimedFunction(env, "getProcessesAccessingMicrophoneWithResultAsync", GetProcessesAccessingMicrophoneWithResultAsync));
+
+  exports.Set(Napi::String::New(env, "getProcessesAccessingMicrophoneDebouncedWithResult"),
+              TimedFunction(env, "getProcessesAccessingMicrophoneDebouncedWithResult", GetProcessesAccessingMicrophoneDebouncedWithResult));
+
+  exports.Set(Napi::String::New(env, "getProcessesAccessingSpeakersWithResult"),
+              TimedFunction(env, "getProcessesAccessingSpeakersWithResult", GetProcessesAccessingSpeakersWithResult));
+
+  exports.Set(Napi::String::New(env, "getProcessesAccessingSpeakersWithResultAsync"),
+              TimedFunction(env, "getProcessesAccessingSpeakersWithResultAsync", GetProcessesAccessingSpeakersWithResultAsync));
+
+  MicMonitorHub::Init(env, exports, createPipeWireMicBackend);
+  OCRInit(env, exports, CreateTesseractOCRBackend);
+  NativeStatsInit(env, exports);
+  ExecutorInit(env, exports);
+
+  // Hooks for the stress tests and benchmarks, not part of the public API
+  Napi::Object internal = Napi::Object::New(env);
+  internal.Set("startSyntheticEvents", Napi::Function::New(env, StartSyntheticEvents));
+  internal.Set("getSyntheticEventStats", Napi::Function::New(env, GetSyntheticEventStats));
+  internal.Set("stopSyntheticEvents", Napi::Function::New(env, StopSyntheticEvents));
+  internal.Set("useSyntheticMicBackend", Napi::Function::New(env, UseSyntheticMicBackend));
+  internal.Set("injectMicEvents", Napi::Function::New(env, InjectMicEvents));
+  internal.Set("recordMicUses", Napi::Function::New(env, RecordMicUses));
+  internal.Set("runDebouncer", Napi::Function::New(env, RunDebouncer));
+  internal.Set("setProcRoot", Napi::Function::New(env, SetProcRootFunc));
+  internal.Set("loadSyntheticGraph", Napi::Function::New(env, LoadSyntheticGraph));
+  OCRInternalInit(env, internal);
+  exports.Set(Napi::String::New(env, "__internal"), internal);
+
+  return exports;
+}
+
+NODE_API_MODULE(linux_utils, Init)
@@ -1,27 +1,9 @@
 #pragma once
-#include <string>
-#include <vector>
+#include <memory>
 
-class Rectangle {
-public:
-  size_t x, y, width, height;
-};
+#include "../common/OCR.h"
 
-class OCRObservation {
-public:
-  Rectangle bbox;
-  std::string text;
-  OCRObservation(const Rectangle &bbox, const std::string &text)
-      : bbox(bbox), text(text) {};
-};
+OCRData OCRImageData(const OCRImage &image, const OCROptions &options);
 
-class OCRData {
-public:
-  bool success;
-  std::vector<OCRObservation> observations;
-  OCRData(std::vector<OCRObservation> &observations)
-      : success(true), observations(observations) {}
-  OCRData(const bool &success) : success(success) {}
-};
-
-OCRData OCRImageData(const std::vector<uint8_t> &);
+// Vision text recognition as an OCRBackend
+std::unique_ptr<OCRBackend> CreateVisionOCRBackend();
@@ -4,31 +4,66 @@
 
 #include "./ImageOCR.h"
 
-OCRData OCRImageData(const std::vector<uint8_t> &data) {
-  auto length(data.size());
-  auto rawData(data.data());
+// Wraps a raw frame without copying; alpha is skipped.
+static CGImageRef CreateRawImage(const OCRImage &image, CGDataProviderRef prov) {
+  CGColorSpaceRef space(image.format == OCR_FORMAT_GRAY8
+                            ? CGColorSpaceCreateDeviceGray()
+                            : CGColorSpaceCreateDeviceRGB());
+  CGBitmapInfo info;
+  switch (image.format) {
+  case OCR_FORMAT_BGRA:
+    info = kCGBitmapByteOrder32Little | kCGImageAlphaNoneSkipFirst;
+    break;
+  case OCR_FORMAT_RGBA:
+    info = kCGBitmapByteOrder32Big | kCGImageAlphaNoneSkipLast;
+    break;
+  default:
+    info = kCGBitmapByteOrderDefault | kCGImageAlphaNone;
+    break;
+  }
+  size_t bpp(OCRBytesPerPixel(image.format));
+  CGImageRef cgImage(CGImageCreate(image.width, image.height, 8, bpp * 8,
+                                   image.stride, space, info, prov, nullptr,
+                                   false, kCGRenderingIntentDefault));
+  CGColorSpaceRelease(space);
+  return cgImage;
+}
+
+OCRData OCRImageData(const OCRImage &image, const OCROptions &options) {
+  // The provider reads the caller's buffer in place; it is released before
+  // this function returns.
   CGDataProviderRef prov(
-      CGDataProviderCreateWithData(nullptr, rawData, length, nullptr));
+      CGDataProviderCreateWithData(nullptr, image.data, image.length, nullptr));
   if (prov == nullptr) {
     return OCRData(false);
   }
   std::vector<OCRObservation> observations;
 
   @autoreleasepool {
-    auto image(CGImageCreateWithPNGDataProvider(prov, NULL, true,
-                                                kCGRenderingIntentDefault));
+    auto cgImage(image.format == OCR_FORMAT_PNG
+                     ? CGImageCreateWithPNGDataProvider(
+                           prov, NULL, true, kCGRenderingIntentDefault)
+                     : CreateRawImage(image, prov));
     CGDataProviderRelease(prov);
-    if (image == nullptr) {
-      return OCRData(false);
+    if (cgImage == nullptr) {
+      return OCRData(std::string(image.format == OCR_FORMAT_PNG
+                                     ? "Could not decode PNG image"
+                                     : "Could not wrap image frame"));
     }
 
-    auto options([NSDictionary alloc]);
-    auto handler([[VNImageRequestHandler alloc] initWithCGImage:image
-                                                        options:options]);
+    auto handler([[VNImageRequestHandler alloc] initWithCGImage:cgImage
+                                                        options:@{}]);
 
     auto foundresults(false);
     if (handler != nullptr) {
       auto request([[VNRecognizeTextRequest alloc] init]);
+      if (!options.languages.empty()) {
+        NSMutableArray<NSString *> *languages = [NSMutableArray array];
+        for (const auto &language : options.languages) {
+          [languages addObject:[NSString stringWithUTF8String:language.c_str()]];
+        }
+        request.recognitionLanguages = languages;
+      }
       NSError *err(nullptr);
       [handler performRequests:@[ request ] error:&err];
 
@@ -37,15 +72,17 @@ OCRData OCRImageData(const std::vector<uint8_t> &data) {
 
         if (results != nullptr) {
           foundresults = true;
-          auto width(CGImageGetWidth(image)), height(CGImageGetHeight(image));
+          auto width(CGImageGetWidth(cgImage)), height(CGImageGetHeight(cgImage));
           for (NSUInteger i(0); i < [results count]; ++i) {
             auto result([results objectAtIndex:i]);
             auto bbox(VNImageRectForNormalizedRect([result boundingBox], width,
                                                    height));
             auto firstObject([[result topCandidates:1] firstObject]);
             if (firstObject != nullptr && [firstObject string] != nullptr) {
+              // Vision puts the origin at the bottom-left corner
+              double top = double(height) - bbox.origin.y - bbox.size.height;
               const auto rect(
-                  Rectangle{size_t(bbox.origin.x), size_t(bbox.origin.y),
+                  Rectangle{size_t(bbox.origin.x), size_t(top > 0 ? top : 0),
                             size_t(bbox.size.width), size_t(bbox.size.height)});
               const std::string text([[firstObject string] UTF8String]);
               observations.emplace_back(rect, text);
@@ -54,7 +91,7 @@ OCRData OCRImageData(const std::vector<uint8_t> &data) {
         }
       }
     }
-    CGImageRelease(image);
+    CGImageRelease(cgImage);
     if (foundresults) {
       return OCRData(observations);
     } else {
@@ -62,3 +99,20 @@ OCRData OCRImageData(const std::vector<uint8_t> &data) {
     }
   }
 }
+
+namespace {
+
+class VisionOCRBackend : public OCRBackend {
+public:
+  const char *Name() const override { return "vision"; }
+
+  OCRData Recognize(const OCRImage &image, const OCROptions &options) override {
+    return OCRImageData(image, options);
+  }
+};
+
+} // namespace
+
+std::unique_ptr<OCRBackend> CreateVisionOCRBackend() {
+  return std::unique_ptr<OCRBackend>(new VisionOCRBackend());
+}
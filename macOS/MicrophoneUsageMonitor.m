@@ -1,4 +1,5 @@
 #import "MicrophoneUsageMonitor.h"
+#include "../common/NativeStats.h"
 
 static NSString * const errorDomain = @"com.MicrophoneUsageMonitor";
 
@@ -6,7 +7,12 @@ static NSString * const errorDomain = @"com.MicrophoneUsageMonitor";
 
 @property (nonatomic, assign) AudioDeviceID micDeviceID;
 @property (nonatomic, copy) void (^callback)(UInt32 inNumberAddresses, const AudioObjectPropertyAddress *inAddresses);
-@property (nonatomic, copy) void (^storedCompletion)(BOOL microphoneActive, NSError * _Nullable error);
+@property (nonatomic, copy) void (^deviceChangeCallback)(UInt32 inNumberAddresses, const AudioObjectPropertyAddress *inAddresses);
+// Read from the CoreAudio queue as well; nil once monitoring stopped
+@property (copy) void (^storedCompletion)(BOOL microphoneActive, NSError * _Nullable error);
+// The delayed restart scheduled by restartMonitoring, cancelled on stop
+@property (nonatomic, strong) dispatch_block_t pendingRestart;
+@property (nonatomic, assign) BOOL stopped;
 
 - (AudioDeviceID)getDefaultInputDeviceIDWithError:(NSError **) error;
 
@@ -33,15 +39,46 @@ static AudioObjectPropertyAddress defaultInputDeviceAddress = (AudioObjectProper
 @implementation MicrophoneUsageMonitor {}
 
 - (void)restartMonitoring {
-  [self cleanup];
-
-  self.storedCompletion(NO, [self makeInfoErrorWithMessage: @"Waiting to restart monitoring..."]);
-  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(3.0 * NSEC_PER_SEC)),
-                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-       self.storedCompletion(NO, [self makeInfoErrorWithMessage: @"✅ Restarting monitoring"]);
-       [self startMonitoringInternal:self.storedCompletion];
-   });
+  @synchronized (self) {
+    if (self.stopped) {
+      return;
+    }
+    NativeStatsCount("micMonitor.restarts");
+    [self cleanup];
+
+    [self report:NO error:[self makeInfoErrorWithMessage: @"Waiting to restart monitoring..."]];
+    if (self.pendingRestart) {
+      dispatch_block_cancel(self.pendingRestart);
+    }
+
+    // Weak, so a pending restart neither keeps a stopped monitor alive nor
+    // adds its listener back.
+    __weak typeof(self) weakSelf = self;
+    self.pendingRestart = dispatch_block_create(0, ^{
+      __strong typeof(weakSelf) strongSelf = weakSelf;
+      if (!strongSelf) return;
+
+      @synchronized (strongSelf) {
+        if (strongSelf.stopped) {
+          return;
+        }
+        strongSelf.pendingRestart = nil;
+        [strongSelf report:NO error:[strongSelf makeInfoErrorWithMessage: @"✅ Restarting monitoring"]];
+        [strongSelf startMonitoringInternal:strongSelf.storedCompletion];
+      }
+    });
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(3.0 * NSEC_PER_SEC)),
+                   dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                   self.pendingRestart);
+  }
+}
+
+- (void)report:(BOOL)microphoneActive error:(NSError * _Nullable)error {
+  void (^completion)(BOOL microphoneActive, NSError * _Nullable error) = self.storedCompletion;
+  if (completion) {
+    completion(microphoneActive, error);
   }
+}
 
 -(void)startMonitoringInternal:(void (^)(BOOL microphoneActive, NSError * _Nullable error))completion {
 
@@ -67,6 +104,7 @@ static AudioObjectPropertyAddress defaultInputDeviceAddress = (AudioObjectProper
 }
 
 - (void)startMonitoring:(void (^)(BOOL microphoneActive, NSError * _Nullable error))completion {
+  self.stopped = NO;
   self.storedCompletion = completion;
 
   NSError *error = nil;
@@ -77,12 +115,14 @@ static AudioObjectPropertyAddress defaultInputDeviceAddress = (AudioObjectProper
     return;
   }
 
+  self.deviceChangeCallback = [self createMicrophoneCallback];
   OSStatus microphoneAddressStatus = AudioObjectAddPropertyListenerBlock(kAudioObjectSystemObject,
                                                          &defaultInputDeviceAddress,
                                                          dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
-                                                         [self createMicrophoneCallback]);
+                                                         self.deviceChangeCallback);
 
   if (microphoneAddressStatus != noErr) {
+    self.deviceChangeCallback = nil;
     completion(NO, [self makeErrorWithCode:microphoneAddressStatus message:@"Error in AudioObjectAddPropertyListenerBlock"]);
     return;
   }
@@ -188,7 +228,7 @@ static AudioObjectPropertyAddress defaultInputDeviceAddress = (AudioObjectProper
 - (void)cleanup {
   if (self.callback) {
     NSString *message = [NSString stringWithFormat:@"Removing AudioObjectRemovePropertyListenerBlock for micDeviceID: %u", self.micDeviceID];
-    self.storedCompletion(NO, [self makeInfoErrorWithMessage: message]);
+    [self report:NO error:[self makeInfoErrorWithMessage: message]];
     AudioObjectRemovePropertyListenerBlock(self.micDeviceID,
                                          &micPropertyAddress,
                                          dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
@@ -197,8 +237,25 @@ static AudioObjectPropertyAddress defaultInputDeviceAddress = (AudioObjectProper
   }
 }
 
+// Cancels the pending restart, removes both listeners and drops the
+// completion. A listener block that is already running may still call it.
 - (void)stopMonitoring {
-  [self cleanup];
+  @synchronized (self) {
+    self.stopped = YES;
+    if (self.pendingRestart) {
+      dispatch_block_cancel(self.pendingRestart);
+      self.pendingRestart = nil;
+    }
+    if (self.deviceChangeCallback) {
+      AudioObjectRemovePropertyListenerBlock(kAudioObjectSystemObject,
+                                             &defaultInputDeviceAddress,
+                                             dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                                             self.deviceChangeCallback);
+      self.deviceChangeCallback = nil;
+    }
+    [self cleanup];
+    self.storedCompletion = nil;
+  }
 }
 
 - (void)dealloc {
@@ -206,6 +263,7 @@ static AudioObjectPropertyAddress defaultInputDeviceAddress = (AudioObjectProper
 }
 
   - (NSError*)makeErrorWithCode:(OSStatus)code message:(NSString*)message {
+    NativeStatsBackendError("coreaudio", code);
     return [NSError errorWithDomain:errorDomain
                               code:code
                           userInfo:@{NSLocalizedDescriptionKey: message}];
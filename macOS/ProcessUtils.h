@@ -2,6 +2,8 @@
 #include <string>
 #include <vector>
 
+#include "../common/ProcessSnapshot.h"
+
 class InstalledApp {
 public:
   std::string AppType;
@@ -13,6 +15,7 @@ public:
 };
 
 std::vector<std::string> GetRunningProcesses();
+std::vector<ProcessEntry> GetRunningProcessEntries();
 std::vector<InstalledApp> ListInstalledApps();
 std::vector<std::string> ListRunningAppIds();
 std::unique_ptr<InstalledApp> CurrentApp();
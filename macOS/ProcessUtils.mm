@@ -6,48 +6,81 @@
 #include <vector>
 
 #include "ProcessUtils.h"
+#include "../common/ProcessPathCache.h"
+#include "../common/ProcessTree.h"
 
-std::vector<std::string> GetRunningProcesses() {
-  std::vector<std::string> processes;
+std::vector<ProcessEntry> GetRunningProcessEntries() {
+  std::vector<ProcessEntry> entries;
 
-  static int maxArgumentSize(0);
-  size_t size = sizeof(maxArgumentSize);
-  if (sysctl((int[]){CTL_KERN, KERN_ARGMAX}, 2, &maxArgumentSize, &size, NULL, 0) == -1) {
-    maxArgumentSize = 4096; // Default
-  }
   int mib[3] = {CTL_KERN, KERN_PROC, KERN_PROC_ALL};
   struct kinfo_proc *info;
   size_t length;
-  int count;
 
   if (sysctl(mib, 3, NULL, &length, NULL, 0) < 0) {
-    return processes;
+    return entries;
   }
 
   if (!(info = (kinfo_proc *)malloc(length))) {
-    return processes;
+    return entries;
   }
 
   if (sysctl(mib, 3, info, &length, NULL, 0) < 0) {
     free(info);
-    return processes;
+    return entries;
   }
 
-  count = length / sizeof(struct kinfo_proc);
-  char pathbuf[PROC_PIDPATHINFO_MAXSIZE];
+  int count = length / sizeof(struct kinfo_proc);
+  entries.reserve(count);
+  std::vector<ProcessKey> live;
+  live.reserve(count);
+
+  auto &cache = ProcessPathCache::Shared();
+  CachedProcessInfo cached;
   for (int i = 0; i < count; i++) {
     pid_t pid = info[i].kp_proc.p_pid;
     if (pid == 0) {
       continue;
     }
 
-    int ret = proc_pidpath(pid, pathbuf, sizeof(pathbuf));
-    if (ret > 0) {
-      processes.push_back(std::string(pathbuf));
+    const struct timeval &started = info[i].kp_proc.p_starttime;
+    ProcessKey key{uint32_t(pid), uint64_t(started.tv_sec) * 1000000 +
+                                      uint64_t(started.tv_usec)};
+    live.push_back(key);
+
+    // p_comm changes on exec(), which keeps the key
+    bool resolved = cache.Lookup(key, info[i].kp_proc.p_comm, [pid](std::string &path) {
+      char pathbuf[PROC_PIDPATHINFO_MAXSIZE];
+      int ret = proc_pidpath(pid, pathbuf, sizeof(pathbuf));
+      if (ret <= 0) {
+        return false;
+      }
+      path.assign(pathbuf, ret);
+      return true;
+    }, cached);
+
+    if (resolved) {
+      entries.push_back(ProcessEntry{key.pid, key.startTime, cached.path,
+                                     uint32_t(info[i].kp_eproc.e_ppid)});
     }
   }
   free(info);
 
+  // Anything not seen in this pass has exited.
+  cache.Retain(live);
+  ProcessTree::Shared().Update(entries);
+
+  return entries;
+}
+
+std::vector<std::string> GetRunningProcesses() {
+  auto entries = GetRunningProcessEntries();
+
+  std::vector<std::string> processes;
+  processes.reserve(entries.size());
+  for (auto &entry : entries) {
+    processes.push_back(std::move(entry.path));
+  }
+
   return processes;
 }
 
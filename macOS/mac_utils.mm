@@ -4,11 +4,20 @@
 #import "MicrophoneUsageMonitor.h"
 #import "MicrophonePermissions.h"
 #import "ScreenCapturePermissions.h"
+#include "ImageOCR.h"
 #include "ProcessUtils.h"
+#include "../common/AsyncTasks.h"
+#include "../common/ExecutorExports.h"
+#include "../common/Marshal.h"
+#include "../common/MicMonitorHub.h"
+#include "../common/NativeStats.h"
+#include "../common/NativeStatsExports.h"
+#include "../common/OCRExports.h"
+#include "../common/PackedStrings.h"
+#include "../common/ProcessPathCache.h"
 #include <napi.h>
 
-static MicrophoneUsageMonitor *monitor = nil;
-static Napi::ThreadSafeFunction ts_fn;
+static ProcessSnapshotStore processSnapshots;
 
 // Takes the output of BrowserWindow.getNativeWindowHandle
 // (which is a NSView* to the contentView of the window),
@@ -38,146 +47,145 @@ Napi::Value GetRunningInputAudioProcesses(const Napi::CallbackInfo& info) {
   return result;
 }
 
-// Gets processes accessing microphone with structured result
-Napi::Value GetProcessesAccessingMicrophoneWithResult(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
+// Plain C++ copy of AudioProcessResult so it can cross threads
+struct MicrophoneResult {
+  bool success;
+  std::vector<std::string> processes;
+  std::string error;
+  long code;
+  std::string domain;
+
+  MicrophoneResult() : success(true), code(0) {}
+};
+
+static MicrophoneResult ReadProcessesAccessingMicrophone() {
+  MicrophoneResult out;
+
+  @autoreleasepool {
+    struct AudioProcessResult result = [AudioProcessMonitor getProcessesAccessingMicrophoneWithResult];
+    out.success = result.success;
+    if (!result.success) {
+      const char *description = [result.error.localizedDescription UTF8String];
+      const char *domain = [result.error.domain UTF8String];
+      out.error = description != nullptr ? description : "Unknown error occurred";
+      out.domain = domain != nullptr ? domain : "";
+      out.code = (long)result.error.code;
+      NativeStatsBackendError("coreaudio", out.code);
+    } else {
+      out.processes.reserve([result.processes count]);
+      for (NSString *process in result.processes) {
+        out.processes.push_back([process UTF8String]);
+      }
+    }
+  }
 
-  struct AudioProcessResult result = [AudioProcessMonitor getProcessesAccessingMicrophoneWithResult];
+  return out;
+}
 
+static Napi::Array stringsToArray(const Napi::Env& env, const std::vector<std::string>& strings) {
+  Napi::Array result = Napi::Array::New(env, strings.size());
+  for (size_t i = 0; i < strings.size(); i++) {
+      result.Set(i, Napi::String::New(env, strings[i]));
+  }
+
+  return result;
+}
+
+static Napi::Object microphoneResultToObject(const Napi::Env& env, const MicrophoneResult& result) {
   // Create a JavaScript object to represent the AudioProcessResult
   Napi::Object resultObj = Napi::Object::New(env);
   if (!result.success) {
     // Set error information
     resultObj.Set("success", Napi::Boolean::New(env, false));
-    resultObj.Set("error", Napi::String::New(env, [result.error.localizedDescription UTF8String]));
-    resultObj.Set("code", Napi::Number::New(env, result.error.code));
-    resultObj.Set("domain", Napi::String::New(env, [result.error.domain UTF8String]));
+    resultObj.Set("error", Napi::String::New(env, result.error));
+    resultObj.Set("code", Napi::Number::New(env, result.code));
+    resultObj.Set("domain", Napi::String::New(env, result.domain));
     resultObj.Set("processes", Napi::Array::New(env));
   } else {
     // Set success information
     resultObj.Set("success", Napi::Boolean::New(env, true));
     resultObj.Set("error", env.Null());
-
-    // Convert processes array
-    Napi::Array processesArray = Napi::Array::New(env);
-    for (NSUInteger i = 0; i < [result.processes count]; i++) {
-        NSString *process = [result.processes objectAtIndex:i];
-        processesArray.Set(i, Napi::String::New(env, [process UTF8String]));
-    }
-    resultObj.Set("processes", processesArray);
+    resultObj.Set("processes", stringsToArray(env, result.processes));
   }
 
   return resultObj;
 }
 
-// Start monitoring microphone usage
-Napi::Value StartMonitoringMic(const Napi::CallbackInfo& info) {
+// Gets processes accessing microphone with structured result
+Napi::Value GetProcessesAccessingMicrophoneWithResult(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
-  Napi::HandleScope scope(env);
-
-  if (info.Length() < 1 || !info[0].IsFunction()) {
-    Napi::TypeError::New(env, "Expected a callback function").ThrowAsJavaScriptException();
-    return env.Null();
-  }
 
-  @try {
-    ts_fn = Napi::ThreadSafeFunction::New(
-      env,
-      info[0].As<Napi::Function>(),
-      "MicListener",
-      0,
-      1,
-      []( Napi::Env ) {
-        // clean up any resources allocated and passed to the callback
-        // In our case the micState bool is deallocated in the callback
-      }
-    );
-
-    // Create and start the monitor
-    monitor = [[MicrophoneUsageMonitor alloc] init];
-    [monitor startMonitoring:^(BOOL microphoneActive, NSError *error) {
-      // Define a struct to hold both the boolean and error
-      struct CallbackData {
-        bool micActive;
-        NSError* error;
-
-        CallbackData(bool active, NSError* err) : micActive(active), error([err retain]) {}
-        ~CallbackData() {
-          if (error) {
-            [error release];
-          }
-        }
-      };
-
-      auto callback = [](Napi::Env env, Napi::Function js_callback, void* data) {
-
-        if (!data) {
-          NSLog(@"🎤 Error: data is null");
-          return;
-        }
+  return microphoneResultToObject(env, ReadProcessesAccessingMicrophone());
+}
 
-        // Cast the void* back to our CallbackData struct
-        CallbackData* cbData = static_cast<CallbackData*>(data);
+// Promise-returning variant of getProcessesAccessingMicrophoneWithResult
+Napi::Value GetProcessesAccessingMicrophoneWithResultAsync(const Napi::CallbackInfo& info) {
+  return QueueExecutorPromise<MicrophoneResult>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getProcessesAccessingMicrophoneWithResultAsync",
+      ReadProcessesAccessingMicrophone, microphoneResultToObject);
+}
 
-        if (!cbData) {
-          NSLog(@"🎤 Error: cbData is null after cast");
-          return;
+// CoreAudio microphone monitoring behind the shared MicMonitorHub. The
+// callback runs on the CoreAudio queue: it copies out what JS needs and
+// returns.
+class MacMicMonitorBackend : public MicMonitorBackend {
+public:
+  bool Start(MonitorEventSink sink, std::string* error) override {
+    // CoreAudio may still run a listener block after stopMonitoring returns,
+    // so the blocks reach the sink through this and Stop() clears it.
+    target_ = std::make_shared<Target>();
+    target_->sink = std::move(sink);
+    std::shared_ptr<Target> target = target_;
+
+    @try {
+      monitor_ = [[MicrophoneUsageMonitor alloc] init];
+      [monitor_ startMonitoring:^(BOOL microphoneActive, NSError *err) {
+        MonitorEvent event;
+        event.active = microphoneActive;
+        if (err != nil) {
+          NSString* errorDesc = [err localizedDescription];
+          event.hasError = true;
+          event.code = int([err code]);
+          event.message = errorDesc != nil ? [errorDesc UTF8String] : "Unknown error occurred";
+          event.domain = [[err domain] UTF8String];
         }
 
-        if (cbData->error != nil) {
-          NSString* errorDesc = [cbData->error localizedDescription];
-          const char* errorStr = nil;
-
-          if (errorDesc != nil) {
-            errorStr = [errorDesc UTF8String];
-          }
-
-          Napi::Error err;
-          if (errorStr != nil) {
-            err = Napi::Error::New(env, errorStr);
-          } else {
-            err = Napi::Error::New(env, "Unknown error occurred");
-          }
-          err.Set("code", Napi::Number::New(env, cbData->error.code));
-          err.Set("domain", Napi::String::New(env, [cbData->error.domain UTF8String]));
-
-          js_callback.Call({ Napi::Boolean::New(env, cbData->micActive), err.Value() });
-        } else {
-          js_callback.Call({Napi::Boolean::New(env, cbData->micActive), env.Null()});
+        std::lock_guard<std::mutex> lock(target->mutex);
+        if (target->sink) {
+          target->sink(std::move(event));
         }
-
-        // Clean up
-        delete cbData;
-      };
-
-      // Create and pass the data to BlockingCall
-      CallbackData* data = new CallbackData{static_cast<bool>(microphoneActive), error};
-
-      ts_fn.BlockingCall(data, callback);
-    }];
-
-    return Napi::Boolean::New(env, true);
-  } @catch (NSException *exception) {
-    Napi::Error::New(env, "Exception occurred while starting monitoring").ThrowAsJavaScriptException();
-    return env.Null();
+      }];
+      return true;
+    } @catch (NSException *exception) {
+      monitor_ = nil;
+      target_.reset();
+      *error = "Exception occurred while starting monitoring";
+      return false;
+    }
   }
-}
-
-// Stop monitoring microphone usage
-Napi::Value StopMonitoringMic(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
 
-  if (monitor) {
-    [monitor stopMonitoring];
-    monitor = nil;
+  // Waits for a block that is delivering an event; later ones are ignored.
+  void Stop() override {
+    if (target_) {
+      std::lock_guard<std::mutex> lock(target_->mutex);
+      target_->sink = nullptr;
+    }
+    target_.reset();
+    if (monitor_) {
+      [monitor_ stopMonitoring];
+      monitor_ = nil;
+    }
   }
 
-  if (ts_fn) {
-    ts_fn.Release();
-  }
+private:
+  struct Target {
+    std::mutex mutex;
+    MonitorEventSink sink;
+  };
 
-  return env.Undefined();
-}
+  MicrophoneUsageMonitor *monitor_ = nil;
+  std::shared_ptr<Target> target_;
+};
 
 // Gets processes accessing microphone with debounced result (macOS delegates to existing method)
 Napi::Value GetProcessesAccessingMicrophoneDebouncedWithResult(const Napi::CallbackInfo& info) {
@@ -198,6 +206,16 @@ Napi::Value GetRenderProcessesWithResult(const Napi::CallbackInfo& info) {
   return resultObj;
 }
 
+// Promise-returning variant of the getRenderProcessesWithResult no-op
+Napi::Value GetRenderProcessesWithResultAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+  deferred.Resolve(GetRenderProcessesWithResult(info));
+
+  return deferred.Promise();
+}
+
 // Gets the microphone authorization status
 Napi::Value GetMicrophoneAuthorizationStatus(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
@@ -260,52 +278,113 @@ Napi::Value RequestScreenCaptureAccess(const Napi::CallbackInfo& info) {
 Napi::Value GetRunningProcessesFunc(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
-  auto processes = GetRunningProcesses();
-  Napi::Array result = Napi::Array::New(env);
-  for (size_t i = 0; i < processes.size(); i++) {
-      result.Set(i, Napi::String::New(env, processes[i]));
+  if (WantsPackedStrings(info, 0)) {
+    return PackedStringsToObject(env, PackStrings(GetRunningProcesses()));
   }
+  return stringsToArray(env, GetRunningProcesses());
+}
+
+// Promise-returning variant of getRunningProcesses
+Napi::Value GetRunningProcessesAsyncFunc(const Napi::CallbackInfo& info) {
+  if (WantsPackedStrings(info, 0)) {
+    return QueueExecutorPromise<PackedStrings>(
+        info.Env(), EXECUTOR_INTERACTIVE, "getRunningProcessesAsync",
+        []() { return PackStrings(GetRunningProcesses()); }, PackedStringsToObject);
+  }
+  return QueueExecutorPromise<std::vector<std::string>>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getRunningProcessesAsync", GetRunningProcesses,
+      stringsToArray);
+}
+
+// Gets the processes started and exited since the given snapshot generation
+Napi::Value GetRunningProcessesDeltaFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  uint64_t generation = 0;
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    generation = uint64_t(info[0].As<Napi::Number>().Int64Value());
+  }
+
+  auto delta = processSnapshots.Update(GetRunningProcessEntries(), generation);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("added", stringsToArray(env, delta.added));
+  result.Set("removed", stringsToArray(env, delta.removed));
+  result.Set("generation", Napi::Number::New(env, double(delta.generation)));
+  result.Set("full", Napi::Boolean::New(env, delta.full));
 
   return result;
 }
 
+// Gets hit/miss counters of the shared PID to executable path cache
+Napi::Value GetProcessCacheStatsFunc(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  auto stats = ProcessPathCache::Shared().Stats();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("hits", Napi::Number::New(env, double(stats.hits)));
+  result.Set("misses", Napi::Number::New(env, double(stats.misses)));
+  result.Set("entries", Napi::Number::New(env, double(stats.entries)));
+
+  return result;
+}
 
 // Gets a list of full package IDs
 Napi::Value GetRunningAppIDsFunc(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
-  auto appIds = ListRunningAppIds();
-  Napi::Array result = Napi::Array::New(env);
-  for (size_t i = 0; i < appIds.size(); i++) {
-      result.Set(i, Napi::String::New(env, appIds[i]));
+  if (WantsPackedStrings(info, 0)) {
+    return PackedStringsToObject(env, PackStrings(ListRunningAppIds()));
   }
+  return stringsToArray(env, ListRunningAppIds());
+}
 
-  return result;
+// Promise-returning variant of getRunningAppIDs
+Napi::Value GetRunningAppIDsAsyncFunc(const Napi::CallbackInfo& info) {
+  if (WantsPackedStrings(info, 0)) {
+    return QueueExecutorPromise<PackedStrings>(
+        info.Env(), EXECUTOR_INTERACTIVE, "getRunningAppIDsAsync",
+        []() { return PackStrings(ListRunningAppIds()); }, PackedStringsToObject);
+  }
+  return QueueExecutorPromise<std::vector<std::string>>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getRunningAppIDsAsync", ListRunningAppIds,
+      stringsToArray);
 }
 
+template <> struct MarshalFields<InstalledApp> {
+  static auto Get() {
+    return std::make_tuple(Marshal::Field("type", &InstalledApp::AppType),
+                           Marshal::Field("name", &InstalledApp::AppName),
+                           Marshal::Field("id", &InstalledApp::Id),
+                           Marshal::Field("version", &InstalledApp::Version));
+  }
+};
+
 static Napi::Object installedAppToObject(const Napi::Env& env, const InstalledApp& app) {
-    Napi::Object appObj = Napi::Object::New(env);
-    appObj.Set("type", Napi::String::New(env, app.AppType));
-    appObj.Set("name", Napi::String::New(env, app.AppName));
-    appObj.Set("id", Napi::String::New(env, app.Id));
-    appObj.Set("version", Napi::String::New(env, app.Version));
+  return Marshal::ToObject(env, app);
+}
 
-    return appObj;
+static Napi::Array installedAppsToArray(const Napi::Env& env, const std::vector<InstalledApp>& apps) {
+  return Marshal::ToArray(env, apps);
 }
 
 // Gets installed apps
 Napi::Value ListInstalledAppsFunc(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
-  auto apps = ListInstalledApps();
-  Napi::Array result = Napi::Array::New(env);
-  auto index(0);
-  for (auto app : apps) {
-      result.Set(index, installedAppToObject(env, app));
-      index += 1;
-  }
+  return installedAppsToArray(env, ListInstalledApps());
+}
 
-  return result;
+// Promise-returning variant of listInstalledApps; the bundle walk runs off the
+// JS thread, in the executor's bulk lane. {signal} cancels it until it starts.
+Napi::Value ListInstalledAppsAsyncFunc(const Napi::CallbackInfo& info) {
+  Napi::Object signal;
+  if (!ReadAbortSignal(info.Env(), info[0], &signal)) {
+    return info.Env().Null();
+  }
+  return QueueExecutorPromise<std::vector<InstalledApp>>(
+      info.Env(), EXECUTOR_BULK, "listInstalledAppsAsync", ListInstalledApps,
+      installedAppsToArray, Napi::Object(), signal);
 }
 
 Napi::Value CurrentInstalledAppFunc(const Napi::CallbackInfo& info) {
@@ -326,45 +405,68 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
               Napi::Function::New(env, MakeKeyAndOrderFront));
 
   exports.Set(Napi::String::New(env, "getRunningInputAudioProcesses"),
-              Napi::Function::New(env, GetRunningInputAudioProcesses));
+              TimedFunction(env, "getRunningInputAudioProcesses", GetRunningInputAudioProcesses));
 
   exports.Set(Napi::String::New(env, "getProcessesAccessingMicrophoneWithResult"),
-              Napi::Function::New(env, GetProcessesAccessingMicrophoneWithResult));
+              TimedFunction(env, "getProcessesAccessingMicrophoneWithResult", GetProcessesAccessingMicrophoneWithResult));
 
-  exports.Set(Napi::String::New(env, "getProcessesAccessingMicrophoneDebouncedWithResult"),
-              Napi::Function::New(env, GetProcessesAccessingMicrophoneDebouncedWithResult));
+  exports.Set(Napi::String::New(env, "getProcessesAccessingMicrophoneWithResultAsync"),
+              TimedFunction(env, "getProcessesAccessingMicrophoneWithResultAsync", GetProcessesAccessingMicrophoneWithResultAsync));
 
-  exports.Set(Napi::String::New(env, "startMonitoringMic"),
-              Napi::Function::New(env, StartMonitoringMic));
+  exports.Set(Napi::String::New(env, "getProcessesAccessingMicrophoneDebouncedWithResult"),
+              TimedFunction(env, "getProcessesAccessingMicrophoneDebouncedWithResult", GetProcessesAccessingMicrophoneDebouncedWithResult));
 
-  exports.Set(Napi::String::New(env, "stopMonitoringMic"),
-              Napi::Function::New(env, StopMonitoringMic));
+  MicMonitorHub::Init(env, exports, []() {
+    return std::unique_ptr<MicMonitorBackend>(new MacMicMonitorBackend());
+  });
 
   exports.Set(Napi::String::New(env, "getProcessesAccessingSpeakersWithResult"),
-              Napi::Function::New(env, GetRenderProcessesWithResult));
+              TimedFunction(env, "getProcessesAccessingSpeakersWithResult", GetRenderProcessesWithResult));
+
+  exports.Set(Napi::String::New(env, "getProcessesAccessingSpeakersWithResultAsync"),
+              TimedFunction(env, "getProcessesAccessingSpeakersWithResultAsync", GetRenderProcessesWithResultAsync));
 
   exports.Set(Napi::String::New(env, "getMicrophoneAuthorizationStatus"),
-              Napi::Function::New(env, GetMicrophoneAuthorizationStatus));
+              TimedFunction(env, "getMicrophoneAuthorizationStatus", GetMicrophoneAuthorizationStatus));
 
   exports.Set(Napi::String::New(env, "requestMicrophoneAccess"),
-              Napi::Function::New(env, RequestMicrophoneAccess));
+              TimedFunction(env, "requestMicrophoneAccess", RequestMicrophoneAccess));
 
   exports.Set(Napi::String::New(env, "checkScreenCaptureAccess"),
-              Napi::Function::New(env, CheckScreenCaptureAccess));
+              TimedFunction(env, "checkScreenCaptureAccess", CheckScreenCaptureAccess));
 
   exports.Set(Napi::String::New(env, "requestScreenCaptureAccess"),
-              Napi::Function::New(env, RequestScreenCaptureAccess));
+              TimedFunction(env, "requestScreenCaptureAccess", RequestScreenCaptureAccess));
   exports.Set(Napi::String::New(env, "getRunningProcesses"),
-              Napi::Function::New(env, GetRunningProcessesFunc));
+              TimedFunction(env, "getRunningProcesses", GetRunningProcessesFunc));
+
+  exports.Set(Napi::String::New(env, "getRunningProcessesAsync"),
+              TimedFunction(env, "getRunningProcessesAsync", GetRunningProcessesAsyncFunc));
+
+  exports.Set(Napi::String::New(env, "getRunningProcessesDelta"),
+              TimedFunction(env, "getRunningProcessesDelta", GetRunningProcessesDeltaFunc));
+
+  exports.Set(Napi::String::New(env, "getProcessCacheStats"),
+              TimedFunction(env, "getProcessCacheStats", GetProcessCacheStatsFunc));
 
   exports.Set(Napi::String::New(env, "getRunningAppIDs"),
-              Napi::Function::New(env, GetRunningAppIDsFunc));
+              TimedFunction(env, "getRunningAppIDs", GetRunningAppIDsFunc));
+
+  exports.Set(Napi::String::New(env, "getRunningAppIDsAsync"),
+              TimedFunction(env, "getRunningAppIDsAsync", GetRunningAppIDsAsyncFunc));
 
   exports.Set(Napi::String::New(env, "listInstalledApps"),
-              Napi::Function::New(env, ListInstalledAppsFunc));
+              TimedFunction(env, "listInstalledApps", ListInstalledAppsFunc));
+
+  exports.Set(Napi::String::New(env, "listInstalledAppsAsync"),
+              TimedFunction(env, "listInstalledAppsAsync", ListInstalledAppsAsyncFunc));
 
   exports.Set(Napi::String::New(env, "currentInstalledApp"),
-              Napi::Function::New(env, CurrentInstalledAppFunc));
+              TimedFunction(env, "currentInstalledApp", CurrentInstalledAppFunc));
+
+  OCRInit(env, exports, CreateVisionOCRBackend);
+  NativeStatsInit(env, exports);
+  ExecutorInit(env, exports);
 
   return exports;
 }
@@ -0,0 +1,98 @@
+/**
+ * Test for the activity debouncer behind the debounced microphone query
+ * (Linux only)
+ *
+ * Drives the native engine through the internal hook on a fake clock and
+ * checks each transition: reporting active, the hold after the last active
+ * sample, the inactive debounce, the extended debounce of a flapping id and
+ * forgetting ids that stayed quiet.
+ */
+
+const { check, finish, requireLinux } = require("./test-helpers.js");
+
+const { runDebouncer } = requireLinux("Debouncer test", { internal: true });
+
+// Samples of one id as [time, active] pairs; returns what each reported
+function sample(options, samples) {
+  return runDebouncer(
+    options,
+    samples.map(([at, active]) => ({ at, id: "mic", active }))
+  ).map((result) => result.reported);
+}
+
+function same(a, b) {
+  return JSON.stringify(a) === JSON.stringify(b);
+}
+
+// Every sample that disagrees with the reported state counts as a rapid
+// change, so the tests that are not about flapping raise the limit.
+const calm = { maxRapidChanges: 100 };
+
+check("a new user is reported on the first sample by default", same(sample({}, [[0, true]]), [true]));
+
+check(
+  "active after requiredActiveChecks samples",
+  same(sample({ ...calm, requiredActiveChecks: 3 }, [[0, true], [100, true], [200, true]]), [false, false, true])
+);
+
+check(
+  "held for activeHoldMs after the last active sample",
+  same(
+    sample({ ...calm, activeHoldMs: 5000, debounceMs: 0, requiredInactiveChecks: 1 }, [
+      [0, true],
+      [1000, false],
+      [4900, false],
+      [5100, false],
+    ]),
+    [true, true, true, false]
+  )
+);
+
+const debounced = { ...calm, activeHoldMs: 0, debounceMs: 3000, requiredInactiveChecks: 2 };
+check(
+  "inactive only once debounceMs passed since the change",
+  same(sample(debounced, [[0, true], [1000, false], [2000, false], [3500, false]]), [true, true, true, false])
+);
+check(
+  "inactive only after requiredInactiveChecks samples",
+  same(sample(debounced, [[0, true], [4000, false], [4100, false]]), [true, true, false])
+);
+
+const flapping = [[0, true], [200, false], [400, true], [600, false], [5300, false], [5500, false]];
+const thresholds = { activeHoldMs: 0, debounceMs: 100, requiredInactiveChecks: 1, rapidChangeWindowMs: 60000 };
+check(
+  "a steady id goes inactive after debounceMs",
+  same(sample({ ...thresholds, maxRapidChanges: 100 }, flapping.slice(0, 4)), [true, false, true, false])
+);
+check(
+  "extendedDebounceMs once maxRapidChanges is reached",
+  same(sample({ ...thresholds, maxRapidChanges: 3, extendedDebounceMs: 5000 }, flapping), [
+    true,
+    false,
+    true,
+    true,
+    true,
+    false,
+  ])
+);
+
+const sets = runDebouncer({ ...calm, requiredInactiveChecks: 1 }, [
+  { at: 0, active: ["b", "a"] },
+  { at: 1000, active: ["b"] },
+  { at: 5000, active: [] },
+  { at: 6000, active: [] },
+  { at: 15001, active: [] },
+  { at: 16001, active: [] },
+]);
+check("active ids are reported in order", same(sets[0].reported, ["b", "a"]));
+check("held ids follow the active ones", same(sets[1].reported, ["b", "a"]));
+check("each id is held from its own last activity", same(sets[2].reported, ["b"]) && same(sets[3].reported, []));
+check(
+  `quiet ids are forgotten after rapidChangeWindowMs (${sets.map((s) => s.tracked).join(", ")})`,
+  same(
+    sets.map((s) => s.tracked),
+    [2, 2, 2, 2, 1, 0]
+  )
+);
+
+finish();
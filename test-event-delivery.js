@@ -0,0 +1,155 @@
+/**
+ * Stress test for native event delivery (Linux only)
+ *
+ * Synthetic producer threads push state changes through the same lock-free
+ * ring and batched wakeup as the microphone monitor. Every pushed event must
+ * end up delivered, dropped or coalesced, and the JS callback must run far
+ * fewer times per batch than there are events, even when it throws.
+ */
+
+const utils = require("./index.js");
+const { requireLinux } = require("./test-helpers.js");
+
+const {
+  startSyntheticEvents,
+  getSyntheticEventStats,
+  stopSyntheticEvents,
+  useSyntheticMicBackend,
+  injectMicEvents,
+} = requireLinux("Event delivery stress test", { internal: true });
+
+const scenarios = [
+  { name: "unbounded burst", producers: 4, events: 250000, devices: 8, capacity: 1024 },
+  { name: "paced, large ring", producers: 2, events: 20000, devices: 4, capacity: 65536, intervalUs: 50 },
+  { name: "coalescing 5ms", producers: 4, events: 100000, devices: 8, capacity: 4096, coalesceMs: 5 },
+  { name: "throwing callback", producers: 2, events: 20000, devices: 4, capacity: 65536, throwEvery: 1000 },
+];
+
+function runScenario(scenario) {
+  return new Promise((resolve) => {
+    let calls = 0;
+    let uncaught = 0;
+    const onUncaught = () => uncaught++;
+    if (scenario.throwEvery) {
+      process.on("uncaughtException", onUncaught);
+    }
+    const started = process.hrtime.bigint();
+
+    startSyntheticEvents((active, error) => {
+      calls++;
+      if (scenario.throwEvery && calls % scenario.throwEvery === 0) {
+        throw new Error("callback failed");
+      }
+    }, scenario);
+
+    const poll = setInterval(() => {
+      const stats = getSyntheticEventStats();
+      const settled = stats.delivered + stats.dropped + stats.coalesced;
+      if (!stats.finished || settled < stats.pushed) {
+        return;
+      }
+
+      clearInterval(poll);
+      process.off("uncaughtException", onUncaught);
+      const final = stopSyntheticEvents();
+      const elapsedMs = Number(process.hrtime.bigint() - started) / 1e6;
+      resolve({ ...final, calls, uncaught, elapsedMs });
+    }, 10);
+  });
+}
+
+// 200 subscribers: a third get the aggregate state, a third device-1 only
+// and a third every device. Some close themselves halfway through.
+async function runFanout() {
+  const subscribers = 200;
+  const rounds = 1000;
+  const devices = 2;
+  useSyntheticMicBackend(true);
+
+  const counts = new Array(subscribers).fill(0);
+  const handles = [];
+  for (let i = 0; i < subscribers; i++) {
+    const devicesFilter = [undefined, ["device-1"], ["*"]][i % 3];
+    handles.push(
+      utils.createMicMonitor({
+        capacity: 65536,
+        devices: devicesFilter,
+        callback: () => {
+          counts[i]++;
+        },
+      })
+    );
+  }
+
+  const settle = () =>
+    new Promise((resolve) => {
+      const check = () => {
+        const stats = utils.getMicMonitorStats();
+        if (stats.delivered + stats.dropped >= stats.pushed) {
+          resolve(stats);
+        } else {
+          setImmediate(check);
+        }
+      };
+      check();
+    });
+
+  // Each round is one aggregate event followed by one per device.
+  injectMicEvents({ count: (rounds / 2) * (devices + 1), devices });
+  await settle();
+  for (let i = 0; i < subscribers; i += 2) {
+    handles[i].close();
+  }
+  injectMicEvents({ count: (rounds / 2) * (devices + 1), devices });
+  const stats = await settle();
+
+  let ok = stats.dropped === 0 && stats.subscribers === subscribers / 2;
+  for (let i = 0; i < subscribers; i++) {
+    const perRound = [1, 1, devices][i % 3];
+    const expected = (i % 2 === 0 ? rounds / 2 : rounds) * perRound;
+    ok = ok && counts[i] === expected && handles[i].closed === (i % 2 === 0);
+  }
+
+  for (const handle of handles) {
+    handle.close();
+  }
+  ok = ok && utils.getMicMonitorStats().subscribers === 0;
+  useSyntheticMicBackend(false);
+
+  console.log(`fan-out to ${subscribers} subscribers:`);
+  console.log(`   ${counts.reduce((a, b) => a + b, 0)} callbacks from ${stats.delivered} delivered events`);
+  console.log(ok ? "   ✅ every subscriber got exactly its events\n" : "   ❌ subscriber counts do not match\n");
+  return ok;
+}
+
+async function main() {
+  console.log("Testing batched native event delivery");
+  console.log("=====================================\n");
+
+  let failed = false;
+  for (const scenario of scenarios) {
+    const result = await runScenario(scenario);
+    const expected = scenario.producers * scenario.events;
+    const accounted = result.delivered + result.dropped + result.coalesced;
+
+    console.log(`${scenario.name}:`);
+    console.log(`   produced ${result.produced}, pushed ${result.pushed} in ${result.elapsedMs.toFixed(1)}ms`);
+    console.log(`   delivered ${result.delivered}, dropped ${result.dropped}, coalesced ${result.coalesced}`);
+    console.log(`   ${result.batches} batches, ${(result.delivered / Math.max(result.batches, 1)).toFixed(1)} events per wakeup`);
+
+    const ok =
+      result.produced === expected &&
+      result.pushed === expected &&
+      accounted === expected &&
+      result.calls === result.delivered &&
+      result.uncaught === (scenario.throwEvery ? Math.floor(result.calls / scenario.throwEvery) : 0);
+    console.log(ok ? "   ✅ all events accounted for\n" : "   ❌ counters do not add up\n");
+    failed = failed || !ok;
+  }
+
+  failed = !(await runFanout()) || failed;
+
+  process.exit(failed ? 1 : 0);
+}
+
+main();
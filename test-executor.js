@@ -0,0 +1,94 @@
+/**
+ * Test for the native executor behind the Promise variants
+ *
+ * Configures it before the first async call, then checks the lane stats.
+ * On Linux, with the synthetic OCR engine, it also fills the bulk lane with
+ * OCR of a large frame and checks that a process query still returns before
+ * that work drains, and that an AbortSignal cancels the OCR jobs that have
+ * not started.
+ */
+
+const utils = require("./index.js");
+const { makeTextFrame } = require("./bench/synthetic.js");
+const { check, finish } = require("./test-helpers.js");
+
+async function settle(promise) {
+  try {
+    return { value: await promise };
+  } catch (error) {
+    return { error };
+  }
+}
+
+async function main() {
+  utils.getRunningProcesses();
+  if (!utils.getNativeStats().exports.getRunningProcesses) {
+    console.log("Native module not loaded; nothing to test");
+    return;
+  }
+  let threw = false;
+  try {
+    utils.configureExecutor({ threads: 0 });
+  } catch (error) {
+    threw = error instanceof TypeError;
+  }
+  check("0 threads is rejected", threw);
+  check("not started before the first async call", utils.getExecutorStats().started === false);
+  check("configures before the first async call", utils.configureExecutor({ threads: 3, interactiveThreads: 1 }));
+
+  await utils.getRunningProcessesAsync();
+  let stats = utils.getExecutorStats();
+  check(
+    `started with ${stats.threads} threads, ${stats.bulkThreads} for bulk jobs`,
+    stats.started && stats.threads === 3 && stats.bulkThreads === 2
+  );
+  check("process queries run in the interactive lane", stats.lanes.interactive.completed === 1);
+  check("configuring later changes nothing", utils.configureExecutor({ threads: 8 }) === false);
+
+  const internal = utils.__internal;
+  if (process.platform !== "linux" || !internal) {
+    return;
+  }
+  internal.useSyntheticOCRBackend(true);
+  try {
+    const frame = makeTextFrame(3840, 2160);
+    const started = Date.now();
+    const ocr = [];
+    for (let i = 0; i < 8; i++) {
+      ocr.push(utils.ocrImage(frame).then(() => Date.now() - started));
+    }
+    const queryMs = await utils.getRunningProcessesAsync().then(() => Date.now() - started);
+    const ocrMs = await Promise.all(ocr);
+    console.log(`   process query after ${queryMs} ms, OCR jobs after ${ocrMs.join(", ")} ms`);
+    check("the process query does not wait for the OCR jobs", queryMs < Math.max(...ocrMs));
+    stats = utils.getExecutorStats().lanes.bulk;
+    check(`bulk lane queued up to ${stats.maxQueued} jobs`, stats.maxQueued >= 8 - 2 && stats.completed >= 8);
+
+    const controller = new AbortController();
+    const jobs = [];
+    for (let i = 0; i < 8; i++) {
+      jobs.push(settle(utils.ocrImage(frame, { signal: controller.signal })));
+    }
+    controller.abort();
+    const results = await Promise.all(jobs);
+    const aborted = results.filter((r) => r.error && r.error.name === "AbortError").length;
+    const completed = results.filter((r) => r.value && r.value.success).length;
+    console.log(`   ${completed} completed, ${aborted} cancelled`);
+    check("jobs not yet started are cancelled", aborted >= 8 - 2 && aborted + completed === 8);
+    check("cancellations are counted", utils.getExecutorStats().lanes.bulk.cancelled === aborted);
+
+    const early = await settle(utils.ocrImage(frame, { signal: AbortSignal.abort() }));
+    check("an aborted signal rejects right away", early.error && early.error.name === "AbortError");
+    threw = false;
+    try {
+      utils.ocrImage(frame, { signal: {} });
+    } catch (error) {
+      threw = error instanceof TypeError;
+    }
+    check("a signal that is not an AbortSignal is rejected", threw);
+  } finally {
+    internal.useSyntheticOCRBackend(false);
+  }
+}
+
+main().then(finish);
@@ -0,0 +1,37 @@
+/**
+ * Helpers shared by the test-*.js scripts: the platform guard and the
+ * pass/fail reporting.
+ */
+
+let failed = false;
+
+// Prints one result; any failure makes finish() exit with 1
+function check(label, ok) {
+  console.log(`${ok ? "✅" : "❌"} ${label}`);
+  failed = failed || !ok;
+}
+
+function finish() {
+  process.exit(failed ? 1 : 0);
+}
+
+// Skips the test (exit code 0) unless running on Linux. With `internal`, it
+// also needs the native module, and its test hooks are returned.
+function requireLinux(name, { internal = false } = {}) {
+  if (process.platform !== "linux") {
+    console.log(`${name} only runs on Linux`);
+    process.exit(0);
+  }
+  if (!internal) {
+    return undefined;
+  }
+
+  const hooks = require("./index.js").__internal;
+  if (!hooks) {
+    console.log(`${name} only runs on Linux with the native module built`);
+    process.exit(0);
+  }
+  return hooks;
+}
+
+module.exports = { check, finish, requireLinux };
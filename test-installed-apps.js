@@ -0,0 +1,83 @@
+/**
+ * Test for the installed app index (Linux only)
+ *
+ * Builds a small XDG tree in a temporary directory and checks that a warm
+ * listInstalledApps() reuses the on-disk index, that only changed entries are
+ * parsed again, and that the inotify watcher picks up new and rewritten
+ * files on its own.
+ */
+
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const { check, finish, requireLinux } = require("./test-helpers.js");
+
+requireLinux("Installed app index test");
+
+// The roots and the index location are read from the environment on every
+// call, so they can be pointed at the temporary tree before loading.
+const base = fs.mkdtempSync(path.join(os.tmpdir(), "installed-apps-"));
+const userApps = path.join(base, "data", "applications");
+const systemApps = path.join(base, "system", "applications");
+fs.mkdirSync(path.join(userApps, "vendor"), { recursive: true });
+fs.mkdirSync(systemApps, { recursive: true });
+process.env.XDG_DATA_HOME = path.join(base, "data");
+process.env.XDG_DATA_DIRS = path.join(base, "system");
+process.env.XDG_CACHE_HOME = path.join(base, "cache");
+
+const utils = require("./index.js");
+
+function writeEntry(file, name, extra = "") {
+  fs.writeFileSync(file, `[Desktop Entry]\nType=Application\nName=${name}\n${extra}`);
+}
+
+for (let i = 0; i < 20; i++) {
+  writeEntry(path.join(systemApps, `org.example.App${i}.desktop`), `App ${i}`);
+}
+writeEntry(path.join(userApps, "vendor", "tool.desktop"), "Vendor Tool");
+// Overrides and hides the system entry with the same desktop file id
+writeEntry(path.join(userApps, "org.example.App3.desktop"), "App 3", "Hidden=true\n");
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+const names = () => utils.listInstalledApps().map((app) => app.name);
+
+async function main() {
+  const cold = utils.listInstalledApps();
+  let stats = utils.getInstalledAppIndexStats();
+  const ours = cold.filter((app) => app.id.startsWith("org.example.") || app.id === "vendor-tool");
+  check(`cold scan lists 20 apps (${ours.length}), parsed ${stats.parsedFiles} files`, ours.length === 20);
+  check("hidden override removes the system entry", !ours.some((app) => app.id === "org.example.App3"));
+  check("index file written", fs.existsSync(path.join(base, "cache", "node-mac-utils", "installed-apps.idx")));
+
+  utils.listInstalledApps();
+  stats = utils.getInstalledAppIndexStats();
+  check(
+    `warm scan reuses every directory (${stats.reusedDirectories}/${stats.directories})`,
+    stats.parsedFiles === 0 && stats.reusedDirectories === stats.directories
+  );
+
+  writeEntry(path.join(systemApps, "org.example.Added.desktop"), "Added");
+  const afterAdd = names();
+  stats = utils.getInstalledAppIndexStats();
+  check(`adding a file parses only that file (${stats.parsedFiles})`, stats.parsedFiles === 1 && afterAdd.includes("Added"));
+
+  utils.startWatchingInstalledApps();
+  writeEntry(path.join(systemApps, "org.example.App1.desktop"), "App 1 renamed");
+  fs.mkdirSync(path.join(systemApps, "extra"));
+  writeEntry(path.join(systemApps, "extra", "late.desktop"), "Late");
+  await sleep(800);
+
+  const watched = names();
+  stats = utils.getInstalledAppIndexStats();
+  check(`watcher refreshed (${stats.watchRefreshes} refreshes)`, stats.watching && stats.watchRefreshes > 0);
+  check("in-place rewrite picked up", watched.includes("App 1 renamed") && !watched.includes("App 1"));
+  check("new subdirectory picked up", watched.includes("Late"));
+
+  utils.stopWatchingInstalledApps();
+  check("watcher stopped", !utils.getInstalledAppIndexStats().watching);
+
+  fs.rmSync(base, { recursive: true, force: true });
+  finish();
+}
+
+main();
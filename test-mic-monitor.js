@@ -5,20 +5,26 @@
  * 1. Request microphone permission with callback
  * 2. Start monitoring microphone usage
  * 3. Get a list of processes using the microphone
+ *
+ * On Linux monitoring needs a running PipeWire daemon. Without a desktop
+ * session one can be started headless, e.g.:
+ *   pipewire & wireplumber &
+ *   pw-record --target 0 /dev/null   # makes a source node run
  */
 
 const { getRunningInputAudioProcesses, INFO_ERROR_CODE, ERROR_DOMAIN } = require('./index');
 const EventEmitter = require('events');
 
-// Only import mic monitoring functions on Darwin (macOS) systems
-const { startMonitoringMic, stopMonitoringMic } = process.platform === 'darwin'
+// Only import mic monitoring functions on macOS and Linux
+const supportsMonitoring = process.platform === 'darwin' || process.platform === 'linux';
+const { startMonitoringMic, stopMonitoringMic } = supportsMonitoring
   ? require('./index')
   : {
       startMonitoringMic: () => {
-        throw new Error('Microphone monitoring is only supported on macOS');
+        throw new Error('Microphone monitoring is only supported on macOS and Linux');
       },
       stopMonitoringMic: () => {
-        // No-op for non-Darwin systems
+        // No-op for other systems
       }
     };
 
@@ -127,7 +133,7 @@ console.log('Press Ctrl+C to stop.\n');
 
 displayMicProcesses();
 
-if (process.platform === 'darwin') {
+if (supportsMonitoring) {
   startMicrophoneStatusEmitter();
   // Keep the process running
   process.stdin.resume();
@@ -0,0 +1,70 @@
+/**
+ * Test for the microphone usage timeline (Linux only)
+ *
+ * Feeds samples through the internal hook instead of PipeWire, then checks
+ * interval boundaries, range and process queries, the export/import round
+ * trip and that memory stays bounded by the capacity.
+ */
+
+const utils = require("./index.js");
+const { check, finish, requireLinux } = require("./test-helpers.js");
+
+const { recordMicUses } = requireLinux("Mic timeline test", { internal: true });
+
+const t0 = Date.now() - 24 * 3600 * 1000;
+const zoom = { process: "zoom", pid: 100, device: "alsa_input.usb-mic" };
+const obs = { process: "obs", pid: 200, device: "alsa_input.usb-mic" };
+
+recordMicUses([zoom], t0);
+recordMicUses([zoom, obs], t0 + 1000);
+recordMicUses([obs], t0 + 5000);
+recordMicUses([], t0 + 6000);
+
+const all = utils.queryMicTimeline({ from: t0, to: t0 + 10000 });
+check(`two intervals recorded (${all.length})`, all.length === 2);
+check(
+  "zoom interval boundaries",
+  all[0].process === "zoom" && all[0].pid === 100 && all[0].start === t0 && all[0].end === t0 + 5000
+);
+check("obs interval boundaries", all[1].start === t0 + 1000 && all[1].end === t0 + 6000);
+check("process filter", utils.queryMicTimeline({ process: "obs" }).length === 1);
+check("range excludes earlier intervals", utils.queryMicTimeline({ from: t0 + 5500 }).length === 1);
+check("range excludes later intervals", utils.queryMicTimeline({ to: t0 + 500 }).length === 1);
+
+recordMicUses([zoom], t0 + 7000);
+const open = utils.queryMicTimeline({ from: t0 + 6500 });
+check("open interval has a null end", open.length === 1 && open[0].end === null);
+
+const blob = utils.exportMicTimeline();
+console.log(`export: ${blob.length} bytes for 3 intervals`);
+recordMicUses([], t0 + 8000);
+check(`import restores the history (${utils.importMicTimeline(blob)})`, utils.queryMicTimeline().length === 3);
+let threw = false;
+try {
+  utils.importMicTimeline(blob.subarray(0, blob.length - 1));
+} catch (error) {
+  threw = true;
+}
+check("truncated blob is rejected", threw && utils.queryMicTimeline().length === 3);
+
+// Time never moves backwards, and the import above ended at the present.
+// Then 30000 two-second uses by 50 processes against the default capacity.
+const t1 = Date.now() + 1000;
+for (let i = 0; i < 30000; i++) {
+  recordMicUses([{ process: `app-${i % 50}`, pid: 1000 + (i % 50), device: "mic" }], t1 + i * 2000);
+}
+recordMicUses([], t1 + 30000 * 2000);
+const stats = utils.getMicTimelineStats();
+console.log(stats);
+check("history is bounded by the capacity", stats.intervals === stats.capacity && stats.evicted > 0);
+check("names are shared between intervals", stats.names <= 51);
+
+const started = process.hrtime.bigint();
+const recent = utils.queryMicTimeline({ from: t1 + 29000 * 2000, process: "app-7" });
+const micros = Number(process.hrtime.bigint() - started) / 1000;
+check(`range query returns the recent intervals (${recent.length} in ${micros.toFixed(0)}µs)`, recent.length === 20);
+
+const exported = utils.exportMicTimeline();
+console.log(`export: ${exported.length} bytes, ${(exported.length / stats.intervals).toFixed(1)} per interval`);
+
+finish();
@@ -0,0 +1,48 @@
+/**
+ * Test for getNativeStats()
+ *
+ * Calls a few exports, then checks that each call shows up in the latency
+ * histograms, that the Promise variants also report their executor time,
+ * and that resetNativeStats() starts over.
+ */
+
+const utils = require("./index.js");
+const { check, finish } = require("./test-helpers.js");
+
+async function main() {
+  utils.resetNativeStats();
+  for (let i = 0; i < 100; i++) {
+    utils.getRunningProcesses();
+  }
+  await utils.getRunningProcessesAsync();
+
+  const stats = utils.getNativeStats();
+  const sync = stats.exports.getRunningProcesses;
+  if (!sync) {
+    console.log("Native module not loaded; nothing is recorded");
+    process.exit(0);
+  }
+  console.log(JSON.stringify({ ...sync, histogram: `${sync.histogram.length} buckets` }));
+
+  check(`every call is counted (${sync.calls})`, sync.calls === 100);
+  check(
+    "quantiles are ordered",
+    sync.p50Ns <= sync.p90Ns && sync.p90Ns <= sync.p99Ns && sync.p99Ns <= sync.p999Ns && sync.p999Ns <= sync.maxNs
+  );
+  check(
+    "histogram adds up to the calls",
+    sync.histogram.reduce((total, [, count]) => total + count, 0) === sync.calls
+  );
+  check("Promise variant is timed", stats.exports.getRunningProcessesAsync.calls === 1);
+  check("executor work is timed", stats.exports["getRunningProcessesAsync:work"].calls === 1);
+  check("backend errors are listed", Array.isArray(stats.backendErrors));
+
+  utils.resetNativeStats();
+  const reset = utils.getNativeStats();
+  check("reset clears the histograms", !reset.exports.getRunningProcesses);
+  check("getNativeStats itself is not timed", !reset.exports.getNativeStats);
+
+  finish();
+}
+
+main();
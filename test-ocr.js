@@ -0,0 +1,170 @@
+/**
+ * Test for the OCR preprocessing stage and ocrImage input checks (Linux only)
+ *
+ * Runs the preprocessing hook on a generated text frame with every kernel
+ * set the CPU supports and checks that they agree, then recognizes the frame
+ * if the build has Tesseract and checks that the boxes stay in frame
+ * coordinates when the stage downscales.
+ *
+ * OcrSession is checked with the synthetic OCR engine, so without Tesseract
+ * too: its stitched text and boxes must match ocrImage on the whole frame,
+ * and a frame with one changed line must only send a few tiles to the engine.
+ */
+
+const utils = require("./index.js");
+const { makeTextFrame, encodePng } = require("./bench/synthetic.js");
+const { check, finish, requireLinux } = require("./test-helpers.js");
+
+const { preprocessImage, imageKernels, useSyntheticOCRBackend } = requireLinux("OCR test", { internal: true });
+
+// Argument errors throw before a Promise exists; failures after reject it
+async function rejects(call) {
+  try {
+    await call();
+    return false;
+  } catch (error) {
+    return true;
+  }
+}
+
+async function sessionChecks() {
+  useSyntheticOCRBackend(true);
+  try {
+    // Tiles much smaller than the frame, so that lines cross tile edges
+    const session = utils.createOcrSession({ tileWidth: 200, tileHeight: 64, overlap: 24 });
+    for (const [label, frame] of [
+      ["first frame", makeTextFrame(643, 400)],
+      ["one line changed", makeTextFrame(643, 400, [1], 2)],
+      ["same frame again", makeTextFrame(643, 400, [1], 2)],
+    ]) {
+      const whole = await utils.ocrImage(frame);
+      const tiled = await session.recognize(frame);
+      check(
+        `${label}: session reads ${tiled.text.length} lines like ocrImage`,
+        whole.success &&
+          tiled.success &&
+          whole.text.length > 0 &&
+          JSON.stringify(tiled.text) === JSON.stringify(whole.text) &&
+          JSON.stringify(tiled.boxes) === JSON.stringify(whole.boxes)
+      );
+      console.log(`   ${tiled.recognizedTiles} of ${tiled.tiles} tiles recognized`);
+      if (label === "first frame") {
+        check(`${label}: every tile recognized`, tiled.recognizedTiles === tiled.tiles);
+      } else if (label === "one line changed") {
+        // The line and its overlap span two of the seven tile rows
+        check(`${label}: at most 8 tiles recognized`, tiled.recognizedTiles <= 8);
+      } else {
+        check(`${label}: no tile recognized`, tiled.recognizedTiles === 0);
+      }
+    }
+
+    const stats = session.getStats();
+    check(`stats count 3 frames, ${stats.reusedTiles} reused tiles`, stats.frames === 3 && stats.reusedTiles > 0);
+    check("stats add up", stats.recognizedTiles + stats.reusedTiles === stats.tiles);
+    session.reset();
+    const frame = makeTextFrame(643, 400);
+    const again = await session.recognize(frame);
+    check("reset drops the cached tiles", again.recognizedTiles === again.tiles);
+    const changed = makeTextFrame(643, 400, [1], 2);
+    const [first, second] = await Promise.all([session.recognize(changed), session.recognize(changed)]);
+    check(
+      "overlapping calls run in turn",
+      first.recognizedTiles > 0 && second.recognizedTiles === 0 && session.getStats().frames === 6
+    );
+    check("PNG frames are rejected", await rejects(() => session.recognize(encodePng(frame))));
+    const running = session.recognize(changed);
+    const waiting = session.recognize(changed);
+    session.close();
+    check(
+      "close rejects the calls still waiting for their turn",
+      !(await rejects(() => running)) && (await rejects(() => waiting))
+    );
+    check("close marks the session closed", session.closed);
+    check("closed sessions reject", await rejects(() => session.recognize(frame)));
+    let threw = false;
+    try {
+      utils.createOcrSession({ tileWidth: 8 });
+    } catch (error) {
+      threw = error instanceof TypeError;
+    }
+    check("tiny tiles are rejected", threw);
+  } finally {
+    useSyntheticOCRBackend(false);
+  }
+}
+
+async function main() {
+  // Odd sizes leave tails after the vector loops and partial blocks
+  const frame = makeTextFrame(643, 181);
+  const kernels = imageKernels();
+  check(`kernels ${kernels.join(", ")} end with scalar`, kernels[kernels.length - 1] === "scalar");
+
+  for (const preprocess of [{}, { downscale: 3 }, { binarize: true }, { downscale: 2, binarize: true }]) {
+    const label = JSON.stringify(preprocess);
+    const reference = preprocessImage(frame, { ...preprocess, kernel: "scalar" });
+    const scale = preprocess.downscale || 1;
+    check(
+      `${label} output is ${reference.width}x${reference.height}`,
+      reference.scale === scale &&
+        reference.width === Math.floor(643 / scale) &&
+        reference.height === Math.floor(181 / scale)
+    );
+    for (const kernel of kernels) {
+      const result = preprocessImage(frame, { ...preprocess, kernel });
+      check(`${label} ${kernel} matches scalar`, result.data.equals(reference.data));
+    }
+    if (preprocess.binarize) {
+      check(`${label} is black and white`, reference.data.every((v) => v === 0 || v === 255));
+    }
+  }
+
+  const gray = preprocessImage(frame, {});
+  const rgba = { ...frame, format: "rgba" };
+  check("gray8 frames pass through", preprocessImage({ ...gray, format: "gray8" }, {}).data.equals(gray.data));
+  const padded = Buffer.alloc((frame.stride + 12) * frame.height);
+  for (let y = 0; y < frame.height; y++) {
+    frame.data.copy(padded, y * (frame.stride + 12), y * frame.stride, (y + 1) * frame.stride);
+  }
+  check(
+    "row padding is skipped",
+    preprocessImage({ ...frame, data: padded, stride: frame.stride + 12 }, {}).data.equals(gray.data)
+  );
+  check("rgba of a gray frame matches bgra", preprocessImage(rgba, {}).data.equals(gray.data));
+
+  for (const [label, image, options] of [
+    ["unknown format", { ...frame, format: "argb" }],
+    ["short data", { ...frame, height: frame.height + 1 }],
+    ["stride below the row size", { ...frame, stride: frame.width }],
+    ["fractional downscale", frame, { preprocess: { downscale: 1.5 } }],
+    ["downscale above 8", frame, { preprocess: { downscale: 9 } }],
+  ]) {
+    let threw = false;
+    try {
+      await utils.ocrImage(image, options);
+    } catch (error) {
+      threw = error instanceof TypeError || error instanceof RangeError;
+    }
+    check(`${label} is rejected`, threw);
+  }
+
+  await sessionChecks();
+
+  const full = await utils.ocrImage(frame, { preprocess: false });
+  if (!full.success) {
+    console.log(`Skipping recognition: ${full.error}`);
+    return;
+  }
+  check(`recognized ${full.text.length} lines`, full.text.length > 0 && full.boxes.length === full.text.length * 4);
+  const small = await utils.ocrImage(frame, { preprocess: { downscale: 2 } });
+  const inside = (boxes) =>
+    boxes.every((v, i) => (i % 2 === 0 ? v <= frame.width : v <= frame.height) && v >= 0);
+  check("downscaled boxes are in frame coordinates", small.success && inside(small.boxes));
+  if (small.text.length > 0 && full.text.length > 0) {
+    check(
+      `first line lands at the same place (${full.boxes[1]} vs ${small.boxes[1]})`,
+      Math.abs(full.boxes[1] - small.boxes[1]) <= 4
+    );
+  }
+}
+
+main().then(finish);
@@ -0,0 +1,90 @@
+/**
+ * Test for watchProcesses() (Linux only)
+ *
+ * Spawns short-lived processes and checks that their exec and exit are
+ * reported, first through whatever mode is available (the netlink proc
+ * connector when running with CAP_NET_ADMIN) and then through the forced
+ * /proc fallback, which only sees processes that live across a scan.
+ */
+
+const { spawn } = require("child_process");
+const { Worker, isMainThread } = require("worker_threads");
+const { check, finish, requireLinux } = require("./test-helpers.js");
+
+requireLinux("Process watch test");
+
+const utils = require("./index.js");
+
+// Worker side of the last check: watches and exits without close()
+if (!isMainThread) {
+  utils.watchProcesses(() => {});
+  process.exit(0);
+}
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+async function watch(options, run) {
+  const events = [];
+  const handle = utils.watchProcesses((batch) => events.push(...batch), options);
+  await sleep(200);
+  const pids = await run();
+  await sleep(800);
+  handle.close();
+  return { mode: handle.mode, events, pids };
+}
+
+async function main() {
+  const fast = await watch(undefined, async () => {
+    const pids = [];
+    for (let i = 0; i < 5; i++) {
+      const child = spawn("/bin/true");
+      pids.push(child.pid);
+      await new Promise((resolve) => child.on("exit", resolve));
+    }
+    return pids;
+  });
+  console.log(`mode: ${fast.mode}`);
+  if (fast.mode === "netlink") {
+    const execs = fast.events.filter((e) => e.type === "exec" && fast.pids.includes(e.pid));
+    const exits = fast.events.filter((e) => e.type === "exit" && fast.pids.includes(e.pid));
+    check(`short-lived execs reported (${execs.length}/5)`, execs.length === 5);
+    check(`short-lived exits reported (${exits.length}/5)`, exits.length === 5);
+    // A process reaped before it could be looked up is reported without
+    // details, so only the resolved ones are checked.
+    const resolved = execs.filter((e) => e.path !== "");
+    check(`resolved execs carry parent pid and path (${resolved.length})`,
+      resolved.every((e) => e.ppid === process.pid && e.path.endsWith("true")));
+    check("exits carry the path seen at exec",
+      exits.every((e) => e.path === (execs.find((x) => x.pid === e.pid) || {}).path));
+  } else {
+    console.log("(no CAP_NET_ADMIN, skipping the short-lived process checks)");
+  }
+
+  const slow = await watch({ netlink: false }, async () => {
+    const child = spawn("/bin/sleep", ["0.6"]);
+    await new Promise((resolve) => child.on("exit", resolve));
+    return [child.pid];
+  });
+  const stats = utils.getProcessWatchStats();
+  check(`fallback mode is procfs (${slow.mode})`, slow.mode === "procfs");
+  check("fallback saw the exec", slow.events.some((e) => e.type === "exec" && e.pid === slow.pids[0]));
+  check("fallback saw the exit", slow.events.some((e) => e.type === "exit" && e.pid === slow.pids[0]));
+  check(`fallback scanned /proc (${stats.scans} scans)`, stats.scans > 1);
+  check("watcher stopped after close()", stats.mode === "none");
+  console.log(`events: ${stats.events}, batches: ${stats.batches}, overflows: ${stats.overflows}, dropped: ${stats.dropped}`);
+
+  // A replaced handle must not stop its successor
+  const first = utils.watchProcesses(() => {});
+  const second = utils.watchProcesses(() => {});
+  first.close();
+  check("closing a replaced handle keeps the new watcher", utils.getProcessWatchStats().mode !== "none");
+
+  // Each worker has its own watcher, stopped when the worker exits
+  await new Promise((resolve) => new Worker(__filename).on("exit", resolve));
+  check("a worker's watcher leaves this thread's running", utils.getProcessWatchStats().mode !== "none");
+  second.close();
+
+  finish();
+}
+
+main();
@@ -89,6 +89,13 @@ async function runTests() {
             console.log('getProcessesAccessingMicrophoneWithResult available:', !!utils.getProcessesAccessingMicrophoneWithResult);
             console.log('getProcessesAccessingMicrophoneDebouncedWithResult available:', !!utils.getProcessesAccessingMicrophoneDebouncedWithResult);
             console.log('getProcessesAccessingSpeakersWithResult available:', !!utils.getProcessesAccessingSpeakersWithResult);
+        } else if (process.platform === 'linux') {
+            console.log('\nTesting Linux-specific functions:');
+            const apps = utils.listInstalledApps();
+            console.log('listInstalledApps count:', apps.length);
+            apps.slice(0, 5).forEach((app) => {
+                console.log(`  ${app.type} ${app.id} "${app.name}" ${app.version}`);
+            });
         } else {
             console.log('node-mac-utils Unsupported platform:', process.platform);
             console.log('getProcessesAccessingSpeakersWithResult (no-op):', renderResult.success && renderResult.processes.length === 0 ? 'Returns success with empty processes ✓' : 'Unexpected data');
@@ -104,6 +111,19 @@ async function runTests() {
             console.log('Data matches:', JSON.stringify(processes) === JSON.stringify(result.processes));
         }
 
+        // Test Promise-returning variants
+        console.log('\nTesting async variants:');
+        const [asyncProcesses, asyncMic, asyncSpeakers, asyncApps] = await Promise.all([
+            utils.getRunningProcessesAsync(),
+            utils.getProcessesAccessingMicrophoneWithResultAsync(),
+            utils.getProcessesAccessingSpeakersWithResultAsync(),
+            utils.listInstalledAppsAsync(),
+        ]);
+        console.log('getRunningProcessesAsync count:', asyncProcesses.length);
+        console.log('getProcessesAccessingMicrophoneWithResultAsync success:', asyncMic.success);
+        console.log('getProcessesAccessingSpeakersWithResultAsync success:', asyncSpeakers.success);
+        console.log('listInstalledAppsAsync count:', asyncApps.length);
+
         // Log all available exports
         console.log('\nAll available exports:');
         console.log(Object.keys(utils));
@@ -9,6 +9,7 @@
 
 // Now include other Windows headers
 #include <psapi.h>
+#include <tlhelp32.h>
 #include <audiopolicy.h>
 #include <endpointvolume.h>
 #include <mmdeviceapi.h>
@@ -24,13 +25,15 @@
 #include <string>
 #include <vector>
 #include <unordered_set>
-#include <chrono>
 #include <unordered_map>
 #include <algorithm>
 #include <cctype>
 
 // Project includes
 #include "AudioProcessMonitor.h"
+#include "../common/ActivityDebouncer.h"
+#include "../common/ProcessPathCache.h"
+#include "../common/ProcessTree.h"
 
 _COM_SMARTPTR_TYPEDEF(IPropertyStore, __uuidof(IPropertyStore));
 _COM_SMARTPTR_TYPEDEF(IMMDevice, __uuidof(IMMDevice));
@@ -47,93 +50,120 @@ _COM_SMARTPTR_TYPEDEF(ISimpleAudioVolume, __uuidof(ISimpleAudioVolume));
 
 #pragma comment(lib, "Ole32.lib")
 
-// Function to get process executable path from PID
-static std::string GetProcessExecutablePath(DWORD processID) {
-    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID);
-    if (!hProcess) return "Unknown";
-
+// Reads the image path of an already opened process as UTF-8
+static bool QueryProcessImagePath(HANDLE hProcess, std::string& out) {
     WCHAR path[MAX_PATH];
     DWORD size = MAX_PATH;
 
-    if (QueryFullProcessImageNameW(hProcess, 0, path, &size)) {
-        CloseHandle(hProcess);
-        // Convert wide string to regular string
-        int strSize = WideCharToMultiByte(CP_UTF8, 0, path, -1, nullptr, 0, nullptr, nullptr);
-        std::string result(strSize, 0);
-        WideCharToMultiByte(CP_UTF8, 0, path, -1, &result[0], strSize, nullptr, nullptr);
-        if (!result.empty() && result.back() == 0) {
-            result.pop_back();
-        }
-        return result;
+    if (!QueryFullProcessImageNameW(hProcess, 0, path, &size)) {
+        return false;
+    }
+
+    int strSize = WideCharToMultiByte(CP_UTF8, 0, path, int(size), nullptr, 0, nullptr, nullptr);
+    out.assign(strSize, 0);
+    WideCharToMultiByte(CP_UTF8, 0, path, int(size), &out[0], strSize, nullptr, nullptr);
+    return true;
+}
+
+// Looks up path and name for a PID through the shared (pid, creation time) cache
+static bool GetCachedProcessInfo(DWORD processID, CachedProcessInfo& info) {
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID);
+    if (!hProcess) return false;
+
+    bool resolved = false;
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime)) {
+        ProcessKey key{uint32_t(processID),
+                       (uint64_t(creationTime.dwHighDateTime) << 32) | creationTime.dwLowDateTime};
+        // A Windows process cannot replace its image, so no image name is
+        // needed to notice a changed executable
+        resolved = ProcessPathCache::Shared().Lookup(key, std::string(), [hProcess](std::string& path) {
+            return QueryProcessImagePath(hProcess, path);
+        }, info);
     }
 
     CloseHandle(hProcess);
-    return "Unknown";
+    return resolved;
 }
 
+// Function to get process executable path from PID
+static std::string GetProcessExecutablePath(DWORD processID) {
+    CachedProcessInfo info;
+    if (GetCachedProcessInfo(processID, info)) {
+        return info.path;
+    }
+    return "Unknown";
+}
 
 std::vector<std::string> GetRunningProcesses() {
-    std::vector<std::string> processes;
-
-    DWORD aProcesses[1024], cbNeeded, cProcesses;
-    unsigned int i;
+    auto entries = GetRunningProcessEntries();
 
-    if (!EnumProcesses(aProcesses, sizeof(aProcesses), &cbNeeded))
-    {
-        return processes;
+    std::vector<std::string> processes;
+    processes.reserve(entries.size());
+    for (auto& entry : entries) {
+        processes.push_back(std::move(entry.path));
     }
 
-    // Calculate how many process identifiers were returned.
-    cProcesses = cbNeeded / sizeof(DWORD);
+    return processes;
+}
 
-    for (i = 0; i < cProcesses; i++)
-    {
-        if (aProcesses[i] != 0)
-        {
-            auto ep(GetProcessExecutablePath(aProcesses[i]));
-            if (ep != "Unknown") {
-                processes.push_back(ep);
+std::vector<ProcessEntry> GetRunningProcessEntries() {
+    std::vector<ProcessEntry> entries;
+
+    // A Toolhelp snapshot reports each parent PID along with the PID, which
+    // the process tree needs; EnumProcesses only has the PIDs.
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) {
+        return entries;
+    }
+
+    std::vector<ProcessKey> live;
+    live.reserve(1024);
+    entries.reserve(1024);
+
+    auto& cache = ProcessPathCache::Shared();
+    CachedProcessInfo info;
+    PROCESSENTRY32W process;
+    process.dwSize = sizeof(process);
+    for (BOOL more = Process32FirstW(snapshot, &process); more;
+         more = Process32NextW(snapshot, &process)) {
+        if (process.th32ProcessID == 0) continue;
+
+        HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process.th32ProcessID);
+        if (!hProcess) continue;
+
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime)) {
+            ProcessKey key{uint32_t(process.th32ProcessID),
+                           (uint64_t(creationTime.dwHighDateTime) << 32) | creationTime.dwLowDateTime};
+            live.push_back(key);
+
+            bool resolved = cache.Lookup(key, std::string(), [hProcess](std::string& path) {
+                return QueryProcessImagePath(hProcess, path);
+            }, info);
+            if (resolved) {
+                entries.push_back(ProcessEntry{key.pid, key.startTime, info.path,
+                                               uint32_t(process.th32ParentProcessID)});
             }
         }
+        CloseHandle(hProcess);
     }
+    CloseHandle(snapshot);
 
-    return processes;
+    // Anything not seen in this pass has exited.
+    cache.Retain(live);
+    ProcessTree::Shared().Update(entries);
+
+    return entries;
 }
 
-// Enhanced state caching for Bluetooth device debouncing and power management
-struct BluetoothDeviceState {
-    bool lastActiveState;
-    bool lastReportedState;  // What we last reported to the caller
-    std::chrono::steady_clock::time_point lastStateChange;
-    std::chrono::steady_clock::time_point lastActivityTime;  // Last time any activity was detected
-    std::chrono::steady_clock::time_point lastReportTime;    // Last time we reported a state
-    int consecutiveActiveChecks;
-    int consecutiveInactiveChecks;
-    int rapidStateChangeCount;  // Track rapid flapping
-    std::chrono::steady_clock::time_point rapidStateChangeWindow;
-
-    BluetoothDeviceState() :
-        lastActiveState(false),
-        lastReportedState(false),
-        lastStateChange(std::chrono::steady_clock::now()),
-        lastActivityTime(std::chrono::steady_clock::now()),
-        lastReportTime(std::chrono::steady_clock::now()),
-        consecutiveActiveChecks(0),
-        consecutiveInactiveChecks(0),
-        rapidStateChangeCount(0),
-        rapidStateChangeWindow(std::chrono::steady_clock::now()) {}
-};
-
-static std::unordered_map<std::wstring, BluetoothDeviceState> bluetoothStateCache;
-
-// Enhanced debouncing constants for power management scenarios
-static const int BLUETOOTH_DEBOUNCE_MS = 3000; // Increased to 3 seconds for power management
-static const int BLUETOOTH_ACTIVE_HOLD_MS = 5000; // Hold active state for 5 seconds after last activity
-static const int REQUIRED_CONSECUTIVE_ACTIVE_CHECKS = 2; // Reduced for faster response
-static const int REQUIRED_CONSECUTIVE_INACTIVE_CHECKS = 4; // More checks needed to go inactive
-static const int RAPID_CHANGE_WINDOW_MS = 10000; // 10 second window for flapping detection
-static const int MAX_RAPID_CHANGES = 5; // Max state changes in window before extending debounce
-static const int EXTENDED_DEBOUNCE_MS = 8000; // Extended debounce for flapping devices
+// Bluetooth endpoints flap with power management; their activity goes through
+// the shared hysteresis engine. The defaults of DebounceConfig were tuned here.
+static ActivityDebouncer bluetoothDebouncer;
+
+DebounceConfig GetMicrophoneDebounceConfig() {
+    return bluetoothDebouncer.Config();
+}
 
 // Helper function to get device ID for state tracking
 static std::wstring GetDeviceId(IMMDevice* pDevice) {
@@ -362,7 +392,7 @@ static bool CheckSessionsForActivity(IMMDevice* pDevice, bool isBluetooth = fals
 }
 
 // Enhanced function to check if device has active audio with debouncing
-bool HasActiveAudio(IMMDevice* pDevice) {
+bool HasActiveAudio(IMMDevice* pDevice, const DebounceConfig& config) {
     bool isBluetooth = IsBluetoothDevice(pDevice);
     std::wstring deviceId = GetDeviceId(pDevice);
     bool hasActiveAudio = false;
@@ -393,93 +423,12 @@ bool HasActiveAudio(IMMDevice* pDevice) {
         hasActiveAudio = CheckSessionsForActivity(pDevice, isBluetooth);
     }
 
-    // Method 4: Enhanced Bluetooth-specific debouncing and power management
+    // Method 4: Bluetooth-specific debouncing and power management
     if (isBluetooth && !deviceId.empty()) {
-        auto& state = bluetoothStateCache[deviceId];
-        auto now = std::chrono::steady_clock::now();
-        auto timeSinceLastChange = std::chrono::duration_cast<std::chrono::milliseconds>(now - state.lastStateChange).count();
-        auto timeSinceLastActivity = std::chrono::duration_cast<std::chrono::milliseconds>(now - state.lastActivityTime).count();
-        auto timeSinceRapidWindow = std::chrono::duration_cast<std::chrono::milliseconds>(now - state.rapidStateChangeWindow).count();
-
-        // Reset rapid change counter if outside window
-        if (timeSinceRapidWindow > RAPID_CHANGE_WINDOW_MS) {
-            state.rapidStateChangeCount = 0;
-            state.rapidStateChangeWindow = now;
-        }
-
-        // Update activity timestamp if any activity detected
-        if (hasActiveAudio) {
-            state.lastActivityTime = now;
-        }
-
-        // Determine current effective debounce time (extended if device is flapping)
-        int effectiveDebounceMs = (state.rapidStateChangeCount >= MAX_RAPID_CHANGES) ?
-                                 EXTENDED_DEBOUNCE_MS : BLUETOOTH_DEBOUNCE_MS;
-
-        if (hasActiveAudio != state.lastActiveState) {
-            // State change detected - increment rapid change counter
-            state.rapidStateChangeCount++;
-            if (hasActiveAudio) {
-                // Going from inactive to active
-                state.consecutiveActiveChecks++;
-                state.consecutiveInactiveChecks = 0;
-                // Require fewer consecutive checks for faster response to genuine activity
-                if (state.consecutiveActiveChecks >= REQUIRED_CONSECUTIVE_ACTIVE_CHECKS) {
-                    state.lastActiveState = true;
-                    state.lastReportedState = true;
-                    state.lastStateChange = now;
-                    state.lastReportTime = now;
-                    return true;
-                }
-                // Still building confidence - return last reported state during probation
-                return state.lastReportedState;
-            } else {
-                // Going from active to inactive
-                state.consecutiveInactiveChecks++;
-                state.consecutiveActiveChecks = 0;
-                // Apply power management holdoff - stay active if recent activity
-                if (timeSinceLastActivity < BLUETOOTH_ACTIVE_HOLD_MS) {
-                    return true; // Keep reporting active due to recent activity
-                }
-                // Apply debouncing with flapping detection
-                if (timeSinceLastChange < effectiveDebounceMs) {
-                    return state.lastReportedState; // Stay in previous reported state during debounce
-                }
-                // Require more consecutive inactive checks to confirm device is truly idle
-                if (state.consecutiveInactiveChecks >= REQUIRED_CONSECUTIVE_INACTIVE_CHECKS) {
-                    state.lastActiveState = false;
-                    state.lastReportedState = false;
-                    state.lastStateChange = now;
-                    state.lastReportTime = now;
-                    return false;
-                }
-                // Still building confidence for inactive state
-                return state.lastReportedState;
-            }
-        } else {
-            // State consistent with previous check
-            if (hasActiveAudio) {
-                // Consistently active - reset inactive counter
-                state.consecutiveInactiveChecks = 0;
-                state.consecutiveActiveChecks = std::min(state.consecutiveActiveChecks + 1, REQUIRED_CONSECUTIVE_ACTIVE_CHECKS + 1);
-
-                // Ensure we report active if consistently seeing activity
-                if (state.consecutiveActiveChecks >= REQUIRED_CONSECUTIVE_ACTIVE_CHECKS && !state.lastReportedState) {
-                    state.lastReportedState = true;
-                    state.lastReportTime = now;
-                }
-                return state.lastReportedState;
-            } else {
-                // Consistently inactive - but check power management holdoff
-                if (timeSinceLastActivity < BLUETOOTH_ACTIVE_HOLD_MS) {
-                    return true; // Keep active due to recent activity
-                }
-                state.consecutiveActiveChecks = 0;
-                state.consecutiveInactiveChecks = std::min(state.consecutiveInactiveChecks + 1, REQUIRED_CONSECUTIVE_INACTIVE_CHECKS + 1);
-
-                return state.lastReportedState;
-            }
-        }
+        int idSize = WideCharToMultiByte(CP_UTF8, 0, deviceId.c_str(), int(deviceId.size()), nullptr, 0, nullptr, nullptr);
+        std::string id(idSize, 0);
+        WideCharToMultiByte(CP_UTF8, 0, deviceId.c_str(), int(deviceId.size()), &id[0], idSize, nullptr, nullptr);
+        return bluetoothDebouncer.Sample(id, hasActiveAudio, config);
     }
 
     return hasActiveAudio;
@@ -578,6 +527,7 @@ AudioProcessResult GetProcessesAccessingMicrophoneWithResult() {
 
                             if (processID != 0 && state == AudioSessionStateActive) {
                                 std::string processPath = GetProcessExecutablePath(processID);
+                                result.sessions.push_back(SessionProcess{uint32_t(processID), processPath});
 
                                 // Only insert if not already seen
                                 if (seen.insert(processPath).second) {
@@ -796,13 +746,9 @@ RenderProcessResult GetRenderProcessesWithResult() {
                         if (processId != 0 && isActiveSession) {
                             RenderProcessInfo info;
                             info.processId = processId;
-                            info.processName = GetProcessExecutablePath(processId);
-
-                            // Extract filename from path
-                            size_t lastSlash = info.processName.find_last_of("\\");
-                            if (lastSlash != std::string::npos) {
-                                info.processName = info.processName.substr(lastSlash + 1);
-                            }
+                            // The cache already holds the file name part of the path
+                            CachedProcessInfo cached;
+                            info.processName = GetCachedProcessInfo(processId, cached) ? cached.name : "Unknown";
 
                             info.deviceName = deviceName;
                             info.isActive = true;
@@ -829,8 +775,48 @@ RenderProcessResult GetRenderProcessesWithResult() {
     return result;
 }
 
+static void RefreshProcessTree() {
+    GetRunningProcessEntries();
+}
+
+AudioProcessResult AttributeMicrophoneToRootApps(AudioProcessResult result) {
+    if (result.success) {
+        result.processes = AttributeToRootApps(result.sessions, RefreshProcessTree);
+    }
+    return result;
+}
+
+RenderProcessResult AttributeRenderToRootApps(RenderProcessResult result) {
+    if (!result.success) {
+        return result;
+    }
+
+    std::vector<uint32_t> pids;
+    pids.reserve(result.processes.size());
+    for (const auto& info : result.processes) {
+        pids.push_back(uint32_t(info.processId));
+    }
+    std::vector<ProcessEntry> roots = ProcessTree::Shared().RootApps(pids, RefreshProcessTree);
+
+    std::vector<RenderProcessInfo> processes;
+    std::unordered_set<std::string> seen;
+    for (size_t i = 0; i < result.processes.size(); i++) {
+        RenderProcessInfo info = result.processes[i];
+        if (roots[i].pid != 0) {
+            info.processId = DWORD(roots[i].pid);
+            info.processName = ProcessNameFromPath(roots[i].path);
+        }
+        // Device names cannot contain NUL, so it separates the pair.
+        if (seen.insert(std::to_string(info.processId) + '\0' + info.deviceName).second) {
+            processes.push_back(std::move(info));
+        }
+    }
+    result.processes.swap(processes);
+    return result;
+}
+
 // New debounced function with structured result using enumeration of all devices
-AudioProcessResult GetProcessAccessMicrophoneDebouncedWithResult() {
+AudioProcessResult GetProcessAccessMicrophoneDebouncedWithResult(const DebounceConfig& config) {
     AudioProcessResult result;
     std::unordered_set<std::string> seen;
     HRESULT hr = CoInitialize(nullptr);
@@ -875,7 +861,7 @@ AudioProcessResult GetProcessAccessMicrophoneDebouncedWithResult() {
         if (FAILED(hr)) continue;
 
         // Use enhanced activity detection with debouncing
-        if (HasActiveAudio(pDevice)) {
+        if (HasActiveAudio(pDevice, config)) {
             IAudioSessionManager2* pSessionManager = nullptr;
             hr = pDevice->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, nullptr, (void**)&pSessionManager);
             if (SUCCEEDED(hr)) {
@@ -901,6 +887,7 @@ AudioProcessResult GetProcessAccessMicrophoneDebouncedWithResult() {
 
                             if (processID != 0 && state == AudioSessionStateActive) {
                                 std::string processPath = GetProcessExecutablePath(processID);
+                                result.sessions.push_back(SessionProcess{uint32_t(processID), processPath});
 
                                 // Only insert if not already seen
                                 if (seen.insert(processPath).second) {
@@ -4,8 +4,14 @@
 #include <windows.h>
 #include <cstdint>
 
+#include "../common/ActivityDebouncer.h"
+#include "../common/ProcessSnapshot.h"
+#include "../common/ProcessTree.h"
+
 struct AudioProcessResult {
     std::vector<std::string> processes;
+    // Every active session with its PID, before deduplication by path
+    std::vector<SessionProcess> sessions;
     HRESULT errorCode;
     std::string errorMessage;
     bool success;
@@ -39,7 +45,19 @@ AudioProcessResult GetProcessesAccessingMicrophoneWithResult();
 // Speaker/render process detection
 RenderProcessResult GetRenderProcessesWithResult();
 
-// New debounced method with enhanced Bluetooth support
-AudioProcessResult GetProcessAccessMicrophoneDebouncedWithResult();
+// Report each session by the application owning its process (e.g. the main
+// browser process instead of an audio helper), one entry per application
+AudioProcessResult AttributeMicrophoneToRootApps(AudioProcessResult result);
+RenderProcessResult AttributeRenderToRootApps(RenderProcessResult result);
+
+// New debounced method with enhanced Bluetooth support, debounced with
+// `config` for this call
+AudioProcessResult GetProcessAccessMicrophoneDebouncedWithResult(const DebounceConfig& config);
+
+// Default thresholds of the Bluetooth debouncing of the debounced method
+DebounceConfig GetMicrophoneDebounceConfig();
+
+std::vector<std::string> GetRunningProcesses();
 
-std::vector<std::string> GetRunningProcesses();
\ No newline at end of file
+// Running processes with their creation time, for PID-reuse-safe diffing
+std::vector<ProcessEntry> GetRunningProcessEntries();
\ No newline at end of file
@@ -1,20 +1,125 @@
 #include <napi.h>
 #include <windows.h>
+#include <stdexcept>
 #include "AudioProcessMonitor.h"
 #include "MSIXTools.h"
+#include "../common/AsyncTasks.h"
+#include "../common/AttributionOptions.h"
+#include "../common/DebounceOptions.h"
+#include "../common/ExecutorExports.h"
+#include "../common/Marshal.h"
+#include "../common/NativeStats.h"
+#include "../common/NativeStatsExports.h"
+#include "../common/PackedStrings.h"
+#include "../common/ProcessPathCache.h"
+
+static ProcessSnapshotStore processSnapshots;
+
+static Napi::Array stringsToArray(const Napi::Env& env, const std::vector<std::string>& strings) {
+  Napi::Array result = Napi::Array::New(env, strings.size());
+  for (size_t i = 0; i < strings.size(); i++) {
+    result.Set(i, Napi::String::New(env, strings[i]));
+  }
+
+  return result;
+}
+
+static Napi::Object audioResultToObject(const Napi::Env& env, const AudioProcessResult& result) {
+  // Create a JavaScript object to represent the AudioProcessResult
+  Napi::Object resultObj = Napi::Object::New(env);
+  if (!result.success) {
+    // Set error information
+    resultObj.Set("success", Napi::Boolean::New(env, false));
+    resultObj.Set("error", Napi::String::New(env, result.errorMessage));
+    resultObj.Set("code", Napi::Number::New(env, result.errorCode));
+    resultObj.Set("domain", Napi::String::New(env, "AudioProcessMonitor"));
+    NativeStatsBackendError("com", result.errorCode);
+    resultObj.Set("processes", Napi::Array::New(env));
+  } else {
+    // Set success information
+    resultObj.Set("success", Napi::Boolean::New(env, true));
+    resultObj.Set("error", env.Null());
+    resultObj.Set("processes", stringsToArray(env, result.processes));
+  }
 
+  return resultObj;
+}
+
+template <> struct MarshalFields<RenderProcessInfo> {
+  static auto Get() {
+    return std::make_tuple(Marshal::Field("processName", &RenderProcessInfo::processName),
+                           Marshal::Field("processId", &RenderProcessInfo::processId),
+                           Marshal::Field("deviceName", &RenderProcessInfo::deviceName),
+                           Marshal::Field("isActive", &RenderProcessInfo::isActive));
+  }
+};
+
+static Napi::Object renderResultToObject(const Napi::Env& env, const RenderProcessResult& result) {
+  // Create a JavaScript object to represent the RenderProcessResult
+  Napi::Object resultObj = Napi::Object::New(env);
+  if (!result.success) {
+    // Set error information
+    resultObj.Set("success", Napi::Boolean::New(env, false));
+    resultObj.Set("error", Napi::String::New(env, result.errorMessage));
+    resultObj.Set("code", Napi::Number::New(env, result.errorCode));
+    resultObj.Set("domain", Napi::String::New(env, "RenderProcessMonitor"));
+    NativeStatsBackendError("com", result.errorCode);
+    resultObj.Set("processes", Napi::Array::New(env));
+  } else {
+    // Set success information
+    resultObj.Set("success", Napi::Boolean::New(env, true));
+    resultObj.Set("error", env.Null());
+
+    resultObj.Set("processes", Marshal::ToArray(env, result.processes));
+  }
+
+  return resultObj;
+}
 
 // Gets a list of running .exe files
 Napi::Value GetRunningProcessesWindows(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
   try {
-    std::vector<std::string> processes = GetRunningProcesses();
-
-    Napi::Array result = Napi::Array::New(env);
-    for (size_t i = 0; i < processes.size(); i++) {
-      result.Set(i, Napi::String::New(env, processes[i]));
+    if (WantsPackedStrings(info, 0)) {
+      return PackedStringsToObject(env, PackStrings(GetRunningProcesses()));
     }
+    return stringsToArray(env, GetRunningProcesses());
+  } catch (const std::exception& e) {
+    Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+}
+
+// Promise-returning variant of getRunningProcesses
+Napi::Value GetRunningProcessesAsyncWindows(const Napi::CallbackInfo& info) {
+  if (WantsPackedStrings(info, 0)) {
+    return QueueExecutorPromise<PackedStrings>(
+        info.Env(), EXECUTOR_INTERACTIVE, "getRunningProcessesAsync",
+        []() { return PackStrings(GetRunningProcesses()); }, PackedStringsToObject);
+  }
+  return QueueExecutorPromise<std::vector<std::string>>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getRunningProcessesAsync", GetRunningProcesses,
+      stringsToArray);
+}
+
+// Gets the processes started and exited since the given snapshot generation
+Napi::Value GetRunningProcessesDeltaWindows(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  uint64_t generation = 0;
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    generation = uint64_t(info[0].As<Napi::Number>().Int64Value());
+  }
+
+  try {
+    auto delta = processSnapshots.Update(GetRunningProcessEntries(), generation);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("added", stringsToArray(env, delta.added));
+    result.Set("removed", stringsToArray(env, delta.removed));
+    result.Set("generation", Napi::Number::New(env, double(delta.generation)));
+    result.Set("full", Napi::Boolean::New(env, delta.full));
 
     return result;
   } catch (const std::exception& e) {
@@ -23,151 +128,134 @@ Napi::Value GetRunningProcessesWindows(const Napi::CallbackInfo& info) {
   }
 }
 
+// Gets hit/miss counters of the shared PID to executable path cache
+Napi::Value GetProcessCacheStatsWindows(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  auto stats = ProcessPathCache::Shared().Stats();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("hits", Napi::Number::New(env, double(stats.hits)));
+  result.Set("misses", Napi::Number::New(env, double(stats.misses)));
+  result.Set("entries", Napi::Number::New(env, double(stats.entries)));
+
+  return result;
+}
+
 // Gets a list of full package IDs
 Napi::Value GetRunningAppIdsWindows(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
   try {
-    std::vector<std::string> processes = ListRunningAppIds();
-
-    Napi::Array result = Napi::Array::New(env);
-    for (size_t i = 0; i < processes.size(); i++) {
-      result.Set(i, Napi::String::New(env, processes[i]));
+    if (WantsPackedStrings(info, 0)) {
+      return PackedStringsToObject(env, PackStrings(ListRunningAppIds()));
     }
-
-    return result;
+    return stringsToArray(env, ListRunningAppIds());
   } catch (const std::exception& e) {
     Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
     return env.Null();
   }
 }
 
+// Promise-returning variant of getRunningAppIDs
+Napi::Value GetRunningAppIdsAsyncWindows(const Napi::CallbackInfo& info) {
+  if (WantsPackedStrings(info, 0)) {
+    return QueueExecutorPromise<PackedStrings>(
+        info.Env(), EXECUTOR_INTERACTIVE, "getRunningAppIDsAsync",
+        []() { return PackStrings(ListRunningAppIds()); }, PackedStringsToObject);
+  }
+  return QueueExecutorPromise<std::vector<std::string>>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getRunningAppIDsAsync", ListRunningAppIds,
+      stringsToArray);
+}
+
 // Gets a list of processes that are accessing input (microphone) - original interface
 Napi::Value GetRunningInputAudioProcesses(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
   try {
-    std::vector<std::string> processes = GetAudioInputProcesses();
-
-    Napi::Array result = Napi::Array::New(env);
-    for (size_t i = 0; i < processes.size(); i++) {
-      result.Set(i, Napi::String::New(env, processes[i]));
-    }
-
-    return result;
+    return stringsToArray(env, GetAudioInputProcesses());
   } catch (const std::exception& e) {
     Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
     return env.Null();
   }
 }
 
-// Gets processes accessing microphone with structured result
+// Gets processes accessing microphone with structured result. With
+// {attribution: "rootApp"} each session is reported by its owning app.
 Napi::Value GetProcessesAccessingMicrophoneWithResult(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
+  bool rootApp = false;
+  if (!ReadRootAppAttribution(info, 0, &rootApp)) {
+    return env.Null();
+  }
   try {
     AudioProcessResult result = GetProcessesAccessingMicrophoneWithResult();
-
-    // Create a JavaScript object to represent the AudioProcessResult
-    Napi::Object resultObj = Napi::Object::New(env);
-    if (!result.success) {
-      // Set error information
-      resultObj.Set("success", Napi::Boolean::New(env, false));
-      resultObj.Set("error", Napi::String::New(env, result.errorMessage));
-      resultObj.Set("code", Napi::Number::New(env, result.errorCode));
-      resultObj.Set("domain", Napi::String::New(env, "AudioProcessMonitor"));
-      resultObj.Set("processes", Napi::Array::New(env));
-    } else {
-      // Set success information
-      resultObj.Set("success", Napi::Boolean::New(env, true));
-      resultObj.Set("error", env.Null());
-
-      // Convert processes array
-      Napi::Array processesArray = Napi::Array::New(env);
-      for (size_t i = 0; i < result.processes.size(); i++) {
-        processesArray.Set(i, Napi::String::New(env, result.processes[i]));
-      }
-      resultObj.Set("processes", processesArray);
-    }
-
-    return resultObj;
+    return audioResultToObject(env, rootApp ? AttributeMicrophoneToRootApps(result) : result);
   } catch (const std::exception& e) {
     Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
     return env.Null();
   }
 }
 
-// Gets a list of processes that are using speakers/render devices
+// Promise-returning variant of getProcessesAccessingMicrophoneWithResult
+Napi::Value GetProcessesAccessingMicrophoneWithResultAsync(const Napi::CallbackInfo& info) {
+  bool rootApp = false;
+  if (!ReadRootAppAttribution(info, 0, &rootApp)) {
+    return info.Env().Null();
+  }
+  auto work = [rootApp]() {
+    AudioProcessResult result = GetProcessesAccessingMicrophoneWithResult();
+    return rootApp ? AttributeMicrophoneToRootApps(result) : result;
+  };
+  return QueueExecutorPromise<AudioProcessResult>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getProcessesAccessingMicrophoneWithResultAsync", work,
+      audioResultToObject);
+}
+
+// Gets a list of processes that are using speakers/render devices. With
+// {attribution: "rootApp"} each session is reported by its owning app.
 Napi::Value GetRenderProcessesWithResult(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
+  bool rootApp = false;
+  if (!ReadRootAppAttribution(info, 0, &rootApp)) {
+    return env.Null();
+  }
   try {
     RenderProcessResult result = GetRenderProcessesWithResult();
-
-    // Create a JavaScript object to represent the RenderProcessResult
-    Napi::Object resultObj = Napi::Object::New(env);
-    if (!result.success) {
-      // Set error information
-      resultObj.Set("success", Napi::Boolean::New(env, false));
-      resultObj.Set("error", Napi::String::New(env, result.errorMessage));
-      resultObj.Set("code", Napi::Number::New(env, result.errorCode));
-      resultObj.Set("domain", Napi::String::New(env, "RenderProcessMonitor"));
-      resultObj.Set("processes", Napi::Array::New(env));
-    } else {
-      // Set success information
-      resultObj.Set("success", Napi::Boolean::New(env, true));
-      resultObj.Set("error", env.Null());
-
-      // Convert processes array
-      Napi::Array processesArray = Napi::Array::New(env);
-      for (size_t i = 0; i < result.processes.size(); i++) {
-        Napi::Object processObj = Napi::Object::New(env);
-        processObj.Set("processName", Napi::String::New(env, result.processes[i].processName));
-        processObj.Set("processId", Napi::Number::New(env, result.processes[i].processId));
-        processObj.Set("deviceName", Napi::String::New(env, result.processes[i].deviceName));
-        processObj.Set("isActive", Napi::Boolean::New(env, result.processes[i].isActive));
-        processesArray.Set(i, processObj);
-      }
-      resultObj.Set("processes", processesArray);
-    }
-
-    return resultObj;
+    return renderResultToObject(env, rootApp ? AttributeRenderToRootApps(result) : result);
   } catch (const std::exception& e) {
     Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
     return env.Null();
   }
 }
 
+// Promise-returning variant of getProcessesAccessingSpeakersWithResult
+Napi::Value GetRenderProcessesWithResultAsync(const Napi::CallbackInfo& info) {
+  bool rootApp = false;
+  if (!ReadRootAppAttribution(info, 0, &rootApp)) {
+    return info.Env().Null();
+  }
+  auto work = [rootApp]() {
+    RenderProcessResult result = GetRenderProcessesWithResult();
+    return rootApp ? AttributeRenderToRootApps(result) : result;
+  };
+  return QueueExecutorPromise<RenderProcessResult>(
+      info.Env(), EXECUTOR_INTERACTIVE, "getProcessesAccessingSpeakersWithResultAsync", work,
+      renderResultToObject);
+}
+
 // Gets processes accessing microphone with debounced structured result
 Napi::Value GetProcessesAccessingMicrophoneDebouncedWithResult(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
   try {
-    AudioProcessResult result = GetProcessAccessMicrophoneDebouncedWithResult();
-
-    // Create a JavaScript object to represent the AudioProcessResult
-    Napi::Object resultObj = Napi::Object::New(env);
-    if (!result.success) {
-      // Set error information
-      resultObj.Set("success", Napi::Boolean::New(env, false));
-      resultObj.Set("error", Napi::String::New(env, result.errorMessage));
-      resultObj.Set("code", Napi::Number::New(env, result.errorCode));
-      resultObj.Set("domain", Napi::String::New(env, "AudioProcessMonitor"));
-      resultObj.Set("processes", Napi::Array::New(env));
-    } else {
-      // Set success information
-      resultObj.Set("success", Napi::Boolean::New(env, true));
-      resultObj.Set("error", env.Null());
-
-      // Convert processes array
-      Napi::Array processesArray = Napi::Array::New(env);
-      for (size_t i = 0; i < result.processes.size(); i++) {
-        processesArray.Set(i, Napi::String::New(env, result.processes[i]));
-      }
-      resultObj.Set("processes", processesArray);
+    DebounceConfig config = GetMicrophoneDebounceConfig();
+    if (info.Length() > 0 && info[0].IsObject()) {
+      config = ReadDebounceOptions(info[0].As<Napi::Object>(), config);
     }
-
-    return resultObj;
+    return audioResultToObject(env, GetProcessAccessMicrophoneDebouncedWithResult(config));
   } catch (const std::exception& e) {
     Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
     return env.Null();
@@ -175,14 +263,21 @@ Napi::Value GetProcessesAccessingMicrophoneDebouncedWithResult(const Napi::Callb
 }
 
 
+template <> struct MarshalFields<InstalledApp> {
+  static auto Get() {
+    return std::make_tuple(Marshal::Field("type", &InstalledApp::AppType),
+                           Marshal::Field("name", &InstalledApp::AppName),
+                           Marshal::Field("id", &InstalledApp::Id),
+                           Marshal::Field("version", &InstalledApp::Version));
+  }
+};
+
 static Napi::Object installedAppToObject(const Napi::Env& env, const InstalledApp& app) {
-    Napi::Object appObj = Napi::Object::New(env);
-    appObj.Set("type", Napi::String::New(env, app.AppType));
-    appObj.Set("name", Napi::String::New(env, app.AppName));
-    appObj.Set("id", Napi::String::New(env, app.Id));
-    appObj.Set("version", Napi::String::New(env, app.Version));
+  return Marshal::ToObject(env, app);
+}
 
-    return appObj;
+static Napi::Array installedAppsToArray(const Napi::Env& env, const std::vector<InstalledApp>& apps) {
+  return Marshal::ToArray(env, apps);
 }
 
 // Gets installed apps
@@ -190,22 +285,34 @@ Napi::Value ListInstalledAppsWindows(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
   try {
-    auto apps = ListInstalledApps();
-
-    Napi::Array result = Napi::Array::New(env);
-    auto index(0);
-    for (auto app : apps) {
-      result.Set(index, installedAppToObject(env, app));
-      index += 1;
-    }
-
-    return result;
+    return installedAppsToArray(env, ListInstalledApps());
   } catch (const std::exception& e) {
     Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
     return env.Null();
   }
 }
 
+// Promise-returning variant of listInstalledApps; the inventory query runs off
+// the JS thread, in the executor's bulk lane. {signal} cancels it until it starts.
+Napi::Value ListInstalledAppsAsyncWindows(const Napi::CallbackInfo& info) {
+  Napi::Object signal;
+  if (!ReadAbortSignal(info.Env(), info[0], &signal)) {
+    return info.Env().Null();
+  }
+  return QueueExecutorPromise<std::vector<InstalledApp>>(
+      info.Env(), EXECUTOR_BULK, "listInstalledAppsAsync",
+      []() {
+        // ListInstalledApps leaves the apartment it joined on every path. Its
+        // WinRT errors are not std::exceptions, so convert them to reject.
+        try {
+          return ListInstalledApps();
+        } catch (const winrt::hresult_error& e) {
+          throw std::runtime_error(winrt::to_string(e.message()));
+        }
+      },
+      installedAppsToArray, Napi::Object(), signal);
+}
+
 
 Napi::Value CurrentInstalledAppWindows(const Napi::CallbackInfo& info) {
     auto currentApp = CurrentApp();
@@ -252,39 +359,63 @@ Napi::Value RequestMicrophoneAccess(const Napi::CallbackInfo& info) {
 // Initialize the module exports
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
   Napi::Value (*getRunningProcessesFunc)(const Napi::CallbackInfo&) = GetRunningProcessesWindows;
+  Napi::Value (*getRunningProcessesAsyncFunc)(const Napi::CallbackInfo&) = GetRunningProcessesAsyncWindows;
   Napi::Value (*getRunningAppIDsFunc)(const Napi::CallbackInfo&) = GetRunningAppIdsWindows;
+  Napi::Value (*getRunningAppIDsAsyncFunc)(const Napi::CallbackInfo&) = GetRunningAppIdsAsyncWindows;
+  Napi::Value (*getRunningProcessesDeltaFunc)(const Napi::CallbackInfo&) = GetRunningProcessesDeltaWindows;
+  Napi::Value (*getProcessCacheStatsFunc)(const Napi::CallbackInfo&) = GetProcessCacheStatsWindows;
   Napi::Value (*originalAudioProcessesFunc)(const Napi::CallbackInfo&) = GetRunningInputAudioProcesses;
   Napi::Value (*microphoneAccessFunc)(const Napi::CallbackInfo&) = GetProcessesAccessingMicrophoneWithResult;
+  Napi::Value (*microphoneAccessAsyncFunc)(const Napi::CallbackInfo&) = GetProcessesAccessingMicrophoneWithResultAsync;
   Napi::Value (*microphoneDebouncedAccessFunc)(const Napi::CallbackInfo&) = GetProcessesAccessingMicrophoneDebouncedWithResult;
   Napi::Value (*renderProcessesFunc)(const Napi::CallbackInfo&) = GetRenderProcessesWithResult;
+  Napi::Value (*renderProcessesAsyncFunc)(const Napi::CallbackInfo&) = GetRenderProcessesWithResultAsync;
   Napi::Value (*listInstalledAppsFunc)(const Napi::CallbackInfo&) = ListInstalledAppsWindows;
+  Napi::Value (*listInstalledAppsAsyncFunc)(const Napi::CallbackInfo&) = ListInstalledAppsAsyncWindows;
   Napi::Value (*currentInstalledAppFunc)(const Napi::CallbackInfo&) = CurrentInstalledAppWindows;
   Napi::Value (*installMSIXAndRestartFunc)(const Napi::CallbackInfo&) = InstallMSIXAndRestartWindows;
   Napi::Value (*microphoneAuthStatusFunc)(const Napi::CallbackInfo&) = GetMicrophoneAuthorizationStatus;
   Napi::Value (*requestMicAccessFunc)(const Napi::CallbackInfo&) = RequestMicrophoneAccess;
 
   exports.Set("getRunningProcesses",
-              Napi::Function::New(env, getRunningProcessesFunc));
+              TimedFunction(env, "getRunningProcesses", getRunningProcessesFunc));
+  exports.Set("getRunningProcessesAsync",
+              TimedFunction(env, "getRunningProcessesAsync", getRunningProcessesAsyncFunc));
   exports.Set("getRunningAppIDs",
-              Napi::Function::New(env, getRunningProcessesFunc));
+              TimedFunction(env, "getRunningAppIDs", getRunningAppIDsFunc));
+  exports.Set("getRunningAppIDsAsync",
+              TimedFunction(env, "getRunningAppIDsAsync", getRunningAppIDsAsyncFunc));
+  exports.Set("getRunningProcessesDelta",
+              TimedFunction(env, "getRunningProcessesDelta", getRunningProcessesDeltaFunc));
+  exports.Set("getProcessCacheStats",
+              TimedFunction(env, "getProcessCacheStats", getProcessCacheStatsFunc));
   exports.Set("getRunningInputAudioProcesses",
-              Napi::Function::New(env, originalAudioProcessesFunc));
+              TimedFunction(env, "getRunningInputAudioProcesses", originalAudioProcessesFunc));
   exports.Set("getProcessesAccessingMicrophoneWithResult",
-              Napi::Function::New(env, microphoneAccessFunc));
+              TimedFunction(env, "getProcessesAccessingMicrophoneWithResult", microphoneAccessFunc));
+  exports.Set("getProcessesAccessingMicrophoneWithResultAsync",
+              TimedFunction(env, "getProcessesAccessingMicrophoneWithResultAsync", microphoneAccessAsyncFunc));
   exports.Set("getProcessesAccessingMicrophoneDebouncedWithResult",
-              Napi::Function::New(env, microphoneDebouncedAccessFunc));
+              TimedFunction(env, "getProcessesAccessingMicrophoneDebouncedWithResult", microphoneDebouncedAccessFunc));
   exports.Set("getProcessesAccessingSpeakersWithResult",
-              Napi::Function::New(env, renderProcessesFunc));
+              TimedFunction(env, "getProcessesAccessingSpeakersWithResult", renderProcessesFunc));
+  exports.Set("getProcessesAccessingSpeakersWithResultAsync",
+              TimedFunction(env, "getProcessesAccessingSpeakersWithResultAsync", renderProcessesAsyncFunc));
   exports.Set("listInstalledApps",
-              Napi::Function::New(env, listInstalledAppsFunc));
+              TimedFunction(env, "listInstalledApps", listInstalledAppsFunc));
+  exports.Set("listInstalledAppsAsync",
+              TimedFunction(env, "listInstalledAppsAsync", listInstalledAppsAsyncFunc));
   exports.Set("currentInstalledApp",
-              Napi::Function::New(env, currentInstalledAppFunc));
+              TimedFunction(env, "currentInstalledApp", currentInstalledAppFunc));
   exports.Set("installMSIXAndRestart",
-              Napi::Function::New(env, installMSIXAndRestartFunc));
+              TimedFunction(env, "installMSIXAndRestart", installMSIXAndRestartFunc));
   exports.Set("getMicrophoneAuthorizationStatus",
-              Napi::Function::New(env, microphoneAuthStatusFunc));
+              TimedFunction(env, "getMicrophoneAuthorizationStatus", microphoneAuthStatusFunc));
   exports.Set("requestMicrophoneAccess",
-              Napi::Function::New(env, requestMicAccessFunc));
+              TimedFunction(env, "requestMicrophoneAccess", requestMicAccessFunc));
+
+  NativeStatsInit(env, exports);
+  ExecutorInit(env, exports);
 
   return exports;
 }